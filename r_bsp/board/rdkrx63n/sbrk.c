@@ -25,6 +25,7 @@
 /***********************************************************************************************************************
 * History : DD.MM.YYYY Version  Description
 *         : 26.10.2011 1.00     First Release
+*         : 19.10.2026 1.01     Added sbrk_used()
 ***********************************************************************************************************************/
 /***********************************************************************************************************************
 Includes   <System Includes> , "Project Includes"
@@ -47,6 +48,8 @@ Function Prototypes
 ***********************************************************************************************************************/
 /* Memory allocation function prototype declaration */
 int8_t  *sbrk(size_t size);
+/* Heap high-water mark prototype declaration */
+size_t  sbrk_used(void);
 
 /***********************************************************************************************************************
 Global Variables
@@ -94,3 +97,15 @@ int8_t  *sbrk(size_t size)
     /* Return result */
     return p;
 }
+
+/***********************************************************************************************************************
+* Function name: sbrk_used
+* Description  : Returns the size of the area already assigned by sbrk. The area is never given back, so this is also
+*                the high-water mark of the heap.
+* Arguments    : none
+* Return value : Assigned size in bytes (at most HEAPSIZE)
+***********************************************************************************************************************/
+size_t  sbrk_used(void)
+{
+    return (size_t)(brk - heap_area.heap);
+}
@@ -24,6 +24,7 @@
 /***********************************************************************************************************************
 * History : DD.MM.YYYY Version  Description
 *         : 26.10.2011 1.00     First Release
+*         : 19.10.2026 1.01     Added sbrk_used()
 ***********************************************************************************************************************/
 
 /***********************************************************************************************************************
@@ -33,9 +34,21 @@ Macro definitions
 #ifndef SBRK_H
 #define SBRK_H
 
+/***********************************************************************************************************************
+Includes   <System Includes> , "Project Includes"
+***********************************************************************************************************************/
+/* Defines size_t */
+#include <stddef.h>
+
 /* Size of area managed by sbrk */
 #define HEAPSIZE 0x400
 
+/***********************************************************************************************************************
+Exported global functions (to be accessed by other files)
+***********************************************************************************************************************/
+/* Heap high-water mark (bytes assigned by sbrk) */
+size_t  sbrk_used(void);
+
 
 /* End of mutliple inclusion prevention macro */
 #endif
\ No newline at end of file
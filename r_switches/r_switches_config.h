@@ -23,6 +23,7 @@
 ************************************************************************************************************************
 * History : DD.MM.YYYY Version Description           
 *         : 17.01.2012 1.00    First Release            
+*         : 19.10.2026 1.10    Both-edge detection option, IMU_switch callbacks
 ***********************************************************************************************************************/
 #ifndef SWITCHES_CONFIG_HEADER_FILE
 #define SWITCHES_CONFIG_HEADER_FILE
@@ -38,8 +39,12 @@ Configuration Options
    Example: If SW1_CALLBACK_FUNCTION is defined to be sw1_callback then the sw1_callback function will be called when 
    switch 1 is pressed.   
 */
-#define SW1_CALLBACK_FUNCTION       (sw1_callback)
-#define SW2_CALLBACK_FUNCTION       (sw2_callback)
-#define SW3_CALLBACK_FUNCTION       (sw3_callback)
+#define SW1_CALLBACK_FUNCTION       (IMU_switch_sw1)
+#define SW2_CALLBACK_FUNCTION       (IMU_switch_sw2)
+#define SW3_CALLBACK_FUNCTION       (IMU_switch_sw3)
+
+/* IRQ detection of the switch pins: 0x01 = falling edge (press), 0x03 = both edges (press and release). Both edges
+   let the callbacks timestamp every transition and debounce in software (IMU_switch.c). */
+#define SWITCHES_IRQ_DETECTION      (0x03)
 
 #endif /* SWITCHES_CONFIG_HEADER_FILE */
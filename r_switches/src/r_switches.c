@@ -23,6 +23,7 @@
 ************************************************************************************************************************
 * History : DD.MM.YYYY Version Description           
 *         : 17.01.2012 1.00    First Release            
+*         : 19.10.2026 1.10    IRQ detection from SWITCHES_IRQ_DETECTION
 ***********************************************************************************************************************/
 
 /***********************************************************************************************************************
@@ -226,10 +227,16 @@ void R_SWITCHES_Init(void)
 #endif
 
 
-    /* Set IRQ type (falling edge) */
+    /* Set IRQ type (falling edge unless configured otherwise) */
+#if defined(SWITCHES_IRQ_DETECTION)
+    ICU.IRQCR[SW1_IRQ_NUMBER].BIT.IRQMD  = SWITCHES_IRQ_DETECTION;
+    ICU.IRQCR[SW2_IRQ_NUMBER].BIT.IRQMD  = SWITCHES_IRQ_DETECTION;
+    ICU.IRQCR[SW3_IRQ_NUMBER].BIT.IRQMD  = SWITCHES_IRQ_DETECTION;
+#else
     ICU.IRQCR[SW1_IRQ_NUMBER].BIT.IRQMD  = 0x01; 
     ICU.IRQCR[SW2_IRQ_NUMBER].BIT.IRQMD  = 0x01; 
     ICU.IRQCR[SW3_IRQ_NUMBER].BIT.IRQMD  = 0x01; 
+#endif
     
     /* Set interrupt priority to 3 */
     _IPR( X_IRQ(SW1_IRQ_NUMBER) ) = 3;
@@ -257,7 +264,7 @@ void R_SWITCHES_Init(void)
 #pragma interrupt (sw1_isr (vect=_VECT(X_IRQ(SW1_IRQ_NUMBER))))
 static void sw1_isr (void) 
 {
-    /* TODO: Add some debouncing! */
+    /* No debouncing here: the callback gets every edge (see SWITCHES_IRQ_DETECTION). */
 
     /* Call callback function. */
     SW1_CALLBACK_FUNCTION();    
@@ -274,7 +281,7 @@ static void sw1_isr (void)
 #pragma interrupt (sw2_isr (vect=_VECT(X_IRQ(SW2_IRQ_NUMBER))))
 static void sw2_isr (void) 
 {
-    /* TODO: Add some debouncing! */
+    /* No debouncing here: the callback gets every edge (see SWITCHES_IRQ_DETECTION). */
 
     /* Call callback function. */
     SW2_CALLBACK_FUNCTION();    
@@ -291,7 +298,7 @@ static void sw2_isr (void)
 #pragma interrupt (sw3_isr (vect=_VECT(X_IRQ(SW3_IRQ_NUMBER))))
 static void sw3_isr (void) 
 {
-    /* TODO: Add some debouncing! */
+    /* No debouncing here: the callback gets every edge (see SWITCHES_IRQ_DETECTION). */
     
     /* Call callback function. */
     SW3_CALLBACK_FUNCTION();    
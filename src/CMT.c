@@ -28,6 +28,7 @@
 /*******************************************************************************
 * History : DD.MM.YYYY     Version     Description
 *         : 16.02.2012     1.00        First release
+*         : 19.10.2026     1.10        Tick callback
 *******************************************************************************/
 
 /******************************************************************************
@@ -101,6 +102,59 @@ void CMT_init (void)
 } /* End of function CMT_init() */
 
 
+/*******************************************************************************
+* Function name: CMT_counter_init
+* Description  : Sets up CMT1 as a free running 16-bit counter, without
+*                interrupts, used to measure the execution time of code.
+*                One count is CMT_COUNTER_CYCLES CPU clock cycles, the counter
+*                wraps around every 65536 counts (10.9 ms)
+* Arguments    : none
+* Return value : none
+*******************************************************************************/
+void CMT_counter_init (void)
+{
+#ifdef PLATFORM_BOARD_RDKRX63N
+	SYSTEM.PRCR.WORD = 0xA50B; /* Protect off */
+#endif
+
+    /* Power up CMT1 */
+    MSTP(CMT1) = 0;
+
+#ifdef PLATFORM_BOARD_RDKRX63N
+	SYSTEM.PRCR.WORD = 0xA500; /* Protect on  */
+#endif
+
+    /* Stop the clock */
+    CMT.CMSTR0.BIT.STR1 = 0;
+
+    /* CMCR - Compare Match Timer Control Register
+    b6      CMIE: 0 = Compare match interrupt (CMIn) disabled
+    b1:b0   CKS:  0 = Clock selects is PCLK/8 (6 MHz @ PCLK = 48 MHz)
+    */
+    CMT1.CMCR.WORD = 0x0000;
+
+    /* Count over the full 16-bit range */
+    CMT1.CMCOR = 0xFFFF;
+    CMT1.CMCNT = 0;
+
+    /* Start the clock running */
+    CMT.CMSTR0.BIT.STR1 = 1;
+} /* End of function CMT_counter_init() */
+
+
+/*******************************************************************************
+* Function name: CMT_counter
+* Description  : Reads the CMT1 counter. The difference of two readings,
+*                computed in uint16_t, is valid across one wrap around
+* Arguments    : none
+* Return value : counter value
+*******************************************************************************/
+uint16_t CMT_counter (void)
+{
+    return CMT1.CMCNT;
+} /* End of function CMT_counter() */
+
+
 /*******************************************************************************
 * Function name: CMT_isr
 * Description  : Interrupt Service Routine for CMT match interrupt.
@@ -119,5 +173,9 @@ void CMT_init (void)
 static void CMT_isr (void)
 {
     millis++;
+
+#if defined(CMT_TICK_CALLBACK_FUNCTION)
+    CMT_TICK_CALLBACK_FUNCTION();
+#endif
 } /* End of CMT_isr() */
 
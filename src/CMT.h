@@ -28,16 +28,33 @@
 /*******************************************************************************
 * History : DD.MM.YYYY     Version     Description
 *         : 19.01.2012     1.00        First release
+*         : 19.10.2026     1.10        Tick callback
 *******************************************************************************/
 
 #ifndef _CMT_H_             /* Multiple inclusion prevention. */
 #define _CMT_H_
 
+/*******************************************************************************
+Macro definitions
+*******************************************************************************/
+/* CPU clock cycles per count of CMT_counter() (ICLK 96 MHz, PCLK/8 = 6 MHz) */
+#define CMT_COUNTER_CYCLES  16
+
+/* Function called from the 1 ms CMT0 interrupt after millis is updated
+   (switch debouncing). It runs in the interrupt: keep it short */
+#define CMT_TICK_CALLBACK_FUNCTION  (IMU_switch_tick)
+
 /*******************************************************************************
 Prototypes for exported functions
 *******************************************************************************/
 void CMT_init (void) ;
 int32_t get_ms();
 void ms_delay(int32_t t);
+void CMT_counter_init (void);
+uint16_t CMT_counter (void);
+
+#if defined(CMT_TICK_CALLBACK_FUNCTION)
+void CMT_TICK_CALLBACK_FUNCTION (void);
+#endif
 
 #endif                       /* Multiple inclusion prevention. */
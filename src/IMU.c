@@ -12,506 +12,958 @@ Includes: <System Includes> , "Project Includes"
 #include "platform.h"
 #include "CMT.h"
 #include "IMU.h"
+#include "IMU_regmap.h"
+#include "IMU_bias.h"
+#include "IMU_temp.h"
+#include "IMU_calib.h"
+#include "IMU_dmp.h"
+#include "IMU_ring.h"
+#include "IMU_state.h"
+#include "IMU_math.h"
+#include "IMU_filter.h"
+#include "IMU_decim.h"
+#include "IMU_power.h"
+#include "IMU_mag.h"
+#include "IMU_log.h"
 #include "r_riic_rx600.h"
-#include "r_riic_rx600_master.h"
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+/* Tolleranze del voting, modificabili a runtime (IMU_param) */
+float IMU_vote_angle_tol = IMU_VOTE_ANGLE_TOL_RAD;
+float IMU_vote_omega_tol = IMU_VOTE_OMEGA_TOL_RAD;
+
+/*******************************************************************************
+Definizione strutture
+*******************************************************************************/
+/* Code dei consumatori dei campioni grezzi (fusione, telemetria, ...) */
+static IMU_ring_struct *IMU_sample_ring[IMU_MAX_RINGS];
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static riic_ret_t Accel_init (IMU_dev_struct *dev);
+static riic_ret_t Gyro_init (IMU_dev_struct *dev);
+static riic_ret_t IMU_config (IMU_dev_struct *dev);
+static void IMU_vote_load (const IMU_data_struct *x, float *val);
+static float IMU_median (float *val, uint8_t n);
 
 /*******************************************************************************
 * Nome funzione     : IMU_init
-* Descrizione  	    : Inizializza l'IMU
-* Argomenti         : (IMU_data struct) *x -
-* 						puntatore alla struttura dell'IMU
+* Descrizione  	    : Inizializza tutti i sensori. Un sensore che non risponde
+* 					  viene lasciato escluso dal voting
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						vettore degli handle dei sensori (canale e indirizzo
+* 						gia' impostati)
+* 					  (uint8_t) num_dev -
+* 					  	numero di sensori
 * Valori restituiti : No
 *******************************************************************************/
-void IMU_init(IMU_data_struct *x)
+void IMU_init(IMU_dev_struct *dev, uint8_t num_dev)
 {
 	/* Definisce le variabili locali */
-    uint8_t target_data = 0;
-    riic_ret_t ret = RIIC_OK;
+	uint8_t i;
 
     /* Inizializza il CMT */
     CMT_init();
 
+    /* Inizializza i sensori uno alla volta */
+    for (i = 0; i < num_dev; i++)
+    {
+    	IMU_dev_init(&dev[i]);
+    }
+
+} /* Fine IMU_init() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_dev_init
+* Descrizione  	    : Inizializza e calibra un singolo sensore
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						handle del sensore
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato dell'inizializzazione
+*******************************************************************************/
+riic_ret_t IMU_dev_init(IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+    uint8_t target_data = 0;
+    riic_ret_t ret = RIIC_OK;
+
+    dev->ready = false;
+    dev->online = false;
+    dev->recovery_count = 0;
+    memset(&dev->stats, 0, sizeof(dev->stats));
+    memset(&dev->raw, 0, sizeof(dev->raw));
+    memset(&dev->power, 0, sizeof(dev->power));
+    memset(&dev->mag, 0, sizeof(dev->mag));
+
     /* Inizializza l'IIC */
-	R_RIIC_Init(&riic_master_config);
+    ret = IMU_bus_init(dev->channel);
+    if (RIIC_OK != ret) {
+    	return ret;
+    }
 
 	/* Resetta l'IMU (si assicura che il bit dello stato precedente non sia presente) */
-    do
-    {
-		target_data = INV_MPU6050_BIT_H_RESET;
-		ret = IMU_write(CHANNEL_0, MPU_ADDRESS, INV_MPU6050_REG_PWR_MGMT_1, &target_data, 1);
+	IMU_reg_reset_shadow(dev);
+	ret = IMU_reg_write(dev, INV_MPU6050_REG_PWR_MGMT_1, INV_MPU6050_BIT_H_RESET);
+	if (RIIC_OK != ret) {
+		return ret;
+	}
+
+    /* Verifica che all'indirizzo ci sia davvero un MPU-6050 (WHO_AM_I non dipende da AD0) */
+    ms_delay(INV_MPU6050_POWER_UP_TIME);
+    ret = IMU_read(dev, INV_MPU6050_REG_WHO_AM_I, &target_data, 1);
+    if (RIIC_OK != ret) {
+    	return ret;
+    }
+    if ((target_data & 0x7E) != INV_MPU6050_DEVICE_ID) {
+    	return RIIC_NO_DEVICE_FOUND;
+    }
 
-    } while(RIIC_OK != ret);
+    /* Allinea la copia locale allo stato reale dei registri dopo il reset */
+    ret = IMU_reg_load(dev);
+    if (RIIC_OK != ret) {
+    	return ret;
+    }
 
     /* Disattiva/Attiva lo stato di alimentazione (dopo il reset, il bit di sospensione
      potrebbe essere acceso o spento a seconda delle impostazioni OTP) */
+    ret = IMU_set_power(dev, false);
+    if (RIIC_OK != ret) {
+    	return ret;
+    }
+
     ms_delay(INV_MPU6050_POWER_UP_TIME);
-    do
-    {
-		ret = IMU_set_power(false);
+    ret = IMU_set_power(dev, true);
+    if (RIIC_OK != ret) {
+    	return ret;
+    }
 
-    } while(RIIC_OK != ret);
+    /* Configura l'IMU */
+    ret = IMU_config(dev);
+    if (RIIC_OK != ret) {
+    	return ret;
+    }
 
-    ms_delay(INV_MPU6050_POWER_UP_TIME);
-    do
-    {
-		ret = IMU_set_power(true);
+    /* Senza un modello caricato usa quello ideale */
+    if (!dev->calib.loaded) {
+    	IMU_calib_set_model(dev, 0, 0);
+    }
 
-    } while(RIIC_OK != ret);
+    /* Da qui il sensore puo' essere letto */
+    dev->ready = true;
 
-    /* Configura l'IMU */
-    do
-    {
-		ret = IMU_config();
+    return IMU_dev_calibrate(dev);
+
+} /* Fine IMU_dev_init() */
 
-    } while(RIIC_OK != ret);
+/*******************************************************************************
+* Nome funzione     : IMU_dev_calibrate
+* Descrizione  	    : Misura livellamento e offset con il robot fermo in piedi
+* 					  e riavvia la stima continua del bias. Va ripetuta dopo
+* 					  aver cambiato il modello di calibrazione. Bloccante
+* 					  (circa 220 periodi di campionamento): nel ciclo
+* 					  principale si usano IMU_dev_calibrate_start e
+* 					  IMU_dev_calibrate_step
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						handle del sensore
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della calibrazione
+*******************************************************************************/
+riic_ret_t IMU_dev_calibrate(IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	int32_t period = INV_MPU6050_ONE_K_HZ / dev->config.rate_hz;
 
-    /* Inizializza l'accelerometro */
-    Accel_init(x);
+	IMU_dev_calibrate_start(dev);
+	do
+	{
+		ms_delay(period);
+		IMU_dev_sample(dev);
+	} while (IMU_dev_calibrate_step(dev));
 
-    /* Inizializza il giroscopio */
-    Gyro_init(x);
+	return (riic_ret_t)dev->recal.result;
 
-} /* Fine IMU_init() */
+} /* Fine IMU_dev_calibrate() */
 
 /*******************************************************************************
-* Nome funzione     : IMU_result
-* Descrizione  	    : Acquisice i dati dall'IMU
-* Argomenti         : (IMU_data struct) *x -
-* 						puntatore alla struttura dell'IMU
+* Nome funzione     : IMU_dev_calibrate_start
+* Descrizione  	    : Avvia la calibrazione a passi: il sensore esce dal
+* 					  voting e il livellamento viene tolto, perche' la gravita'
+* 					  si misura negli assi del sensore calibrato
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						handle del sensore
 * Valori restituiti : No
 *******************************************************************************/
-void IMU_result(IMU_data_struct *x)
+void IMU_dev_calibrate_start(IMU_dev_struct *dev)
 {
-	/* Definisce le variabili locali */
-	uint8_t data[6];
-	int16_t raw_data[6];
-	float ax, ay, az, gx, gy, gz;
+	dev->ready = true;
+	dev->online = false;
+	IMU_calib_set_level(dev, 0);
 
-	/* Legge i valori dall'accelerometro */
-	IMU_read(RIIC_CHANNEL, MPU_ADDRESS, INV_MPU6050_REG_RAW_ACCEL_X, data, 6);
+	/* Con il nuovo livellamento il DMP rimisura la posizione di riposo */
+	dev->dmp.off_valid = false;
 
-	/* Esegue il masking (unisce gli 8 bit trasmessi tramite IIC di ogni componente in un vettore di 6 elementi ognuno
-	 di 16 bit. Esegue lo shift degli 8 bit verso sinistra e, con un AND bit a  bit ("&"), ottiene una variabile i cui
-	 primi 8 bit sono uguali a data[0] e gli ultimi 8 sono 0. Siamo sicuri di  questo grazie all'AND eseguito
-	 con 0xFF00 (0xFF00 = 11111111 00000000). Poi con un OR bit a bit ("|") ottiene il valore unito e completo in
-	 un unica cella di memoria da 16 bit) */
-	raw_data[0] = (int16_t)((((uint16_t)data[0]) << 8) & 0xFF00);
-	raw_data[0] |= data[1]; /*raw_data[0] ora contiene il dato grezzo letto del registro x dell'accelerometro */
+	memset(&dev->recal, 0, sizeof(dev->recal));
+	dev->recal.phase = IMU_RECAL_ACCEL_SETTLE;
+	dev->recal.last_sample = dev->stats.samples;
 
-	raw_data[1] = (int16_t)((((uint16_t)data[2]) << 8) & 0xFF00);
-	raw_data[1] |= data[3]; /*raw_data[1] ora contiene il dato grezzo letto del registro y dell'accelerometro */
+} /* Fine IMU_dev_calibrate_start() */
 
-	raw_data[2] = (int16_t)((((uint16_t)data[4]) << 8) & 0xFF00);
-	raw_data[2] |= data[5]; /*raw_data[2] ora contiene il dato grezzo letto del registro z dell'accelerometro */
+/*******************************************************************************
+* Nome funzione     : IMU_dev_calibrate_step
+* Descrizione  	    : Un passo della calibrazione, una volta per periodo di
+* 					  campionamento dopo la lettura del sensore: usa il
+* 					  campione nuovo (un passo senza campione conta come una
+* 					  lettura fallita). Ogni fase dura un numero fisso di
+* 					  passi: letture a vuoto e letture sommate
+* 					  dell'accelerometro, poi del giroscopio. Alla fine il
+* 					  sensore torna nel voting se la calibrazione e' riuscita
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						handle del sensore
+* Valori restituiti : (bool) -
+* 						 true finche' la calibrazione e' in corso; l'esito e'
+* 						 in recal.result
+*******************************************************************************/
+bool IMU_dev_calibrate_step(IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	IMU_recal_struct *r = &dev->recal;
+	riic_ret_t ret = RIIC_OK;
+	float v[3];
+	bool fresh;
+	uint8_t k;
+
+	if (IMU_RECAL_IDLE == r->phase) {
+		return false;
+	}
 
-	/* Calibra i valori sulla sensitività scelta per l'accelerometro */
-	ax = (float)raw_data[0]/16384;
-	ay = (float)raw_data[1]/16384;
-	az = (float)raw_data[2]/16384;
+	fresh = (r->last_sample != dev->stats.samples);
+	r->last_sample = dev->stats.samples;
 
-	/* Calcola gli angoli */
-	x->RollRad  = atanf(ay/sqrtf(ax*ax + az*az));
-	x->PitchRad = atanf(-ax/sqrtf(ay*ay+az*az));
-	x->YawRad  =  atanf(az/sqrtf(ax*ax + ay*ay));
+	/* Somma i campioni calibrati (accelerometro senza livellamento, giroscopio gia' livellato) */
+	if (fresh && ((IMU_RECAL_ACCEL == r->phase) || (IMU_RECAL_GYRO == r->phase)))
+	{
+		if (IMU_RECAL_ACCEL == r->phase) {
+			IMU_calib_accel(dev, v);
+		}
+		else {
+			IMU_calib_gyro(dev, v);
+		}
+		for (k = 0; k < 3; k++) {
+			r->sum[k] += v[k];
+		}
+		r->valid++;
+	}
+
+	r->count++;
+	if (r->count < (((IMU_RECAL_ACCEL_SETTLE == r->phase) || (IMU_RECAL_GYRO_SETTLE == r->phase)) ?
+					IMU_RECAL_SETTLE_READS : IMU_RECAL_READS)) {
+		return true;
+	}
+
+	/* Fine della fase */
+	if (IMU_RECAL_ACCEL == r->phase) {
+		ret = Accel_init(dev);
+	}
+	else if (IMU_RECAL_GYRO == r->phase)
+	{
+		ret = Gyro_init(dev);
+
+		/* Avvia la stima continua del bias a partire dagli offset appena misurati */
+		if (RIIC_OK == ret) {
+			ret = IMU_bias_init(dev);
+		}
+	}
 
-	/* Calibra gli angoli (rad) sottraendo l'offset e li memorizza nella struttura */
-	x->RollRad  = x->RollRad  -  x->off_RollRad;
-	x->PitchRad = x->PitchRad -  x->off_PitchRad;
-	x->YawRad   = x->YawRad   -  x->off_YawRad;
+	/* Prossima fase */
+	if ((RIIC_OK == ret) && (IMU_RECAL_GYRO != r->phase))
+	{
+		r->phase++;
+		r->count = 0;
+		r->valid = 0;
+		for (k = 0; k < 3; k++) {
+			r->sum[k] = 0.0f;
+		}
+		return true;
+	}
 
-	/* Converte gli angoli in gradi e li memorizza nella struttura */
-	x->RollDeg  = x->RollRad  * (180.0/M_PI);
-	x->PitchDeg = x->PitchRad * (180.0/M_PI);
-	x->YawDeg   = x->YawRad   * (180.0/M_PI);
+	/* Un sensore non calibrato non partecipa al voting */
+	r->phase = IMU_RECAL_IDLE;
+	r->result = (uint16_t)ret;
+	dev->ready = (RIIC_OK == ret);
+	dev->online = (RIIC_OK == ret);
 
-	/* Legge i valori dal giroscopio */
-	IMU_read(RIIC_CHANNEL, MPU_ADDRESS, INV_MPU6050_REG_RAW_GYRO_X, data, 6);
+	return false;
 
-	/* Esegue il masking */
-	raw_data[3] = (int16_t)((((uint16_t)data[0]) << 8) & 0xFF00);
-	raw_data[3] |= data[1];  /*raw_data[3] ora contiene il dato grezzo del registro x del giroscopio*/
+} /* Fine IMU_dev_calibrate_step() */
 
-	raw_data[4] = (int16_t)((((uint16_t)data[2]) << 8) & 0xFF00);
-	raw_data[4] |= data[3]; /*raw_data[4] ora contiene il dato grezzo del registro y del giroscopio*/
+/*******************************************************************************
+* Nome funzione     : IMU_result
+* Descrizione  	    : Acquisisce i dati da tutti i sensori e ne fonde i risultati.
+* 					  Le letture sono eseguite una dopo l'altra prima di ogni
+* 					  elaborazione, cosi' tutti i sensori campionano nello
+* 					  stesso slot
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						vettore degli handle dei sensori
+* 					  (uint8_t) num_dev -
+* 					  	numero di sensori
+* 					  (IMU_data struct) *x -
+* 						puntatore alla struttura con il risultato fuso
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_result(IMU_dev_struct *dev, uint8_t num_dev, IMU_data_struct *x)
+{
+	/* Definisce le variabili locali */
+	IMU_attitude_struct attitude;
+	uint8_t i;
 
-	raw_data[5] = (int16_t)((((uint16_t)data[4]) << 8) & 0xFF00);
-	raw_data[5] |= data[5]; /*raw_data[5] ora contiene il dato grezzo del registro z del giroscopio*/
+	/* Legge i campioni grezzi da tutti i sensori e li accoda per i consumatori;
+	 un sensore in wake-on-motion viene solo controllato e si risveglia da se' */
+	for (i = 0; i < num_dev; i++)
+	{
+		IMU_power_poll(&dev[i]);
+		if (RIIC_OK == IMU_dev_sample(&dev[i])) {
+			IMU_publish_sample(&dev[i], i);
+		}
+	}
 
-	/* Calibra i valori sulla sensitività scelta per il giroscopio */
-	gx = (float)raw_data[3]/131;
-	gy = (float)raw_data[4]/131;
-	gz = (float)raw_data[5]/131;
+	/* Aggiorna il bias ed elabora i campioni dei sensori attivi */
+	for (i = 0; i < num_dev; i++)
+	{
+		if (dev[i].online)
+		{
+			/* Con il giroscopio in standby non c'e' bias da stimare */
+			if (IMU_POWER_FULL == dev[i].power.state) {
+				IMU_bias_update(&dev[i]);
+			}
+
+			/* Quaternioni del DMP: con un quaternione valido sostituiscono
+			 la fusione sull'MCU (IMU_dev_process) */
+			if (dev[i].dmp.enabled) {
+				IMU_dmp_read(&dev[i]);
+			}
+			IMU_dev_process(&dev[i]);
+		}
+	}
 
-	/* Calibra le velocità angolari (grad/s) sottraendo l'offset e le memorizza nella struttura */
-	x->omegaRollDeg  = gx - x->off_omegaRollDeg;
-	x->omegaPitchDeg = gy - x->off_omegaPitchDeg;
-	x->omegaYawDeg   = gz - x->off_omegaYawDeg;
+	/* Fonde i risultati */
+	attitude.sensors = IMU_vote(dev, num_dev, x);
 
-	/* Converte le velocità angolari in rad/s e le memorizza nella struttura */
-	x->omegaRollRad  = x->omegaRollDeg  * (M_PI/180.0);
-	x->omegaPitchRad = x->omegaPitchDeg * (M_PI/180.0);
-	x->omegaYawRad   = x->omegaYawDeg   * (M_PI/180.0);
+	/* Pubblica l'assetto fuso per i lettori (display, telemetria, controllo) */
+	attitude.timestamp = get_ms();
+	for (i = 0; i < 3; i++)
+	{
+		attitude.angle[i] = x->angle[i];
+		attitude.omega[i] = x->omega[i];
+	}
+	IMU_state_publish(&IMU_state, &attitude);
 
 } /* Fine IMU_result() */
 
 /*******************************************************************************
-* Nome funzione     : IMU_write
-* Descrizione  	    : Scrive un numero specifico di byte sull'IMU
-* Argomenti         : (uint8_t) riic_channel -
-* 					  	 quale canale iic deve usare il microcontrollore
-* 					  (uint8_t) slave_addr -
-* 					  	 indirizzo slave
-* 					  (uint8_t) register_number -
-* 					  	 registro slave su cui scrive il master
-* 					  (uint8_t) *source_buff -
-* 					  	 puntatore al vettore da cui vengono copiati i dati
-* 					  	 da scrivere
-* 					  (uint32_t) num_byte -
-* 					     numero di byte da scrivere
-* Valori restituiti : (riic_ret_t) ret -
-* 						 risultato della comunicazione
+* Nome funzione     : IMU_attach_ring
+* Descrizione  	    : Registra la coda di un consumatore dei campioni grezzi.
+* 					  Ogni coda ha un solo consumatore; il produttore e' chi
+* 					  chiama IMU_publish_sample
+* Argomenti         : (IMU_ring_struct) *ring -
+* 						coda gia' inizializzata
+* Valori restituiti : (bool) -
+* 						false se sono gia' registrate IMU_MAX_RINGS code
 *******************************************************************************/
-static riic_ret_t IMU_write (uint8_t riic_channel, uint8_t slave_addr, uint8_t register_number, uint8_t *source_buff, uint32_t num_bytes)
+bool IMU_attach_ring(IMU_ring_struct *ring)
 {
 	/* Definisce le variabili locali */
-    uint8_t   addr_and_register[2]={slave_addr, register_number};
-    riic_ret_t  ret = RIIC_OK;
+	uint8_t i;
 
+	for (i = 0; i < IMU_MAX_RINGS; i++)
+	{
+		if (0 == IMU_sample_ring[i])
+		{
+			IMU_sample_ring[i] = ring;
+			return true;
+		}
+	}
 
-    /* Il master trasmette indirizzo e numero di registro dello slave su cui vuole scrivere */
-    ERR_COUNT=0;
-    ret |= R_RIIC_MasterTransmitHead(CHANNEL_0, addr_and_register, 2);
+	return false;
 
-    /* Controlla se si sono verificati errori */
-    if(ret != RIIC_OK)
-    {
-    	ERROR_HEAD_WRITE = 1;
-    	ERR_COUNT++;
-    	if (ERR_COUNT == 50) return ret;
-    	IMU_write (riic_channel, slave_addr, register_number, source_buff, num_bytes);
-    }
+} /* Fine IMU_attach_ring() */
 
-    /* Il master trasmette i dati presi dal source_buff sul registro */
-    ERR_COUNT=0;
-    ret |= R_RIIC_MasterTransmit(CHANNEL_0, source_buff, num_bytes);
+/*******************************************************************************
+* Nome funzione     : IMU_publish_sample
+* Descrizione  	    : Accoda l'ultimo campione del sensore, con l'istante di
+* 					  acquisizione, in tutte le code registrate
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						handle del sensore
+* 					  (uint8_t) sensor -
+* 					  	indice del sensore
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_publish_sample(IMU_dev_struct *dev, uint8_t sensor)
+{
+	/* Definisce le variabili locali */
+	IMU_sample_struct sample;
+	uint8_t i;
 
-    /* Controlla se si sono verificati errori */
-    if(ret != RIIC_OK) {
-    	ERROR_WRITE = 1;
-    	ERR_COUNT++;
-    	if (ERR_COUNT == 50) return ret;
-    	IMU_write (riic_channel, slave_addr, register_number, source_buff, num_bytes);
-    }
+	sample.timestamp = get_ms();
+	sample.sensor = sensor;
+	sample.raw = dev->raw;
 
-    return ret;
+	for (i = 0; i < IMU_MAX_RINGS; i++)
+	{
+		if (0 != IMU_sample_ring[i]) {
+			IMU_ring_push(IMU_sample_ring[i], &sample);
+		}
+	}
 
-} /* Fine IMU_write() */
+} /* Fine IMU_publish_sample() */
 
 /*******************************************************************************
-* Nome funzione     : IMU_read
-* Descrizione  	    : Legge un numero specifico di byte dall'IMU
-* Argomenti         : (uint8_t) riic_channel -
-* 					  	 quale canale iic deve usare il microcontrollore
-* 					  (uint8_t) slave_addr -
-* 					  	 indirizzo slave
-* 					  (uint8_t) register_number -
-* 					  	 registro slave da cui legge il master
-* 					  (uint8_t) *dest_buff -
-* 					  	 puntatore al vettore su cui vengono copiati i dati
-* 					  	 letti
-* 					  (uint32_t) num_byte -
-* 					  	 numero di byte da leggere
+* Nome funzione     : IMU_dev_sample
+* Descrizione  	    : Legge accelerometro, temperatura e giroscopio con una
+* 					  sola transazione e aggiorna lo stato di salute del sensore
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						handle del sensore
 * Valori restituiti : (riic_ret_t) ret -
-* 						 risultato della comunicazione
+* 						 risultato della lettura
 *******************************************************************************/
-static riic_ret_t IMU_read(uint8_t riic_channel, uint8_t slave_addr, uint8_t register_number, uint8_t *dest_buff, uint32_t num_bytes)
+riic_ret_t IMU_dev_sample(IMU_dev_struct *dev)
 {
 	/* Definisce le variabili locali */
-	riic_ret_t  ret = RIIC_OK;
-	uint8_t     addr_and_register[2] = {slave_addr, register_number};
+	uint8_t data[IMU_BURST_BYTES + IMU_MAG_BYTES];
+	IMU_raw_struct raw;
+	riic_ret_t ret;
 
+	/* Un sensore mai inizializzato non viene letto */
+	if (!dev->ready) {
+		return RIIC_NO_DEVICE_FOUND;
+	}
 
-	/* Il master trasmette indirizzo e numero di registro dello slave da cui vuole leggere */
-	ERR_COUNT=0;
-	ret |= R_RIIC_MasterTransmitHead(riic_channel, addr_and_register, 2);
+	/* Un sensore escluso per errori di comunicazione viene riprovato solo periodicamente,
+	 per non occupare il bus con i timeout */
+	if (dev->stats.consecutive_errors >= IMU_FAULT_ERRORS)
+	{
+		if (++dev->recovery_count < IMU_RECOVERY_PERIOD) {
+			return RIIC_NO_DEVICE_FOUND;
+		}
+		dev->recovery_count = 0;
+	}
 
-	/* Controlla se si sono verificati errori */
-	if(ret != RIIC_OK)
+	/* Un sensore a ciclo, in sleep o ancora in avvio non produce campioni validi */
+	if (!IMU_power_ready(dev))
 	{
-		ERROR_HEAD_READ = 1;
-		ERR_COUNT++;
-		if (ERR_COUNT == 50) return ret;
-        IMU_read (riic_channel, slave_addr, register_number, dest_buff, num_bytes);
+		dev->online = false;
+		return RIIC_NO_DEVICE_FOUND;
 	}
 
-	/* Il master riceve i dati presi dal registro sul dest_buff  */
-	ERR_COUNT=0;
-	ret |= R_RIIC_MasterReceive(riic_channel, slave_addr, dest_buff, num_bytes);
+	memset(&raw, 0, sizeof(raw));
+	if (dev->decim.enabled)
+	{
+		/* Campione decimato dalla FIFO (attende se non e' ancora pronto) */
+		ret = IMU_decim_read(dev, &raw);
+	}
+	else
+	{
+		/* Legge i 14 registri consecutivi a partire da ACCEL_XOUT_H, piu' i 6 dei dati
+		 esterni (EXT_SENS_DATA_00 segue GYRO_ZOUT_L) se c'e' il magnetometro */
+		ret = IMU_read(dev, INV_MPU6050_REG_RAW_ACCEL, data,
+					   IMU_BURST_BYTES + (dev->mag.enabled ? IMU_MAG_BYTES : 0));
+
+		/* Esegue il masking (unisce i due byte big-endian di ogni registro a 16 bit) */
+		raw.accel[0] = (int16_t)(((uint16_t)data[0]  << 8) | data[1]);
+		raw.accel[1] = (int16_t)(((uint16_t)data[2]  << 8) | data[3]);
+		raw.accel[2] = (int16_t)(((uint16_t)data[4]  << 8) | data[5]);
+		raw.temp     = (int16_t)(((uint16_t)data[6]  << 8) | data[7]);
+		raw.gyro[0]  = (int16_t)(((uint16_t)data[8]  << 8) | data[9]);
+		raw.gyro[1]  = (int16_t)(((uint16_t)data[10] << 8) | data[11]);
+		raw.gyro[2]  = (int16_t)(((uint16_t)data[12] << 8) | data[13]);
+		if (dev->mag.enabled)
+		{
+			raw.mag[0] = (int16_t)(((uint16_t)data[14] << 8) | data[15]);
+			raw.mag[1] = (int16_t)(((uint16_t)data[16] << 8) | data[17]);
+			raw.mag[2] = (int16_t)(((uint16_t)data[18] << 8) | data[19]);
+		}
+	}
 
 	/* Controlla se si sono verificati errori */
-	if(ret != RIIC_OK)
+	if (RIIC_OK != ret)
 	{
-		ERROR_READ = 1;
-		ERR_COUNT++;
-		if (ERR_COUNT == 50) return ret;
-    	IMU_read (riic_channel, slave_addr, register_number, dest_buff, num_bytes);
+		if (dev->stats.consecutive_errors < IMU_FAULT_ERRORS)
+		{
+			if (++dev->stats.consecutive_errors >= IMU_FAULT_ERRORS) {
+				IMU_LOG3(IMU_LOG_SENSOR_FAULT, dev->slave_address, IMU_FAULT_ERRORS, ret);
+			}
+		}
+		if (dev->stats.consecutive_errors >= IMU_FAULT_ERRORS) {
+			dev->online = false;
+		}
+		return ret;
 	}
+	if (dev->stats.consecutive_errors >= IMU_FAULT_ERRORS) {
+		IMU_LOG1(IMU_LOG_SENSOR_RECOVERED, dev->slave_address);
+	}
+	dev->stats.consecutive_errors = 0;
+	dev->stats.samples++;
+
+	/* Un sensore che restituisce sempre lo stesso campione e' bloccato (il rumore
+	 del giroscopio cambia almeno un bit ad ogni nuovo campione) */
+	if (0 == memcmp(&raw, &dev->raw, sizeof(raw)))
+	{
+		if ((dev->stats.stuck_count < IMU_STUCK_SAMPLES) &&
+			(++dev->stats.stuck_count >= IMU_STUCK_SAMPLES)) {
+			IMU_LOG2(IMU_LOG_SENSOR_STUCK, dev->slave_address, IMU_STUCK_SAMPLES);
+		}
+	}
+	else
+	{
+		dev->stats.stuck_count = 0;
+	}
+
+	dev->raw = raw;
+	dev->online = (dev->stats.stuck_count < IMU_STUCK_SAMPLES);
+
+	/* Aggiorna temperatura e bias del modello termico */
+	IMU_temp_update(dev);
 
 	return ret;
 
-} /* Fine IMU_read() */
+} /* Fine IMU_dev_sample() */
 
 /*******************************************************************************
-* Nome funzione     : IMU_axis_read
-* Descrizione  	    : Legge i dati dai singoli assi dell'accelerometro e del
-* 					  giroscopio dell'IMU
-* Argomenti         : (uint8_t) axis -
-* 						 registro del singolo asse
-* Valori restituiti : (int16_t) axis_val -
-* 						 valore del singolo asse letto
+* Nome funzione     : IMU_dev_process
+* Descrizione  	    : Calcola angoli e velocita' angolari dall'ultimo campione
+* 					  grezzo del sensore. Con il DMP attivo gli angoli sono
+* 					  quelli del suo quaternione e sull'MCU resta solo la
+* 					  calibrazione del giroscopio: niente filtro software (il
+* 					  DMP lavora con il DLPF del sensore a 42 Hz), inclinazione
+* 					  e magnetometro
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						handle del sensore
+* Valori restituiti : No
 *******************************************************************************/
-static int16_t  IMU_axis_read (uint8_t axis)
+void IMU_dev_process(IMU_dev_struct *dev)
 {
 	/* Definisce le variabili locali */
-    int16_t    axis_val=0;
-    uint8_t    reg = axis;
-    uint8_t    data[2];
-    riic_ret_t ret;
-    unsigned char local_index = 0;
-
-    /* Legge i valori dal singolo asse */
-    ms_delay(1);
-    ret = IMU_read(RIIC_CHANNEL, MPU_ADDRESS, reg, data, 2);
-
-    /* Controlla se si sono verificati errori */
-    while (RIIC_OK != ret)
-    {
-        IMU_axis_read (axis);
-    }
+	IMU_data_struct *x = &dev->data;
+	float v[IMU_FILTER_CHANNELS];
+	float *a = &v[0], *g = &v[3];
+	uint8_t k;
+
+	/* Applica la calibrazione completa (bias, scala, disallineamento, livellamento);
+	 il giroscopio negli stessi assi dell'accelerometro */
+	IMU_calib_gyro(dev, g);
+
+	/* Assetto dal DMP negli assi del robot, riferito alla sua posizione di
+	 riposo (la rotta del DMP non e' l'elevazione di IMU_tilt) */
+	if (dev->dmp.enabled && dev->dmp.valid)
+	{
+		for (k = 0; k < 3; k++)
+		{
+			x->angle[k] = IMU_wrap_pi(dev->dmp.angle[k] - dev->dmp.off_angle[k]);
+			x->omega[k] = g[k] * IMU_DEG_TO_RAD - x->off_omega[k];
+		}
+		return;
+	}
+	IMU_calib_accel(dev, a);
+
+	/* Filtra i sei canali (un campione, canali contigui). Con la decimazione i
+	 campioni sono gia' filtrati nella FIFO; se e' sospesa (stati a ciclo) i
+	 coefficienti sono per la frequenza della FIFO e il filtro resta fermo */
+	if (dev->config.decim <= 1) {
+		IMU_filter_run(&dev->filter, v, 1, 1);
+	}
+
+	/* Calcola gli angoli */
+	IMU_tilt(a, x->angle);
+
+	/* Sottrae gli offset; le velocita' angolari passano da grad/s a rad/s */
+	for (k = 0; k < 3; k++)
+	{
+		x->angle[k] -= x->off_angle[k];
+		x->omega[k]  = g[k] * IMU_DEG_TO_RAD - x->off_omega[k];
+	}
 
-    /* Esegue il masking */
-    for(local_index = 0; local_index < 8; local_index++)
-      {
-    	if(data[0] & (1 << local_index)) axis_val |= ((uint16_t)1 << (8 + local_index));
-    	if(data[1] & (1 << local_index)) axis_val |= ((uint16_t)1 << local_index);
-      }
+	/* Con il giroscopio in standby restano solo gli angoli dell'accelerometro */
+	if (IMU_POWER_GYRO_STANDBY == dev->power.state)
+	{
+		for (k = 0; k < 3; k++) {
+			x->omega[k] = 0.0f;
+		}
+	}
 
-    return axis_val;
+	/* Con il magnetometro l'imbardata e' la direzione assoluta (dal nord
+	 magnetico) fusa con il giroscopio, senza offset di riposo */
+	if (dev->mag.enabled)
+	{
+		IMU_mag_update(dev, a, x->omega);
+		x->angle[IMU_YAW] = dev->mag.yaw;
+	}
 
-} /* Fine IMU_axis_read() */
+} /* Fine IMU_dev_process() */
 
 /*******************************************************************************
-* Nome funzione     : Accel_init
-* Descrizione  	    : Inizializza l'accelerometro
-* Argomenti         : (IMU_data_struct) *x -
-*   					 puntatore alla struttura dell'IMU
-* Valori restituiti : No
+* Nome funzione     : IMU_vote
+* Descrizione  	    : Fonde i risultati dei sensori attivi. Per ogni grandezza
+* 					  calcola la mediana, scarta i sensori che se ne discostano
+* 					  oltre la tolleranza e media i rimanenti. Se nessun sensore
+* 					  e' in accordo (due sensori discordi) sceglie quello piu'
+* 					  vicino alla stima precedente. Senza sensori attivi la
+* 					  stima precedente non viene modificata. L'imbardata del
+* 					  magnetometro ha un salto a +-pi: viene riportata vicino
+* 					  alla stima precedente prima del confronto e il
+* 					  risultato riportato in [-pi, pi]
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						vettore degli handle dei sensori
+* 					  (uint8_t) num_dev -
+* 					  	numero di sensori
+* 					  (IMU_data struct) *fused -
+* 						puntatore alla struttura con il risultato fuso
+* Valori restituiti : (uint8_t) used -
+* 						 numero di sensori usati nella media
 *******************************************************************************/
-void Accel_init(IMU_data_struct *x)
+uint8_t IMU_vote(IMU_dev_struct *dev, uint8_t num_dev, IMU_data_struct *fused)
 {
 	/* Definisce le variabili locali */
-	float raw_data_zero[3], Rad[3], off_Rad[3]={0};
-	float ax_zero = 0;
-	float ay_zero = 0;
-	float az_zero = 0;
+	const float tol[6] = {IMU_vote_angle_tol, IMU_vote_angle_tol, IMU_vote_angle_tol,
+						  IMU_vote_omega_tol, IMU_vote_omega_tol, IMU_vote_omega_tol};
+	float val[IMU_MAX_SENSORS][6], column[IMU_MAX_SENSORS], med[6], sum[6], prev[6];
+	float dist, best_dist = 0;
+	uint8_t idx[IMU_MAX_SENSORS];
+	bool accepted[IMU_MAX_SENSORS];
+	uint8_t n = 0, used = 0, best = 0, i, k;
+
+	/* Raccoglie i sensori attivi */
+	for (i = 0; (i < num_dev) && (n < IMU_MAX_SENSORS); i++)
+	{
+		if (dev[i].online)
+		{
+			idx[n] = i;
+			IMU_vote_load(&dev[i].data, val[n]);
+			val[n][IMU_YAW] = fused->angle[IMU_YAW] + IMU_wrap_pi(val[n][IMU_YAW] - fused->angle[IMU_YAW]);
+			n++;
+		}
+	}
 
-	/* Esegue le prime 10 letture a vuoto (stabilizzazione dei valori di accelerazione) */
-	for (int i = 0; i < 10; i++)
-    {
-       IMU_axis_read(INV_MPU6050_REG_RAW_ACCEL_X);
-       IMU_axis_read(INV_MPU6050_REG_RAW_ACCEL_Y);
-       IMU_axis_read(INV_MPU6050_REG_RAW_ACCEL_Z);
-    }
+	if (0 == n) {
+		return 0;
+	}
 
-	/* Esegue 100 letture */
-	for (int i = 0; i < 100; i++)
+	/* Mediana di ogni grandezza */
+	for (k = 0; k < 6; k++)
 	{
-		/* Legge i valori grezzi */
-		raw_data_zero[0] = (float)IMU_axis_read(INV_MPU6050_REG_RAW_ACCEL_X);
-	    raw_data_zero[1] = (float)IMU_axis_read(INV_MPU6050_REG_RAW_ACCEL_Y);
-	    raw_data_zero[2] = (float)IMU_axis_read(INV_MPU6050_REG_RAW_ACCEL_Z);
-
-	    /* Calibra i valori sulla sensitività scelta per l'accelerometro */
-	    ax_zero = raw_data_zero[0]/16384;
-	    ay_zero = raw_data_zero[1]/16384;
-	    az_zero = raw_data_zero[2]/16384;
-
-	    /* Calcola gli angoli */
-	    Rad[0] = atanf(ay_zero/sqrtf(ax_zero*ax_zero+az_zero*az_zero));
-	    Rad[1] = atanf(-ax_zero/sqrtf(ay_zero*ay_zero+az_zero*az_zero));
-	    Rad[2] = atanf(az_zero/sqrtf(ax_zero*ax_zero+ay_zero*ay_zero));
-
-	    /* Somma gli angoli misurati  */
-	    off_Rad[0] += Rad[0];
-	    off_Rad[1] += Rad[1];
-	    off_Rad[2] += Rad[2];
-    }
+		for (i = 0; i < n; i++) {
+			column[i] = val[i][k];
+		}
+		med[k] = IMU_median(column, n);
+		sum[k] = 0;
+	}
+
+	/* Accetta i sensori entro la tolleranza dalla mediana */
+	for (i = 0; i < n; i++)
+	{
+		accepted[i] = true;
+		for (k = 0; k < 6; k++)
+		{
+			if (fabsf(val[i][k] - med[k]) > tol[k]) {
+				accepted[i] = false;
+			}
+		}
+		if (accepted[i]) {
+			used++;
+		}
+	}
 
-	/* Determina i valori medi, ossia gli angoli di offset (rad), e li memorizza nella struttura */
-	x->off_RollRad  = off_Rad[0]/100;
-	x->off_PitchRad = off_Rad[1]/100;
-	x->off_YawRad   = off_Rad[2]/100;
+	/* Nessun accordo: sceglie il sensore piu' vicino alla stima precedente */
+	if (0 == used)
+	{
+		IMU_vote_load(fused, prev);
+		for (i = 0; i < n; i++)
+		{
+			dist = 0;
+			for (k = 0; k < 6; k++) {
+				dist += fabsf(val[i][k] - prev[k]) / tol[k];
+			}
+			if ((0 == i) || (dist < best_dist))
+			{
+				best_dist = dist;
+				best = i;
+			}
+		}
+		accepted[best] = true;
+		used = 1;
+		IMU_LOG2(IMU_LOG_VOTE_DISAGREE, n, IMU_LOG_F(best_dist));
+	}
 
-	/* Converte gli angoli di offset in gradi e li memorizza nella struttura */
-	x->off_RollDeg  = x->off_RollRad  * (180.0/M_PI);
-	x->off_PitchDeg = x->off_PitchRad * (180.0/M_PI);
-	x->off_YawDeg   = x->off_YawRad   * (180.0/M_PI);
+	/* Media dei sensori accettati */
+	for (i = 0; i < n; i++)
+	{
+		if (accepted[i])
+		{
+			for (k = 0; k < 6; k++) {
+				sum[k] += val[i][k];
+			}
+		}
+		else
+		{
+			dev[idx[i]].stats.vote_rejects++;
+		}
+	}
 
-} /* Fine Accel_init() */
+	/* Memorizza il risultato fuso nella struttura */
+	for (k = 0; k < 3; k++)
+	{
+		fused->angle[k] = sum[k] / used;
+		fused->omega[k] = sum[k + 3] / used;
+	}
+	fused->angle[IMU_YAW] = IMU_wrap_pi(fused->angle[IMU_YAW]);
+
+	return used;
+
+} /* Fine IMU_vote() */
 
 /*******************************************************************************
-* Nome funzione     : Gyro_init
-* Descrizione  	    : Inizializza il giroscopio
+* Nome funzione     : IMU_vote_load
+* Descrizione  	    : Copia in un vettore le grandezze usate dal voting
 * Argomenti         : (IMU_data_struct) *x -
-*   					 puntatore alla struttura dell'IMU
+* 						 puntatore alla struttura dell'IMU
+* 					  (float) *val -
+* 					  	 vettore di 6 elementi di destinazione
 * Valori restituiti : No
 *******************************************************************************/
-void Gyro_init(IMU_data_struct *x)
+static void IMU_vote_load(const IMU_data_struct *x, float *val)
 {
 	/* Definisce le variabili locali */
-	float raw_data_zero[3], off_omegaDeg[3];
-	float gx_zero = 0;
-	float gy_zero = 0;
-	float gz_zero = 0;
+	uint8_t k;
 
-	/* Esegue le prime 10 letture a vuoto (stabilizzazione dei valori di velocità) */
-	for (int i = 0; i < 10; i++)
+	for (k = 0; k < 3; k++)
 	{
-		IMU_axis_read(INV_MPU6050_REG_RAW_GYRO_X);
-		IMU_axis_read(INV_MPU6050_REG_RAW_GYRO_Y);
-		IMU_axis_read(INV_MPU6050_REG_RAW_GYRO_Z);
+		val[k]     = x->angle[k];
+		val[k + 3] = x->omega[k];
 	}
 
-	/* Esegue 100 letture */
-	for (int i = 0; i < 100; i++)
+} /* Fine IMU_vote_load() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_median
+* Descrizione  	    : Calcola la mediana di pochi valori (ordinamento per
+* 					  inserzione sul vettore passato)
+* Argomenti         : (float) *val -
+* 						 vettore dei valori (viene riordinato)
+* 					  (uint8_t) n -
+* 					  	 numero di valori
+* Valori restituiti : (float) -
+* 						 mediana
+*******************************************************************************/
+static float IMU_median(float *val, uint8_t n)
+{
+	/* Definisce le variabili locali */
+	float tmp;
+	int8_t i, j;
+
+	for (i = 1; i < n; i++)
 	{
-		/* Legge i valori grezzi */
-		raw_data_zero[0] = (float)IMU_axis_read(INV_MPU6050_REG_RAW_GYRO_X);
-		raw_data_zero[1] = (float)IMU_axis_read(INV_MPU6050_REG_RAW_GYRO_Y);
-		raw_data_zero[2] = (float)IMU_axis_read(INV_MPU6050_REG_RAW_GYRO_Z);
+		tmp = val[i];
+		for (j = i - 1; (j >= 0) && (val[j] > tmp); j--) {
+			val[j + 1] = val[j];
+		}
+		val[j + 1] = tmp;
+	}
+
+	if (n & 1) {
+		return val[n / 2];
+	}
+
+	return 0.5f * (val[n / 2 - 1] + val[n / 2]);
+
+} /* Fine IMU_median() */
+
+/*******************************************************************************
+* Nome funzione     : Accel_init
+* Descrizione  	    : Completa l'inizializzazione dell'accelerometro con le
+* 					  letture sommate da IMU_dev_calibrate_step: dalla
+* 					  gravita' con il robot in piedi ricava la rotazione di
+* 					  livellamento. Gli angoli di offset restano quelli della
+* 					  posizione di riposo, calcolati dopo il livellamento
+* Argomenti         : (IMU_dev_struct) *dev -
+*   					 handle del sensore
+* Valori restituiti : (riic_ret_t) -
+* 						 RIIC_OK se almeno una lettura e' andata a buon fine
+*******************************************************************************/
+static riic_ret_t Accel_init(IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	IMU_data_struct *x = &dev->data;
+	const float (*level)[3] = (const float (*)[3])dev->calib.level;
+	const float *g = dev->recal.sum;
+	float zero[3];
+	uint8_t valid = dev->recal.valid;
+
+	if (0 == valid) {
+		return RIIC_NO_DEVICE_FOUND;
+	}
 
-		/* Calibra i valori sulla sensitività scelta per il giroscopio */
-		gx_zero = raw_data_zero[0]/131;
-		gy_zero = raw_data_zero[1]/131;
-		gz_zero = raw_data_zero[2]/131;
+	/* Ruota gli assi del sensore su quelli del robot */
+	IMU_calib_set_level(dev, g);
 
-		/* Somma le velocità angolari misurate */
-		off_omegaDeg[0] += gx_zero;
-		off_omegaDeg[1] += gy_zero;
-		off_omegaDeg[2] += gz_zero;
+	/* Gravita' media negli assi del robot (idealmente solo su z) */
+	for (int k = 0; k < 3; k++) {
+		zero[k] = (level[k][0]*g[0] + level[k][1]*g[1] + level[k][2]*g[2]) / valid;
 	}
 
-    /* Determina i valori medi, ossia le velocità angolari di offset (grad/s), e le memorizza nella struttura */
-	x->off_omegaRollDeg  = off_omegaDeg[0]/100;
-	x->off_omegaPitchDeg = off_omegaDeg[1]/100;
-	x->off_omegaYawDeg   = off_omegaDeg[2]/100;
+	/* Calcola gli angoli di offset (rad) della posizione di riposo e li memorizza nella struttura */
+	IMU_tilt(zero, x->off_angle);
+
+	return RIIC_OK;
+
+} /* Fine Accel_init() */
+
+/*******************************************************************************
+* Nome funzione     : Gyro_init
+* Descrizione  	    : Completa l'inizializzazione del giroscopio con le
+* 					  letture sommate da IMU_dev_calibrate_step (gia' negli
+* 					  assi del robot)
+* Argomenti         : (IMU_dev_struct) *dev -
+*   					 handle del sensore
+* Valori restituiti : (riic_ret_t) -
+* 						 RIIC_OK se almeno una lettura e' andata a buon fine
+*******************************************************************************/
+static riic_ret_t Gyro_init(IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	IMU_data_struct *x = &dev->data;
+	uint8_t valid = dev->recal.valid;
 
-	/* Converte le velocità angolari di offset in rad/s e le memorizza nella struttura*/
-	x->off_omegaRollRad  = x->off_omegaRollDeg  * (M_PI/180.0);
-    x->off_omegaPitchRad = x->off_omegaPitchDeg * (M_PI/180.0);
-	x->off_omegaYawRad   = x->off_omegaYawDeg   * (M_PI/180.0);
+	if (0 == valid) {
+		return RIIC_NO_DEVICE_FOUND;
+	}
+
+    /* Determina i valori medi, ossia le velocita' angolari di offset (rad/s), e le memorizza nella struttura */
+	for (int k = 0; k < 3; k++) {
+		x->off_omega[k] = dev->recal.sum[k] * IMU_DEG_TO_RAD / valid;
+	}
+
+	return RIIC_OK;
 
 } /* Fine Gyro_init() */
 
 /*******************************************************************************
 * Nome funzione     : IMU_config
-* Descrizione  	    : Configura l'IMU
-* Argomenti         : No
+* Descrizione  	    : Configura l'IMU secondo dev->config e calcola i fattori
+* 					  di scala corrispondenti. I registri SMPLRT_DIV, CONFIG,
+* 					  GYRO_CONFIG e ACCEL_CONFIG (0x19-0x1C) sono contigui e
+* 					  vengono scritti con una sola transazione; quelli che non
+* 					  cambiano non vengono riscritti
+* Argomenti         : (IMU_dev_struct) *dev -
+*   					 handle del sensore
 * Valori restituiti : (riic_ret_t) - ret
 * 						 risultato della configurazione
 *******************************************************************************/
-static riic_ret_t IMU_config(void)
+static riic_ret_t IMU_config(IMU_dev_struct *dev)
 {
 	/* Definisce le variabili locali */
 	riic_ret_t ret;
-	uint8_t d;
-
-	/* Attiva lo stato di alimentazione */
-	ms_delay(INV_MPU6050_POWER_UP_TIME);
-	ret = IMU_set_power(true);
-
-	/* Controlla se si sono verificati errori */
-    if(RIIC_OK != ret){
-    	return ret;
-    }
+	uint16_t base_hz, odr_hz;
 
-	/* Configura l'accelerometro */
-	d = (INV_MPU6050_FS_02G << INV_MPU6050_ACCL_CONFIG_FSR_SHIFT);
-	ms_delay(1);
-	ret = IMU_write(RIIC_CHANNEL, MPU_ADDRESS, INV_MPU6050_REG_ACCEL_CONFIG, &d, 1); /* i bit 0,1,2 del registro INV_MPU6050_REG_ACCEL_CONFIG sono riservati e
-    non si possono sovrascrivere. Avendo definito INV_MPU6050_FS_02G=0, eseguendo uno shift degli 8bit verso sinistra si avra' qualcosa del tipo 00000xxx.
-    Ma gli ultimi tre bit (quelli scritti come x) non sono scrivibili sul registro INV_MPU6050_ACCEL_CONFIG_FSR_SHIFT quindi non importa cosa siano. I bit 3 e 4
-    valgono 0 e indicano la scala di 2G, i bit 5, 6 e 7 indicano rispettivamente gli assi z, y e x e vengono quindi inizializzati al valore zero */
+	/* Configura la frequenza di campionamento (il giroscopio e' campionato a 8 kHz
+	 con il filtro del sensore spento, a 1 kHz altrimenti); con la decimazione il
+	 sensore campiona decim volte piu' veloce dell'uscita */
+	base_hz = ((INV_MPU6050_FILTER_256HZ_NODLPF == dev->config.dlpf) ||
+			   (INV_MPU6050_FILTER_2100HZ_NODLPF == dev->config.dlpf)) ? INV_MPU6050_EIGHT_K_HZ : INV_MPU6050_ONE_K_HZ;
+	odr_hz = dev->config.rate_hz * ((dev->config.decim > 1) ? dev->config.decim : 1);
+	IMU_reg_set(dev, INV_MPU6050_REG_SAMPLE_RATE_DIV, base_hz / odr_hz - 1);
 
-	/* Controlla se si sono verificati errori*/
-    if(RIIC_OK != ret){
-    	return ret;
-    }
+	/* Configura il filtro */
+	IMU_reg_update_bits(dev, INV_MPU6050_REG_CONFIG, INV_MPU6050_BITS_DLPF_CFG, dev->config.dlpf);
 
-    /* Configura il giroscopio */
-	d = (INV_MPU6050_FSR_250DPS << INV_MPU6050_GYRO_CONFIG_FSR_SHIFT); /* vale lo stesso discorso dell'accelerometro */
-	ms_delay(1);
-	ret = IMU_write(RIIC_CHANNEL, MPU_ADDRESS, INV_MPU6050_REG_GYRO_CONFIG, &d, 1);
+    /* Configura il giroscopio (i bit 5, 6 e 7 avviano l'autotest e restano a zero) */
+	IMU_reg_set(dev, INV_MPU6050_REG_GYRO_CONFIG, dev->config.gyro_fs << INV_MPU6050_GYRO_CONFIG_FSR_SHIFT);
 
-	/* Controlla se si sono verificati errori*/
-    if(RIIC_OK != ret){
-    	return ret;
-    }
+	/* Configura l'accelerometro. I bit 3 e 4 indicano il fondo scala, i bit 5, 6 e 7
+	 avviano l'autotest degli assi z, y e x e restano a zero; i bit 0, 1, 2 (filtro
+	 passa alto per il rilevamento del movimento) vengono conservati dalla copia locale */
+	IMU_reg_update_bits(dev, INV_MPU6050_REG_ACCEL_CONFIG, (uint8_t)~INV_MPU6050_BITS_ACCEL_HPF,
+						dev->config.accel_fs << INV_MPU6050_ACCL_CONFIG_FSR_SHIFT);
 
-	/* Configura il filtro */
-	d = INV_MPU6050_FILTER_20HZ;
-	ms_delay(1);
-	ret = IMU_write(RIIC_CHANNEL, MPU_ADDRESS, INV_MPU6050_REG_CONFIG, &d, 1);
+	/* Scrive i registri modificati */
+	ret = IMU_reg_flush(dev);
 
 	/* Controlla se si sono verificati errori */
 	if(RIIC_OK != ret) {
 		return ret;
 	}
 
-	/* Configura la frequenza di campionamento */
-	d = INV_MPU6050_ONE_K_HZ / INV_MPU6050_INIT_FIFO_RATE - 1;
-	ms_delay(1);
-	ret = IMU_write(RIIC_CHANNEL, MPU_ADDRESS, INV_MPU6050_REG_SAMPLE_RATE_DIV, &d, 1);
+	/* Fattori di scala: 16384 LSB/g a 2G e 131 LSB/(grad/s) a 250 grad/s, dimezzati ad ogni fondo scala */
+	dev->accel_scale = (float)(1 << dev->config.accel_fs) / 16384.0f;
+	dev->gyro_scale  = (float)(1 << dev->config.gyro_fs)  / 131.0f;
 
-	/* Controlla se si sono verificati errori */
-	if(RIIC_OK != ret) {
+	/* Filtro software alla frequenza di uscita, o a quella della FIFO con la decimazione */
+	IMU_filter_init(&dev->filter, &dev->config.filter, IMU_filter_rate(dev));
+
+	/* Magnetometro sul bus ausiliario: va configurato prima della FIFO, che ne
+	 include i dati */
+	ret = IMU_mag_start(dev);
+	if (RIIC_OK != ret) {
 		return ret;
 	}
 
+	/* Acquisizione dalla FIFO con decimazione, oppure lettura diretta dei registri */
+	if (dev->config.decim > 1) {
+		ret = IMU_decim_start(dev);
+	}
+	else if (dev->decim.enabled) {
+		ret = IMU_decim_stop(dev);
+	}
+
 	return ret;
 
-} /* Fine IMU_init_config() */
+} /* Fine IMU_config() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_set_config
+* Descrizione  	    : Cambia a runtime il profilo di configurazione del sensore
+* 					  (una sola transazione, senza ritardi)
+* Argomenti         : (IMU_dev_struct) *dev -
+*   					 handle del sensore
+* 					  (IMU_config_struct) *config -
+* 					  	 nuova configurazione
+* Valori restituiti : (riic_ret_t) - ret
+* 						 risultato della configurazione
+*******************************************************************************/
+riic_ret_t IMU_set_config(IMU_dev_struct *dev, const IMU_config_struct *config)
+{
+	dev->config = *config;
+
+	return IMU_config(dev);
+
+} /* Fine IMU_set_config() */
 
 /******************************************************************************
 * Nome funzione     : IMU_set_power
 * Descrizione  	    : Attiva/disattiva lo stato di alimentazione dell'IMU
-* Argomenti         : (bool) power on -
+* 					  (solo il bit SLEEP, per l'inizializzazione; gli altri
+* 					  stati sono gestiti da IMU_power_set)
+* Argomenti         : (IMU_dev_struct) *dev -
+*   					 handle del sensore
+* 					  (bool) power on -
 * 						 acceso/spento
 * Valori restituiti : (riic_ret_t) ret -
 * 						 risultato operazione
 *******************************************************************************/
-riic_ret_t IMU_set_power(bool power_on)
+riic_ret_t IMU_set_power(IMU_dev_struct *dev, bool power_on)
 {
 	/* Denifisce le variabili locali */
 	riic_ret_t ret;
-	uint8_t target_data;
 
 	/* Setta lo stato di alimentazione */
-	if (power_on)
-	{
-		target_data = 0;
-		ret = IMU_write(RIIC_CHANNEL, MPU_ADDRESS, INV_MPU6050_REG_PWR_MGMT_1, &target_data, 1);
-	}
-	else
-	{
-		target_data = INV_MPU6050_BIT_SLEEP;
-		ret = IMU_write(RIIC_CHANNEL, MPU_ADDRESS, INV_MPU6050_REG_PWR_MGMT_1, &target_data, 1);
-	}
+	IMU_reg_update_bits(dev, INV_MPU6050_REG_PWR_MGMT_1, INV_MPU6050_BIT_SLEEP, power_on ? 0 : INV_MPU6050_BIT_SLEEP);
+	ret = IMU_reg_flush(dev);
 
 	/* Controlla se si sono verificati errori */
 	if(RIIC_OK != ret){
 		return ret;
 	}
+	dev->power.state = power_on ? IMU_POWER_FULL : IMU_POWER_SLEEP;
 
 	/* Introduce un delay se lo stato di alimentazione è attivo*/
 	if (power_on) {
@@ -524,25 +976,110 @@ riic_ret_t IMU_set_power(bool power_on)
 
 /*******************************************************************************
 * Nome funzione     : IMU_update
-* Descrizione  	    : Stampa i risultati acquisiti dell'IMU
-* Argomenti         : (IMU_data_struct) *x -
-* 						 puntatore alla struttura dell'IMU
+* Descrizione  	    : Stampa l'ultimo assetto pubblicato. Legge una copia
+* 					  coerente, quindi puo' girare a una frequenza qualsiasi
+* 					  rispetto allo stimatore
+* Argomenti         : (IMU_state_struct) *state -
+* 						 assetto pubblicato da IMU_result
 * Valori restituiti : No
 *******************************************************************************/
-void IMU_update(IMU_data_struct *x)
+void IMU_update(const IMU_state_struct *state)
 {
    	uint8_t lcd_buffer[13];
+   	IMU_attitude_struct a;
+
+   	if (!IMU_state_read(state, &a)) {
+   		return;
+   	}
 
-    sprintf((char *)lcd_buffer, "Rg:%5.3f " , x->RollDeg);
+    sprintf((char *)lcd_buffer, "Rg:%5.3f " , a.angle[IMU_ROLL] * IMU_RAD_TO_DEG);
    	lcd_display(LCD_LINE1, lcd_buffer);
 
-   	sprintf((char *)lcd_buffer, "Pg:%5.3f ", x->PitchDeg);
+   	sprintf((char *)lcd_buffer, "Pg:%5.3f ", a.angle[IMU_PITCH] * IMU_RAD_TO_DEG);
    	lcd_display(LCD_LINE2, lcd_buffer);
 
-   	sprintf((char *)lcd_buffer, "wRg:%5.3f" , x->omegaRollDeg);
+   	sprintf((char *)lcd_buffer, "wRg:%5.3f" , a.omega[IMU_ROLL] * IMU_RAD_TO_DEG);
    	lcd_display(LCD_LINE3, lcd_buffer);
 
-   	sprintf((char *)lcd_buffer, "wPg:%5.3f", x->omegaPitchDeg);
+   	sprintf((char *)lcd_buffer, "wPg:%5.3f", a.omega[IMU_PITCH] * IMU_RAD_TO_DEG);
    	lcd_display(LCD_LINE4, lcd_buffer);
 
 } /* Fine IMU_update() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_show_status
+* Descrizione  	    : Pagina di diagnostica del display: stato, campioni
+* 					  bloccati ed errori di comunicazione di ogni sensore,
+* 					  messaggi del registro differito e quelli persi
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle dei sensori
+* 					  (uint8_t) num_dev -
+* 					  	 numero di sensori
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_show_status(const IMU_dev_struct *dev, uint8_t num_dev)
+{
+	/* Definisce le variabili locali */
+	uint8_t lcd_buffer[13];
+	uint8_t i, line = LCD_LINE1;
+	uint32_t n;
+
+	/* I contatori sono limitati alle cifre che stanno in una riga */
+	for (i = 0; (i < num_dev) && (line < LCD_LINE8); i++)
+	{
+		n = dev[i].stats.stuck_count;
+		sprintf((char *)lcd_buffer, "S%u %s b:%-3lu", i, dev[i].online ? "ok " : "off", (unsigned long)(n > 999 ? 999 : n));
+		lcd_display(line, lcd_buffer);
+		line += LCD_LINE2 - LCD_LINE1;
+
+		n = dev[i].stats.read_errors + dev[i].stats.write_errors;
+		sprintf((char *)lcd_buffer, " err:%-7lu", (unsigned long)(n > 9999999 ? 9999999 : n));
+		lcd_display(line, lcd_buffer);
+		line += LCD_LINE2 - LCD_LINE1;
+	}
+
+	if (line < LCD_LINE8)
+	{
+		n = IMU_log.records;
+		sprintf((char *)lcd_buffer, "log:%-8lu", (unsigned long)(n > 99999999 ? 99999999 : n));
+		lcd_display(line, lcd_buffer);
+		line += LCD_LINE2 - LCD_LINE1;
+
+		n = IMU_log.drops;
+		sprintf((char *)lcd_buffer, "persi:%-6lu", (unsigned long)(n > 999999 ? 999999 : n));
+		lcd_display(line, lcd_buffer);
+	}
+
+} /* Fine IMU_show_status() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_angle_deg
+* Descrizione  	    : Angolo in gradi, calcolato solo quando serve
+* Argomenti         : (IMU_data_struct) *x -
+* 						 puntatore alla struttura dell'IMU
+* 					  (uint8_t) axis -
+* 					  	 IMU_ROLL, IMU_PITCH o IMU_YAW
+* Valori restituiti : (float) -
+* 						 angolo (grad)
+*******************************************************************************/
+float IMU_angle_deg(const IMU_data_struct *x, uint8_t axis)
+{
+	return x->angle[axis] * IMU_RAD_TO_DEG;
+
+} /* Fine IMU_angle_deg() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_omega_deg
+* Descrizione  	    : Velocita' angolare in grad/s, calcolata solo quando serve
+* Argomenti         : (IMU_data_struct) *x -
+* 						 puntatore alla struttura dell'IMU
+* 					  (uint8_t) axis -
+* 					  	 IMU_ROLL, IMU_PITCH o IMU_YAW
+* Valori restituiti : (float) -
+* 						 velocita' angolare (grad/s)
+*******************************************************************************/
+float IMU_omega_deg(const IMU_data_struct *x, uint8_t axis)
+{
+	return x->omega[axis] * IMU_RAD_TO_DEG;
+
+} /* Fine IMU_omega_deg() */
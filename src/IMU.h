@@ -1,23 +1,38 @@
 /* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
 
+#ifndef _IMU_H_
+#define _IMU_H_
+
 /*******************************************************************************
 Includes: <System Includes> , "Project Includes"
 *******************************************************************************/
 #include <stdbool.h>
 #include "main.h"
+#include "IMU_ring.h"
 #include "r_riic_rx600.h"
 
 /*******************************************************************************
 Defines
 *******************************************************************************/
+#ifndef M_PI
 #define M_PI  								3.14159
-#define RIIC_CHANNEL            			CHANNEL_0
-#define MPU_ADDRESS 						0xD0
+#endif
+#define IMU_RAD_TO_DEG						((float)(180.0/M_PI))
+#define IMU_DEG_TO_RAD						((float)(M_PI/180.0))
 #define MASTER_IIC_ADDRESS_LO				0x20
 #define MASTER_IIC_ADDRESS_HI				0x00
 #define RW_BIT                  			0x01
-#define CHANNEL								0
 #define NUM_BYTES							1
+#define IMU_MAX_RETRY						3		/* tentativi per ogni transazione IIC */
+#define IMU_FAULT_ERRORS					5		/* errori consecutivi prima di escludere il sensore */
+#define IMU_STUCK_SAMPLES					200		/* campioni identici prima di considerare il sensore bloccato */
+#define IMU_RECOVERY_PERIOD					100		/* ogni quanti slot si riprova un sensore escluso */
+#define IMU_VOTE_ANGLE_TOL_RAD				0.087f	/* massima discrepanza ammessa sugli angoli (5 gradi) */
+#define IMU_VOTE_OMEGA_TOL_RAD				0.175f	/* massima discrepanza ammessa sulle velocita' angolari (10 grad/s) */
+#define IMU_BURST_BYTES						14		/* accelerometro + temperatura + giroscopio */
+#define IMU_MAX_RINGS						2		/* code dei consumatori dei campioni grezzi */
+#define IMU_RECAL_SETTLE_READS				10		/* letture a vuoto prima di ogni misura della calibrazione */
+#define IMU_RECAL_READS						100		/* letture sommate per accelerometro e giroscopio */
 #define IIO_VAL_INT 						1
 #define IIO_VAL_INT_PLUS_MICRO 				2
 #define IIO_VAL_INT_PLUS_NANO 				3
@@ -44,66 +59,101 @@ Defines
 #define INV_MPU6050_MAX_FIFO_RATE           1000
 #define INV_MPU6050_MIN_FIFO_RATE           4
 #define INV_MPU6050_ONE_K_HZ                1000
+#define INV_MPU6050_EIGHT_K_HZ              8000
 #define INV_MPU6050_REG_SAMPLE_RATE_DIV     0x19
 #define INV_MPU6050_REG_CONFIG              0x1A
+#define INV_MPU6050_BITS_DLPF_CFG           0x07
 #define INV_MPU6050_REG_GYRO_CONFIG         0x1B
 #define INV_MPU6050_REG_ACCEL_CONFIG	    0x1C
+#define INV_MPU6050_BITS_ACCEL_HPF          0x07
+#define INV_MPU6050_ACCEL_HPF_5HZ           0x01
+#define INV_MPU6050_ACCEL_HPF_HOLD          0x07
+#define INV_MPU6050_REG_MOT_THR             0x1F
+#define INV_MPU6050_REG_MOT_DUR             0x20
+#define INV_MPU6050_REG_ZRMOT_THR           0x21
+#define INV_MPU6050_REG_ZRMOT_DUR           0x22
 #define INV_MPU6050_REG_FIFO_EN             0x23
+#define INV_MPU6050_BIT_SLV0_FIFO_EN        0x01
+#define INV_MPU6050_REG_I2C_MST_CTRL        0x24
+#define INV_MPU6050_BIT_WAIT_FOR_ES         0x40
+#define INV_MPU6050_I2C_MST_CLK_400KHZ      0x0D
+#define INV_MPU6050_REG_I2C_SLV0_ADDR       0x25
+#define INV_MPU6050_REG_I2C_SLV0_REG        0x26
+#define INV_MPU6050_REG_I2C_SLV0_CTRL       0x27
+#define INV_MPU6050_BIT_SLV_BYTE_SW         0x40
+#define INV_MPU6050_BITS_SLV_LEN            0x0F
+#define INV_MPU6050_BIT_I2C_READ            0x80
+#define INV_MPU6050_REG_I2C_SLV4_ADDR       0x31
+#define INV_MPU6050_REG_I2C_SLV4_REG        0x32
+#define INV_MPU6050_REG_I2C_SLV4_DO         0x33
 #define INV_MPU6050_BIT_ACCEL_OUT           0x08
+#define INV_MPU6050_BIT_TEMP_OUT            0x80
 #define INV_MPU6050_BITS_GYRO_OUT           0x70
+#define INV_MPU6050_REG_I2C_SLV4_CTRL       0x34
+#define INV_MPU6050_BIT_SLV_EN              0x80
+#define INV_MPU6050_BITS_I2C_MST_DLY        0x1F
+#define INV_MPU6050_REG_I2C_SLV4_DI         0x35
+#define INV_MPU6050_REG_I2C_MST_STATUS      0x36
+#define INV_MPU6050_BIT_SLV4_DONE           0x40
+#define INV_MPU6050_BIT_SLV4_NACK           0x10
+#define INV_MPU6050_REG_INT_PIN_CFG         0x37
+#define INV_MPU6050_BIT_I2C_BYPASS_EN       0x02
 #define INV_MPU6050_REG_INT_ENABLE          0x38
 #define INV_MPU6050_BIT_DATA_RDY_EN         0x01
 #define INV_MPU6050_BIT_DMP_INT_EN          0x02
+#define INV_MPU6050_BIT_ZMOT_EN             0x20
+#define INV_MPU6050_BIT_MOT_EN              0x40
+#define INV_MPU6050_REG_INT_STATUS          0x3A
+#define INV_MPU6050_BIT_MOT_INT             0x40
 #define INV_MPU6050_REG_RAW_ACCEL           0x3B
 #define INV_MPU6050_REG_RAW_ACCEL_X			0x3B
 #define INV_MPU6050_REG_RAW_ACCEL_Y			0x3D
 #define INV_MPU6050_REG_RAW_ACCEL_Z			0x3F
 #define INV_MPU6050_REG_TEMPERATURE         0x41
 #define INV_MPU6050_REG_RAW_GYRO            0x43
+#define INV_MPU6050_REG_EXT_SENS_DATA_00    0x49
+#define INV_MPU6050_REG_MOT_DETECT_STATUS   0x61
+#define INV_MPU6050_BIT_ZRMOT               0x01
 #define INV_MPU6050_REG_USER_CTRL           0x6A
 #define INV_MPU6050_REG_RAW_GYRO_X          0x43
 #define INV_MPU6050_REG_RAW_GYRO_Y          0x45
 #define INV_MPU6050_REG_RAW_GYRO_Z          0x47
+#define INV_MPU6050_BIT_SIG_COND_RST        0x01
+#define INV_MPU6050_BIT_I2C_MST_RST         0x02
 #define INV_MPU6050_BIT_FIFO_RST            0x04
 #define INV_MPU6050_BIT_DMP_RST             0x08
 #define INV_MPU6050_BIT_I2C_MST_EN          0x20
 #define INV_MPU6050_BIT_FIFO_EN             0x40
 #define INV_MPU6050_BIT_DMP_EN              0x80
+#define INV_MPU6050_REG_SIGNAL_PATH_RESET   0x68
+#define INV_MPU6050_BITS_PATH_RESET         0x07
+#define INV_MPU6050_REG_I2C_MST_DELAY_CTRL  0x67
+#define INV_MPU6050_BIT_SLV0_DLY_EN         0x01
+#define INV_MPU6050_REG_MOT_DETECT_CTRL     0x69
+#define INV_MPU6050_BITS_ACCEL_ON_DELAY     0x30
 #define INV_MPU6050_REG_PWR_MGMT_1          0x6B
 #define INV_MPU6050_BIT_H_RESET             0x80
 #define INV_MPU6050_BIT_SLEEP               0x40
+#define INV_MPU6050_BIT_CYCLE               0x20
+#define INV_MPU6050_BIT_TEMP_DIS            0x08
 #define INV_MPU6050_BIT_CLK_MASK            0x7
 #define INV_MPU6050_REG_PWR_MGMT_2          0x6C
+#define INV_MPU6050_REG_BANK_SEL            0x6D
+#define INV_MPU6050_REG_MEM_START_ADDR      0x6E
+#define INV_MPU6050_REG_MEM_R_W             0x6F
+#define INV_MPU6050_REG_PRGM_START_H        0x70
 #define INV_MPU6050_BIT_PWR_ACCL_STBY       0x38
 #define INV_MPU6050_BIT_PWR_GYRO_STBY       0x07
+#define INV_MPU6050_BITS_LP_WAKE_CTRL       0xC0
+#define INV_MPU6050_LP_WAKE_CTRL_SHIFT      6
 #define INV_MPU6050_REG_FIFO_COUNT_H        0x72
 #define INV_MPU6050_REG_FIFO_R_W            0x74
 #define INV_MPU6050_REG_WHO_AM_I			0x75
 #define INV_MPU6050_DEVICE_ID				0x68
 
 /*******************************************************************************
-Definizione strutture
+Definizione enumerazioni
 *******************************************************************************/
-IMU_data_struct x;
-
-riic_config_t riic_master_config =  {RIIC_CHANNEL,
-									 RIIC_MASTER_CONFIG,
-                                     0,
-                                     0,
-                                     0,
-                                     0,
-                                     MASTER_IIC_ADDRESS_LO,
-                                     MASTER_IIC_ADDRESS_HI};
-
-/*******************************************************************************
-Definizione variabili
-*******************************************************************************/
-unsigned char ERROR_HEAD_WRITE = 0;
-unsigned char ERROR_WRITE = 0;
-unsigned char ERROR_HEAD_READ = 0;
-unsigned char ERROR_READ = 0;
-int ERR_COUNT = 0;
-
 enum inv_mpu6050_filter_e {
 	INV_MPU6050_FILTER_256HZ_NODLPF = 0,
 	INV_MPU6050_FILTER_188HZ,
@@ -116,6 +166,14 @@ enum inv_mpu6050_filter_e {
 	NUM_MPU6050_FILTER
 };
 
+enum inv_mpu6050_lp_wake_e {
+	INV_MPU6050_LP_WAKE_1_25HZ = 0,
+	INV_MPU6050_LP_WAKE_5HZ,
+	INV_MPU6050_LP_WAKE_20HZ,
+	INV_MPU6050_LP_WAKE_40HZ,
+	NUM_MPU6050_LP_WAKE
+};
+
 enum inv_mpu6050_accl_fs_e {
 	INV_MPU6050_FS_02G = 0,
 	INV_MPU6050_FS_04G,
@@ -132,15 +190,35 @@ enum inv_mpu6050_fsr_e {
 	NUM_MPU6050_FSR
 };
 
+/* Fasi della calibrazione a passi (IMU_dev_calibrate_step) */
+enum IMU_recal_phase_e {
+	IMU_RECAL_IDLE = 0,
+	IMU_RECAL_ACCEL_SETTLE,
+	IMU_RECAL_ACCEL,
+	IMU_RECAL_GYRO_SETTLE,
+	IMU_RECAL_GYRO,
+	NUM_IMU_RECAL_PHASE
+};
+
 /*******************************************************************************
-Prototipi funzioni
+Variabili globali
 *******************************************************************************/
-static riic_ret_t IMU_write (uint8_t riic_channel, uint8_t slave_addr, uint8_t register_number, uint8_t *source_buff, uint32_t num_bytes);
-static riic_ret_t IMU_read (uint8_t riic_channel, uint8_t slave_addr, uint8_t register_number, uint8_t *dest_buff, uint32_t num_bytes);
-static int16_t  IMU_axis_read (uint8_t axis);
-void Accel_init (IMU_data_struct *x);
-void Gyro_init (IMU_data_struct *x);
-static riic_ret_t IMU_config(void);
-riic_ret_t IMU_set_power(bool power_on);
+extern float IMU_vote_angle_tol;
+extern float IMU_vote_omega_tol;
 
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+riic_ret_t IMU_dev_init(IMU_dev_struct *dev);
+riic_ret_t IMU_dev_calibrate(IMU_dev_struct *dev);
+void IMU_dev_calibrate_start(IMU_dev_struct *dev);
+bool IMU_dev_calibrate_step(IMU_dev_struct *dev);
+riic_ret_t IMU_dev_sample(IMU_dev_struct *dev);
+bool IMU_attach_ring(IMU_ring_struct *ring);
+void IMU_publish_sample(IMU_dev_struct *dev, uint8_t sensor);
+void IMU_dev_process(IMU_dev_struct *dev);
+uint8_t IMU_vote(IMU_dev_struct *dev, uint8_t num_dev, IMU_data_struct *fused);
+riic_ret_t IMU_set_power(IMU_dev_struct *dev, bool power_on);
+riic_ret_t IMU_set_config(IMU_dev_struct *dev, const IMU_config_struct *config);
 
+#endif /* _IMU_H_ */
@@ -0,0 +1,470 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Scatola nera del robot: ad ogni ciclo un campione compatto di assetto,
+* accelerazioni e comandi dei motori entra in un anello in RAM con gli ultimi
+* IMU_BBOX_RECORDS campioni. Alla caduta (inclinazione oltre
+* IMU_BBOX_FALL_ANGLE) o su richiesta (pulsante) registra ancora
+* IMU_BBOX_POST campioni, ferma l'anello e lo copia in data flash.
+* La copia procede a un'operazione del FCU alla volta: la prima parte dal
+* ciclo principale, le successive dall'interrupt di fine operazione, quindi il
+* ciclo principale non attende mai cancellazioni e programmazioni. Il CRC dei
+* campioni si calcola durante la programmazione e l'intestazione viene scritta
+* per ultima: un'interruzione dell'alimentazione lascia una registrazione
+* senza intestazione, ignorata alla lettura.
+* Le registrazioni si leggono sulla telemetria con IMU_bbox_dump o, sull'host,
+* con tools/imu_bboxsim.c e l'emulatore tools/host/flash_sim.c
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <mathf.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "platform.h"
+#include "CMT.h"
+#include "IMU_bbox.h"
+#include "IMU_flash.h"
+#include "IMU_telem.h"
+#include "IMU_log.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_BBOX_OFFSET(block)				((uint32_t)((block) % IMU_FLASH_BLOCKS) * IMU_FLASH_BLOCK)
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+IMU_bbox_struct IMU_bbox;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static void IMU_bbox_commit (void);
+static void IMU_bbox_next (void);
+static bool IMU_bbox_header_valid (const IMU_bbox_header_struct *h, uint16_t block);
+static int16_t IMU_bbox_pack (float v, float scale);
+
+/*******************************************************************************
+* Nome funzione     : IMU_bbox_init
+* Descrizione  	    : Prepara la data flash e cerca l'ultima registrazione
+* 					  completa: la testa del log riparte dal blocco successivo
+* 					  alla sua fine. La caduta resta disarmata finche' il robot
+* 					  non e' in piedi
+* Argomenti         : No
+* Valori restituiti : (bool) -
+* 						 false se la data flash non e' disponibile
+*******************************************************************************/
+bool IMU_bbox_init(void)
+{
+	/* Definisce le variabili locali */
+	IMU_bbox_header_struct h;
+	uint16_t b;
+
+	memset(&IMU_bbox, 0, sizeof(IMU_bbox));
+
+	if (!IMU_flash_init(IMU_bbox_next)) {
+		return false;
+	}
+
+	for (b = 0; b < IMU_FLASH_BLOCKS; b++)
+	{
+		IMU_flash_read(IMU_BBOX_OFFSET(b), &h, sizeof(h));
+		if (IMU_bbox_header_valid(&h, b) &&
+			((0 == IMU_bbox.latest) || ((int32_t)(h.number - IMU_bbox.latest) > 0)))
+		{
+			IMU_bbox.latest = h.number;
+			IMU_bbox.next_block = (uint16_t)((b + 1 + h.count) % IMU_FLASH_BLOCKS);
+		}
+	}
+
+	IMU_bbox.state = IMU_BBOX_RECORDING;
+
+	return true;
+
+} /* Fine IMU_bbox_init() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_bbox_log
+* Descrizione  	    : Aggiunge il campione del ciclo all'anello e controlla la
+* 					  caduta. Durante la scrittura in data flash l'anello e'
+* 					  fermo e il campione viene ignorato
+* Argomenti         : (IMU_data_struct) *x -
+* 						 assetto fuso
+* 					  (IMU_dev_struct) *dev -
+* 					  	 vettore degli handle dei sensori
+* 					  (uint8_t) num_dev -
+* 					  	 numero di sensori
+* 					  (uint16_t) work -
+* 					  	 durata dell'elaborazione (unita' di CMT_counter)
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_bbox_log(const IMU_data_struct *x, const IMU_dev_struct *dev, uint8_t num_dev, uint16_t work)
+{
+	/* Definisce le variabili locali */
+	IMU_bbox_record_struct *r;
+	float tilt;
+	uint8_t i, k;
+
+	if ((IMU_BBOX_RECORDING != IMU_bbox.state) && (IMU_BBOX_POST_TRIGGER != IMU_bbox.state)) {
+		return;
+	}
+
+	/* Caduta: scatta una volta, si riarma con il robot di nuovo in piedi */
+	tilt = fmaxf(fabsf(x->angle[IMU_ROLL]), fabsf(x->angle[IMU_PITCH]));
+	if (IMU_bbox.armed && (tilt > IMU_BBOX_FALL_ANGLE)) {
+		IMU_bbox_trigger(IMU_BBOX_FALL);
+	}
+	else if (tilt < IMU_BBOX_REARM_ANGLE) {
+		IMU_bbox.armed = true;
+	}
+
+	r = &IMU_bbox.ring[IMU_bbox.head];
+	memset(r, 0, sizeof(*r));
+	r->timestamp = (uint32_t)get_ms();
+	r->work = work;
+
+	for (k = 0; k < 3; k++)
+	{
+		r->angle[k] = IMU_bbox_pack(x->angle[k], IMU_BBOX_ANGLE_SCALE);
+		r->omega[k] = IMU_bbox_pack(x->omega[k], IMU_BBOX_OMEGA_SCALE);
+		r->control[k] = IMU_bbox.control[k];
+	}
+
+	for (i = 0; i < num_dev; i++)
+	{
+		if (!dev[i].online) {
+			continue;
+		}
+		if (0 == r->sensors++) {
+			memcpy(r->accel, dev[i].raw.accel, sizeof(r->accel));
+		}
+	}
+
+	if (IMU_bbox.mark)
+	{
+		r->flags |= IMU_BBOX_FLAG_TRIGGER;
+		IMU_bbox.mark = false;
+	}
+
+	IMU_bbox.head = (IMU_bbox.head + 1) % IMU_BBOX_RECORDS;
+	if (IMU_bbox.count < IMU_BBOX_RECORDS) {
+		IMU_bbox.count++;
+	}
+
+	if ((IMU_BBOX_POST_TRIGGER == IMU_bbox.state) && (0 == --IMU_bbox.post)) {
+		IMU_bbox_commit();
+	}
+
+} /* Fine IMU_bbox_log() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_bbox_set_control
+* Descrizione  	    : Comandi dei motori registrati dai campioni successivi
+* Argomenti         : (int16_t) *control -
+* 						 tre comandi, nelle unita' del controllo
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_bbox_set_control(const int16_t *control)
+{
+	memcpy(IMU_bbox.control, control, sizeof(IMU_bbox.control));
+
+} /* Fine IMU_bbox_set_control() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_bbox_trigger
+* Descrizione  	    : Segna l'evento sul prossimo campione; dopo altri
+* 					  IMU_BBOX_POST campioni l'anello viene scritto. Gli
+* 					  eventi durante una registrazione vengono ignorati
+* Argomenti         : (uint8_t) trigger -
+* 						 causa, IMU_bbox_trigger_e
+* Valori restituiti : (bool) -
+* 						 false se l'evento e' stato ignorato
+*******************************************************************************/
+bool IMU_bbox_trigger(uint8_t trigger)
+{
+	if (IMU_BBOX_RECORDING != IMU_bbox.state) {
+		return false;
+	}
+
+	IMU_bbox.header.trigger = trigger;
+	IMU_bbox.header.timestamp = (uint32_t)get_ms();
+	IMU_bbox.post = IMU_BBOX_POST + 1;
+	IMU_bbox.mark = true;
+	IMU_bbox.armed = false;
+	IMU_bbox.state = IMU_BBOX_POST_TRIGGER;
+	IMU_LOG1(IMU_LOG_BBOX_TRIGGER, trigger);
+
+	return true;
+
+} /* Fine IMU_bbox_trigger() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_bbox_find
+* Descrizione  	    : Cerca una registrazione completa con i campioni intatti
+* 					  (non durante una scrittura). Le registrazioni hanno
+* 					  progressivi consecutivi: la k-esima dalla piu' recente
+* 					  e' IMU_bbox.latest - k
+* Argomenti         : (uint32_t) number -
+* 						 progressivo
+* 					  (IMU_bbox_header_struct) *h -
+* 					  	 intestazione trovata
+* Valori restituiti : (bool) -
+* 						 false se non c'e' o e' stata in parte sovrascritta
+*******************************************************************************/
+bool IMU_bbox_find(uint32_t number, IMU_bbox_header_struct *h)
+{
+	/* Definisce le variabili locali */
+	IMU_bbox_record_struct r;
+	uint16_t b, i, crc;
+
+	if ((IMU_BBOX_COMMIT == IMU_bbox.state) || (0 == number)) {
+		return false;
+	}
+
+	for (b = 0; b < IMU_FLASH_BLOCKS; b++)
+	{
+		IMU_flash_read(IMU_BBOX_OFFSET(b), h, sizeof(*h));
+		if (!IMU_bbox_header_valid(h, b) || (h->number != number)) {
+			continue;
+		}
+
+		for (i = 0, crc = IMU_TELEM_CRC_INIT; i < h->count; i++)
+		{
+			IMU_bbox_read(h, i, &r);
+			crc = IMU_telem_crc16((const uint8_t *)&r, sizeof(r), crc);
+		}
+		return (crc == h->data_crc);
+	}
+
+	return false;
+
+} /* Fine IMU_bbox_find() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_bbox_read
+* Descrizione  	    : Legge un campione di una registrazione
+* Argomenti         : (IMU_bbox_header_struct) *h -
+* 						 intestazione della registrazione
+* 					  (uint16_t) index -
+* 					  	 campione, dal piu' vecchio
+* 					  (IMU_bbox_record_struct) *r -
+* 					  	 campione letto
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_bbox_read(const IMU_bbox_header_struct *h, uint16_t index, IMU_bbox_record_struct *r)
+{
+	IMU_flash_read(IMU_BBOX_OFFSET(h->block + 1 + index), r, sizeof(*r));
+
+} /* Fine IMU_bbox_read() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_bbox_dump_start
+* Descrizione  	    : Prepara la lettura di tutte le registrazioni, dalla piu'
+* 					  recente
+* Argomenti         : No
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_bbox_dump_start(void)
+{
+	IMU_bbox.dump_number = IMU_bbox.latest;
+	IMU_bbox.dump_index = 0;
+	if (!IMU_bbox_find(IMU_bbox.dump_number, &IMU_bbox.dump)) {
+		IMU_bbox.dump_number = 0;
+	}
+
+} /* Fine IMU_bbox_dump_start() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_bbox_dump
+* Descrizione  	    : Invia sulla telemetria il prossimo campione delle
+* 					  registrazioni. Con la linea occupata non invia nulla e
+* 					  ritenta alla chiamata successiva, quindi nessun campione
+* 					  va perso
+* Argomenti         : No
+* Valori restituiti : (bool) -
+* 						 false a lettura finita
+*******************************************************************************/
+bool IMU_bbox_dump(void)
+{
+	/* Definisce le variabili locali */
+	IMU_bbox_record_struct r;
+
+	if (0 == IMU_bbox.dump_number) {
+		return false;
+	}
+	if (IMU_telem.pending >= 0) {
+		return true;
+	}
+
+	IMU_bbox_read(&IMU_bbox.dump, IMU_bbox.dump_index, &r);
+	if (!IMU_telem_send_bbox(&IMU_bbox.dump, IMU_bbox.dump_index, &r)) {
+		return true;
+	}
+
+	/* Registrazione successiva, la precedente nel tempo */
+	if (++IMU_bbox.dump_index >= IMU_bbox.dump.count)
+	{
+		IMU_bbox.dump_index = 0;
+		IMU_bbox.dump_number--;
+		if (!IMU_bbox_find(IMU_bbox.dump_number, &IMU_bbox.dump)) {
+			IMU_bbox.dump_number = 0;
+		}
+	}
+
+	return true;
+
+} /* Fine IMU_bbox_dump() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_bbox_commit
+* Descrizione  	    : Ferma l'anello, prepara l'intestazione e avvia la prima
+* 					  cancellazione
+* Argomenti         : No
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_bbox_commit(void)
+{
+	/* Definisce le variabili locali */
+	IMU_bbox_header_struct *h = &IMU_bbox.header;
+
+	h->magic = IMU_BBOX_MAGIC;
+	h->number = IMU_bbox.latest + 1;
+	h->count = IMU_bbox.count;
+	h->trigger_index = IMU_bbox.count - 1 - IMU_BBOX_POST;
+	h->block = IMU_bbox.next_block;
+	h->data_crc = IMU_TELEM_CRC_INIT;
+	memset(h->spare, 0, sizeof(h->spare));
+
+	IMU_bbox.first = (IMU_bbox.head + IMU_BBOX_RECORDS - IMU_bbox.count) % IMU_BBOX_RECORDS;
+	IMU_bbox.step = 0;
+	IMU_bbox.state = IMU_BBOX_COMMIT;
+
+	IMU_bbox_next();
+
+} /* Fine IMU_bbox_commit() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_bbox_next
+* Descrizione  	    : Avvia l'operazione successiva della scrittura: prima le
+* 					  cancellazioni di tutti i blocchi, poi i campioni, infine
+* 					  l'intestazione. Chiamata alla fine di ogni operazione
+* 					  dall'interrupt del FCU. Un errore abbandona la
+* 					  registrazione, che resta senza intestazione
+* Argomenti         : No
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_bbox_next(void)
+{
+	/* Definisce le variabili locali */
+	IMU_bbox_header_struct *h = &IMU_bbox.header;
+	const IMU_bbox_record_struct *r;
+	uint16_t blocks = 1 + h->count;
+	uint16_t writes = h->count * IMU_BBOX_WRITES;
+	uint16_t s = IMU_bbox.step;
+	uint16_t rec, part;
+	bool ok;
+
+	if (IMU_BBOX_COMMIT != IMU_bbox.state) {
+		return;
+	}
+
+	if ((s > 0) && (IMU_FLASH_ERROR == IMU_flash_status()))
+	{
+		IMU_bbox.errors++;
+		IMU_bbox.count = 0;
+		IMU_bbox.state = IMU_BBOX_RECORDING;
+		return;
+	}
+
+	if (s < blocks) {
+		ok = IMU_flash_erase(IMU_BBOX_OFFSET(h->block + s));
+	}
+	else if (s < blocks + writes)
+	{
+		rec = (s - blocks) / IMU_BBOX_WRITES;
+		part = (s - blocks) % IMU_BBOX_WRITES;
+		r = &IMU_bbox.ring[(IMU_bbox.first + rec) % IMU_BBOX_RECORDS];
+		if (0 == part) {
+			h->data_crc = IMU_telem_crc16((const uint8_t *)r, sizeof(*r), h->data_crc);
+		}
+		ok = IMU_flash_program(IMU_BBOX_OFFSET(h->block + 1 + rec) + part * IMU_FLASH_WRITE,
+							   (const uint8_t *)r + part * IMU_FLASH_WRITE);
+	}
+	else if (s < blocks + writes + IMU_BBOX_WRITES)
+	{
+		part = s - blocks - writes;
+		if (0 == part) {
+			h->crc = IMU_telem_crc16((const uint8_t *)h, sizeof(*h) - 2, IMU_TELEM_CRC_INIT);
+		}
+		ok = IMU_flash_program(IMU_BBOX_OFFSET(h->block) + part * IMU_FLASH_WRITE,
+							   (const uint8_t *)h + part * IMU_FLASH_WRITE);
+	}
+	else
+	{
+		/* Registrazione completa: l'anello riparte vuoto */
+		IMU_bbox.latest = h->number;
+		IMU_bbox.next_block = (uint16_t)((h->block + blocks) % IMU_FLASH_BLOCKS);
+		IMU_bbox.commits++;
+		IMU_bbox.count = 0;
+		IMU_bbox.state = IMU_BBOX_RECORDING;
+		return;
+	}
+
+	if (!ok)
+	{
+		IMU_bbox.errors++;
+		IMU_bbox.count = 0;
+		IMU_bbox.state = IMU_BBOX_RECORDING;
+		return;
+	}
+	IMU_bbox.step = s + 1;
+
+} /* Fine IMU_bbox_next() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_bbox_header_valid
+* Descrizione  	    : Controlla firma, CRC e posizione di un'intestazione letta
+* 					  dalla data flash (le celle cancellate hanno contenuto
+* 					  indefinito)
+* Argomenti         : (IMU_bbox_header_struct) *h -
+* 						 intestazione
+* 					  (uint16_t) block -
+* 					  	 blocco da cui e' stata letta
+* Valori restituiti : (bool) -
+* 						 true se valida
+*******************************************************************************/
+static bool IMU_bbox_header_valid(const IMU_bbox_header_struct *h, uint16_t block)
+{
+	return (IMU_BBOX_MAGIC == h->magic) && (block == h->block) &&
+		   (h->count > 0) && (h->count <= IMU_BBOX_RECORDS) &&
+		   (h->crc == IMU_telem_crc16((const uint8_t *)h, sizeof(*h) - 2, IMU_TELEM_CRC_INIT));
+
+} /* Fine IMU_bbox_header_valid() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_bbox_pack
+* Descrizione  	    : Converte in virgola fissa a 16 bit con saturazione
+* Argomenti         : (float) v -
+* 						 valore
+* 					  (float) scale -
+* 					  	 LSB per unita'
+* Valori restituiti : (int16_t) -
+* 						 valore convertito
+*******************************************************************************/
+static int16_t IMU_bbox_pack(float v, float scale)
+{
+	v *= scale;
+	if (v > 32767.0f) {
+		return 32767;
+	}
+	if (v < -32768.0f) {
+		return -32768;
+	}
+
+	return (int16_t)floorf(v + 0.5f);
+
+} /* Fine IMU_bbox_pack() */
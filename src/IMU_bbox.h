@@ -0,0 +1,125 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _IMU_BBOX_H_
+#define _IMU_BBOX_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "main.h"
+#include "IMU_flash.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_BBOX_RECORDS					256		/* campioni nell'anello: 2.56 s a 100 Hz */
+#define IMU_BBOX_POST						50		/* campioni registrati dopo l'evento */
+#define IMU_BBOX_FALL_ANGLE					0.6f	/* inclinazione della caduta (rad, circa 35 grad) */
+#define IMU_BBOX_REARM_ANGLE				0.2f	/* inclinazione sotto cui la caduta si riarma (rad) */
+#define IMU_BBOX_ANGLE_SCALE				10000.0f	/* LSB per rad */
+#define IMU_BBOX_OMEGA_SCALE				1000.0f		/* LSB per rad/s */
+#define IMU_BBOX_MAGIC						0x31584242UL	/* "BBX1" */
+#define IMU_BBOX_FLAG_TRIGGER				0x01	/* campione dell'evento */
+#define IMU_BBOX_WRITES						(IMU_FLASH_BLOCK / IMU_FLASH_WRITE)	/* programmazioni per blocco */
+
+/*******************************************************************************
+Definizione enumerazioni
+*******************************************************************************/
+/* Causa della registrazione */
+enum IMU_bbox_trigger_e {
+	IMU_BBOX_FALL = 1,
+	IMU_BBOX_SWITCH,
+	NUM_IMU_BBOX_TRIGGER
+};
+
+/* Stato del registratore */
+enum IMU_bbox_state_e {
+	IMU_BBOX_OFF = 0,				/* data flash non disponibile */
+	IMU_BBOX_RECORDING,
+	IMU_BBOX_POST_TRIGGER,			/* evento avvenuto, registra gli ultimi IMU_BBOX_POST campioni */
+	IMU_BBOX_COMMIT,				/* anello fermo, scrittura in data flash in corso */
+	NUM_IMU_BBOX_STATE
+};
+
+/*******************************************************************************
+Definizione strutture
+*******************************************************************************/
+/* Campione registrato: un blocco di cancellazione della data flash */
+typedef struct
+{
+	uint32_t timestamp;				/* ms da CMT */
+	int16_t  angle[3];				/* rollio, beccheggio, imbardata (IMU_BBOX_ANGLE_SCALE) */
+	int16_t  omega[3];				/* velocita' angolari (IMU_BBOX_OMEGA_SCALE) */
+	int16_t  accel[3];				/* accelerometro del primo sensore in linea (LSB) */
+	int16_t  control[3];			/* comandi dei motori (IMU_bbox_set_control) */
+	uint16_t work;					/* durata di IMU_result (unita' di CMT_counter) */
+	uint8_t  sensors;				/* sensori in linea */
+	uint8_t  flags;
+
+} IMU_bbox_record_struct;
+
+/* Intestazione della registrazione, nel blocco che precede i campioni. Viene
+   scritta per ultima: una registrazione interrotta non ha intestazione */
+typedef struct
+{
+	uint32_t magic;
+	uint32_t number;				/* progressivo, dal piu' vecchio al piu' recente */
+	uint32_t timestamp;				/* istante dell'evento (ms) */
+	uint16_t count;					/* campioni registrati */
+	uint16_t trigger_index;			/* campione dell'evento */
+	uint16_t block;					/* blocco dell'intestazione */
+	uint8_t  trigger;				/* IMU_bbox_trigger_e */
+	uint8_t  spare[9];
+	uint16_t data_crc;				/* CRC dei campioni */
+	uint16_t crc;					/* CRC dei byte precedenti */
+
+} IMU_bbox_header_struct;
+
+/* Registratore. La data flash e' un log circolare di registrazioni contigue
+   (intestazione e campioni, un blocco ciascuno): la testa avanza ad ogni
+   registrazione e cancella le piu' vecchie, quindi ogni blocco viene
+   cancellato con la stessa frequenza. state, step e la testa sono scritti
+   anche dall'interrupt del FCU durante la scrittura */
+typedef struct
+{
+	IMU_bbox_record_struct ring[IMU_BBOX_RECORDS];
+	uint16_t head;					/* prossima posizione nell'anello */
+	uint16_t count;					/* campioni nell'anello */
+	uint16_t post;					/* campioni ancora da registrare dopo l'evento */
+	int16_t  control[3];
+	bool     armed;					/* robot in piedi: la caduta puo' scattare */
+	bool     mark;					/* il prossimo campione e' quello dell'evento */
+	volatile uint8_t state;			/* IMU_bbox_state_e */
+	IMU_bbox_header_struct header;	/* registrazione in scrittura */
+	volatile uint16_t step;			/* operazione del FCU in corso */
+	uint16_t first;					/* posizione nell'anello del campione piu' vecchio */
+	uint16_t next_block;			/* testa del log in data flash */
+	uint32_t latest;				/* progressivo dell'ultima registrazione (0: nessuna) */
+	uint32_t dump_number;			/* lettura in corso con IMU_bbox_dump */
+	uint16_t dump_index;
+	IMU_bbox_header_struct dump;
+	uint32_t commits;
+	uint32_t errors;				/* scritture fallite */
+
+} IMU_bbox_struct;
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+extern IMU_bbox_struct IMU_bbox;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+bool IMU_bbox_init(void);
+void IMU_bbox_log(const IMU_data_struct *x, const IMU_dev_struct *dev, uint8_t num_dev, uint16_t work);
+void IMU_bbox_set_control(const int16_t *control);
+bool IMU_bbox_trigger(uint8_t trigger);
+bool IMU_bbox_find(uint32_t number, IMU_bbox_header_struct *h);
+void IMU_bbox_read(const IMU_bbox_header_struct *h, uint16_t index, IMU_bbox_record_struct *r);
+void IMU_bbox_dump_start(void);
+bool IMU_bbox_dump(void);
+
+#endif /* _IMU_BBOX_H_ */
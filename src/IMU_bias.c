@@ -0,0 +1,174 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <mathf.h>
+#include <stdbool.h>
+#include <string.h>
+#include "platform.h"
+#include "IMU.h"
+#include "IMU_bias.h"
+#include "IMU_calib.h"
+#include "IMU_regmap.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_BIAS_GYRO_VAR_MAX				0.09f		/* varianza massima del giroscopio in quiete ((grad/s)^2) */
+#define IMU_BIAS_ACCEL_VAR_MAX				0.0001f		/* varianza massima dell'accelerometro in quiete (g^2) */
+#define IMU_BIAS_MAX_STEP					1.0f		/* massima distanza tra media e bias attuale (grad/s): oltre
+														   e' una rotazione lenta, non deriva */
+#define IMU_BIAS_ALPHA						0.002f		/* guadagno del passa basso (costante di tempo di circa
+														   500 campioni, 5 s a 100 Hz) */
+#define IMU_BIAS_ZRMOT_THR					4			/* soglia zero-motion del sensore */
+#define IMU_BIAS_ZRMOT_DUR					2			/* durata zero-motion del sensore (64 ms per LSB) */
+
+/*******************************************************************************
+* Nome funzione     : IMU_bias_init
+* Descrizione  	    : Azzera la finestra del rilevatore di quiete e, se
+* 					  richiesto da dev->config.bias_zmot, attiva il rilevatore
+* 					  zero-motion del sensore (usa il filtro passa alto
+* 					  dell'accelerometro, che non altera i dati in uscita)
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della configurazione
+*******************************************************************************/
+riic_ret_t IMU_bias_init(IMU_dev_struct *dev)
+{
+	memset(&dev->bias, 0, sizeof(dev->bias));
+	dev->bias.last_sample = dev->stats.samples;
+
+	if (!dev->config.bias_zmot) {
+		return RIIC_OK;
+	}
+
+	/* ZRMOT_THR e ZRMOT_DUR sono contigui: una sola scrittura insieme ad ACCEL_CONFIG e INT_ENABLE */
+	IMU_reg_set(dev, INV_MPU6050_REG_ZRMOT_THR, IMU_BIAS_ZRMOT_THR);
+	IMU_reg_set(dev, INV_MPU6050_REG_ZRMOT_DUR, IMU_BIAS_ZRMOT_DUR);
+	IMU_reg_update_bits(dev, INV_MPU6050_REG_ACCEL_CONFIG, INV_MPU6050_BITS_ACCEL_HPF, INV_MPU6050_ACCEL_HPF_5HZ);
+	IMU_reg_update_bits(dev, INV_MPU6050_REG_INT_ENABLE, INV_MPU6050_BIT_ZMOT_EN, INV_MPU6050_BIT_ZMOT_EN);
+
+	return IMU_reg_flush(dev);
+
+} /* Fine IMU_bias_init() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_bias_update
+* Descrizione  	    : Aggiunge l'ultimo campione alla finestra scorrevole e, se
+* 					  le varianze di accelerometro e giroscopio indicano che il
+* 					  sensore e' fermo, avvicina lentamente gli offset del
+* 					  giroscopio alla media della finestra.
+* 					  Va chiamata dopo ogni IMU_dev_sample; un campione gia'
+* 					  visto viene ignorato
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_bias_update(IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	IMU_bias_struct *b = &dev->bias;
+	IMU_data_struct *x = &dev->data;
+	int16_t *slot;
+	int16_t sample[6];
+	float mean[6], var, scale2;
+	uint8_t zmot_status;
+	uint8_t k;
+
+	/* Nessun campione nuovo */
+	if (b->last_sample == dev->stats.samples) {
+		return;
+	}
+	b->last_sample = dev->stats.samples;
+
+	sample[0] = dev->raw.accel[0];
+	sample[1] = dev->raw.accel[1];
+	sample[2] = dev->raw.accel[2];
+	sample[3] = dev->raw.gyro[0];
+	sample[4] = dev->raw.gyro[1];
+	sample[5] = dev->raw.gyro[2];
+
+	/* Sostituisce il campione piu' vecchio aggiornando somme e somme dei quadrati */
+	slot = b->window[b->head];
+	for (k = 0; k < 6; k++)
+	{
+		if (b->count == IMU_BIAS_WINDOW)
+		{
+			b->sum[k]   -= slot[k];
+			b->sumsq[k] -= (int32_t)slot[k] * slot[k];
+		}
+		slot[k] = sample[k];
+		b->sum[k]   += sample[k];
+		b->sumsq[k] += (int32_t)sample[k] * sample[k];
+	}
+	b->head = (b->head + 1) & (IMU_BIAS_WINDOW - 1);
+	if (b->count < IMU_BIAS_WINDOW) {
+		b->count++;
+		return;
+	}
+
+	/* Media e varianza di ogni canale (varianza = E[x^2] - E[x]^2), in unita' fisiche.
+	 La media del giroscopio e' al netto del bias termico: qui si stima solo il residuo */
+	b->still = true;
+	for (k = 0; k < 6; k++)
+	{
+		mean[k] = (float)b->sum[k] * (1.0f / IMU_BIAS_WINDOW);
+		var = (float)b->sumsq[k] * (1.0f / IMU_BIAS_WINDOW) - mean[k] * mean[k];
+
+		if (k < 3)
+		{
+			scale2 = dev->accel_scale * dev->accel_scale;
+			if (var * scale2 > IMU_BIAS_ACCEL_VAR_MAX) {
+				b->still = false;
+			}
+		}
+		else
+		{
+			scale2 = dev->gyro_scale * dev->gyro_scale;
+			if (var * scale2 > IMU_BIAS_GYRO_VAR_MAX) {
+				b->still = false;
+			}
+		}
+	}
+
+	/* La media del giroscopio va portata negli assi calibrati e in rad/s, come gli offset */
+	IMU_calib_gyro_mean(dev, &mean[3], &mean[3]);
+	for (k = 3; k < 6; k++) {
+		mean[k] *= IMU_DEG_TO_RAD;
+	}
+
+	/* Una rotazione lenta e costante ha varianza bassa: la media deve restare vicina al bias attuale */
+	for (k = 0; k < 3; k++)
+	{
+		if (fabsf(mean[k + 3] - x->off_omega[k]) > IMU_BIAS_MAX_STEP * IMU_DEG_TO_RAD) {
+			b->still = false;
+		}
+	}
+
+	/* Conferma con il rilevatore del sensore, letto una volta per finestra */
+	if (dev->config.bias_zmot)
+	{
+		if (++b->zmot_poll >= IMU_BIAS_WINDOW)
+		{
+			b->zmot_poll = 0;
+			if (RIIC_OK == IMU_read(dev, INV_MPU6050_REG_MOT_DETECT_STATUS, &zmot_status, 1)) {
+				b->zmot = (0 != (zmot_status & INV_MPU6050_BIT_ZRMOT));
+			}
+		}
+		b->still = b->still && b->zmot;
+	}
+
+	if (!b->still) {
+		return;
+	}
+
+	/* Aggiorna gli offset con un passa basso lento */
+	for (k = 0; k < 3; k++) {
+		x->off_omega[k] += IMU_BIAS_ALPHA * (mean[k + 3] - x->off_omega[k]);
+	}
+
+	b->updates++;
+
+} /* Fine IMU_bias_update() */
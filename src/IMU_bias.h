@@ -0,0 +1,18 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _IMU_BIAS_H_
+#define _IMU_BIAS_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include "main.h"
+#include "r_riic_rx600.h"
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+riic_ret_t IMU_bias_init(IMU_dev_struct *dev);
+void IMU_bias_update(IMU_dev_struct *dev);
+
+#endif /* _IMU_BIAS_H_ */
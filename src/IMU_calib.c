@@ -0,0 +1,857 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <machine.h>
+#include <mathf.h>
+#include <stdbool.h>
+#include <string.h>
+#include "platform.h"
+#include "CMT.h"
+#include "IMU.h"
+#include "IMU_calib.h"
+#include "IMU_mag.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_CALIB_ONE						(1 << IMU_CALIB_Q)	/* 1.0 in Q14 */
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static void IMU_calib_build (IMU_calib_struct *cal);
+static void IMU_calib_quantize (const float (*level)[3], const float (*M)[3], int16_t (*q)[3]);
+static void IMU_calib_kernel (const int16_t (*q)[3], const int16_t *raw, const float *b, const float *tc,
+							  float scale, float *v);
+static bool IMU_calib_solve4 (float (*a)[4], float *y, float *x);
+static bool IMU_calib_wait_key (void);
+static bool IMU_calib_average (IMU_dev_struct *dev, bool gyro, float *mean);
+
+/*******************************************************************************
+* Nome funzione     : IMU_calib_set_model
+* Descrizione  	    : Carica i modelli di calibrazione di accelerometro e
+* 					  giroscopio. Va chiamata prima di IMU_init; se non viene
+* 					  chiamata IMU_dev_init carica il modello ideale. La prima
+* 					  chiamata carica anche il modello ideale del magnetometro
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (IMU_calmodel_struct) *accel -
+* 					  	 modello dell'accelerometro (0 per il modello ideale)
+* 					  (IMU_calmodel_struct) *gyro -
+* 					  	 modello del giroscopio (0 per il modello ideale)
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_calib_set_model(IMU_dev_struct *dev, const IMU_calmodel_struct *accel, const IMU_calmodel_struct *gyro)
+{
+	/* Definisce le variabili locali */
+	IMU_calib_struct *cal = &dev->calib;
+	IMU_calmodel_struct model[2];
+	uint8_t i;
+
+	/* Copia prima di modificare: i modelli possono essere quelli gia' caricati */
+	memset(model, 0, sizeof(model));
+	for (i = 0; i < 3; i++)
+	{
+		model[0].M[i][i] = 1.0f;
+		model[1].M[i][i] = 1.0f;
+	}
+
+	if (0 != accel) {
+		model[0] = *accel;
+	}
+	if (0 != gyro) {
+		model[1] = *gyro;
+	}
+
+	cal->accel = model[0];
+	cal->gyro  = model[1];
+
+	if (!cal->loaded) {
+		memset(&cal->mag, 0, sizeof(cal->mag));
+		for (i = 0; i < 3; i++) {
+			cal->mag.M[i][i] = 1.0f;
+		}
+	}
+
+	cal->loaded = true;
+
+	/* Il livellamento precedente non vale piu' per il nuovo modello */
+	IMU_calib_set_level(dev, 0);
+
+} /* Fine IMU_calib_set_model() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_calib_set_mag_model
+* Descrizione  	    : Carica il modello del magnetometro: b e' il ferro duro
+* 					  (LSB), M il ferro dolce. Va chiamata dopo
+* 					  IMU_calib_set_model
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (IMU_calmodel_struct) *mag -
+* 					  	 modello del magnetometro (0 per il modello ideale)
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_calib_set_mag_model(IMU_dev_struct *dev, const IMU_calmodel_struct *mag)
+{
+	/* Definisce le variabili locali */
+	IMU_calib_struct *cal = &dev->calib;
+	uint8_t i;
+
+	if (0 != mag) {
+		cal->mag = *mag;
+	}
+	else
+	{
+		memset(&cal->mag, 0, sizeof(cal->mag));
+		for (i = 0; i < 3; i++) {
+			cal->mag.M[i][i] = 1.0f;
+		}
+	}
+
+	IMU_calib_build(cal);
+
+} /* Fine IMU_calib_set_mag_model() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_calib_set_level
+* Descrizione  	    : Calcola la rotazione minima che porta la gravita' misurata
+* 					  sull'asse z del robot e la applica ad entrambi i sensori,
+* 					  cosi' gli angoli sono esatti anche per inclinazioni ampie
+* 					  invece di essere corretti per sottrazione
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (float) *g -
+* 					  	 gravita' misurata con il robot in piedi, gia' calibrata
+* 					  	 (0 per togliere il livellamento)
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_calib_set_level(IMU_dev_struct *dev, const float *g)
+{
+	/* Definisce le variabili locali */
+	IMU_calib_struct *cal = &dev->calib;
+	float u[3], K[3][3], n, c, f;
+	uint8_t i, j, k;
+
+	memset(cal->level, 0, sizeof(cal->level));
+	for (i = 0; i < 3; i++) {
+		cal->level[i][i] = 1.0f;
+	}
+
+	if (0 != g)
+	{
+		n = sqrtf(g[0]*g[0] + g[1]*g[1] + g[2]*g[2]);
+
+		/* Con la scheda capovolta la rotazione non e' definita: resta l'identita' */
+		if (n > 0.0f)
+		{
+			u[0] = g[0] / n;
+			u[1] = g[1] / n;
+			u[2] = g[2] / n;
+			c = u[2];
+
+			if (c > -0.99f)
+			{
+				/* Rodrigues: R = I + K + K^2 / (1 + c), K = [u x z] */
+				memset(K, 0, sizeof(K));
+				K[0][2] = -u[0];
+				K[1][2] = -u[1];
+				K[2][0] =  u[0];
+				K[2][1] =  u[1];
+
+				f = 1.0f / (1.0f + c);
+				for (i = 0; i < 3; i++)
+				{
+					for (j = 0; j < 3; j++)
+					{
+						cal->level[i][j] += K[i][j];
+						for (k = 0; k < 3; k++) {
+							cal->level[i][j] += K[i][k] * K[k][j] * f;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	IMU_calib_build(cal);
+
+} /* Fine IMU_calib_set_level() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_calib_accel
+* Descrizione  	    : Applica la calibrazione all'ultimo campione
+* 					  dell'accelerometro
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (float) *v -
+* 					  	 accelerazione calibrata, assi del robot (g)
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_calib_accel(IMU_dev_struct *dev, float *v)
+{
+	IMU_calib_kernel((const int16_t (*)[3])dev->calib.accel_q, dev->raw.accel, dev->calib.accel.b,
+					 &dev->tempcomp.bias[3], dev->accel_scale, v);
+
+} /* Fine IMU_calib_accel() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_calib_gyro
+* Descrizione  	    : Applica la calibrazione all'ultimo campione del
+* 					  giroscopio (gli offset stimati all'avvio e dal
+* 					  rilevatore di quiete non sono compresi)
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (float) *v -
+* 					  	 velocita' angolare calibrata, assi del robot (grad/s)
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_calib_gyro(IMU_dev_struct *dev, float *v)
+{
+	IMU_calib_kernel((const int16_t (*)[3])dev->calib.gyro_q, dev->raw.gyro, dev->calib.gyro.b,
+					 &dev->tempcomp.bias[0], dev->gyro_scale, v);
+
+} /* Fine IMU_calib_gyro() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_calib_gyro_mean
+* Descrizione  	    : Come IMU_calib_gyro, ma per un valore medio in LSB
+* 					  (non intero) invece che per l'ultimo campione
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (float) *mean -
+* 					  	 media grezza del giroscopio (LSB)
+* 					  (float) *v -
+* 					  	 media calibrata, assi del robot (grad/s)
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_calib_gyro_mean(IMU_dev_struct *dev, const float *mean, float *v)
+{
+	/* Definisce le variabili locali */
+	const int16_t (*q)[3] = (const int16_t (*)[3])dev->calib.gyro_q;
+	float d[3], inv = 1.0f / dev->gyro_scale;
+	float scale = dev->gyro_scale * (1.0f / IMU_CALIB_ONE);
+	uint8_t k;
+
+	for (k = 0; k < 3; k++) {
+		d[k] = mean[k] - dev->calib.gyro.b[k] - dev->tempcomp.bias[k] * inv;
+	}
+
+	for (k = 0; k < 3; k++) {
+		v[k] = ((float)q[k][0] * d[0] + (float)q[k][1] * d[1] + (float)q[k][2] * d[2]) * scale;
+	}
+
+} /* Fine IMU_calib_gyro_mean() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_calib_mag
+* Descrizione  	    : Applica la calibrazione a un campione del magnetometro
+* 					  (senza compensazione termica)
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (int16_t) *raw -
+* 					  	 campione grezzo negli assi del magnetometro
+* 					  (float) *v -
+* 					  	 campo calibrato, assi del robot (gauss)
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_calib_mag(IMU_dev_struct *dev, const int16_t *raw, float *v)
+{
+	/* Definisce le variabili locali */
+	static const float zero[3] = {0.0f, 0.0f, 0.0f};
+
+	IMU_calib_kernel((const int16_t (*)[3])dev->calib.mag_q, raw, dev->calib.mag.b, zero, dev->mag.scale, v);
+
+} /* Fine IMU_calib_mag() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_calib_fit
+* Descrizione  	    : Stima ai minimi quadrati il modello ref = M * (meas - b)
+* 					  da almeno quattro coppie misura/riferimento non
+* 					  complanari. Il modello affine ref = A * [meas; 1] e'
+* 					  lineare nei parametri: per ogni riga di A si risolvono
+* 					  le equazioni normali 4x4, poi b = -M^-1 * A[:,3]
+* Argomenti         : (float) (*meas)[3] -
+* 						 misure (LSB)
+* 					  (float) (*ref)[3] -
+* 					  	 valori attesi (LSB nominali)
+* 					  (uint8_t) n -
+* 					  	 numero di coppie
+* 					  (IMU_calmodel_struct) *model -
+* 					  	 modello stimato
+* Valori restituiti : (bool) -
+* 						 false se i punti non determinano il modello
+*******************************************************************************/
+bool IMU_calib_fit(const float (*meas)[3], const float (*ref)[3], uint8_t n, IMU_calmodel_struct *model)
+{
+	/* Definisce le variabili locali */
+	float N[4][4], y[4], a[4], x[4], c[3], inv[3][3], det, k;
+	uint8_t i, r, p, q;
+
+	if (n < 4) {
+		return false;
+	}
+
+	/* Normalizza sul modulo del primo riferimento per contenere i prodotti in singola precisione */
+	k = sqrtf(ref[0][0]*ref[0][0] + ref[0][1]*ref[0][1] + ref[0][2]*ref[0][2]);
+	if (k <= 0.0f) {
+		return false;
+	}
+	k = 1.0f / k;
+
+	for (r = 0; r < 3; r++)
+	{
+		memset(N, 0, sizeof(N));
+		memset(y, 0, sizeof(y));
+		for (i = 0; i < n; i++)
+		{
+			x[0] = meas[i][0] * k;
+			x[1] = meas[i][1] * k;
+			x[2] = meas[i][2] * k;
+			x[3] = 1.0f;
+			for (p = 0; p < 4; p++)
+			{
+				y[p] += x[p] * ref[i][r] * k;
+				for (q = 0; q < 4; q++) {
+					N[p][q] += x[p] * x[q];
+				}
+			}
+		}
+
+		if (!IMU_calib_solve4(N, y, a)) {
+			return false;
+		}
+
+		model->M[r][0] = a[0];
+		model->M[r][1] = a[1];
+		model->M[r][2] = a[2];
+		c[r] = a[3] / k;
+	}
+
+	/* b = -M^-1 * c, con l'inversa per cofattori */
+	inv[0][0] = model->M[1][1]*model->M[2][2] - model->M[1][2]*model->M[2][1];
+	inv[0][1] = model->M[0][2]*model->M[2][1] - model->M[0][1]*model->M[2][2];
+	inv[0][2] = model->M[0][1]*model->M[1][2] - model->M[0][2]*model->M[1][1];
+	inv[1][0] = model->M[1][2]*model->M[2][0] - model->M[1][0]*model->M[2][2];
+	inv[1][1] = model->M[0][0]*model->M[2][2] - model->M[0][2]*model->M[2][0];
+	inv[1][2] = model->M[0][2]*model->M[1][0] - model->M[0][0]*model->M[1][2];
+	inv[2][0] = model->M[1][0]*model->M[2][1] - model->M[1][1]*model->M[2][0];
+	inv[2][1] = model->M[0][1]*model->M[2][0] - model->M[0][0]*model->M[2][1];
+	inv[2][2] = model->M[0][0]*model->M[1][1] - model->M[0][1]*model->M[1][0];
+	det = model->M[0][0]*inv[0][0] + model->M[0][1]*inv[1][0] + model->M[0][2]*inv[2][0];
+	if (fabsf(det) < 1.0e-6f) {
+		return false;
+	}
+
+	for (r = 0; r < 3; r++) {
+		model->b[r] = -(inv[r][0]*c[0] + inv[r][1]*c[1] + inv[r][2]*c[2]) / det;
+	}
+
+	return true;
+
+} /* Fine IMU_calib_fit() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_calib_accel_six_position
+* Descrizione  	    : Calibrazione dell'accelerometro a sei posizioni guidata
+* 					  dai pulsanti: per ogni posizione indicata sul display si
+* 					  appoggia la scheda, si preme SW1 e si attende la misura.
+* 					  SW3 annulla. Il modello del giroscopio non cambia
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : (bool) -
+* 						 true se il nuovo modello e' stato caricato
+*******************************************************************************/
+bool IMU_calib_accel_six_position(IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	static const int8_t up[IMU_CALIB_POSITIONS][3] = {{0, 0, 1}, {0, 0, -1}, {1, 0, 0},
+													  {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}};
+	static const char * const label[IMU_CALIB_POSITIONS] = {"Z su", "Z giu'", "X su", "X giu'", "Y su", "Y giu'"};
+	float meas[IMU_CALIB_POSITIONS][3], ref[IMU_CALIB_POSITIONS][3];
+	IMU_calmodel_struct model;
+	uint8_t i, k;
+
+	for (i = 0; i < IMU_CALIB_POSITIONS; i++)
+	{
+		lcd_display(LCD_LINE1, (const uint8_t *)"Calib. acc.");
+		lcd_display(LCD_LINE2, (const uint8_t *)label[i]);
+		lcd_display(LCD_LINE3, (const uint8_t *)"SW1 misura");
+		lcd_display(LCD_LINE4, (const uint8_t *)"SW3 annulla");
+		if (!IMU_calib_wait_key()) {
+			return false;
+		}
+
+		lcd_display(LCD_LINE3, (const uint8_t *)"Misura...");
+		if (!IMU_calib_average(dev, false, meas[i])) {
+			return false;
+		}
+
+		/* La gravita' attesa e' +1 g sull'asse rivolto verso l'alto */
+		for (k = 0; k < 3; k++) {
+			ref[i][k] = (float)up[i][k] / dev->accel_scale;
+		}
+	}
+
+	if (!IMU_calib_fit((const float (*)[3])meas, (const float (*)[3])ref, IMU_CALIB_POSITIONS, &model)) {
+		return false;
+	}
+
+	IMU_calib_set_model(dev, &model, &dev->calib.gyro);
+
+	return true;
+
+} /* Fine IMU_calib_accel_six_position() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_calib_gyro_scale
+* Descrizione  	    : Calibrazione della scala del giroscopio: per ogni asse si
+* 					  preme SW1 con il robot fermo, lo si ruota di un giro
+* 					  completo attorno all'asse e si preme di nuovo SW1.
+* 					  La scala e' il rapporto tra il giro e l'integrale della
+* 					  velocita' misurata. SW3 annulla
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : (bool) -
+* 						 true se il nuovo modello e' stato caricato
+*******************************************************************************/
+bool IMU_calib_gyro_scale(IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	static const char * const label[3] = {"Asse X", "Asse Y", "Asse Z"};
+	IMU_calmodel_struct model;
+	float rest[3], omega, prev, angle;
+	uint32_t now, last;
+	int32_t period = INV_MPU6050_ONE_K_HZ / dev->config.rate_hz;
+	uint8_t k;
+
+	memset(&model, 0, sizeof(model));
+
+	for (k = 0; k < 3; k++)
+	{
+		lcd_display(LCD_LINE1, (const uint8_t *)"Calib. gyro");
+		lcd_display(LCD_LINE2, (const uint8_t *)label[k]);
+		lcd_display(LCD_LINE3, (const uint8_t *)"SW1 inizio");
+		lcd_display(LCD_LINE4, (const uint8_t *)"SW3 annulla");
+		if (!IMU_calib_wait_key()) {
+			return false;
+		}
+
+		/* Bias a riposo, misurato subito prima della rotazione */
+		lcd_display(LCD_LINE3, (const uint8_t *)"Fermo...");
+		if (!IMU_calib_average(dev, true, rest)) {
+			return false;
+		}
+
+		/* Integra con il tempo effettivo tra due letture (regola dei trapezi) */
+		lcd_display(LCD_LINE3, (const uint8_t *)"Ruota 360");
+		lcd_display(LCD_LINE4, (const uint8_t *)"SW1 fine");
+		angle = 0.0f;
+		prev = 0.0f;
+		last = get_ms();
+		while (SW_ACTIVE != SW1)
+		{
+			ms_delay(period);
+			if (RIIC_OK != IMU_dev_sample(dev)) {
+				continue;
+			}
+			now = get_ms();
+			omega = ((float)dev->raw.gyro[k] - rest[k]) * dev->gyro_scale - dev->tempcomp.bias[k];
+			angle += 0.5f * (omega + prev) * (float)(now - last) * 0.001f;
+			prev = omega;
+			last = now;
+		}
+		while (SW_ACTIVE == SW1) {
+		}
+		ms_delay(IMU_CALIB_DEBOUNCE_MS);
+
+		/* Meno di mezzo giro e' certamente un errore dell'operatore */
+		if (fabsf(angle) < 0.5f * IMU_CALIB_TURN_DEG) {
+			return false;
+		}
+
+		/* Assi incrociati non osservabili con questa procedura: solo la diagonale */
+		model.M[k][k] = IMU_CALIB_TURN_DEG / fabsf(angle);
+	}
+
+	IMU_calib_set_model(dev, &dev->calib.accel, &model);
+
+	return true;
+
+} /* Fine IMU_calib_gyro_scale() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_calib_mag_rotate
+* Descrizione  	    : Calibrazione del magnetometro: si preme SW1, si ruota il
+* 					  robot in tutte le direzioni e si preme di nuovo SW1.
+* 					  Dai minimi e massimi di ogni asse: ferro duro al centro
+* 					  dell'intervallo e ferro dolce come diagonale che porta i
+* 					  tre semiassi al loro valore medio. SW3 annulla
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : (bool) -
+* 						 true se il nuovo modello e' stato caricato
+*******************************************************************************/
+bool IMU_calib_mag_rotate(IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	IMU_calmodel_struct model;
+	int16_t r[3], lo[3], hi[3];
+	float half[3], mean;
+	int32_t period = INV_MPU6050_ONE_K_HZ / dev->config.rate_hz;
+	uint8_t k;
+
+	if (!dev->mag.enabled) {
+		return false;
+	}
+
+	lcd_display(LCD_LINE1, (const uint8_t *)"Calib. mag.");
+	lcd_display(LCD_LINE2, (const uint8_t *)"Tutte le dir.");
+	lcd_display(LCD_LINE3, (const uint8_t *)"SW1 inizio");
+	lcd_display(LCD_LINE4, (const uint8_t *)"SW3 annulla");
+	if (!IMU_calib_wait_key()) {
+		return false;
+	}
+
+	lcd_display(LCD_LINE3, (const uint8_t *)"Ruota...");
+	lcd_display(LCD_LINE4, (const uint8_t *)"SW1 fine");
+	for (k = 0; k < 3; k++)
+	{
+		lo[k] = 32767;
+		hi[k] = -32768;
+	}
+	while (SW_ACTIVE != SW1)
+	{
+		ms_delay(period);
+		if ((RIIC_OK != IMU_dev_sample(dev)) || !IMU_mag_raw(dev, r)) {
+			continue;
+		}
+		for (k = 0; k < 3; k++)
+		{
+			if (r[k] < lo[k]) {
+				lo[k] = r[k];
+			}
+			if (r[k] > hi[k]) {
+				hi[k] = r[k];
+			}
+		}
+	}
+	while (SW_ACTIVE == SW1) {
+	}
+	ms_delay(IMU_CALIB_DEBOUNCE_MS);
+
+	/* Un asse che non ha visto il campo in entrambi i versi non e' stimabile */
+	memset(&model, 0, sizeof(model));
+	mean = 0.0f;
+	for (k = 0; k < 3; k++)
+	{
+		half[k] = 0.5f * ((float)hi[k] - (float)lo[k]);
+		if (half[k] * dev->mag.scale < IMU_CALIB_MAG_MIN_FIELD) {
+			return false;
+		}
+		model.b[k] = 0.5f * ((float)hi[k] + (float)lo[k]);
+		mean += half[k] * (1.0f / 3.0f);
+	}
+	for (k = 0; k < 3; k++) {
+		model.M[k][k] = mean / half[k];
+	}
+
+	IMU_calib_set_mag_model(dev, &model);
+
+	return true;
+
+} /* Fine IMU_calib_mag_rotate() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_calib_run
+* Descrizione  	    : Procedura completa: sei posizioni dell'accelerometro,
+* 					  scala del giroscopio, magnetometro (se presente), poi
+* 					  livellamento e offset con il robot di nuovo in piedi.
+* 					  Il modello resta in RAM fino al reset
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : (bool) -
+* 						 true se la procedura e' stata completata
+*******************************************************************************/
+bool IMU_calib_run(IMU_dev_struct *dev)
+{
+	if (!IMU_calib_accel_six_position(dev) || !IMU_calib_gyro_scale(dev)) {
+		return false;
+	}
+	if (dev->mag.enabled && !IMU_calib_mag_rotate(dev)) {
+		return false;
+	}
+
+	lcd_display(LCD_LINE1, (const uint8_t *)"Robot fermo");
+	lcd_display(LCD_LINE2, (const uint8_t *)"in piedi");
+	lcd_display(LCD_LINE3, (const uint8_t *)"SW1 conferma");
+	lcd_display(LCD_LINE4, (const uint8_t *)"SW3 annulla");
+	if (!IMU_calib_wait_key()) {
+		return false;
+	}
+
+	return (RIIC_OK == IMU_dev_calibrate(dev));
+
+} /* Fine IMU_calib_run() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_calib_build
+* Descrizione  	    : Prepara le matrici intere usate ad ogni campione
+* Argomenti         : (IMU_calib_struct) *cal -
+* 						 calibrazione del sensore
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_calib_build(IMU_calib_struct *cal)
+{
+	IMU_calib_quantize((const float (*)[3])cal->level, (const float (*)[3])cal->accel.M, cal->accel_q);
+	IMU_calib_quantize((const float (*)[3])cal->level, (const float (*)[3])cal->gyro.M, cal->gyro_q);
+	IMU_calib_quantize((const float (*)[3])cal->level, (const float (*)[3])cal->mag.M, cal->mag_q);
+
+} /* Fine IMU_calib_build() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_calib_quantize
+* Descrizione  	    : Calcola q = level * M in Q14, con arrotondamento e
+* 					  saturazione a 16 bit (circa +-2)
+* Argomenti         : (float) (*level)[3] -
+* 						 rotazione di livellamento
+* 					  (float) (*M)[3] -
+* 					  	 matrice di calibrazione
+* 					  (int16_t) (*q)[3] -
+* 					  	 risultato
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_calib_quantize(const float (*level)[3], const float (*M)[3], int16_t (*q)[3])
+{
+	/* Definisce le variabili locali */
+	float v;
+	uint8_t i, j;
+
+	for (i = 0; i < 3; i++)
+	{
+		for (j = 0; j < 3; j++)
+		{
+			v = (level[i][0]*M[0][j] + level[i][1]*M[1][j] + level[i][2]*M[2][j]) * IMU_CALIB_ONE;
+			v = floorf(v + 0.5f);
+			if (v > 32767.0f) {
+				v = 32767.0f;
+			}
+			else if (v < -32768.0f) {
+				v = -32768.0f;
+			}
+			q[i][j] = (int16_t)v;
+		}
+	}
+
+} /* Fine IMU_calib_quantize() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_calib_kernel
+* Descrizione  	    : v = q * (raw - b - tc/scale) * scale / 2^14.
+* 					  Il bias (statico e termico) viene tolto in LSB interi,
+* 					  poi ogni riga e' un prodotto scalare 16x16 bit; sull'RX
+* 					  usa l'intrinseca macl (MULLO/MACLO sull'accumulatore).
+* 					  Con |q| <= 2 per riga il risultato sta in 32 bit
+* Argomenti         : (int16_t) (*q)[3] -
+* 						 matrice Q14
+* 					  (int16_t) *raw -
+* 					  	 campione grezzo
+* 					  (float) *b -
+* 					  	 bias statico (LSB)
+* 					  (float) *tc -
+* 					  	 bias termico (unita' fisiche)
+* 					  (float) scale -
+* 					  	 unita' fisiche per LSB
+* 					  (float) *v -
+* 					  	 risultato (unita' fisiche)
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_calib_kernel(const int16_t (*q)[3], const int16_t *raw, const float *b, const float *tc,
+							 float scale, float *v)
+{
+	/* Definisce le variabili locali */
+	short d[3];
+	int32_t t, acc[3];
+	float inv = 1.0f / scale;
+	uint8_t k;
+
+	/* Toglie il bias arrotondato all'LSB, saturando a 16 bit */
+	for (k = 0; k < 3; k++)
+	{
+		t = (int32_t)raw[k] - (int32_t)floorf(b[k] + tc[k] * inv + 0.5f);
+		if (t > 32767) {
+			t = 32767;
+		}
+		else if (t < -32768) {
+			t = -32768;
+		}
+		d[k] = (short)t;
+	}
+
+#ifdef __RX
+	acc[0] = macl((short *)q[0], d, 3);
+	acc[1] = macl((short *)q[1], d, 3);
+	acc[2] = macl((short *)q[2], d, 3);
+#else
+	for (k = 0; k < 3; k++) {
+		acc[k] = (int32_t)q[k][0] * d[0] + (int32_t)q[k][1] * d[1] + (int32_t)q[k][2] * d[2];
+	}
+#endif
+
+	scale *= (1.0f / IMU_CALIB_ONE);
+	v[0] = (float)acc[0] * scale;
+	v[1] = (float)acc[1] * scale;
+	v[2] = (float)acc[2] * scale;
+
+} /* Fine IMU_calib_kernel() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_calib_solve4
+* Descrizione  	    : Risolve a * x = y (4x4) per eliminazione di Gauss con
+* 					  pivot parziale. a e y vengono modificati
+* Argomenti         : (float) (*a)[4] -
+* 						 matrice dei coefficienti
+* 					  (float) *y -
+* 					  	 termini noti
+* 					  (float) *x -
+* 					  	 soluzione
+* Valori restituiti : (bool) -
+* 						 false se la matrice e' singolare
+*******************************************************************************/
+static bool IMU_calib_solve4(float (*a)[4], float *y, float *x)
+{
+	/* Definisce le variabili locali */
+	float f, t;
+	uint8_t i, j, r, p;
+
+	for (i = 0; i < 4; i++)
+	{
+		p = i;
+		for (r = i + 1; r < 4; r++)
+		{
+			if (fabsf(a[r][i]) > fabsf(a[p][i])) {
+				p = r;
+			}
+		}
+		if (fabsf(a[p][i]) < 1.0e-9f) {
+			return false;
+		}
+		if (p != i)
+		{
+			for (j = 0; j < 4; j++)
+			{
+				t = a[i][j];
+				a[i][j] = a[p][j];
+				a[p][j] = t;
+			}
+			t = y[i];
+			y[i] = y[p];
+			y[p] = t;
+		}
+		for (r = i + 1; r < 4; r++)
+		{
+			f = a[r][i] / a[i][i];
+			for (j = i; j < 4; j++) {
+				a[r][j] -= f * a[i][j];
+			}
+			y[r] -= f * y[i];
+		}
+	}
+
+	for (i = 4; i-- > 0; )
+	{
+		t = y[i];
+		for (j = i + 1; j < 4; j++) {
+			t -= a[i][j] * x[j];
+		}
+		x[i] = t / a[i][i];
+	}
+
+	return true;
+
+} /* Fine IMU_calib_solve4() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_calib_wait_key
+* Descrizione  	    : Attende la pressione (e il rilascio) di SW1 o SW3
+* Argomenti         : No
+* Valori restituiti : (bool) -
+* 						 true per SW1, false per SW3
+*******************************************************************************/
+static bool IMU_calib_wait_key(void)
+{
+	/* Definisce le variabili locali */
+	bool ok = false;
+
+	while (1)
+	{
+		if ((SW_ACTIVE == SW1) || (SW_ACTIVE == SW3))
+		{
+			/* Conferma dopo il rimbalzo */
+			ok = (SW_ACTIVE == SW1);
+			ms_delay(IMU_CALIB_DEBOUNCE_MS);
+			if ((SW_ACTIVE == SW1) || (SW_ACTIVE == SW3)) {
+				break;
+			}
+		}
+	}
+
+	/* Attende il rilascio */
+	while ((SW_ACTIVE == SW1) || (SW_ACTIVE == SW3)) {
+	}
+	ms_delay(IMU_CALIB_DEBOUNCE_MS);
+
+	return ok;
+
+} /* Fine IMU_calib_wait_key() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_calib_average
+* Descrizione  	    : Media di IMU_CALIB_SAMPLES campioni grezzi, al netto del
+* 					  bias termico
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (bool) gyro -
+* 					  	 true per il giroscopio, false per l'accelerometro
+* 					  (float) *mean -
+* 					  	 media (LSB)
+* Valori restituiti : (bool) -
+* 						 false se nessuna lettura e' andata a buon fine
+*******************************************************************************/
+static bool IMU_calib_average(IMU_dev_struct *dev, bool gyro, float *mean)
+{
+	/* Definisce le variabili locali */
+	const int16_t *raw = gyro ? dev->raw.gyro : dev->raw.accel;
+	const float *tc = gyro ? &dev->tempcomp.bias[0] : &dev->tempcomp.bias[3];
+	float inv = 1.0f / (gyro ? dev->gyro_scale : dev->accel_scale);
+	int32_t period = INV_MPU6050_ONE_K_HZ / dev->config.rate_hz;
+	uint16_t valid = 0;
+	uint16_t i;
+	uint8_t k;
+
+	mean[0] = mean[1] = mean[2] = 0.0f;
+
+	for (i = 0; i < IMU_CALIB_SAMPLES; i++)
+	{
+		ms_delay(period);
+		if (RIIC_OK != IMU_dev_sample(dev)) {
+			continue;
+		}
+		for (k = 0; k < 3; k++) {
+			mean[k] += (float)raw[k] - tc[k] * inv;
+		}
+		valid++;
+	}
+
+	if (0 == valid) {
+		return false;
+	}
+
+	for (k = 0; k < 3; k++) {
+		mean[k] /= valid;
+	}
+
+	return true;
+
+} /* Fine IMU_calib_average() */
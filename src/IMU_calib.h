@@ -0,0 +1,37 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _IMU_CALIB_H_
+#define _IMU_CALIB_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdbool.h>
+#include "main.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_CALIB_POSITIONS					6		/* posizioni della calibrazione dell'accelerometro */
+#define IMU_CALIB_SAMPLES					200		/* campioni mediati per ogni posizione */
+#define IMU_CALIB_TURN_DEG					360.0f	/* rotazione imposta per la scala del giroscopio */
+#define IMU_CALIB_DEBOUNCE_MS				20		/* attesa per il rimbalzo dei pulsanti */
+#define IMU_CALIB_MAG_MIN_FIELD				0.1f	/* semiasse minimo del magnetometro (gauss) */
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+void IMU_calib_set_model(IMU_dev_struct *dev, const IMU_calmodel_struct *accel, const IMU_calmodel_struct *gyro);
+void IMU_calib_set_mag_model(IMU_dev_struct *dev, const IMU_calmodel_struct *mag);
+void IMU_calib_set_level(IMU_dev_struct *dev, const float *g);
+void IMU_calib_accel(IMU_dev_struct *dev, float *v);
+void IMU_calib_gyro(IMU_dev_struct *dev, float *v);
+void IMU_calib_gyro_mean(IMU_dev_struct *dev, const float *mean, float *v);
+void IMU_calib_mag(IMU_dev_struct *dev, const int16_t *raw, float *v);
+bool IMU_calib_fit(const float (*meas)[3], const float (*ref)[3], uint8_t n, IMU_calmodel_struct *model);
+bool IMU_calib_accel_six_position(IMU_dev_struct *dev);
+bool IMU_calib_gyro_scale(IMU_dev_struct *dev);
+bool IMU_calib_mag_rotate(IMU_dev_struct *dev);
+bool IMU_calib_run(IMU_dev_struct *dev);
+
+#endif /* _IMU_CALIB_H_ */
@@ -0,0 +1,452 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Acquisizione sovracampionata: il sensore campiona a rate_hz * decim con il
+* filtro interno aperto e scrive accelerometro, temperatura, giroscopio e
+* l'eventuale magnetometro (slave 0 del master I2C) nella FIFO; ad ogni
+* lettura si svuota la FIFO e si decima con un filtro CIC di ordine
+* IMU_DECIM_ORDER. Prima del CIC ogni blocco letto passa dal filtro software
+* alla frequenza della FIFO, cosi' i notch coprono anche le vibrazioni sopra
+* la frequenza di Nyquist dell'uscita, che il CIC ripiegherebbe nella banda
+* utile. Il CIC usa solo somme intere, ha zeri su tutti i multipli della
+* frequenza di uscita (dove cadrebbero gli alias) e un ritardo di
+* ORDER * (decim - 1) / 2 campioni in ingresso (9 ms a 1 kHz con decim 10).
+* L'uscita diventa il campione grezzo del sensore, quindi bias, temperatura
+* e calibrazione restano invariati
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <mathf.h>
+#include <stdbool.h>
+#include <string.h>
+#include "platform.h"
+#include "CMT.h"
+#include "IMU.h"
+#include "IMU_regmap.h"
+#include "IMU_decim.h"
+#include "IMU_filter.h"
+#include "IMU_mag.h"
+#include "IMU_mem.h"
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static riic_ret_t IMU_decim_reset_fifo (IMU_dev_struct *dev);
+static void IMU_decim_filter (IMU_dev_struct *dev, uint8_t *data, float *x, uint16_t n);
+static bool IMU_decim_push (IMU_decim_struct *d, const uint8_t *frame, int32_t *y);
+static void IMU_decim_noise (IMU_dev_struct *dev);
+
+/*******************************************************************************
+* Nome funzione     : IMU_decim_start
+* Descrizione  	    : Azzera il decimatore e avvia la scrittura della FIFO.
+* 					  La frequenza del sensore e' gia' impostata da IMU_config
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della comunicazione
+*******************************************************************************/
+riic_ret_t IMU_decim_start(IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	IMU_decim_struct *d = &dev->decim;
+	uint8_t k;
+
+	memset(d, 0, sizeof(*d));
+	d->factor = (dev->config.decim > IMU_DECIM_MAX_FACTOR) ? IMU_DECIM_MAX_FACTOR : dev->config.decim;
+	d->settle = IMU_DECIM_ORDER - 1;
+	d->frame = IMU_DECIM_FRAME + (dev->mag.enabled ? IMU_MAG_BYTES : 0);
+	d->channels = d->frame / 2;
+	d->gain = 1;
+	for (k = 0; k < IMU_DECIM_ORDER; k++) {
+		d->gain *= d->factor;
+	}
+
+	IMU_reg_set(dev, INV_MPU6050_REG_FIFO_EN,
+				INV_MPU6050_BIT_TEMP_OUT | INV_MPU6050_BITS_GYRO_OUT | INV_MPU6050_BIT_ACCEL_OUT |
+				(dev->mag.enabled ? INV_MPU6050_BIT_SLV0_FIFO_EN : 0));
+	d->enabled = true;
+
+	/* Il filtro software riparte dal primo campione della FIFO */
+	dev->filter.primed = false;
+
+	return IMU_decim_reset_fifo(dev);
+
+} /* Fine IMU_decim_start() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_decim_stop
+* Descrizione  	    : Spegne la FIFO; il sensore torna alla lettura diretta
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della comunicazione
+*******************************************************************************/
+riic_ret_t IMU_decim_stop(IMU_dev_struct *dev)
+{
+	dev->decim.enabled = false;
+
+	IMU_reg_set(dev, INV_MPU6050_REG_FIFO_EN, 0);
+	IMU_reg_update_bits(dev, INV_MPU6050_REG_USER_CTRL, INV_MPU6050_BIT_FIFO_EN, 0);
+
+	return IMU_reg_flush(dev);
+
+} /* Fine IMU_decim_stop() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_decim_read
+* Descrizione  	    : Legge tutti i campioni presenti nella FIFO e restituisce
+* 					  l'ultima uscita del decimatore. Se la FIFO non contiene
+* 					  ancora un'uscita completa la attende: il ciclo
+* 					  principale resta cosi' sincronizzato con il sensore.
+* 					  Una FIFO piena o disallineata viene svuotata e il
+* 					  decimatore ripartito
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (IMU_raw_struct) *raw -
+* 					  	 campione decimato (LSB, arrotondato)
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della comunicazione, RIIC_RDRF_TMO se la
+* 						 FIFO non si riempie
+*******************************************************************************/
+riic_ret_t IMU_decim_read(IMU_dev_struct *dev, IMU_raw_struct *raw)
+{
+	/* Definisce le variabili locali */
+	IMU_decim_struct *d = &dev->decim;
+	uint8_t *data;
+	float *x;
+	int32_t y[IMU_DECIM_CHANNELS], v[IMU_DECIM_CHANNELS];
+	int32_t start = get_ms();
+	int32_t timeout = IMU_DECIM_TIMEOUT_PERIODS * INV_MPU6050_ONE_K_HZ / dev->config.rate_hz;
+	uint16_t frames, n, i;
+	bool ready = false;
+	riic_ret_t ret;
+	uint8_t k;
+
+	if (!d->enabled) {
+		return RIIC_MODE_ERR;
+	}
+
+	while (!ready)
+	{
+		ret = IMU_decim_fifo_frames(dev, &frames);
+		if (RIIC_OK != ret) {
+			return ret;
+		}
+
+		/* Attende che arrivino i campioni mancanti */
+		if (d->phase + frames < d->factor)
+		{
+			if (get_ms() - start > timeout) {
+				return RIIC_RDRF_TMO;
+			}
+			ms_delay(1);
+			continue;
+		}
+
+		/* Svuota la FIFO a blocchi; tiene l'ultima uscita. Il blocco viene da
+		   IMU_mem_batches (un blocco per volta: i sensori si leggono in sequenza)
+		   e contiene i canali del filtro seguiti dai byte letti */
+		x = (float *)IMU_pool_alloc(&IMU_mem_batches);
+		if (0 == x) {
+			return RIIC_MODE_ERR;
+		}
+		data = (uint8_t *)&x[IMU_FILTER_CHANNELS * IMU_DECIM_BURST_FRAMES];
+		while (frames > 0)
+		{
+			n = (frames > IMU_DECIM_BURST_FRAMES) ? IMU_DECIM_BURST_FRAMES : frames;
+			ret = IMU_read(dev, INV_MPU6050_REG_FIFO_R_W, data, n * d->frame);
+			if (RIIC_OK != ret)
+			{
+				IMU_pool_free(&IMU_mem_batches, x);
+				return ret;
+			}
+			IMU_decim_filter(dev, data, x, n);
+			for (i = 0; i < n; i++)
+			{
+				if (!IMU_decim_push(d, &data[i * d->frame], v)) {
+					continue;
+				}
+
+				/* Le prime uscite dopo un azzeramento non coprono ancora tutta la risposta del CIC */
+				if (d->settle > 0)
+				{
+					d->settle--;
+					continue;
+				}
+				memcpy(y, v, sizeof(y));
+				ready = true;
+			}
+			frames -= n;
+			d->frames += n;
+		}
+		IMU_pool_free(&IMU_mem_batches, x);
+	}
+
+	/* Riporta l'uscita in LSB, arrotondando al piu' vicino */
+	for (k = 0; k < d->channels; k++)
+	{
+		d->out[k] = (float)y[k] / d->gain;
+		y[k] = (y[k] >= 0) ? (y[k] + d->gain / 2) / d->gain : -((-y[k] + d->gain / 2) / d->gain);
+	}
+	raw->accel[0] = (int16_t)y[0];
+	raw->accel[1] = (int16_t)y[1];
+	raw->accel[2] = (int16_t)y[2];
+	raw->temp     = (int16_t)y[3];
+	raw->gyro[0]  = (int16_t)y[4];
+	raw->gyro[1]  = (int16_t)y[5];
+	raw->gyro[2]  = (int16_t)y[6];
+	if (d->channels > 7)
+	{
+		raw->mag[0] = (int16_t)y[7];
+		raw->mag[1] = (int16_t)y[8];
+		raw->mag[2] = (int16_t)y[9];
+	}
+	d->outputs++;
+
+	IMU_decim_noise(dev);
+
+	return RIIC_OK;
+
+} /* Fine IMU_decim_read() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_decim_fifo_frames
+* Descrizione  	    : Numero di campioni completi nella FIFO. Con la FIFO
+* 					  piena il sensore ha gia' perso campioni e l'allineamento
+* 					  non e' garantito: la FIFO viene svuotata, il decimatore
+* 					  ripartito e il numero restituito e' zero
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (uint16_t) *frames -
+* 					  	 campioni da decim.frame byte pronti
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della comunicazione
+*******************************************************************************/
+riic_ret_t IMU_decim_fifo_frames(IMU_dev_struct *dev, uint16_t *frames)
+{
+	/* Definisce le variabili locali */
+	IMU_decim_struct *d = &dev->decim;
+	uint8_t count_buf[2];
+	uint16_t count;
+	riic_ret_t ret;
+
+	*frames = 0;
+
+	ret = IMU_read(dev, INV_MPU6050_REG_FIFO_COUNT_H, count_buf, 2);
+	if (RIIC_OK != ret) {
+		return ret;
+	}
+	count = ((uint16_t)count_buf[0] << 8) | count_buf[1];
+
+	if ((count > IMU_DECIM_FIFO_SIZE - d->frame) || (0 != (count % d->frame)))
+	{
+		d->overflows++;
+		d->phase = 0;
+		d->settle = IMU_DECIM_ORDER - 1;
+		memset(d->integ, 0, sizeof(d->integ));
+		memset(d->comb, 0, sizeof(d->comb));
+		return IMU_decim_reset_fifo(dev);
+	}
+
+	*frames = count / d->frame;
+
+	return RIIC_OK;
+
+} /* Fine IMU_decim_fifo_frames() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_decim_filter
+* Descrizione  	    : Passa un blocco della FIFO dal filtro software e riscrive
+* 					  nel blocco i campioni filtrati, arrotondati al LSB e
+* 					  saturati a 16 bit: l'errore di arrotondamento (1/12 di
+* 					  LSB al quadrato) viene poi mediato dal CIC. Temperatura
+* 					  e magnetometro restano invariati
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (uint8_t) *data -
+* 					  	 campioni letti dalla FIFO
+* 					  (float) *x -
+* 					  	 canali del filtro, IMU_DECIM_BURST_FRAMES per canale
+* 					  (uint16_t) n -
+* 					  	 campioni nel blocco
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_decim_filter(IMU_dev_struct *dev, uint8_t *data, float *x, uint16_t n)
+{
+	/* Definisce le variabili locali */
+	uint8_t *f;
+	float y;
+	int16_t s;
+	uint16_t i;
+	uint8_t c, o;
+
+	/* Accelerometro ai byte 0-5, giroscopio 8-13 (la temperatura sta in mezzo) */
+	for (i = 0, f = data; i < n; i++, f += dev->decim.frame)
+	{
+		for (c = 0; c < IMU_FILTER_CHANNELS; c++)
+		{
+			o = 2 * c + ((c < 3) ? 0 : 2);
+			x[c * IMU_DECIM_BURST_FRAMES + i] = (float)(int16_t)(((uint16_t)f[o] << 8) | f[o + 1]);
+		}
+	}
+
+	IMU_filter_run(&dev->filter, x, n, IMU_DECIM_BURST_FRAMES);
+
+	for (i = 0, f = data; i < n; i++, f += dev->decim.frame)
+	{
+		for (c = 0; c < IMU_FILTER_CHANNELS; c++)
+		{
+			o = 2 * c + ((c < 3) ? 0 : 2);
+			y = x[c * IMU_DECIM_BURST_FRAMES + i];
+			if (y >= 32767.0f) {
+				s = 32767;
+			}
+			else if (y <= -32768.0f) {
+				s = -32768;
+			}
+			else {
+				s = (int16_t)((y >= 0.0f) ? (y + 0.5f) : (y - 0.5f));
+			}
+			f[o]     = (uint8_t)((uint16_t)s >> 8);
+			f[o + 1] = (uint8_t)s;
+		}
+	}
+
+} /* Fine IMU_decim_filter() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_decim_push
+* Descrizione  	    : Aggiunge un campione della FIFO al CIC. Gli integratori
+* 					  girano ad ogni campione, i derivatori solo sull'uscita.
+* 					  Le somme traboccano in modo definito (senza segno) e il
+* 					  risultato e' esatto finche' l'uscita sta in 31 bit
+* Argomenti         : (IMU_decim_struct) *d -
+* 						 decimatore
+* 					  (uint8_t) *frame -
+* 					  	 campione big-endian nell'ordine dei registri 0x3B-0x48,
+* 					  	 seguito dai dati esterni dello slave 0
+* 					  (int32_t) *y -
+* 					  	 uscita moltiplicata per il guadagno, se disponibile
+* Valori restituiti : (bool) -
+* 						 true se e' stata prodotta un'uscita
+*******************************************************************************/
+static bool IMU_decim_push(IMU_decim_struct *d, const uint8_t *frame, int32_t *y)
+{
+	/* Definisce le variabili locali */
+	uint32_t v, t;
+	uint8_t c, k;
+
+	for (c = 0; c < d->channels; c++)
+	{
+		v = (uint32_t)(int32_t)(int16_t)(((uint16_t)frame[2 * c] << 8) | frame[2 * c + 1]);
+		for (k = 0; k < IMU_DECIM_ORDER; k++)
+		{
+			d->integ[k][c] += v;
+			v = d->integ[k][c];
+		}
+	}
+
+	if (++d->phase < d->factor) {
+		return false;
+	}
+	d->phase = 0;
+
+	for (c = 0; c < d->channels; c++)
+	{
+		v = d->integ[IMU_DECIM_ORDER - 1][c];
+		for (k = 0; k < IMU_DECIM_ORDER; k++)
+		{
+			t = v;
+			v -= d->comb[k][c];
+			d->comb[k][c] = t;
+		}
+		y[c] = (int32_t)v;
+	}
+
+	return true;
+
+} /* Fine IMU_decim_push() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_decim_noise
+* Descrizione  	    : Stima la densita' spettrale del rumore in uscita dalla
+* 					  varianza su IMU_DECIM_NOISE_BLOCK uscite, supponendo
+* 					  rumore bianco fino a meta' della frequenza di uscita.
+* 					  Vale solo con il sensore fermo: i blocchi in cui il
+* 					  rilevatore di quiete non conferma vengono scartati
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_decim_noise(IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	IMU_decim_struct *d = &dev->decim;
+	float x, mean, var, bw;
+	uint8_t k, c;
+
+	for (k = 0; k < 6; k++)
+	{
+		c = (k < 3) ? k : k + 1;					/* salta la temperatura */
+		if (0 == d->noise_count) {
+			d->noise_ref[k] = d->out[c];
+		}
+		x = d->out[c] - d->noise_ref[k];
+		d->noise_sum[k] += x;
+		d->noise_sumsq[k] += x * x;
+	}
+
+	if (++d->noise_count < IMU_DECIM_NOISE_BLOCK) {
+		return;
+	}
+
+	if (dev->bias.still)
+	{
+		bw = 0.5f * dev->config.rate_hz;
+		for (k = 0; k < 6; k++)
+		{
+			mean = d->noise_sum[k] * (1.0f / IMU_DECIM_NOISE_BLOCK);
+			var = d->noise_sumsq[k] * (1.0f / IMU_DECIM_NOISE_BLOCK) - mean * mean;
+			d->noise_density[k] = sqrtf((var > 0.0f) ? var : 0.0f) / sqrtf(bw) *
+								  ((k < 3) ? dev->accel_scale : dev->gyro_scale);
+		}
+	}
+
+	d->noise_count = 0;
+	memset(d->noise_sum, 0, sizeof(d->noise_sum));
+	memset(d->noise_sumsq, 0, sizeof(d->noise_sumsq));
+
+} /* Fine IMU_decim_noise() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_decim_reset_fifo
+* Descrizione  	    : Spegne la FIFO, la azzera e la riaccende
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della comunicazione
+*******************************************************************************/
+static riic_ret_t IMU_decim_reset_fifo(IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	riic_ret_t ret;
+
+	IMU_reg_update_bits(dev, INV_MPU6050_REG_USER_CTRL, INV_MPU6050_BIT_FIFO_EN, 0);
+	ret = IMU_reg_flush(dev);
+	if (RIIC_OK != ret) {
+		return ret;
+	}
+
+	IMU_reg_update_bits(dev, INV_MPU6050_REG_USER_CTRL, INV_MPU6050_BIT_FIFO_RST, INV_MPU6050_BIT_FIFO_RST);
+	ret = IMU_reg_flush(dev);
+	if (RIIC_OK != ret) {
+		return ret;
+	}
+
+	IMU_reg_update_bits(dev, INV_MPU6050_REG_USER_CTRL, INV_MPU6050_BIT_FIFO_EN, INV_MPU6050_BIT_FIFO_EN);
+
+	return IMU_reg_flush(dev);
+
+} /* Fine IMU_decim_reset_fifo() */
@@ -0,0 +1,33 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _IMU_DECIM_H_
+#define _IMU_DECIM_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include "main.h"
+#include "r_riic_rx600.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_DECIM_MAX_FACTOR				32		/* 32768 * 32^2 sta in 31 bit */
+#define IMU_DECIM_FRAME						14		/* accelerometro, temperatura, giroscopio */
+#define IMU_DECIM_MAX_FRAME					(2 * IMU_DECIM_CHANNELS)	/* con il magnetometro */
+#define IMU_DECIM_BURST_FRAMES				8		/* campioni letti con una transazione */
+/* Blocco di IMU_decim_read: i canali del filtro in float (4 byte) per canale, seguiti dai byte della FIFO */
+#define IMU_DECIM_BURST_BYTES				(IMU_DECIM_BURST_FRAMES * (4 * IMU_FILTER_CHANNELS + IMU_DECIM_MAX_FRAME))
+#define IMU_DECIM_FIFO_SIZE					1024
+#define IMU_DECIM_TIMEOUT_PERIODS			3		/* periodi di uscita senza dati prima dell'errore */
+#define IMU_DECIM_NOISE_BLOCK				128		/* uscite per ogni stima del rumore */
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+riic_ret_t IMU_decim_start(IMU_dev_struct *dev);
+riic_ret_t IMU_decim_stop(IMU_dev_struct *dev);
+riic_ret_t IMU_decim_read(IMU_dev_struct *dev, IMU_raw_struct *raw);
+riic_ret_t IMU_decim_fifo_frames(IMU_dev_struct *dev, uint16_t *frames);
+
+#endif /* _IMU_DECIM_H_ */
@@ -0,0 +1,496 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <mathf.h>
+#include <stdbool.h>
+#include <string.h>
+#include "platform.h"
+#include "CMT.h"
+#include "IMU.h"
+#include "IMU_regmap.h"
+#include "IMU_dmp.h"
+#include "IMU_math.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_DMP_Q30							(1.0f / 1073741824.0f)	/* 2^-30 */
+#define IMU_DMP_NORM_TOL					0.1f	/* scarto ammesso sulla norma del quaternione */
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static riic_ret_t IMU_dmp_set_addr (IMU_dev_struct *dev, uint16_t addr);
+static riic_ret_t IMU_dmp_reset_fifo (IMU_dev_struct *dev);
+static riic_ret_t IMU_dmp_enable (IMU_dev_struct *dev);
+
+/*******************************************************************************
+* Nome funzione     : IMU_dmp_write_mem
+* Descrizione  	    : Scrive nella memoria del DMP a blocchi di IMU_DMP_CHUNK
+* 					  byte che non attraversano il confine di un banco. Ogni
+* 					  blocco viene riletto e confrontato; un blocco diverso
+* 					  viene riscritto al massimo IMU_MAX_RETRY volte
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (uint16_t) addr -
+* 					  	 indirizzo di partenza (banco nel byte alto)
+* 					  (uint8_t) *data -
+* 					  	 dati da scrivere
+* 					  (uint16_t) len -
+* 					  	 numero di byte
+* Valori restituiti : (riic_ret_t) ret -
+* 						 RIIC_VERIFY_ERR se la rilettura non coincide
+*******************************************************************************/
+riic_ret_t IMU_dmp_write_mem(IMU_dev_struct *dev, uint16_t addr, const uint8_t *data, uint16_t len)
+{
+	/* Definisce le variabili locali */
+	uint8_t check[IMU_DMP_CHUNK];
+	riic_ret_t ret = RIIC_OK;
+	uint16_t n;
+	uint8_t retry;
+
+	while (len > 0)
+	{
+		n = (len < IMU_DMP_CHUNK) ? len : IMU_DMP_CHUNK;
+		if ((addr % IMU_DMP_BANK_SIZE) + n > IMU_DMP_BANK_SIZE) {
+			n = IMU_DMP_BANK_SIZE - (addr % IMU_DMP_BANK_SIZE);
+		}
+
+		for (retry = 0; retry < IMU_MAX_RETRY; retry++)
+		{
+			/* Scrive il blocco */
+			ret = IMU_dmp_set_addr(dev, addr);
+			if (RIIC_OK == ret) {
+				ret = IMU_write(dev, INV_MPU6050_REG_MEM_R_W, (uint8_t *)data, n);
+			}
+
+			/* Lo rilegge e lo confronta */
+			if (RIIC_OK == ret) {
+				ret = IMU_dmp_set_addr(dev, addr);
+			}
+			if (RIIC_OK == ret) {
+				ret = IMU_read(dev, INV_MPU6050_REG_MEM_R_W, check, n);
+			}
+			if ((RIIC_OK == ret) && (0 != memcmp(check, data, n))) {
+				ret = RIIC_VERIFY_ERR;
+			}
+
+			/* Controlla se si sono verificati errori */
+			if (RIIC_OK == ret) {
+				break;
+			}
+		}
+		if (RIIC_OK != ret) {
+			return ret;
+		}
+
+		addr += n;
+		data += n;
+		len  -= n;
+	}
+
+	return ret;
+
+} /* Fine IMU_dmp_write_mem() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_dmp_read_mem
+* Descrizione  	    : Legge dalla memoria del DMP, un banco alla volta
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (uint16_t) addr -
+* 					  	 indirizzo di partenza (banco nel byte alto)
+* 					  (uint8_t) *data -
+* 					  	 dati letti
+* 					  (uint16_t) len -
+* 					  	 numero di byte
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della comunicazione
+*******************************************************************************/
+riic_ret_t IMU_dmp_read_mem(IMU_dev_struct *dev, uint16_t addr, uint8_t *data, uint16_t len)
+{
+	/* Definisce le variabili locali */
+	riic_ret_t ret = RIIC_OK;
+	uint16_t n;
+
+	while (len > 0)
+	{
+		n = IMU_DMP_BANK_SIZE - (addr % IMU_DMP_BANK_SIZE);
+		if (n > len) {
+			n = len;
+		}
+
+		ret = IMU_dmp_set_addr(dev, addr);
+		if (RIIC_OK == ret) {
+			ret = IMU_read(dev, INV_MPU6050_REG_MEM_R_W, data, n);
+		}
+		if (RIIC_OK != ret) {
+			return ret;
+		}
+
+		addr += n;
+		data += n;
+		len  -= n;
+	}
+
+	return ret;
+
+} /* Fine IMU_dmp_read_mem() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_dmp_load
+* Descrizione  	    : Carica il firmware del DMP, le scritture di
+* 					  configurazione e l'indirizzo di partenza del programma.
+* 					  Il sensore deve essere inizializzato; il DMP resta
+* 					  spento fino a IMU_dmp_start
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (IMU_dmp_image_struct) *image -
+* 					  	 firmware e configurazione
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato del caricamento
+*******************************************************************************/
+riic_ret_t IMU_dmp_load(IMU_dev_struct *dev, const IMU_dmp_image_struct *image)
+{
+	/* Definisce le variabili locali */
+	uint8_t start[2];
+	riic_ret_t ret;
+	uint8_t i;
+
+	memset(&dev->dmp, 0, sizeof(dev->dmp));
+
+	if ((image->packet_len < IMU_DMP_QUAT_PACKET) || (image->packet_len > IMU_DMP_MAX_PACKET)) {
+		return RIIC_MODE_ERR;
+	}
+
+	/* Carica il programma */
+	ret = IMU_dmp_write_mem(dev, 0, image->code, image->size);
+	if (RIIC_OK != ret) {
+		return ret;
+	}
+
+	/* Configura l'uscita */
+	for (i = 0; i < image->num_keys; i++)
+	{
+		ret = IMU_dmp_write_mem(dev, image->keys[i].addr, image->keys[i].data, image->keys[i].len);
+		if (RIIC_OK != ret) {
+			return ret;
+		}
+	}
+
+	/* Indirizzo di partenza (PRGM_START_H e PRGM_START_L con una transazione) */
+	start[0] = (uint8_t)(image->start >> 8);
+	start[1] = (uint8_t)(image->start & 0xFF);
+	ret = IMU_write(dev, INV_MPU6050_REG_PRGM_START_H, start, 2);
+	if (RIIC_OK != ret) {
+		return ret;
+	}
+
+	dev->dmp.packet_len = image->packet_len;
+
+	return ret;
+
+} /* Fine IMU_dmp_load() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_dmp_start
+* Descrizione  	    : Imposta la frequenza dei pacchetti, azzera FIFO e DMP e
+* 					  li avvia. Il sensore deve essere gia' configurato con
+* 					  la frequenza interna del DMP (IMU_DMP_SAMPLE_RATE), il
+* 					  giroscopio a 2000 grad/s e senza decimazione (la FIFO
+* 					  serve al DMP)
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (uint16_t) rate_hz -
+* 					  	 frequenza dei quaternioni (divisore di 200 Hz)
+* Valori restituiti : (riic_ret_t) ret -
+* 						 RIIC_MODE_ERR se il DMP non e' caricato o la
+* 						 configurazione non e' compatibile
+*******************************************************************************/
+riic_ret_t IMU_dmp_start(IMU_dev_struct *dev, uint16_t rate_hz)
+{
+	/* Definisce le variabili locali */
+	uint8_t div[2];
+	uint16_t d;
+	riic_ret_t ret;
+
+	if ((0 == dev->dmp.packet_len) ||
+		(IMU_DMP_SAMPLE_RATE != dev->config.rate_hz) ||
+		(INV_MPU6050_FSR_2000DPS != dev->config.gyro_fs) ||
+		dev->decim.enabled) {
+		return RIIC_MODE_ERR;
+	}
+
+	if ((0 == rate_hz) || (rate_hz > IMU_DMP_SAMPLE_RATE)) {
+		rate_hz = IMU_DMP_SAMPLE_RATE;
+	}
+	d = IMU_DMP_SAMPLE_RATE / rate_hz - 1;
+	div[0] = (uint8_t)(d >> 8);
+	div[1] = (uint8_t)(d & 0xFF);
+	ret = IMU_dmp_write_mem(dev, IMU_DMP_KEY_RATE_DIV, div, 2);
+	if (RIIC_OK != ret) {
+		return ret;
+	}
+	dev->dmp.rate_hz = IMU_DMP_SAMPLE_RATE / (d + 1);
+
+	/* La FIFO viene riempita solo dal DMP */
+	IMU_reg_set(dev, INV_MPU6050_REG_FIFO_EN, 0);
+
+	/* All'avvio si puo' attendere la fine del reset */
+	ret = IMU_dmp_reset_fifo(dev);
+	if (RIIC_OK != ret) {
+		return ret;
+	}
+	ms_delay(IMU_DMP_RESET_TIME);
+	ret = IMU_dmp_enable(dev);
+	if (RIIC_OK != ret) {
+		return ret;
+	}
+
+	dev->dmp.restarting = false;
+	dev->dmp.packets = 0;
+	dev->dmp.overflows = 0;
+	dev->dmp.bad_packets = 0;
+	dev->dmp.valid = false;
+	dev->dmp.off_valid = false;
+	dev->dmp.enabled = true;
+
+	return ret;
+
+} /* Fine IMU_dmp_start() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_dmp_stop
+* Descrizione  	    : Spegne DMP e FIFO; il firmware resta in memoria
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della comunicazione
+*******************************************************************************/
+riic_ret_t IMU_dmp_stop(IMU_dev_struct *dev)
+{
+	dev->dmp.enabled = false;
+	dev->dmp.restarting = false;
+
+	IMU_reg_update_bits(dev, INV_MPU6050_REG_USER_CTRL, INV_MPU6050_BIT_FIFO_EN | INV_MPU6050_BIT_DMP_EN, 0);
+
+	return IMU_reg_flush(dev);
+
+} /* Fine IMU_dmp_stop() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_dmp_read
+* Descrizione  	    : Svuota la FIFO e ricava gli angoli dall'ultimo
+* 					  quaternione. I pacchetti piu' vecchi vengono scartati: il
+* 					  loro numero da' il ritardo accumulato. Una FIFO piena o
+* 					  non multipla del pacchetto viene azzerata senza attese:
+* 					  FIFO e DMP restano in reset per IMU_DMP_RESET_TIME e si
+* 					  riaccendono in una chiamata successiva; fino al primo
+* 					  pacchetto buono gli angoli non sono validi.
+* 					  Il quaternione resta negli assi del sensore; gli angoli
+* 					  sono negli assi del robot (livellamento di IMU_calib).
+* 					  Il primo quaternione valido da' la posizione di riposo
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della comunicazione
+*******************************************************************************/
+riic_ret_t IMU_dmp_read(IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	IMU_dmp_struct *dmp = &dev->dmp;
+	uint8_t packet[IMU_DMP_MAX_PACKET];
+	uint8_t count_buf[2];
+	uint16_t count;
+	const float (*level)[3] = dev->calib.level;
+	float r[3][3], m[3][3];
+	int32_t q;
+	float n, w, x, y, z;
+	riic_ret_t ret;
+	uint8_t j, k;
+
+	if (!dmp->enabled) {
+		return RIIC_MODE_ERR;
+	}
+
+	/* Reset in corso: si riaccende quando e' trascorso il tempo; la FIFO e' vuota */
+	if (dmp->restarting)
+	{
+		if ((get_ms() - dmp->restart_ms) < 0) {
+			return RIIC_OK;
+		}
+		ret = IMU_dmp_enable(dev);
+		if (RIIC_OK == ret) {
+			dmp->restarting = false;
+		}
+		return ret;
+	}
+
+	ret = IMU_read(dev, INV_MPU6050_REG_FIFO_COUNT_H, count_buf, 2);
+	if (RIIC_OK != ret) {
+		return ret;
+	}
+	count = ((uint16_t)count_buf[0] << 8) | count_buf[1];
+
+	if (count < dmp->packet_len) {
+		return RIIC_OK;
+	}
+
+	/* Con la FIFO piena il sensore ha gia' perso pacchetti e l'allineamento non e' garantito */
+	if ((count > IMU_DMP_FIFO_SIZE - dmp->packet_len) || (0 != (count % dmp->packet_len)))
+	{
+		dmp->overflows++;
+		dmp->valid = false;
+		ret = IMU_dmp_reset_fifo(dev);
+		if (RIIC_OK == ret)
+		{
+			dmp->restarting = true;
+			dmp->restart_ms = get_ms() + IMU_DMP_RESET_TIME;
+		}
+		return ret;
+	}
+
+	dmp->latency_ms = (uint16_t)((count / dmp->packet_len - 1) * 1000u / dmp->rate_hz);
+
+	/* Legge tutti i pacchetti, tiene l'ultimo */
+	while (count >= dmp->packet_len)
+	{
+		ret = IMU_read(dev, INV_MPU6050_REG_FIFO_R_W, packet, dmp->packet_len);
+		if (RIIC_OK != ret) {
+			return ret;
+		}
+		count -= dmp->packet_len;
+		dmp->packets++;
+	}
+
+	/* Quaternione w, x, y, z in Q30 big-endian */
+	for (k = 0; k < 4; k++)
+	{
+		q = (int32_t)(((uint32_t)packet[4*k] << 24) | ((uint32_t)packet[4*k + 1] << 16) |
+					  ((uint32_t)packet[4*k + 2] << 8) | packet[4*k + 3]);
+		dmp->quat[k] = (float)q * IMU_DMP_Q30;
+	}
+
+	w = dmp->quat[0];
+	x = dmp->quat[1];
+	y = dmp->quat[2];
+	z = dmp->quat[3];
+
+	/* Un pacchetto letto fuori allineamento non ha norma unitaria */
+	n = w*w + x*x + y*y + z*z;
+	if (fabsf(n - 1.0f) > IMU_DMP_NORM_TOL)
+	{
+		dmp->bad_packets++;
+		return RIIC_OK;
+	}
+
+	/* Matrice di rotazione del quaternione (assi del sensore -> riferimento del DMP) */
+	r[0][0] = 1.0f - 2.0f * (y*y + z*z);
+	r[0][1] = 2.0f * (x*y - w*z);
+	r[0][2] = 2.0f * (x*z + w*y);
+	r[1][0] = 2.0f * (x*y + w*z);
+	r[1][1] = 1.0f - 2.0f * (x*x + z*z);
+	r[1][2] = 2.0f * (y*z - w*x);
+	r[2][0] = 2.0f * (x*z - w*y);
+	r[2][1] = 2.0f * (y*z + w*x);
+	r[2][2] = 1.0f - 2.0f * (x*x + y*y);
+
+	/* Assetto degli assi del robot: level porta il sensore sul robot, quindi
+	 si compone con la sua trasposta (m = r * level^T) */
+	for (j = 0; j < 3; j++)
+	{
+		for (k = 0; k < 3; k++) {
+			m[j][k] = r[j][0]*level[k][0] + r[j][1]*level[k][1] + r[j][2]*level[k][2];
+		}
+	}
+
+	/* Angoli di Tait-Bryan (z-y-x) */
+	dmp->angle[IMU_ROLL]  = IMU_atan2f(m[2][1], m[2][2]);
+	dmp->angle[IMU_PITCH] = IMU_asinf(-m[2][0]);
+	dmp->angle[IMU_YAW]   = IMU_atan2f(m[1][0], m[0][0]);
+	dmp->valid = true;
+
+	/* La posizione di riposo si misura sul primo quaternione valido */
+	if (!dmp->off_valid)
+	{
+		for (k = 0; k < 3; k++) {
+			dmp->off_angle[k] = dmp->angle[k];
+		}
+		dmp->off_valid = true;
+	}
+
+	return RIIC_OK;
+
+} /* Fine IMU_dmp_read() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_dmp_set_addr
+* Descrizione  	    : Seleziona banco e indirizzo della memoria del DMP
+* 					  (BANK_SEL e MEM_START_ADDR con una transazione)
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (uint16_t) addr -
+* 					  	 indirizzo (banco nel byte alto)
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della comunicazione
+*******************************************************************************/
+static riic_ret_t IMU_dmp_set_addr(IMU_dev_struct *dev, uint16_t addr)
+{
+	/* Definisce le variabili locali */
+	uint8_t sel[2];
+
+	sel[0] = (uint8_t)(addr >> 8);
+	sel[1] = (uint8_t)(addr & 0xFF);
+
+	return IMU_write(dev, INV_MPU6050_REG_BANK_SEL, sel, 2);
+
+} /* Fine IMU_dmp_set_addr() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_dmp_reset_fifo
+* Descrizione  	    : Spegne FIFO e DMP e li azzera. Vanno riaccesi con
+* 					  IMU_dmp_enable dopo IMU_DMP_RESET_TIME
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della comunicazione
+*******************************************************************************/
+static riic_ret_t IMU_dmp_reset_fifo(IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	const uint8_t bits = INV_MPU6050_BIT_FIFO_EN | INV_MPU6050_BIT_DMP_EN;
+	const uint8_t rst  = INV_MPU6050_BIT_FIFO_RST | INV_MPU6050_BIT_DMP_RST;
+	riic_ret_t ret;
+
+	IMU_reg_update_bits(dev, INV_MPU6050_REG_USER_CTRL, bits, 0);
+	ret = IMU_reg_flush(dev);
+	if (RIIC_OK != ret) {
+		return ret;
+	}
+
+	IMU_reg_update_bits(dev, INV_MPU6050_REG_USER_CTRL, rst, rst);
+
+	return IMU_reg_flush(dev);
+
+} /* Fine IMU_dmp_reset_fifo() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_dmp_enable
+* Descrizione  	    : Riaccende FIFO e DMP dopo IMU_dmp_reset_fifo
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della comunicazione
+*******************************************************************************/
+static riic_ret_t IMU_dmp_enable(IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	const uint8_t bits = INV_MPU6050_BIT_FIFO_EN | INV_MPU6050_BIT_DMP_EN;
+
+	IMU_reg_update_bits(dev, INV_MPU6050_REG_USER_CTRL, bits, bits);
+
+	return IMU_reg_flush(dev);
+
+} /* Fine IMU_dmp_enable() */
@@ -0,0 +1,34 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _IMU_DMP_H_
+#define _IMU_DMP_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include "main.h"
+#include "r_riic_rx600.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_DMP_BANK_SIZE					256		/* byte per banco della memoria del DMP */
+#define IMU_DMP_CHUNK						16		/* byte per transazione di caricamento */
+#define IMU_DMP_SAMPLE_RATE					200		/* frequenza interna richiesta dal DMP (Hz) */
+#define IMU_DMP_KEY_RATE_DIV				534		/* D_0_22: divisore della frequenza dei pacchetti */
+#define IMU_DMP_FIFO_SIZE					1024	/* byte della FIFO del sensore */
+#define IMU_DMP_MAX_PACKET					32		/* pacchetto piu' lungo gestito */
+#define IMU_DMP_QUAT_PACKET					16		/* quaternione a 6 assi: 4 x int32 in Q30 */
+#define IMU_DMP_RESET_TIME					50		/* attesa dopo il reset di FIFO e DMP (ms) */
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+riic_ret_t IMU_dmp_write_mem(IMU_dev_struct *dev, uint16_t addr, const uint8_t *data, uint16_t len);
+riic_ret_t IMU_dmp_read_mem(IMU_dev_struct *dev, uint16_t addr, uint8_t *data, uint16_t len);
+riic_ret_t IMU_dmp_load(IMU_dev_struct *dev, const IMU_dmp_image_struct *image);
+riic_ret_t IMU_dmp_start(IMU_dev_struct *dev, uint16_t rate_hz);
+riic_ret_t IMU_dmp_stop(IMU_dev_struct *dev);
+riic_ret_t IMU_dmp_read(IMU_dev_struct *dev);
+
+#endif /* _IMU_DMP_H_ */
@@ -0,0 +1,191 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* FFT reale in singola precisione, sul posto, per l'analisi delle vibrazioni.
+* Gli N campioni reali sono trattati come N / 2 campioni complessi (pari come
+* parte reale, dispari come immaginaria): una FFT complessa radix-2 a
+* decimazione nel tempo di N / 2 punti seguita dal passo di separazione da lo
+* spettro reale con circa meta' delle operazioni. Tutti i coefficienti vengono
+* dalla sola tabella IMU_fft_twiddle in flash, senza seni e coseni a runtime
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include "IMU_fft.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_FFT_HALF						(IMU_FFT_SIZE / 2)
+
+#if (IMU_FFT_SIZE < 8) || (0 != (IMU_FFT_SIZE & (IMU_FFT_SIZE - 1)))
+#error "IMU_FFT_SIZE deve essere una potenza di due"
+#endif
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static void IMU_fft_complex (float *x);
+
+/*******************************************************************************
+* Nome funzione     : IMU_fft_hann
+* Descrizione  	    : Applica sul posto la finestra di Hann periodica,
+* 					  w[n] = (1 - cos(2 pi n / N)) / 2, con i coseni della
+* 					  tabella (simmetrica intorno a N / 2)
+* Argomenti         : (float) *x -
+* 						 IMU_FFT_SIZE campioni
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_fft_hann(float *x)
+{
+	/* Definisce le variabili locali */
+	float w;
+	uint16_t n;
+
+	x[0] = 0.0f;
+	for (n = 1; n < IMU_FFT_HALF; n++)
+	{
+		w = 0.5f - 0.5f * IMU_fft_twiddle[n][0];
+		x[n] *= w;
+		x[IMU_FFT_SIZE - n] *= w;
+	}
+
+} /* Fine IMU_fft_hann() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_fft_real
+* Descrizione  	    : Trasformata di IMU_FFT_SIZE campioni reali, sul posto.
+* 					  In uscita x[0] e' X[0], x[1] e' X[N/2] (entrambi reali)
+* 					  e x[2k], x[2k+1] sono parte reale e immaginaria di X[k]
+* 					  per 0 < k < N/2, con X[k] = sum x[n] e^(-j 2 pi k n / N)
+* Argomenti         : (float) *x -
+* 						 campioni in ingresso, spettro in uscita
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_fft_real(float *x)
+{
+	/* Definisce le variabili locali */
+	float ar, ai, br, bi, er, ei, odr, odi, tr, ti, c, s;
+	uint16_t k, m;
+
+	IMU_fft_complex(x);
+
+	/* X[0] e X[N/2] dipendono solo da Z[0] */
+	ar = x[0];
+	ai = x[1];
+	x[0] = ar + ai;
+	x[1] = ar - ai;
+
+	/* Le coppie k, N/2 - k si separano insieme:
+	   E = (Z[k] + Z*[N/2-k]) / 2, O = -j (Z[k] - Z*[N/2-k]) / 2,
+	   X[k] = E + W^k O, X[N/2-k] = (E - W^k O)* con W = e^(-j 2 pi / N) */
+	for (k = 1; k <= IMU_FFT_HALF / 2; k++)
+	{
+		m = IMU_FFT_HALF - k;
+		ar = x[2 * k];
+		ai = x[2 * k + 1];
+		br = x[2 * m];
+		bi = x[2 * m + 1];
+
+		er = 0.5f * (ar + br);
+		ei = 0.5f * (ai - bi);
+		odr = 0.5f * (ai + bi);
+		odi = 0.5f * (br - ar);
+
+		c = IMU_fft_twiddle[k][0];
+		s = IMU_fft_twiddle[k][1];
+		tr = c * odr + s * odi;
+		ti = c * odi - s * odr;
+
+		x[2 * k] = er + tr;
+		x[2 * k + 1] = ei + ti;
+		x[2 * m] = er - tr;
+		x[2 * m + 1] = ti - ei;
+	}
+
+} /* Fine IMU_fft_real() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_fft_power
+* Descrizione  	    : Converte sul posto l'uscita di IMU_fft_real nello spettro
+* 					  di potenza |X[k]|^2, k = 0 ... N/2 (IMU_FFT_BINS valori).
+* 					  Ogni x[k] viene scritto dopo aver letto x[2k] e x[2k+1]
+* Argomenti         : (float) *x -
+* 						 spettro complesso in ingresso, potenza in uscita
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_fft_power(float *x)
+{
+	/* Definisce le variabili locali */
+	float nyq = x[1] * x[1];
+	uint16_t k;
+
+	x[0] = x[0] * x[0];
+	for (k = 1; k < IMU_FFT_HALF; k++) {
+		x[k] = x[2 * k] * x[2 * k] + x[2 * k + 1] * x[2 * k + 1];
+	}
+	x[IMU_FFT_HALF] = nyq;
+
+} /* Fine IMU_fft_power() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_fft_complex
+* Descrizione  	    : FFT complessa radix-2 di N/2 punti, sul posto, con
+* 					  riordino a bit invertiti e farfalle a decimazione nel
+* 					  tempo. Il coefficiente di ogni farfalla e' caricato una
+* 					  volta per tutti i blocchi dello stadio
+* Argomenti         : (float) *x -
+* 						 N/2 campioni complessi (reale, immaginario)
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_fft_complex(float *x)
+{
+	/* Definisce le variabili locali */
+	float wr, wi, tr, ti;
+	uint16_t i, j, k, bit, len, half, step, a, b;
+
+	/* Riordino a bit invertiti */
+	for (i = 1, j = 0; i < IMU_FFT_HALF; i++)
+	{
+		for (bit = IMU_FFT_HALF >> 1; j & bit; bit >>= 1) {
+			j ^= bit;
+		}
+		j |= bit;
+
+		if (i < j)
+		{
+			tr = x[2 * i];
+			ti = x[2 * i + 1];
+			x[2 * i] = x[2 * j];
+			x[2 * i + 1] = x[2 * j + 1];
+			x[2 * j] = tr;
+			x[2 * j + 1] = ti;
+		}
+	}
+
+	/* Stadi: farfalle di lunghezza len, W_len^k = W_N^(k N / len) */
+	for (len = 2; len <= IMU_FFT_HALF; len <<= 1)
+	{
+		half = len >> 1;
+		step = IMU_FFT_SIZE / len;
+
+		for (k = 0; k < half; k++)
+		{
+			wr = IMU_fft_twiddle[k * step][0];
+			wi = -IMU_fft_twiddle[k * step][1];
+
+			for (a = k; a < IMU_FFT_HALF; a += len)
+			{
+				b = a + half;
+				tr = wr * x[2 * b] - wi * x[2 * b + 1];
+				ti = wr * x[2 * b + 1] + wi * x[2 * b];
+				x[2 * b] = x[2 * a] - tr;
+				x[2 * b + 1] = x[2 * a + 1] - ti;
+				x[2 * a] += tr;
+				x[2 * a + 1] += ti;
+			}
+		}
+	}
+
+} /* Fine IMU_fft_complex() */
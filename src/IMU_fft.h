@@ -0,0 +1,31 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _IMU_FFT_H_
+#define _IMU_FFT_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdint.h>
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_FFT_SIZE						512		/* campioni reali per trasformata */
+#define IMU_FFT_BINS						(IMU_FFT_SIZE / 2 + 1)
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+/* cos e sin di 2 pi k / IMU_FFT_SIZE, k < IMU_FFT_SIZE / 2: src/IMU_fft_twiddle.c,
+   generato con tools/imu_fftgen.c */
+extern const float IMU_fft_twiddle[IMU_FFT_SIZE / 2][2];
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+void IMU_fft_hann(float *x);
+void IMU_fft_real(float *x);
+void IMU_fft_power(float *x);
+
+#endif /* _IMU_FFT_H_ */
@@ -0,0 +1,274 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/* File generato da tools/imu_fftgen.c per IMU_FFT_SIZE = 512: non modificare */
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include "IMU_fft.h"
+
+#if IMU_FFT_SIZE != 512
+#error "Tabella da rigenerare con tools/imu_fftgen.c"
+#endif
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+const float IMU_fft_twiddle[IMU_FFT_SIZE / 2][2] = {
+	{1.000000000e+00f, 0.000000000e+00f},
+	{9.999247193e-01f, 1.227153838e-02f},
+	{9.996988177e-01f, 2.454122901e-02f},
+	{9.993223548e-01f, 3.680722415e-02f},
+	{9.987954497e-01f, 4.906767607e-02f},
+	{9.981181026e-01f, 6.132073700e-02f},
+	{9.972904325e-01f, 7.356456667e-02f},
+	{9.963126183e-01f, 8.579730988e-02f},
+	{9.951847196e-01f, 9.801714122e-02f},
+	{9.939069748e-01f, 1.102222055e-01f},
+	{9.924795628e-01f, 1.224106774e-01f},
+	{9.909026623e-01f, 1.345807016e-01f},
+	{9.891765118e-01f, 1.467304677e-01f},
+	{9.873014092e-01f, 1.588581502e-01f},
+	{9.852776527e-01f, 1.709618866e-01f},
+	{9.831054807e-01f, 1.830398887e-01f},
+	{9.807852507e-01f, 1.950903237e-01f},
+	{9.783173800e-01f, 2.071113735e-01f},
+	{9.757021070e-01f, 2.191012353e-01f},
+	{9.729399681e-01f, 2.310581058e-01f},
+	{9.700312614e-01f, 2.429801822e-01f},
+	{9.669764638e-01f, 2.548656464e-01f},
+	{9.637760520e-01f, 2.667127550e-01f},
+	{9.604305029e-01f, 2.785196900e-01f},
+	{9.569403529e-01f, 2.902846634e-01f},
+	{9.533060193e-01f, 3.020059466e-01f},
+	{9.495281577e-01f, 3.136817515e-01f},
+	{9.456073046e-01f, 3.253102899e-01f},
+	{9.415440559e-01f, 3.368898630e-01f},
+	{9.373390079e-01f, 3.484186828e-01f},
+	{9.329928160e-01f, 3.598950505e-01f},
+	{9.285060763e-01f, 3.713172078e-01f},
+	{9.238795042e-01f, 3.826834261e-01f},
+	{9.191138744e-01f, 3.939920366e-01f},
+	{9.142097831e-01f, 4.052413106e-01f},
+	{9.091680050e-01f, 4.164295495e-01f},
+	{9.039893150e-01f, 4.275550842e-01f},
+	{8.986744881e-01f, 4.386162460e-01f},
+	{8.932242990e-01f, 4.496113360e-01f},
+	{8.876396418e-01f, 4.605387151e-01f},
+	{8.819212914e-01f, 4.713967443e-01f},
+	{8.760700822e-01f, 4.821837842e-01f},
+	{8.700869679e-01f, 4.928981960e-01f},
+	{8.639728427e-01f, 5.035383701e-01f},
+	{8.577286005e-01f, 5.141027570e-01f},
+	{8.513551950e-01f, 5.245896578e-01f},
+	{8.448535800e-01f, 5.349976420e-01f},
+	{8.382247090e-01f, 5.453249812e-01f},
+	{8.314695954e-01f, 5.555702448e-01f},
+	{8.245893121e-01f, 5.657318234e-01f},
+	{8.175848126e-01f, 5.758081675e-01f},
+	{8.104571700e-01f, 5.857978463e-01f},
+	{8.032075167e-01f, 5.956993103e-01f},
+	{7.958369255e-01f, 6.055110693e-01f},
+	{7.883464098e-01f, 6.152315736e-01f},
+	{7.807372212e-01f, 6.248595119e-01f},
+	{7.730104327e-01f, 6.343932748e-01f},
+	{7.651672363e-01f, 6.438315511e-01f},
+	{7.572088242e-01f, 6.531728506e-01f},
+	{7.491363883e-01f, 6.624158025e-01f},
+	{7.409511209e-01f, 6.715589762e-01f},
+	{7.326542735e-01f, 6.806010008e-01f},
+	{7.242470980e-01f, 6.895405650e-01f},
+	{7.157308459e-01f, 6.983762383e-01f},
+	{7.071067691e-01f, 7.071067691e-01f},
+	{6.983762383e-01f, 7.157308459e-01f},
+	{6.895405650e-01f, 7.242470980e-01f},
+	{6.806010008e-01f, 7.326542735e-01f},
+	{6.715589762e-01f, 7.409511209e-01f},
+	{6.624158025e-01f, 7.491363883e-01f},
+	{6.531728506e-01f, 7.572088242e-01f},
+	{6.438315511e-01f, 7.651672363e-01f},
+	{6.343932748e-01f, 7.730104327e-01f},
+	{6.248595119e-01f, 7.807372212e-01f},
+	{6.152315736e-01f, 7.883464098e-01f},
+	{6.055110693e-01f, 7.958369255e-01f},
+	{5.956993103e-01f, 8.032075167e-01f},
+	{5.857978463e-01f, 8.104571700e-01f},
+	{5.758081675e-01f, 8.175848126e-01f},
+	{5.657318234e-01f, 8.245893121e-01f},
+	{5.555702448e-01f, 8.314695954e-01f},
+	{5.453249812e-01f, 8.382247090e-01f},
+	{5.349976420e-01f, 8.448535800e-01f},
+	{5.245896578e-01f, 8.513551950e-01f},
+	{5.141027570e-01f, 8.577286005e-01f},
+	{5.035383701e-01f, 8.639728427e-01f},
+	{4.928981960e-01f, 8.700869679e-01f},
+	{4.821837842e-01f, 8.760700822e-01f},
+	{4.713967443e-01f, 8.819212914e-01f},
+	{4.605387151e-01f, 8.876396418e-01f},
+	{4.496113360e-01f, 8.932242990e-01f},
+	{4.386162460e-01f, 8.986744881e-01f},
+	{4.275550842e-01f, 9.039893150e-01f},
+	{4.164295495e-01f, 9.091680050e-01f},
+	{4.052413106e-01f, 9.142097831e-01f},
+	{3.939920366e-01f, 9.191138744e-01f},
+	{3.826834261e-01f, 9.238795042e-01f},
+	{3.713172078e-01f, 9.285060763e-01f},
+	{3.598950505e-01f, 9.329928160e-01f},
+	{3.484186828e-01f, 9.373390079e-01f},
+	{3.368898630e-01f, 9.415440559e-01f},
+	{3.253102899e-01f, 9.456073046e-01f},
+	{3.136817515e-01f, 9.495281577e-01f},
+	{3.020059466e-01f, 9.533060193e-01f},
+	{2.902846634e-01f, 9.569403529e-01f},
+	{2.785196900e-01f, 9.604305029e-01f},
+	{2.667127550e-01f, 9.637760520e-01f},
+	{2.548656464e-01f, 9.669764638e-01f},
+	{2.429801822e-01f, 9.700312614e-01f},
+	{2.310581058e-01f, 9.729399681e-01f},
+	{2.191012353e-01f, 9.757021070e-01f},
+	{2.071113735e-01f, 9.783173800e-01f},
+	{1.950903237e-01f, 9.807852507e-01f},
+	{1.830398887e-01f, 9.831054807e-01f},
+	{1.709618866e-01f, 9.852776527e-01f},
+	{1.588581502e-01f, 9.873014092e-01f},
+	{1.467304677e-01f, 9.891765118e-01f},
+	{1.345807016e-01f, 9.909026623e-01f},
+	{1.224106774e-01f, 9.924795628e-01f},
+	{1.102222055e-01f, 9.939069748e-01f},
+	{9.801714122e-02f, 9.951847196e-01f},
+	{8.579730988e-02f, 9.963126183e-01f},
+	{7.356456667e-02f, 9.972904325e-01f},
+	{6.132073700e-02f, 9.981181026e-01f},
+	{4.906767607e-02f, 9.987954497e-01f},
+	{3.680722415e-02f, 9.993223548e-01f},
+	{2.454122901e-02f, 9.996988177e-01f},
+	{1.227153838e-02f, 9.999247193e-01f},
+	{6.123234263e-17f, 1.000000000e+00f},
+	{-1.227153838e-02f, 9.999247193e-01f},
+	{-2.454122901e-02f, 9.996988177e-01f},
+	{-3.680722415e-02f, 9.993223548e-01f},
+	{-4.906767607e-02f, 9.987954497e-01f},
+	{-6.132073700e-02f, 9.981181026e-01f},
+	{-7.356456667e-02f, 9.972904325e-01f},
+	{-8.579730988e-02f, 9.963126183e-01f},
+	{-9.801714122e-02f, 9.951847196e-01f},
+	{-1.102222055e-01f, 9.939069748e-01f},
+	{-1.224106774e-01f, 9.924795628e-01f},
+	{-1.345807016e-01f, 9.909026623e-01f},
+	{-1.467304677e-01f, 9.891765118e-01f},
+	{-1.588581502e-01f, 9.873014092e-01f},
+	{-1.709618866e-01f, 9.852776527e-01f},
+	{-1.830398887e-01f, 9.831054807e-01f},
+	{-1.950903237e-01f, 9.807852507e-01f},
+	{-2.071113735e-01f, 9.783173800e-01f},
+	{-2.191012353e-01f, 9.757021070e-01f},
+	{-2.310581058e-01f, 9.729399681e-01f},
+	{-2.429801822e-01f, 9.700312614e-01f},
+	{-2.548656464e-01f, 9.669764638e-01f},
+	{-2.667127550e-01f, 9.637760520e-01f},
+	{-2.785196900e-01f, 9.604305029e-01f},
+	{-2.902846634e-01f, 9.569403529e-01f},
+	{-3.020059466e-01f, 9.533060193e-01f},
+	{-3.136817515e-01f, 9.495281577e-01f},
+	{-3.253102899e-01f, 9.456073046e-01f},
+	{-3.368898630e-01f, 9.415440559e-01f},
+	{-3.484186828e-01f, 9.373390079e-01f},
+	{-3.598950505e-01f, 9.329928160e-01f},
+	{-3.713172078e-01f, 9.285060763e-01f},
+	{-3.826834261e-01f, 9.238795042e-01f},
+	{-3.939920366e-01f, 9.191138744e-01f},
+	{-4.052413106e-01f, 9.142097831e-01f},
+	{-4.164295495e-01f, 9.091680050e-01f},
+	{-4.275550842e-01f, 9.039893150e-01f},
+	{-4.386162460e-01f, 8.986744881e-01f},
+	{-4.496113360e-01f, 8.932242990e-01f},
+	{-4.605387151e-01f, 8.876396418e-01f},
+	{-4.713967443e-01f, 8.819212914e-01f},
+	{-4.821837842e-01f, 8.760700822e-01f},
+	{-4.928981960e-01f, 8.700869679e-01f},
+	{-5.035383701e-01f, 8.639728427e-01f},
+	{-5.141027570e-01f, 8.577286005e-01f},
+	{-5.245896578e-01f, 8.513551950e-01f},
+	{-5.349976420e-01f, 8.448535800e-01f},
+	{-5.453249812e-01f, 8.382247090e-01f},
+	{-5.555702448e-01f, 8.314695954e-01f},
+	{-5.657318234e-01f, 8.245893121e-01f},
+	{-5.758081675e-01f, 8.175848126e-01f},
+	{-5.857978463e-01f, 8.104571700e-01f},
+	{-5.956993103e-01f, 8.032075167e-01f},
+	{-6.055110693e-01f, 7.958369255e-01f},
+	{-6.152315736e-01f, 7.883464098e-01f},
+	{-6.248595119e-01f, 7.807372212e-01f},
+	{-6.343932748e-01f, 7.730104327e-01f},
+	{-6.438315511e-01f, 7.651672363e-01f},
+	{-6.531728506e-01f, 7.572088242e-01f},
+	{-6.624158025e-01f, 7.491363883e-01f},
+	{-6.715589762e-01f, 7.409511209e-01f},
+	{-6.806010008e-01f, 7.326542735e-01f},
+	{-6.895405650e-01f, 7.242470980e-01f},
+	{-6.983762383e-01f, 7.157308459e-01f},
+	{-7.071067691e-01f, 7.071067691e-01f},
+	{-7.157308459e-01f, 6.983762383e-01f},
+	{-7.242470980e-01f, 6.895405650e-01f},
+	{-7.326542735e-01f, 6.806010008e-01f},
+	{-7.409511209e-01f, 6.715589762e-01f},
+	{-7.491363883e-01f, 6.624158025e-01f},
+	{-7.572088242e-01f, 6.531728506e-01f},
+	{-7.651672363e-01f, 6.438315511e-01f},
+	{-7.730104327e-01f, 6.343932748e-01f},
+	{-7.807372212e-01f, 6.248595119e-01f},
+	{-7.883464098e-01f, 6.152315736e-01f},
+	{-7.958369255e-01f, 6.055110693e-01f},
+	{-8.032075167e-01f, 5.956993103e-01f},
+	{-8.104571700e-01f, 5.857978463e-01f},
+	{-8.175848126e-01f, 5.758081675e-01f},
+	{-8.245893121e-01f, 5.657318234e-01f},
+	{-8.314695954e-01f, 5.555702448e-01f},
+	{-8.382247090e-01f, 5.453249812e-01f},
+	{-8.448535800e-01f, 5.349976420e-01f},
+	{-8.513551950e-01f, 5.245896578e-01f},
+	{-8.577286005e-01f, 5.141027570e-01f},
+	{-8.639728427e-01f, 5.035383701e-01f},
+	{-8.700869679e-01f, 4.928981960e-01f},
+	{-8.760700822e-01f, 4.821837842e-01f},
+	{-8.819212914e-01f, 4.713967443e-01f},
+	{-8.876396418e-01f, 4.605387151e-01f},
+	{-8.932242990e-01f, 4.496113360e-01f},
+	{-8.986744881e-01f, 4.386162460e-01f},
+	{-9.039893150e-01f, 4.275550842e-01f},
+	{-9.091680050e-01f, 4.164295495e-01f},
+	{-9.142097831e-01f, 4.052413106e-01f},
+	{-9.191138744e-01f, 3.939920366e-01f},
+	{-9.238795042e-01f, 3.826834261e-01f},
+	{-9.285060763e-01f, 3.713172078e-01f},
+	{-9.329928160e-01f, 3.598950505e-01f},
+	{-9.373390079e-01f, 3.484186828e-01f},
+	{-9.415440559e-01f, 3.368898630e-01f},
+	{-9.456073046e-01f, 3.253102899e-01f},
+	{-9.495281577e-01f, 3.136817515e-01f},
+	{-9.533060193e-01f, 3.020059466e-01f},
+	{-9.569403529e-01f, 2.902846634e-01f},
+	{-9.604305029e-01f, 2.785196900e-01f},
+	{-9.637760520e-01f, 2.667127550e-01f},
+	{-9.669764638e-01f, 2.548656464e-01f},
+	{-9.700312614e-01f, 2.429801822e-01f},
+	{-9.729399681e-01f, 2.310581058e-01f},
+	{-9.757021070e-01f, 2.191012353e-01f},
+	{-9.783173800e-01f, 2.071113735e-01f},
+	{-9.807852507e-01f, 1.950903237e-01f},
+	{-9.831054807e-01f, 1.830398887e-01f},
+	{-9.852776527e-01f, 1.709618866e-01f},
+	{-9.873014092e-01f, 1.588581502e-01f},
+	{-9.891765118e-01f, 1.467304677e-01f},
+	{-9.909026623e-01f, 1.345807016e-01f},
+	{-9.924795628e-01f, 1.224106774e-01f},
+	{-9.939069748e-01f, 1.102222055e-01f},
+	{-9.951847196e-01f, 9.801714122e-02f},
+	{-9.963126183e-01f, 8.579730988e-02f},
+	{-9.972904325e-01f, 7.356456667e-02f},
+	{-9.981181026e-01f, 6.132073700e-02f},
+	{-9.987954497e-01f, 4.906767607e-02f},
+	{-9.993223548e-01f, 3.680722415e-02f},
+	{-9.996988177e-01f, 2.454122901e-02f},
+	{-9.999247193e-01f, 1.227153838e-02f}
+};
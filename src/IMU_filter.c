@@ -0,0 +1,319 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Filtro software sui sei canali del sensore (accelerometro e giroscopio):
+* passa basso Butterworth di ordine pari seguito da notch per le
+* vibrazioni dei motori delle ruote, come cascata di biquad in forma diretta II
+* trasposta. I campioni sono organizzati per canale (un vettore per canale),
+* cosi' un blocco letto dalla FIFO si filtra con un ciclo stretto per stadio e
+* per canale, con coefficienti e stato nei registri.
+* Con la lettura diretta il filtro lavora sui campioni calibrati alla frequenza
+* di uscita; con la decimazione lavora sui campioni grezzi della FIFO, prima
+* del CIC, alla frequenza del sensore (IMU_filter_rate). I canali hanno gli
+* stessi coefficienti e il guadagno in continua e' unitario, quindi filtrare
+* prima della calibrazione, che e' affine, da' lo stesso risultato
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <mathf.h>
+#include <stdbool.h>
+#include <string.h>
+#include "IMU.h"
+#include "IMU_decim.h"
+#include "IMU_filter.h"
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static void IMU_filter_lowpass (IMU_biquad_struct *c, float fs, float f0, float q);
+static void IMU_filter_notch (IMU_biquad_struct *c, float fs, float f0, float q);
+static void IMU_filter_prime (IMU_filter_struct *f, const float *v, uint16_t stride);
+
+/*******************************************************************************
+* Nome funzione     : IMU_filter_init
+* Descrizione  	    : Calcola i coefficienti dalla configurazione e azzera lo
+* 					  stato. Il passa basso di ordine 2N usa N biquad con i
+* 					  fattori di merito dei poli di Butterworth,
+* 					  Q_k = 1 / (2 sin((2k + 1) pi / 4N))
+* Argomenti         : (IMU_filter_struct) *f -
+* 						 filtro
+* 					  (IMU_filter_config_struct) *cfg -
+* 					  	 configurazione
+* 					  (uint16_t) rate_hz -
+* 					  	 frequenza dei campioni filtrati
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_filter_init(IMU_filter_struct *f, const IMU_filter_config_struct *cfg, uint16_t rate_hz)
+{
+	/* Definisce le variabili locali */
+	uint8_t stages = cfg->lowpass_stages;
+	uint8_t k;
+
+	memset(f, 0, sizeof(*f));
+	f->fs = (float)rate_hz;
+	f->notch_q = cfg->notch_q;
+
+	if (stages > IMU_FILTER_MAX_LOWPASS) {
+		stages = IMU_FILTER_MAX_LOWPASS;
+	}
+
+	/* Passa basso */
+	for (k = 0; (k < stages) && (cfg->lowpass_hz > 0.0f); k++)
+	{
+		IMU_filter_lowpass(&f->coef[k], f->fs, cfg->lowpass_hz,
+						   0.5f / sinf((2 * k + 1) * (float)M_PI / (4 * stages)));
+		f->active[k] = true;
+	}
+	f->num_stages = k;
+
+	/* Notch: gli stadi esistono se e' impostata la selettivita', anche se spenti,
+	 per poterli spostare durante il funzionamento */
+	f->notch_first = f->num_stages;
+	if (cfg->notch_q > 0.0f)
+	{
+		f->num_stages += IMU_FILTER_MAX_NOTCH;
+		for (k = 0; k < IMU_FILTER_MAX_NOTCH; k++)
+		{
+			f->notch_hz[k] = -1.0f;
+			IMU_filter_set_notch(f, k, cfg->notch_hz[k]);
+		}
+	}
+
+} /* Fine IMU_filter_init() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_filter_rate
+* Descrizione  	    : Frequenza a cui lavora il filtro software: quella dei
+* 					  campioni della FIFO con la decimazione, altrimenti quella
+* 					  di uscita
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : (uint16_t) -
+* 						 frequenza di campionamento del filtro (Hz)
+*******************************************************************************/
+uint16_t IMU_filter_rate(const IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	uint16_t factor = dev->config.decim;
+
+	if (factor <= 1) {
+		return dev->config.rate_hz;
+	}
+	if (factor > IMU_DECIM_MAX_FACTOR) {
+		factor = IMU_DECIM_MAX_FACTOR;
+	}
+
+	return dev->config.rate_hz * factor;
+
+} /* Fine IMU_filter_rate() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_filter_set_notch
+* Descrizione  	    : Sposta un notch, ad esempio sulla frequenza di rotazione
+* 					  delle ruote. Lo stato viene conservato, quindi il
+* 					  centro puo' seguire con continuita' la velocita' dei
+* 					  motori; variazioni sotto IMU_FILTER_NOTCH_STEP sono
+* 					  ignorate per non ricalcolare seno e coseno ad ogni
+* 					  chiamata. Un centro nullo o oltre il limite di Nyquist
+* 					  spegne il notch
+* Argomenti         : (IMU_filter_struct) *f -
+* 						 filtro
+* 					  (uint8_t) idx -
+* 					  	 indice del notch
+* 					  (float) hz -
+* 					  	 nuovo centro (Hz)
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_filter_set_notch(IMU_filter_struct *f, uint8_t idx, float hz)
+{
+	/* Definisce le variabili locali */
+	uint8_t s = f->notch_first + idx;
+
+	if ((idx >= IMU_FILTER_MAX_NOTCH) || (f->notch_q <= 0.0f) ||
+		(fabsf(hz - f->notch_hz[idx]) < IMU_FILTER_NOTCH_STEP)) {
+		return;
+	}
+
+	f->notch_hz[idx] = hz;
+	f->active[s] = (hz > 0.0f) && (hz < IMU_FILTER_NYQUIST_MARGIN * f->fs);
+	if (f->active[s]) {
+		IMU_filter_notch(&f->coef[s], f->fs, hz, f->notch_q);
+	}
+
+} /* Fine IMU_filter_set_notch() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_filter_run
+* Descrizione  	    : Filtra sul posto un blocco di campioni. Il campione i del
+* 					  canale c si trova in v[c * stride + i]; un singolo
+* 					  campione e' un vettore di sei elementi con stride 1.
+* 					  Alla prima chiamata lo stato viene portato a regime sul
+* 					  primo campione, per evitare il transitorio da zero
+* Argomenti         : (IMU_filter_struct) *f -
+* 						 filtro
+* 					  (float) *v -
+* 					  	 campioni, accelerometro xyz e giroscopio xyz
+* 					  (uint16_t) n -
+* 					  	 campioni per canale
+* 					  (uint16_t) stride -
+* 					  	 distanza tra i canali in v
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_filter_run(IMU_filter_struct *f, float *v, uint16_t n, uint16_t stride)
+{
+	/* Definisce le variabili locali */
+	float b0, b1, b2, a1, a2, z1, z2, x, y;
+	float *p;
+	uint16_t i;
+	uint8_t s, c;
+
+	if (0 == n) {
+		return;
+	}
+
+	if (!f->primed) {
+		IMU_filter_prime(f, v, stride);
+	}
+
+	for (s = 0; s < f->num_stages; s++)
+	{
+		if (!f->active[s]) {
+			continue;
+		}
+
+		b0 = f->coef[s].b0;
+		b1 = f->coef[s].b1;
+		b2 = f->coef[s].b2;
+		a1 = f->coef[s].a1;
+		a2 = f->coef[s].a2;
+
+		for (c = 0; c < IMU_FILTER_CHANNELS; c++)
+		{
+			p = &v[c * stride];
+			z1 = f->z1[s][c];
+			z2 = f->z2[s][c];
+
+			for (i = 0; i < n; i++)
+			{
+				x = p[i];
+				y = b0 * x + z1;
+				z1 = b1 * x - a1 * y + z2;
+				z2 = b2 * x - a2 * y;
+				p[i] = y;
+			}
+
+			f->z1[s][c] = z1;
+			f->z2[s][c] = z2;
+		}
+	}
+
+} /* Fine IMU_filter_run() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_filter_prime
+* Descrizione  	    : Porta lo stato di ogni stadio nella condizione di regime
+* 					  per un ingresso costante pari al primo campione
+* Argomenti         : (IMU_filter_struct) *f -
+* 						 filtro
+* 					  (float) *v -
+* 					  	 primo blocco di campioni
+* 					  (uint16_t) stride -
+* 					  	 distanza tra i canali in v
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_filter_prime(IMU_filter_struct *f, const float *v, uint16_t stride)
+{
+	/* Definisce le variabili locali */
+	const IMU_biquad_struct *k;
+	float x, y;
+	uint8_t s, c;
+
+	for (c = 0; c < IMU_FILTER_CHANNELS; c++)
+	{
+		x = v[c * stride];
+		for (s = 0; s < f->num_stages; s++)
+		{
+			if (!f->active[s]) {
+				continue;
+			}
+			k = &f->coef[s];
+			y = x * (k->b0 + k->b1 + k->b2) / (1.0f + k->a1 + k->a2);
+			f->z2[s][c] = k->b2 * x - k->a2 * y;
+			f->z1[s][c] = k->b1 * x - k->a1 * y + f->z2[s][c];
+			x = y;
+		}
+	}
+
+	f->primed = true;
+
+} /* Fine IMU_filter_prime() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_filter_lowpass
+* Descrizione  	    : Coefficienti di un passa basso del secondo ordine
+* 					  (trasformata bilineare con precompensazione del taglio)
+* Argomenti         : (IMU_biquad_struct) *c -
+* 						 coefficienti calcolati
+* 					  (float) fs -
+* 					  	 frequenza di campionamento (Hz)
+* 					  (float) f0 -
+* 					  	 frequenza di taglio (Hz), limitata sotto Nyquist
+* 					  (float) q -
+* 					  	 fattore di merito
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_filter_lowpass(IMU_biquad_struct *c, float fs, float f0, float q)
+{
+	/* Definisce le variabili locali */
+	float w0, cw, alpha, a0;
+
+	if (f0 > IMU_FILTER_NYQUIST_MARGIN * fs) {
+		f0 = IMU_FILTER_NYQUIST_MARGIN * fs;
+	}
+
+	w0 = 2.0f * (float)M_PI * f0 / fs;
+	cw = cosf(w0);
+	alpha = sinf(w0) / (2.0f * q);
+	a0 = 1.0f + alpha;
+
+	c->b0 = 0.5f * (1.0f - cw) / a0;
+	c->b1 = (1.0f - cw) / a0;
+	c->b2 = c->b0;
+	c->a1 = -2.0f * cw / a0;
+	c->a2 = (1.0f - alpha) / a0;
+
+} /* Fine IMU_filter_lowpass() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_filter_notch
+* Descrizione  	    : Coefficienti di un notch del secondo ordine (guadagno
+* 					  unitario in continua, nullo al centro)
+* Argomenti         : (IMU_biquad_struct) *c -
+* 						 coefficienti calcolati
+* 					  (float) fs -
+* 					  	 frequenza di campionamento (Hz)
+* 					  (float) f0 -
+* 					  	 centro (Hz)
+* 					  (float) q -
+* 					  	 fattore di merito (centro / larghezza di banda)
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_filter_notch(IMU_biquad_struct *c, float fs, float f0, float q)
+{
+	/* Definisce le variabili locali */
+	float w0, cw, alpha, a0;
+
+	w0 = 2.0f * (float)M_PI * f0 / fs;
+	cw = cosf(w0);
+	alpha = sinf(w0) / (2.0f * q);
+	a0 = 1.0f + alpha;
+
+	c->b0 = 1.0f / a0;
+	c->b1 = -2.0f * cw / a0;
+	c->b2 = c->b0;
+	c->a1 = c->b1;
+	c->a2 = (1.0f - alpha) / a0;
+
+} /* Fine IMU_filter_notch() */
@@ -0,0 +1,26 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _IMU_FILTER_H_
+#define _IMU_FILTER_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdint.h>
+#include "main.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_FILTER_NYQUIST_MARGIN			0.45f	/* centro o taglio massimo, in frazioni di fs */
+#define IMU_FILTER_NOTCH_STEP				0.5f	/* variazione minima (Hz) per ricalcolare un notch */
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+void IMU_filter_init(IMU_filter_struct *f, const IMU_filter_config_struct *cfg, uint16_t rate_hz);
+uint16_t IMU_filter_rate(const IMU_dev_struct *dev);
+void IMU_filter_set_notch(IMU_filter_struct *f, uint8_t idx, float hz);
+void IMU_filter_run(IMU_filter_struct *f, float *v, uint16_t n, uint16_t stride);
+
+#endif /* _IMU_FILTER_H_ */
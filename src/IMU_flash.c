@@ -0,0 +1,259 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Data flash E2 dell'RX63N (32 KB, blocchi di cancellazione da 32 byte,
+* programmazione a 8 byte) tramite il FCU. Cancellazione e programmazione
+* vengono solo avviate: la fine dell'operazione arriva con l'interrupt FRDYI,
+* che chiama la funzione registrata in IMU_flash_init, quindi il chiamante non
+* attende mai il FCU. Durante un'operazione la data flash non e' leggibile.
+* Una cella cancellata ha contenuto indefinito in lettura: i dati vanno
+* riconosciuti dal contenuto (firma e CRC), non dal valore 0xFF.
+* Sull'host il modulo e' sostituito da tools/host/flash_sim.c
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "platform.h"
+#include "CMT.h"
+#include "IMU_flash.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_FLASH_READ_MODE					0xAA00	/* FENTRYR: lettura */
+#define IMU_FLASH_PE_MODE					0xAA80	/* FENTRYR: P/E della data flash */
+#define IMU_FLASH_FSTATR0_FRDY				0x80
+#define IMU_FLASH_FSTATR0_ERRORS			0x70	/* ILGLERR, ERSERR, PRGERR */
+#define IMU_FLASH_FSTATR0_ILGLERR			0x40
+#define IMU_FLASH_FASTAT_CMDLK				0x10
+
+#define IMU_FLASH_CMD8(offset)				(*(volatile uint8_t  *)(IMU_FLASH_BASE + (offset)))
+#define IMU_FLASH_CMD16(offset)				(*(volatile uint16_t *)(IMU_FLASH_BASE + (offset)))
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+static volatile uint8_t IMU_flash_state = IMU_FLASH_ERROR;
+static void (*IMU_flash_done)(void);
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static bool IMU_flash_wait (void);
+static void IMU_flash_clear (void);
+
+/*******************************************************************************
+* Nome funzione     : IMU_flash_init
+* Descrizione  	    : Abilita lettura e scrittura della data flash, copia il
+* 					  firmware del FCU nella sua RAM, comunica al FCU la
+* 					  frequenza di FCLK e abilita l'interrupt FRDYI.
+* 					  Bloccante: va chiamata una volta all'avvio
+* Argomenti         : (void (*)(void)) done -
+* 						 chiamata (nell'interrupt) alla fine di ogni
+* 						 cancellazione o programmazione
+* Valori restituiti : (bool) -
+* 						 false se il FCU non risponde
+*******************************************************************************/
+bool IMU_flash_init(void (*done)(void))
+{
+	/* Definisce le variabili locali */
+	bool ok;
+
+	IMU_flash_done = done;
+
+	/* Lettura e P/E abilitate su tutti i 16 blocchi da 2 KB */
+	FLASH.DFLRE0.WORD = 0x2DFF;
+	FLASH.DFLRE1.WORD = 0x2DFF;
+	FLASH.DFLWE0.WORD = 0x1EFF;
+	FLASH.DFLWE1.WORD = 0x1EFF;
+
+	/* Il firmware del FCU si copia con il FCU fermo (modo lettura) */
+	FLASH.FENTRYR.WORD = IMU_FLASH_READ_MODE;
+	FLASH.FCURAME.WORD = 0xC401;
+	memcpy((void *)IMU_FLASH_FCU_RAM, (const void *)IMU_FLASH_FCU_FIRM, IMU_FLASH_FCU_SIZE);
+
+	/* Frequenza di FCLK in MHz, usata dal FCU per i tempi di scrittura */
+	FLASH.FENTRYR.WORD = IMU_FLASH_PE_MODE;
+	FLASH.PCKAR.WORD = FCLK_HZ / 1000000;
+	IMU_FLASH_CMD8(0) = 0xE9;
+	IMU_FLASH_CMD8(0) = 0x03;
+	IMU_FLASH_CMD16(0) = 0x0F0F;
+	IMU_FLASH_CMD16(0) = 0x0F0F;
+	IMU_FLASH_CMD16(0) = 0x0F0F;
+	IMU_FLASH_CMD8(0) = 0xD0;
+	ok = IMU_flash_wait();
+
+	if (!ok || (FLASH.FSTATR0.BYTE & IMU_FLASH_FSTATR0_ERRORS))
+	{
+		IMU_flash_clear();
+		ok = false;
+	}
+	FLASH.FENTRYR.WORD = IMU_FLASH_READ_MODE;
+
+	FLASH.FRDYIE.BYTE = 0x01;
+	IPR(FCU, FRDYI) = 0x01;
+	IEN(FCU, FRDYI) = 1;
+
+	IMU_flash_state = ok ? IMU_FLASH_OK : IMU_FLASH_ERROR;
+
+	return ok;
+
+} /* Fine IMU_flash_init() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_flash_erase
+* Descrizione  	    : Avvia la cancellazione di un blocco da IMU_FLASH_BLOCK byte
+* Argomenti         : (uint32_t) offset -
+* 						 inizio del blocco dall'inizio della data flash
+* Valori restituiti : (bool) -
+* 						 false se il FCU e' occupato
+*******************************************************************************/
+bool IMU_flash_erase(uint32_t offset)
+{
+	if ((IMU_FLASH_BUSY == IMU_flash_state) || (offset >= IMU_FLASH_SIZE)) {
+		return false;
+	}
+
+	IMU_flash_state = IMU_FLASH_BUSY;
+	FLASH.FENTRYR.WORD = IMU_FLASH_PE_MODE;
+	IMU_FLASH_CMD8(offset) = 0x20;
+	IMU_FLASH_CMD8(offset) = 0xD0;
+
+	return true;
+
+} /* Fine IMU_flash_erase() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_flash_program
+* Descrizione  	    : Avvia la programmazione di IMU_FLASH_WRITE byte in una
+* 					  zona cancellata. I dati vengono copiati nel FCU prima
+* 					  del ritorno
+* Argomenti         : (uint32_t) offset -
+* 						 destinazione, multipla di IMU_FLASH_WRITE
+* 					  (uint8_t) *data -
+* 					  	 dati da scrivere
+* Valori restituiti : (bool) -
+* 						 false se il FCU e' occupato
+*******************************************************************************/
+bool IMU_flash_program(uint32_t offset, const uint8_t *data)
+{
+	/* Definisce le variabili locali */
+	uint8_t i;
+
+	if ((IMU_FLASH_BUSY == IMU_flash_state) || (offset >= IMU_FLASH_SIZE)) {
+		return false;
+	}
+
+	IMU_flash_state = IMU_FLASH_BUSY;
+	FLASH.FENTRYR.WORD = IMU_FLASH_PE_MODE;
+	IMU_FLASH_CMD8(offset) = 0xE8;
+	IMU_FLASH_CMD8(offset) = IMU_FLASH_WRITE / 2;
+	for (i = 0; i < IMU_FLASH_WRITE; i += 2) {
+		IMU_FLASH_CMD16(offset) = (uint16_t)(data[i] | (data[i + 1] << 8));
+	}
+	IMU_FLASH_CMD8(offset) = 0xD0;
+
+	return true;
+
+} /* Fine IMU_flash_program() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_flash_status
+* Descrizione  	    : Stato dell'ultima operazione
+* Argomenti         : No
+* Valori restituiti : (uint8_t) -
+* 						 IMU_flash_status_e
+*******************************************************************************/
+uint8_t IMU_flash_status(void)
+{
+	return IMU_flash_state;
+
+} /* Fine IMU_flash_status() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_flash_read
+* Descrizione  	    : Legge la data flash (solo con il FCU fermo)
+* Argomenti         : (uint32_t) offset -
+* 						 inizio della lettura
+* 					  (void) *out -
+* 					  	 destinazione
+* 					  (uint16_t) n -
+* 					  	 byte da leggere
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_flash_read(uint32_t offset, void *out, uint16_t n)
+{
+	memcpy(out, (const void *)(IMU_FLASH_BASE + offset), n);
+
+} /* Fine IMU_flash_read() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_flash_wait
+* Descrizione  	    : Attende FRDY per al massimo IMU_FLASH_TIMEOUT ms
+* Argomenti         : No
+* Valori restituiti : (bool) -
+* 						 false allo scadere del tempo
+*******************************************************************************/
+static bool IMU_flash_wait(void)
+{
+	/* Definisce le variabili locali */
+	int32_t start = get_ms();
+
+	while (!(FLASH.FSTATR0.BYTE & IMU_FLASH_FSTATR0_FRDY))
+	{
+		if (get_ms() - start > IMU_FLASH_TIMEOUT) {
+			return false;
+		}
+	}
+
+	return true;
+
+} /* Fine IMU_flash_wait() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_flash_clear
+* Descrizione  	    : Cancella gli errori del FCU (il blocco dei comandi dopo
+* 					  un comando illegale va tolto prima dello status clear)
+* Argomenti         : No
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_flash_clear(void)
+{
+	if ((FLASH.FSTATR0.BYTE & IMU_FLASH_FSTATR0_ILGLERR) &&
+		(IMU_FLASH_FASTAT_CMDLK != FLASH.FASTAT.BYTE)) {
+		FLASH.FASTAT.BYTE = IMU_FLASH_FASTAT_CMDLK;
+	}
+	IMU_FLASH_CMD8(0) = 0x50;
+
+} /* Fine IMU_flash_clear() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_flash_isr
+* Descrizione  	    : Fine di una cancellazione o programmazione: registra
+* 					  l'esito, torna in lettura e chiama la funzione
+* 					  registrata, che puo' avviare l'operazione successiva
+* Argomenti         : No
+* Valori restituiti : No
+*******************************************************************************/
+#pragma interrupt (IMU_flash_isr(vect = VECT(FCU, FRDYI)))
+static void IMU_flash_isr(void)
+{
+	if (FLASH.FSTATR0.BYTE & IMU_FLASH_FSTATR0_ERRORS)
+	{
+		IMU_flash_clear();
+		IMU_flash_state = IMU_FLASH_ERROR;
+	}
+	else {
+		IMU_flash_state = IMU_FLASH_OK;
+	}
+	FLASH.FENTRYR.WORD = IMU_FLASH_READ_MODE;
+
+	if (IMU_flash_done) {
+		IMU_flash_done();
+	}
+
+} /* Fine IMU_flash_isr() */
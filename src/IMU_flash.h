@@ -0,0 +1,46 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _IMU_FLASH_H_
+#define _IMU_FLASH_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_FLASH_BASE						0x00100000UL	/* data flash E2: lettura e comandi allo stesso indirizzo */
+#define IMU_FLASH_SIZE						32768
+#define IMU_FLASH_BLOCK						32		/* unita' di cancellazione */
+#define IMU_FLASH_WRITE						8		/* unita' di programmazione */
+#define IMU_FLASH_BLOCKS					(IMU_FLASH_SIZE / IMU_FLASH_BLOCK)
+
+#define IMU_FLASH_FCU_FIRM					0xFEFFE000UL	/* firmware del FCU in ROM */
+#define IMU_FLASH_FCU_RAM					0x007F8000UL	/* RAM del FCU */
+#define IMU_FLASH_FCU_SIZE					8192
+#define IMU_FLASH_TIMEOUT					50		/* attesa massima di un comando bloccante (ms) */
+
+/*******************************************************************************
+Definizione enumerazioni
+*******************************************************************************/
+/* Esito dell'ultima operazione */
+enum IMU_flash_status_e {
+	IMU_FLASH_OK = 0,
+	IMU_FLASH_BUSY,
+	IMU_FLASH_ERROR,				/* errore di cancellazione, programmazione o comando */
+	NUM_IMU_FLASH
+};
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+bool IMU_flash_init(void (*done)(void));
+bool IMU_flash_erase(uint32_t offset);
+bool IMU_flash_program(uint32_t offset, const uint8_t *data);
+uint8_t IMU_flash_status(void);
+void IMU_flash_read(uint32_t offset, void *out, uint16_t n);
+
+#endif /* _IMU_FLASH_H_ */
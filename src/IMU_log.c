@@ -0,0 +1,133 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Registro differito: un punto di registrazione (IMU_LOG0..IMU_LOG3) scrive in
+* RAM l'identificativo del messaggio, l'istante e gli argomenti grezzi, senza
+* formattare testo. Costa una chiamata e qualche decina di cicli, quindi si
+* puo' usare negli interrupt e nel ciclo di controllo senza alterarne i
+* tempi. Il ciclo principale svuota il registro sulla telemetria quando la
+* linea e' libera (IMU_telem_send_log); l'host espande i messaggi con i
+* formati di IMU_log_msg.h (tools/imu_telemrec.c -g). Con il debugger il
+* registro si legge anche direttamente (variabile IMU_log).
+*
+* Un messaggio occupa 2 + argomenti parole:
+*   0  argomenti, identificativo, CMT_counter (IMU_LOG_HDR)
+*   1  istante (ms)
+*   2  argomenti (32 bit)
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <machine.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "CMT.h"
+#include "IMU_log.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_LOG_PSW_I						0x00010000	/* bit I della PSW: interrupt abilitati */
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+IMU_log_struct IMU_log;
+
+/*******************************************************************************
+* Nome funzione     : IMU_log_put
+* Descrizione  	    : Registra un messaggio (da usare con IMU_LOG0..IMU_LOG3).
+* 					  Chiamabile da interrupt: solo la riserva dello spazio
+* 					  avviene con gli interrupt mascherati, e il loro stato
+* 					  precedente viene ripristinato
+* Argomenti         : (uint32_t) hdr -
+* 						 IMU_LOG_HDR(identificativo, argomenti)
+* 					  (uint32_t) a, b, c -
+* 					  	 argomenti (quelli oltre il numero indicato sono ignorati)
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_log_put(uint32_t hdr, uint32_t a, uint32_t b, uint32_t c)
+{
+	/* Definisce le variabili locali */
+	IMU_log_struct *l = &IMU_log;
+	uint16_t n = IMU_LOG_HDR_ARGS(hdr) + 2;
+	uint32_t psw;
+	uint16_t head;
+
+	psw = get_psw();
+	clrpsw_i();
+	head = l->head;
+	if ((uint16_t)(head + n - l->tail) > IMU_LOG_SIZE)
+	{
+		l->drops++;
+		if (psw & IMU_LOG_PSW_I) {
+			setpsw_i();
+		}
+		return;
+	}
+	l->head = head + n;
+	l->records++;
+	if (psw & IMU_LOG_PSW_I) {
+		setpsw_i();
+	}
+
+	/* Le parole riservate sono solo di questo messaggio: l'intestazione per ultima */
+	l->buf[(head + 1) & IMU_LOG_MASK] = (uint32_t)get_ms();
+	if (n > 2) {
+		l->buf[(head + 2) & IMU_LOG_MASK] = a;
+	}
+	if (n > 3) {
+		l->buf[(head + 3) & IMU_LOG_MASK] = b;
+	}
+	if (n > 4) {
+		l->buf[(head + 4) & IMU_LOG_MASK] = c;
+	}
+	l->buf[head & IMU_LOG_MASK] = hdr | CMT_counter();
+
+} /* Fine IMU_log_put() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_log_pop
+* Descrizione  	    : Estrae messaggi interi, dal piu' vecchio, fino a max
+* 					  parole (solo il consumatore). Si ferma al primo
+* 					  messaggio riservato ma non ancora scritto (produttore
+* 					  interrotto): uscira' alla chiamata successiva
+* Argomenti         : (uint32_t) *out -
+* 						 parole estratte
+* 					  (uint16_t) max -
+* 					  	 dimensione di out
+* Valori restituiti : (uint16_t) -
+* 						 parole estratte
+*******************************************************************************/
+uint16_t IMU_log_pop(uint32_t *out, uint16_t max)
+{
+	/* Definisce le variabili locali */
+	IMU_log_struct *l = &IMU_log;
+	uint16_t tail = l->tail;
+	uint16_t words = 0, n, k;
+	uint32_t w;
+
+	while (tail != l->head)
+	{
+		w = l->buf[tail & IMU_LOG_MASK];
+		if (0 == w) {
+			break;
+		}
+		n = IMU_LOG_HDR_ARGS(w) + 2;
+		if (words + n > max) {
+			break;
+		}
+
+		for (k = 0; k < n; k++)
+		{
+			out[words++] = l->buf[(tail + k) & IMU_LOG_MASK];
+			l->buf[(tail + k) & IMU_LOG_MASK] = 0;
+		}
+		tail += n;
+	}
+	l->tail = tail;
+
+	return words;
+
+} /* Fine IMU_log_pop() */
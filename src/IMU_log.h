@@ -0,0 +1,96 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _IMU_LOG_H_
+#define _IMU_LOG_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_LOG_SIZE						512		/* parole a 32 bit del registro (potenza di 2) */
+#define IMU_LOG_MASK						(IMU_LOG_SIZE - 1)
+#define IMU_LOG_MAX_ARGS					3
+#define IMU_LOG_MAX_RECORD					(2 + IMU_LOG_MAX_ARGS)	/* parole di un messaggio */
+
+#if (IMU_LOG_SIZE & IMU_LOG_MASK) != 0
+#error "IMU_LOG_SIZE deve essere una potenza di 2"
+#endif
+
+/* Prima parola di un messaggio: argomenti (2 bit), identificativo (14 bit),
+   CMT_counter (16 bit). Non e' mai zero: lo zero segna le parole libere */
+#define IMU_LOG_HDR(id, n)					(((uint32_t)(n) << 30) | ((uint32_t)(id) << 16))
+#define IMU_LOG_HDR_ARGS(w)					((uint8_t)((w) >> 30))
+#define IMU_LOG_HDR_ID(w)					((uint16_t)(((w) >> 16) & 0x3FFF))
+#define IMU_LOG_HDR_COUNT(w)				((uint16_t)(w))
+
+/* Punti di registrazione: identificativo costante e argomenti grezzi, senza
+   formattazione. Gli interi vengono convertiti a 32 bit, i float passano con
+   IMU_LOG_F (i loro bit) */
+#define IMU_LOG0(id)						IMU_log_put(IMU_LOG_HDR(id, 0), 0, 0, 0)
+#define IMU_LOG1(id, a)						IMU_log_put(IMU_LOG_HDR(id, 1), (uint32_t)(a), 0, 0)
+#define IMU_LOG2(id, a, b)					IMU_log_put(IMU_LOG_HDR(id, 2), (uint32_t)(a), (uint32_t)(b), 0)
+#define IMU_LOG3(id, a, b, c)				IMU_log_put(IMU_LOG_HDR(id, 3), (uint32_t)(a), (uint32_t)(b), (uint32_t)(c))
+#define IMU_LOG_F(x)						(((IMU_log_word_u){.f = (float)(x)}).u)
+
+/*******************************************************************************
+Definizione enumerazioni
+*******************************************************************************/
+/* Identificativi dei messaggi, nell'ordine di IMU_log_msg.h */
+#define IMU_LOG_MSG(id, fmt)				id,
+enum IMU_log_id_e {
+	IMU_LOG_NONE = 0,
+#include "IMU_log_msg.h"
+	NUM_IMU_LOG
+};
+#undef IMU_LOG_MSG
+
+#if NUM_IMU_LOG > 0x3FFF
+#error "troppi messaggi per l'intestazione del registro"
+#endif
+
+/*******************************************************************************
+Definizione strutture
+*******************************************************************************/
+/* Parola di un argomento */
+typedef union
+{
+	uint32_t u;
+	float    f;
+
+} IMU_log_word_u;
+
+/* Registro in RAM, a piu' produttori (ciclo principale e interrupt) e un
+   consumatore. Il produttore riserva le parole spostando head con gli
+   interrupt mascherati per poche istruzioni, poi le scrive fuori dalla
+   sezione critica e per ultima l'intestazione: il consumatore si ferma alla
+   prima intestazione ancora a zero e libera le parole azzerandole prima di
+   spostare tail. Gli indici corrono liberi a 16 bit. A registro pieno il
+   messaggio e' scartato e contato. Parte azzerato (variabile globale): non
+   serve inizializzarlo, e funziona prima di ogni altra periferica */
+typedef struct
+{
+	volatile uint32_t buf[IMU_LOG_SIZE];
+	volatile uint16_t head;
+	volatile uint16_t tail;
+	volatile uint32_t drops;			/* messaggi scartati a registro pieno */
+	volatile uint32_t records;			/* messaggi registrati */
+
+} IMU_log_struct;
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+extern IMU_log_struct IMU_log;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+void IMU_log_put(uint32_t hdr, uint32_t a, uint32_t b, uint32_t c);
+uint16_t IMU_log_pop(uint32_t *out, uint16_t max);
+
+#endif /* _IMU_LOG_H_ */
@@ -0,0 +1,30 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Messaggi del registro (IMU_log): identificativo e formato printf. Il file
+* non ha protezione dall'inclusione multipla: chi lo include definisce prima
+* IMU_LOG_MSG. IMU_log.h ne ricava l'enumerazione degli identificativi, lo
+* strumento host (tools/imu_telemrec.c -g) la tabella dei formati; le stringhe
+* non finiscono nel firmware.
+*
+* Gli argomenti viaggiano come parole a 32 bit: %d %i %u %x %X %c per gli
+* interi, %f %g %e per i float passati con IMU_LOG_F; niente %s. L'host va
+* compilato dallo stesso albero del firmware: l'identificativo e' la
+* posizione nella lista, i messaggi nuovi vanno in coda
+*******************************************************************************/
+
+IMU_LOG_MSG(IMU_LOG_BOOT,				"avvio: %u sensori in linea su %u")
+IMU_LOG_MSG(IMU_LOG_SENSOR_FAULT,		"sensore 0x%02X escluso dopo %u errori di comunicazione (riic %d)")
+IMU_LOG_MSG(IMU_LOG_SENSOR_RECOVERED,	"sensore 0x%02X di nuovo in linea")
+IMU_LOG_MSG(IMU_LOG_SENSOR_STUCK,		"sensore 0x%02X bloccato: %u campioni identici")
+IMU_LOG_MSG(IMU_LOG_VOTE_DISAGREE,		"voting: nessun accordo tra %u sensori, scelto il piu' vicino (distanza %.2f)")
+IMU_LOG_MSG(IMU_LOG_PARAM_APPLIED,		"parametro %u sensore %u = 0x%08X")
+IMU_LOG_MSG(IMU_LOG_PARAM_FAILED,		"parametro %u sensore %u: applicazione fallita, valore ripristinato")
+IMU_LOG_MSG(IMU_LOG_BBOX_TRIGGER,		"scatola nera: evento %u")
+IMU_LOG_MSG(IMU_LOG_PARK,				"parcheggio: sensori 0x%X in wake-on-motion")
+IMU_LOG_MSG(IMU_LOG_WAKE,				"risveglio: sensori 0x%X di nuovo a 6 assi")
+IMU_LOG_MSG(IMU_LOG_RX_OVERRUN,			"comandi: byte perso a coda piena (%u in totale)")
+IMU_LOG_MSG(IMU_LOG_SWITCH,				"pulsante SW%u: evento %u (1 click, 2 lungo, 3 doppio)")
+IMU_LOG_MSG(IMU_LOG_RECALIBRATE,		"ricalibrazione da pulsante: sensori 0x%X in linea")
+IMU_LOG_MSG(IMU_LOG_MEM,				"memoria: nuovo massimo, stack utente %u, stack interrupt %u, heap %u byte")
+IMU_LOG_MSG(IMU_LOG_RECALIBRATE_START,	"ricalibrazione da pulsante: sensori 0x%X fuori dal voting a turno")
@@ -0,0 +1,330 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Magnetometro esterno collegato al bus ausiliario del sensore. Il master I2C
+* dell'MPU-6050 (slave 0) legge il magnetometro da solo e ne copia i dati in
+* EXT_SENS_DATA_00, subito dopo il giroscopio: la stessa lettura a raffica
+* (14 + 6 byte, o il campione della FIFO) da' i nove assi senza transazioni
+* in piu' dall'MCU. Lo slave 4 serve solo per identificazione e
+* configurazione all'avvio.
+* Il campo, corretto per ferro duro e dolce con lo stesso nucleo intero della
+* calibrazione, viene proiettato sul piano orizzontale con la gravita' misurata
+* e l'imbardata e' l'integrale del giroscopio attorno alla verticale, corretto
+* lentamente verso la bussola (filtro complementare)
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdbool.h>
+#include <string.h>
+#include "platform.h"
+#include "CMT.h"
+#include "IMU.h"
+#include "IMU_regmap.h"
+#include "IMU_calib.h"
+#include "IMU_math.h"
+#include "IMU_mag.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_MAG_INIT_REGS					3		/* scritture di configurazione all'avvio (massimo) */
+
+/*******************************************************************************
+Definizione strutture
+*******************************************************************************/
+/* Descrizione di un magnetometro supportato */
+typedef struct
+{
+	uint8_t  addr;								/* indirizzo a 7 bit */
+	uint8_t  id_reg;							/* registri di identificazione */
+	uint8_t  id[3];
+	uint8_t  id_len;
+	uint8_t  data_reg;							/* primo registro dei dati */
+	bool     little_endian;						/* invertito dal master (BYTE_SW) */
+	uint8_t  axis[3];							/* parola di EXT_SENS_DATA per x, y, z */
+	uint8_t  init[IMU_MAG_INIT_REGS][2];		/* registro, valore */
+	uint8_t  init_len;
+	uint16_t rate_hz;							/* frequenza dei dati in modo continuo */
+	float    lsb_per_gauss;
+	int16_t  overflow;							/* valore di saturazione (0: nessuno) */
+
+} IMU_mag_chip_struct;
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+/* Peso della bussola, modificabile a runtime (IMU_param) */
+float IMU_mag_yaw_gain = IMU_MAG_YAW_GAIN;
+
+/* Per IMU_mag_type_e, dal secondo elemento:
+   HMC5883L: 8 medie a 75 Hz, +-1.3 gauss, modo continuo (all'accensione e' in
+             misura singola), dati x, z, y big-endian;
+   QMC5883L: set/reset, 200 Hz, +-8 gauss, OSR 512, modo continuo, dati x, y, z little-endian */
+static const IMU_mag_chip_struct IMU_mag_chips[NUM_IMU_MAG - 1] = {
+	{0x1E, 0x0A, {'H', '4', '3'}, 3, 0x03, false, {0, 2, 1}, {{0x00, 0x78}, {0x01, 0x20}, {0x02, 0x00}}, 3,
+	 75, 1090.0f, -4096},
+	{0x0D, 0x0D, {0xFF}, 1, 0x00, true, {0, 1, 2}, {{0x0B, 0x01}, {0x09, 0x1D}}, 2,
+	 200, 3000.0f, 0}
+};
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static riic_ret_t IMU_mag_slv4 (IMU_dev_struct *dev, uint8_t addr, uint8_t reg, uint8_t value, uint8_t *in);
+
+/*******************************************************************************
+* Nome funzione     : IMU_mag_start
+* Descrizione  	    : Avvia (o spegne) il magnetometro indicato in
+* 					  config.mag. La prima volta abilita il master I2C,
+* 					  identifica e configura il magnetometro con lo slave 4 e
+* 					  programma la lettura automatica con lo slave 0; ad ogni
+* 					  chiamata adegua il ritardo del master, cosi' il
+* 					  magnetometro viene letto alla sua frequenza e non a
+* 					  quella del sensore. Va chiamata prima di avviare la FIFO.
+* 					  Un magnetometro assente non e' un errore del sensore:
+* 					  resta spento e viene contato in mag.errors
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della comunicazione con il sensore
+*******************************************************************************/
+riic_ret_t IMU_mag_start(IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	IMU_mag_struct *m = &dev->mag;
+	const IMU_mag_chip_struct *chip;
+	uint32_t errors = m->errors;
+	uint16_t odr_hz, dly;
+	uint8_t id[3], i;
+	riic_ret_t ret = RIIC_OK;
+
+	if ((IMU_MAG_NONE == dev->config.mag) || (dev->config.mag >= NUM_IMU_MAG))
+	{
+		if (!m->enabled) {
+			return RIIC_OK;
+		}
+		m->enabled = false;
+		IMU_reg_set(dev, INV_MPU6050_REG_I2C_SLV0_CTRL, 0);
+		IMU_reg_update_bits(dev, INV_MPU6050_REG_USER_CTRL, INV_MPU6050_BIT_I2C_MST_EN, 0);
+		return IMU_reg_flush(dev);
+	}
+	chip = &IMU_mag_chips[dev->config.mag - 1];
+
+	if (!m->enabled || (m->type != dev->config.mag))
+	{
+		memset(m, 0, sizeof(*m));
+		m->errors = errors;
+
+		/* Master a 400 kHz; il data ready attende la lettura dei dati esterni */
+		IMU_reg_update_bits(dev, INV_MPU6050_REG_INT_PIN_CFG, INV_MPU6050_BIT_I2C_BYPASS_EN, 0);
+		IMU_reg_set(dev, INV_MPU6050_REG_I2C_MST_CTRL, INV_MPU6050_BIT_WAIT_FOR_ES | INV_MPU6050_I2C_MST_CLK_400KHZ);
+		IMU_reg_set(dev, INV_MPU6050_REG_I2C_SLV0_CTRL, 0);
+		IMU_reg_update_bits(dev, INV_MPU6050_REG_USER_CTRL, INV_MPU6050_BIT_I2C_MST_EN, INV_MPU6050_BIT_I2C_MST_EN);
+		ret = IMU_reg_flush(dev);
+		if (RIIC_OK != ret) {
+			return ret;
+		}
+		ms_delay(INV_MPU6050_REG_UP_TIME);
+
+		/* Identificazione e configurazione */
+		for (i = 0; (i < chip->id_len) && (RIIC_OK == ret); i++) {
+			ret = IMU_mag_slv4(dev, chip->addr | INV_MPU6050_BIT_I2C_READ, chip->id_reg + i, 0, &id[i]);
+		}
+		if ((RIIC_OK == ret) && (0 != memcmp(id, chip->id, chip->id_len))) {
+			ret = RIIC_NO_DEVICE_FOUND;
+		}
+		for (i = 0; (i < chip->init_len) && (RIIC_OK == ret); i++) {
+			ret = IMU_mag_slv4(dev, chip->addr, chip->init[i][0], chip->init[i][1], 0);
+		}
+
+		if (RIIC_OK != ret)
+		{
+			m->errors++;
+			IMU_reg_update_bits(dev, INV_MPU6050_REG_USER_CTRL, INV_MPU6050_BIT_I2C_MST_EN, 0);
+			return IMU_reg_flush(dev);
+		}
+
+		/* Lettura automatica dei sei byte dei dati */
+		IMU_reg_set(dev, INV_MPU6050_REG_I2C_SLV0_ADDR, chip->addr | INV_MPU6050_BIT_I2C_READ);
+		IMU_reg_set(dev, INV_MPU6050_REG_I2C_SLV0_REG, chip->data_reg);
+		IMU_reg_set(dev, INV_MPU6050_REG_I2C_SLV0_CTRL, INV_MPU6050_BIT_SLV_EN | IMU_MAG_BYTES |
+					(chip->little_endian ? INV_MPU6050_BIT_SLV_BYTE_SW : 0));
+
+		m->enabled = true;
+		m->type = dev->config.mag;
+		m->scale = 1.0f / chip->lsb_per_gauss;
+	}
+
+	/* Il magnetometro viene letto un campione ogni dly + 1 */
+	odr_hz = dev->config.rate_hz * ((dev->config.decim > 1) ? dev->config.decim : 1);
+	dly = odr_hz / chip->rate_hz;
+	dly = (dly > 0) ? dly - 1 : 0;
+	if (dly > INV_MPU6050_BITS_I2C_MST_DLY) {
+		dly = INV_MPU6050_BITS_I2C_MST_DLY;
+	}
+	IMU_reg_update_bits(dev, INV_MPU6050_REG_I2C_SLV4_CTRL, INV_MPU6050_BITS_I2C_MST_DLY, (uint8_t)dly);
+	IMU_reg_update_bits(dev, INV_MPU6050_REG_I2C_MST_DELAY_CTRL, INV_MPU6050_BIT_SLV0_DLY_EN,
+						(dly > 0) ? INV_MPU6050_BIT_SLV0_DLY_EN : 0);
+
+	return IMU_reg_flush(dev);
+
+} /* Fine IMU_mag_start() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_mag_raw
+* Descrizione  	    : Ultimo campione grezzo del magnetometro negli assi x, y, z
+* 					  del magnetometro
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (int16_t) *r -
+* 					  	 campione (LSB)
+* Valori restituiti : (bool) -
+* 						 false se il magnetometro e' spento o saturato
+*******************************************************************************/
+bool IMU_mag_raw(const IMU_dev_struct *dev, int16_t *r)
+{
+	/* Definisce le variabili locali */
+	const IMU_mag_chip_struct *chip;
+	uint8_t k;
+
+	if (!dev->mag.enabled) {
+		return false;
+	}
+	chip = &IMU_mag_chips[dev->mag.type - 1];
+
+	for (k = 0; k < 3; k++)
+	{
+		r[k] = dev->raw.mag[chip->axis[k]];
+		if ((0 != chip->overflow) && (chip->overflow == r[k])) {
+			return false;
+		}
+	}
+
+	return true;
+
+} /* Fine IMU_mag_raw() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_mag_update
+* Descrizione  	    : Calibra l'ultimo campione, calcola la direzione del nord
+* 					  e aggiorna l'imbardata. Con D = -a/|a| (verso il basso)
+* 					  le direzioni est e nord negli assi del robot sono
+* 					  E = D x m e N = E x D, e l'imbardata dell'asse x e'
+* 					  atan2(E_x, N_x), positiva verso est. La velocita' di
+* 					  imbardata e' la componente di omega lungo D
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (float) *a -
+* 					  	 accelerazione calibrata e filtrata (g)
+* 					  (float) *omega -
+* 					  	 velocita' angolari (rad/s)
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_mag_update(IMU_dev_struct *dev, const float *a, const float *omega)
+{
+	/* Definisce le variabili locali */
+	IMU_mag_struct *m = &dev->mag;
+	const float *f = m->field;
+	int16_t r[3];
+	float d[3], ex, ey, ez, nx, inv, rate;
+
+	if (!m->enabled) {
+		return;
+	}
+
+	if (!IMU_mag_raw(dev, r))
+	{
+		m->saturated++;
+		return;
+	}
+	m->samples++;
+	IMU_calib_mag(dev, r, m->field);
+
+	inv = -IMU_rsqrtf(a[0] * a[0] + a[1] * a[1] + a[2] * a[2] + IMU_MATH_TINY);
+	d[0] = a[0] * inv;
+	d[1] = a[1] * inv;
+	d[2] = a[2] * inv;
+
+	ex = d[1] * f[2] - d[2] * f[1];
+	ey = d[2] * f[0] - d[0] * f[2];
+	ez = d[0] * f[1] - d[1] * f[0];
+	nx = ey * d[2] - ez * d[1];
+	m->heading = IMU_atan2f(ex, nx);
+
+	/* Filtro complementare: il giroscopio per le variazioni rapide, la bussola
+	 corregge la deriva (costante di tempo 1 / IMU_mag_yaw_gain campioni) */
+	rate = omega[0] * d[0] + omega[1] * d[1] + omega[2] * d[2];
+	if (!m->fused)
+	{
+		m->yaw = m->heading;
+		m->fused = true;
+	}
+	else
+	{
+		m->yaw += rate / dev->config.rate_hz;
+		m->yaw = IMU_wrap_pi(m->yaw + IMU_mag_yaw_gain * IMU_wrap_pi(m->heading - m->yaw));
+	}
+
+} /* Fine IMU_mag_update() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_mag_slv4
+* Descrizione  	    : Una lettura o scrittura di un registro del magnetometro
+* 					  con lo slave 4 del master I2C. I registri 0x31-0x34 sono
+* 					  contigui e partono con una sola scrittura; la fine si
+* 					  attende in I2C_MST_STATUS
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (uint8_t) addr -
+* 					  	 indirizzo a 7 bit, con INV_MPU6050_BIT_I2C_READ per leggere
+* 					  (uint8_t) reg -
+* 					  	 registro del magnetometro
+* 					  (uint8_t) value -
+* 					  	 valore da scrivere
+* 					  (uint8_t) *in -
+* 					  	 valore letto (0 in scrittura)
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato, RIIC_NACK_ERR se il magnetometro non risponde,
+* 						 RIIC_RDRF_TMO se la transazione non termina
+*******************************************************************************/
+static riic_ret_t IMU_mag_slv4(IMU_dev_struct *dev, uint8_t addr, uint8_t reg, uint8_t value, uint8_t *in)
+{
+	/* Definisce le variabili locali */
+	int32_t start;
+	uint8_t status;
+	riic_ret_t ret;
+
+	IMU_reg_set(dev, INV_MPU6050_REG_I2C_SLV4_ADDR, addr);
+	IMU_reg_set(dev, INV_MPU6050_REG_I2C_SLV4_REG, reg);
+	IMU_reg_set(dev, INV_MPU6050_REG_I2C_SLV4_DO, value);
+	IMU_reg_update_bits(dev, INV_MPU6050_REG_I2C_SLV4_CTRL, INV_MPU6050_BIT_SLV_EN, INV_MPU6050_BIT_SLV_EN);
+	ret = IMU_reg_flush(dev);
+	if (RIIC_OK != ret) {
+		return ret;
+	}
+
+	/* La transazione parte al campione successivo del sensore */
+	start = get_ms();
+	do
+	{
+		ret = IMU_read(dev, INV_MPU6050_REG_I2C_MST_STATUS, &status, 1);
+		if (RIIC_OK != ret) {
+			return ret;
+		}
+		if (status & INV_MPU6050_BIT_SLV4_NACK) {
+			return RIIC_NACK_ERR;
+		}
+		if (get_ms() - start > IMU_MAG_SLV4_TIMEOUT) {
+			return RIIC_RDRF_TMO;
+		}
+	} while (0 == (status & INV_MPU6050_BIT_SLV4_DONE));
+
+	if (0 != in) {
+		ret = IMU_read(dev, INV_MPU6050_REG_I2C_SLV4_DI, in, 1);
+	}
+
+	return ret;
+
+} /* Fine IMU_mag_slv4() */
@@ -0,0 +1,42 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _IMU_MAG_H_
+#define _IMU_MAG_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdbool.h>
+#include "main.h"
+#include "r_riic_rx600.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_MAG_BYTES						6		/* x, y, z a 16 bit in EXT_SENS_DATA */
+#define IMU_MAG_SLV4_TIMEOUT				20		/* attesa massima di una transazione sul bus ausiliario (ms) */
+#define IMU_MAG_YAW_GAIN					0.02f	/* peso della bussola per campione nella fusione dell'imbardata (iniziale) */
+
+/*******************************************************************************
+Definizione enumerazioni
+*******************************************************************************/
+enum IMU_mag_type_e {
+	IMU_MAG_NONE = 0,
+	IMU_MAG_HMC5883L,
+	IMU_MAG_QMC5883L,
+	NUM_IMU_MAG
+};
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+extern float IMU_mag_yaw_gain;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+riic_ret_t IMU_mag_start(IMU_dev_struct *dev);
+bool IMU_mag_raw(const IMU_dev_struct *dev, int16_t *r);
+void IMU_mag_update(IMU_dev_struct *dev, const float *a, const float *omega);
+
+#endif /* _IMU_MAG_H_ */
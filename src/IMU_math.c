@@ -0,0 +1,179 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Funzioni matematiche veloci per il calcolo dell'assetto. La FPU dell'RX63N
+* non ha la radice quadrata e le funzioni di <mathf.h> sono generiche: qui si
+* usano polinomi minimax di grado basso, senza chiamate di libreria, con un
+* errore massimo documentato in IMU_math.h e verificato da tools/imu_mathsweep.c
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdint.h>
+#include "IMU_math.h"
+#include "main.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+/* atan(t) ~= t * (A1 + A3*t^2 + A5*t^4 + A7*t^6 + A9*t^8) per 0 <= t <= 1
+   (minimax, Abramowitz-Stegun 4.4.47) */
+#define IMU_MATH_ATAN_A1					0.9998660f
+#define IMU_MATH_ATAN_A3					(-0.3302995f)
+#define IMU_MATH_ATAN_A5					0.1801410f
+#define IMU_MATH_ATAN_A7					(-0.0851330f)
+#define IMU_MATH_ATAN_A9					0.0208351f
+#define IMU_MATH_RSQRT_MAGIC				0x5F375A86u	/* stima iniziale di 1/sqrt(x) dai bit del float */
+
+/*******************************************************************************
+* Nome funzione     : IMU_atan2f
+* Descrizione  	    : Arcotangente a quattro quadranti. Riduce l'argomento a
+* 					  [0, 1] con il rapporto tra il minore e il maggiore dei
+* 					  moduli, valuta il polinomio e ricostruisce il quadrante.
+* 					  Con x = y = 0 restituisce 0 (nessuna divisione per zero)
+* Argomenti         : (float) y -
+* 						 ordinata
+* 					  (float) x -
+* 					  	 ascissa
+* Valori restituiti : (float) -
+* 						 angolo in [-pi, pi] (rad), errore <= IMU_MATH_ATAN2_MAX_ERR
+*******************************************************************************/
+float IMU_atan2f(float y, float x)
+{
+	/* Definisce le variabili locali */
+	float ax = (x < 0.0f) ? -x : x;
+	float ay = (y < 0.0f) ? -y : y;
+	float mx = (ax > ay) ? ax : ay;
+	float mn = (ax > ay) ? ay : ax;
+	float t, s, r;
+
+	/* Con x = y = 0 divide 0 per 1 */
+	mx = (mx > 0.0f) ? mx : 1.0f;
+	t = mn / mx;
+	s = t * t;
+	r = ((((IMU_MATH_ATAN_A9 * s + IMU_MATH_ATAN_A7) * s + IMU_MATH_ATAN_A5) * s
+		 + IMU_MATH_ATAN_A3) * s + IMU_MATH_ATAN_A1) * t;
+
+	/* Ricostruisce l'ottante e il quadrante */
+	r = (ay > ax) ? (IMU_MATH_PI_2 - r) : r;
+	r = (x < 0.0f) ? (IMU_MATH_PI - r) : r;
+
+	return (y < 0.0f) ? -r : r;
+
+} /* Fine IMU_atan2f() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_asinf
+* Descrizione  	    : Arcoseno come atan2(s, sqrt(1 - s^2)). L'argomento viene
+* 					  limitato a [-1, 1], quindi piccoli errori di norma non
+* 					  producono NaN
+* Argomenti         : (float) s -
+* 						 seno
+* Valori restituiti : (float) -
+* 						 angolo in [-pi/2, pi/2] (rad)
+*******************************************************************************/
+float IMU_asinf(float s)
+{
+	s = (s > 1.0f) ? 1.0f : s;
+	s = (s < -1.0f) ? -1.0f : s;
+
+	return IMU_atan2f(s, IMU_sqrtf(1.0f - s * s));
+
+} /* Fine IMU_asinf() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_rsqrtf
+* Descrizione  	    : 1/sqrt(x): stima iniziale ricavata dai bit dell'esponente
+* 					  e due iterazioni di Newton
+* Argomenti         : (float) x -
+* 						 argomento, positivo
+* Valori restituiti : (float) -
+* 						 1/sqrt(x), errore relativo <= IMU_MATH_RSQRT_MAX_REL_ERR
+*******************************************************************************/
+float IMU_rsqrtf(float x)
+{
+	/* Definisce le variabili locali */
+	union
+	{
+		float f;
+		uint32_t i;
+	} u;
+	float h = 0.5f * x;
+	float r;
+
+	u.f = x;
+	u.i = IMU_MATH_RSQRT_MAGIC - (u.i >> 1);
+	r = u.f;
+
+	r = r * (1.5f - h * r * r);
+	r = r * (1.5f - h * r * r);
+
+	return r;
+
+} /* Fine IMU_rsqrtf() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_sqrtf
+* Descrizione  	    : Radice quadrata come x * 1/sqrt(x). Vale 0 per x = 0
+* Argomenti         : (float) x -
+* 						 argomento, non negativo
+* Valori restituiti : (float) -
+* 						 sqrt(x)
+*******************************************************************************/
+float IMU_sqrtf(float x)
+{
+	return x * IMU_rsqrtf(x + IMU_MATH_TINY);
+
+} /* Fine IMU_sqrtf() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_wrap_pi
+* Descrizione  	    : Riporta un angolo in [-pi, pi]. Pensata per somme e
+* 					  differenze di angoli gia' ridotti, che escono al piu' di
+* 					  un giro: il ciclo non e' limitato per valori enormi
+* Argomenti         : (float) a -
+* 						 angolo (rad)
+* Valori restituiti : (float) -
+* 						 angolo equivalente in [-pi, pi]
+*******************************************************************************/
+float IMU_wrap_pi(float a)
+{
+	while (a > IMU_MATH_PI) {
+		a -= 2.0f * IMU_MATH_PI;
+	}
+	while (a < -IMU_MATH_PI) {
+		a += 2.0f * IMU_MATH_PI;
+	}
+
+	return a;
+
+} /* Fine IMU_wrap_pi() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_tilt
+* Descrizione  	    : Angoli di inclinazione dal vettore gravita', con le
+* 					  stesse definizioni usate finora (atan di una componente
+* 					  sulla norma delle altre due), scritte come atan2: il
+* 					  risultato non dipende dalla norma del vettore, che
+* 					  quindi non va normalizzato, e il denominatore nullo
+* 					  (scheda in piano per l'imbardata, vettore nullo durante
+* 					  una caduta libera) da' un angolo finito invece di NaN
+* Argomenti         : (float) *a -
+* 						 accelerazione x, y, z (unita' qualsiasi)
+* 					  (float) *angle -
+* 					  	 rollio, beccheggio, imbardata (rad)
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_tilt(const float *a, float *angle)
+{
+	/* Definisce le variabili locali */
+	float xx = a[0] * a[0];
+	float yy = a[1] * a[1];
+	float zz = a[2] * a[2];
+
+	angle[IMU_ROLL]  = IMU_atan2f(a[1],  IMU_sqrtf(xx + zz));
+	angle[IMU_PITCH] = IMU_atan2f(-a[0], IMU_sqrtf(yy + zz));
+	angle[IMU_YAW]   = IMU_atan2f(a[2],  IMU_sqrtf(xx + yy));
+
+} /* Fine IMU_tilt() */
@@ -0,0 +1,32 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _IMU_MATH_H_
+#define _IMU_MATH_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdint.h>
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_MATH_PI							3.14159265f
+#define IMU_MATH_PI_2						1.57079633f
+#define IMU_MATH_TINY						1e-30f	/* rende finita 1/sqrt(0) senza cambiare i valori normali */
+
+/* Errori massimi misurati con tools/imu_mathsweep.c */
+#define IMU_MATH_ATAN2_MAX_ERR				1.2e-5f	/* rad (0.0007 gradi), su tutto il piano */
+#define IMU_MATH_RSQRT_MAX_REL_ERR			5.0e-6f	/* errore relativo, da 1e-30 a 1e30 */
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+float IMU_atan2f(float y, float x);
+float IMU_asinf(float s);
+float IMU_rsqrtf(float x);
+float IMU_sqrtf(float x);
+float IMU_wrap_pi(float a);
+void IMU_tilt(const float *a, float *angle);
+
+#endif /* _IMU_MATH_H_ */
@@ -0,0 +1,320 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Memoria senza allocazione dinamica nel ciclo di controllo: i buffer grandi
+* che prima stavano sullo stack (frame della telemetria, blocchi letti dalla
+* FIFO, comandi ricevuti) vengono da pool di blocchi fissi, con allocazione e
+* rilascio a costo costante. Ogni pool conta i blocchi in uso, il loro
+* massimo e le richieste respinte.
+*
+* All'avvio (prima istruzione di main) gli stack SU e SI vengono riempiti con
+* IMU_MEM_PAINT; IMU_mem_check ne ricava il massimo usato e legge quanto
+* heap ha gia' concesso sbrk (usato solo dalla libreria C, es. sprintf). I
+* valori si vedono con il debugger (IMU_mem), nella pagina del display
+* IMU_mem_show e nel registro differito (IMU_LOG_MEM) a ogni nuovo massimo.
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <machine.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "platform.h"
+#include "IMU_decim.h"
+#include "IMU_telem.h"
+#include "IMU_log.h"
+#include "IMU_mem.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_MEM_PSW_I						0x00010000	/* bit I della PSW: interrupt abilitati */
+
+/* Frame della telemetria: uno alla volta dal ciclo principale, piu' una riserva */
+#define IMU_MEM_FRAME_SIZE					IMU_MEM_ROUND(IMU_TELEM_MAX_FRAME)
+#define IMU_MEM_FRAME_BLOCKS				2
+
+/* Blocchi di campioni letti dalla FIFO (IMU_decim_read) e parole del
+   registro da mettere in un frame (IMU_telem_send_log) */
+#if IMU_DECIM_BURST_BYTES > (4 * IMU_TELEM_LOG_WORDS)
+#define IMU_MEM_BATCH_SIZE					IMU_MEM_ROUND(IMU_DECIM_BURST_BYTES)
+#else
+#define IMU_MEM_BATCH_SIZE					(4 * IMU_TELEM_LOG_WORDS)
+#endif
+#define IMU_MEM_BATCH_BLOCKS				2
+
+/* Comandi: quello codificato in IMU_telem_receive e il contenuto in IMU_param_poll */
+#if IMU_TELEM_CMD_ENCODED > IMU_TELEM_CMD_MAX
+#define IMU_MEM_CMD_SIZE					IMU_MEM_ROUND(IMU_TELEM_CMD_ENCODED)
+#else
+#define IMU_MEM_CMD_SIZE					IMU_MEM_ROUND(IMU_TELEM_CMD_MAX)
+#endif
+#define IMU_MEM_CMD_BLOCKS					2
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+IMU_mem_struct IMU_mem;
+
+static uint32_t IMU_mem_frame_area[IMU_MEM_FRAME_BLOCKS * IMU_MEM_FRAME_SIZE / 4];
+static uint32_t IMU_mem_batch_area[IMU_MEM_BATCH_BLOCKS * IMU_MEM_BATCH_SIZE / 4];
+static uint32_t IMU_mem_cmd_area[IMU_MEM_CMD_BLOCKS * IMU_MEM_CMD_SIZE / 4];
+
+IMU_pool_struct IMU_mem_frames = IMU_POOL_INIT(IMU_mem_frame_area, IMU_MEM_FRAME_SIZE, IMU_MEM_FRAME_BLOCKS);
+IMU_pool_struct IMU_mem_batches = IMU_POOL_INIT(IMU_mem_batch_area, IMU_MEM_BATCH_SIZE, IMU_MEM_BATCH_BLOCKS);
+IMU_pool_struct IMU_mem_cmds = IMU_POOL_INIT(IMU_mem_cmd_area, IMU_MEM_CMD_SIZE, IMU_MEM_CMD_BLOCKS);
+
+/*******************************************************************************
+Prototipi funzioni locali
+*******************************************************************************/
+static uint32_t IMU_mem_stack_used(const uint32_t *top, const uint32_t *end);
+static void IMU_mem_show_usage(uint8_t line, const char *name, const IMU_mem_usage_struct *usage);
+static void IMU_mem_show_pool(uint8_t line, const char *name, const IMU_pool_struct *pool);
+
+/*******************************************************************************
+* Nome funzione     : IMU_mem_paint
+* Descrizione  	    : Riempie gli stack con IMU_MEM_PAINT. Va chiamata come
+* 					  prima istruzione di main: dello stack utente riempie
+* 					  solo la parte sotto quella in uso (con un margine per
+* 					  questa funzione), lo stack degli interrupt tutto, con
+* 					  gli interrupt mascherati
+* Argomenti         : No
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_mem_paint(void)
+{
+	/* Definisce le variabili locali */
+	uint32_t here;
+	uint32_t *top = (uint32_t *)__sectop("SU");
+	uint32_t *end = (uint32_t *)__secend("SU");
+	uint32_t *limit = (uint32_t *)((uint8_t *)&here - IMU_MEM_PAINT_MARGIN);
+	uint32_t *p;
+	uint32_t psw;
+
+	IMU_mem.su.size = (uint32_t)((uint8_t *)end - (uint8_t *)top);
+	IMU_mem.si.size = (uint32_t)((uint8_t *)__secend("SI") - (uint8_t *)__sectop("SI"));
+	IMU_mem.heap.size = HEAPSIZE;
+
+	/* Solo se si sta davvero usando SU (sull'host le sezioni non esistono) */
+	if (((uint32_t *)&here < top) || ((uint32_t *)&here >= end)) {
+		return;
+	}
+	for (p = top; p < limit; p++) {
+		*p = IMU_MEM_PAINT;
+	}
+
+	psw = get_psw();
+	clrpsw_i();
+	for (p = (uint32_t *)__sectop("SI"); p < (uint32_t *)__secend("SI"); p++) {
+		*p = IMU_MEM_PAINT;
+	}
+	if (psw & IMU_MEM_PSW_I) {
+		setpsw_i();
+	}
+
+	IMU_mem.painted = true;
+
+} /* Fine IMU_mem_paint() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_mem_check
+* Descrizione  	    : Aggiorna i massimi di stack e heap; a ogni nuovo
+* 					  massimo registra IMU_LOG_MEM. Costa una lettura della
+* 					  parte ancora libera degli stack: va chiamata di rado
+* 					  (frequenza del display)
+* Argomenti         : No
+* Valori restituiti : (bool) -
+* 						 true se almeno un massimo e' cresciuto
+*******************************************************************************/
+bool IMU_mem_check(void)
+{
+	/* Definisce le variabili locali */
+	IMU_mem_struct *m = &IMU_mem;
+	uint32_t su, si, heap;
+	bool grown;
+
+	su = m->su.peak;
+	si = m->si.peak;
+	if (m->painted)
+	{
+		su = IMU_mem_stack_used((const uint32_t *)__sectop("SU"), (const uint32_t *)__secend("SU"));
+		si = IMU_mem_stack_used((const uint32_t *)__sectop("SI"), (const uint32_t *)__secend("SI"));
+	}
+	heap = (uint32_t)sbrk_used();
+
+	grown = (su > m->su.peak) || (si > m->si.peak) || (heap > m->heap.peak);
+	if (grown)
+	{
+		m->su.peak = su;
+		m->si.peak = si;
+		m->heap.peak = heap;
+		IMU_LOG3(IMU_LOG_MEM, su, si, heap);
+	}
+
+	return grown;
+
+} /* Fine IMU_mem_check() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_mem_show
+* Descrizione  	    : Pagina della memoria del display: massimi usati di
+* 					  stack e heap, poi blocchi dei pool (in uso/massimo e
+* 					  richieste respinte)
+* Argomenti         : No
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_mem_show(void)
+{
+	IMU_mem_show_usage(LCD_LINE1, "SU", &IMU_mem.su);
+	IMU_mem_show_usage(LCD_LINE2, "SI", &IMU_mem.si);
+	IMU_mem_show_usage(LCD_LINE3, "hp", &IMU_mem.heap);
+
+	IMU_mem_show_pool(LCD_LINE4, "frm", &IMU_mem_frames);
+	IMU_mem_show_pool(LCD_LINE5, "bat", &IMU_mem_batches);
+	IMU_mem_show_pool(LCD_LINE6, "cmd", &IMU_mem_cmds);
+
+} /* Fine IMU_mem_show() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_pool_alloc
+* Descrizione  	    : Prende un blocco dal pool: il primo liberato o, se non
+* 					  ce ne sono, il primo mai usato. Chiamabile da interrupt
+* Argomenti         : (IMU_pool_struct) *pool -
+* 						 pool
+* Valori restituiti : (void) * -
+* 						 blocco (pool->size byte, allineato a 4), 0 se il
+* 						 pool e' vuoto
+*******************************************************************************/
+void *IMU_pool_alloc(IMU_pool_struct *pool)
+{
+	/* Definisce le variabili locali */
+	void *block;
+	uint32_t psw;
+
+	psw = get_psw();
+	clrpsw_i();
+	block = pool->free;
+	if (0 != block) {
+		pool->free = *(void **)block;
+	}
+	else if (pool->next < pool->end)
+	{
+		block = pool->next;
+		pool->next += pool->size;
+	}
+
+	if (0 != block)
+	{
+		if (++pool->used > pool->peak) {
+			pool->peak = pool->used;
+		}
+	}
+	else {
+		pool->fails++;
+	}
+	if (psw & IMU_MEM_PSW_I) {
+		setpsw_i();
+	}
+
+	return block;
+
+} /* Fine IMU_pool_alloc() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_pool_free
+* Descrizione  	    : Restituisce un blocco al pool da cui e' stato preso.
+* 					  Chiamabile da interrupt
+* Argomenti         : (IMU_pool_struct) *pool -
+* 						 pool
+* 					  (void) *block -
+* 					  	 blocco (0: nessuna operazione)
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_pool_free(IMU_pool_struct *pool, void *block)
+{
+	/* Definisce le variabili locali */
+	uint32_t psw;
+
+	if (0 == block) {
+		return;
+	}
+
+	psw = get_psw();
+	clrpsw_i();
+	*(void **)block = pool->free;
+	pool->free = block;
+	pool->used--;
+	if (psw & IMU_MEM_PSW_I) {
+		setpsw_i();
+	}
+
+} /* Fine IMU_pool_free() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_mem_stack_used
+* Descrizione  	    : Parte usata di uno stack riempito: gli stack crescono
+* 					  verso il basso, quindi si cerca dal fondo la prima
+* 					  parola modificata
+* Argomenti         : (uint32_t) *top, *end -
+* 						 inizio e fine della sezione
+* Valori restituiti : (uint32_t) -
+* 						 byte usati al massimo
+*******************************************************************************/
+static uint32_t IMU_mem_stack_used(const uint32_t *top, const uint32_t *end)
+{
+	while ((top < end) && (IMU_MEM_PAINT == *top)) {
+		top++;
+	}
+
+	return (uint32_t)((const uint8_t *)end - (const uint8_t *)top);
+
+} /* Fine IMU_mem_stack_used() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_mem_show_usage
+* Descrizione  	    : Riga del display di uno stack o dello heap (byte
+* 					  limitati alle quattro cifre che stanno nella riga)
+* Argomenti         : (uint8_t) line -
+* 						 riga del display
+* 					  (char) *name -
+* 					  	 nome breve (2 caratteri)
+* 					  (IMU_mem_usage_struct) *usage -
+* 					  	 occupazione
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_mem_show_usage(uint8_t line, const char *name, const IMU_mem_usage_struct *usage)
+{
+	/* Definisce le variabili locali */
+	uint8_t lcd_buffer[13];
+
+	sprintf((char *)lcd_buffer, "%.2s %4u/%-4u", name, (unsigned)(usage->peak > 9999 ? 9999 : usage->peak),
+			(unsigned)(usage->size > 9999 ? 9999 : usage->size));
+	lcd_display(line, lcd_buffer);
+
+} /* Fine IMU_mem_show_usage() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_mem_show_pool
+* Descrizione  	    : Riga del display di un pool (contatori limitati alle
+* 					  cifre che stanno nella riga)
+* Argomenti         : (uint8_t) line -
+* 						 riga del display
+* 					  (char) *name -
+* 					  	 nome breve (3 caratteri)
+* 					  (IMU_pool_struct) *pool -
+* 					  	 pool
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_mem_show_pool(uint8_t line, const char *name, const IMU_pool_struct *pool)
+{
+	/* Definisce le variabili locali */
+	uint8_t lcd_buffer[13];
+	uint32_t n = pool->fails;
+
+	sprintf((char *)lcd_buffer, "%s %u/%u x%-3lu", name, (unsigned)(pool->peak > 9 ? 9 : pool->peak),
+			(unsigned)(pool->count > 9 ? 9 : pool->count), (unsigned long)(n > 999 ? 999 : n));
+	lcd_display(line, lcd_buffer);
+
+} /* Fine IMU_mem_show_pool() */
@@ -0,0 +1,83 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _IMU_MEM_H_
+#define _IMU_MEM_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_MEM_PAINT						0xA5A5A5A5UL	/* parola di riempimento degli stack */
+#define IMU_MEM_PAINT_MARGIN				64		/* byte lasciati sotto lo stack in uso durante il riempimento */
+
+/* Blocco di un pool: dimensione arrotondata alla parola, cosi' ogni blocco
+   e' allineato a 4 byte e puo' contenere il puntatore della lista libera */
+#define IMU_MEM_ROUND(n)					(((n) + 3) & ~3)
+
+/* Pool inizializzato staticamente: la memoria e' un vettore di uint32_t */
+#define IMU_POOL_INIT(area, size, count)	{0, (uint8_t *)(area), (uint8_t *)(area) + (size) * (count), (size), (count), 0, 0, 0}
+
+/*******************************************************************************
+Definizione strutture
+*******************************************************************************/
+/* Pool di blocchi di dimensione fissa. I blocchi liberati formano una lista
+   (il puntatore al successivo sta nel blocco stesso); quelli mai usati
+   vengono presi in ordine da next, quindi non serve inizializzare la lista.
+   Allocazione e rilascio costano poche istruzioni con gli interrupt
+   mascherati e si possono chiamare dagli interrupt */
+typedef struct
+{
+	void     *free;					/* primo blocco liberato */
+	uint8_t  *next;					/* primo blocco mai usato */
+	uint8_t  *end;					/* fine della memoria del pool */
+	uint16_t  size;					/* byte per blocco (multiplo di 4) */
+	uint16_t  count;				/* blocchi del pool */
+	uint16_t  used;					/* blocchi in uso */
+	uint16_t  peak;					/* massimo di blocchi in uso */
+	uint32_t  fails;				/* richieste respinte a pool vuoto */
+
+} IMU_pool_struct;
+
+/* Occupazione di un'area: dimensione e massimo usato (byte) */
+typedef struct
+{
+	uint32_t size;
+	uint32_t peak;
+
+} IMU_mem_usage_struct;
+
+/* Stack (riempiti all'avvio con IMU_MEM_PAINT) e heap di sbrk. Il massimo
+   di uno stack e' la parte sopra la prima parola ancora intatta, quello
+   dello heap la parte gia' concessa da sbrk, che non la riprende mai */
+typedef struct
+{
+	IMU_mem_usage_struct su;		/* stack utente (ciclo principale) */
+	IMU_mem_usage_struct si;		/* stack degli interrupt */
+	IMU_mem_usage_struct heap;
+	bool painted;
+
+} IMU_mem_struct;
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+extern IMU_mem_struct IMU_mem;
+extern IMU_pool_struct IMU_mem_frames;		/* frame della telemetria */
+extern IMU_pool_struct IMU_mem_batches;		/* blocchi di campioni letti dalla FIFO, parole del registro */
+extern IMU_pool_struct IMU_mem_cmds;		/* comandi ricevuti */
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+void IMU_mem_paint(void);
+bool IMU_mem_check(void);
+void IMU_mem_show(void);
+void *IMU_pool_alloc(IMU_pool_struct *pool);
+void IMU_pool_free(IMU_pool_struct *pool, void *block);
+
+#endif /* _IMU_MEM_H_ */
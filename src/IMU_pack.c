@@ -0,0 +1,277 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Compressione senza perdite di flussi di campioni a 16 bit (telemetria,
+* registrazioni): ogni canale viene trasmesso come differenza dal campione
+* precedente dello stesso flusso, in zig-zag e varint (7 bit per byte, il bit
+* alto indica che segue un altro byte). Il rumore dei sensori a riposo sta in
+* un byte per canale invece di due.
+*
+* Ogni campione inizia con un varint di intestazione:
+*   ((dt << stream_bits | flusso) << 1) | keyframe
+* con dt i ms dal campione precedente (di qualsiasi flusso). Un keyframe porta
+* l'istante assoluto e i valori interi dei canali: il decodificatore che ha
+* perso dati (IMU_pack_resync) riparte dal primo keyframe di ogni flusso.
+* Un flusso emette un keyframe ogni key_interval campioni.
+*
+* Il costo e' limitato: un passo per canale e al massimo tre byte per
+* differenza, IMU_PACK_MAX_ENTRY byte per campione.
+*
+* Il codec lavora su qualsiasi flusso di int16: la telemetria lo usa per i
+* campioni grezzi (IMU_telem_send_samples), e un campione della scatola nera
+* (14 canali dopo l'istante) rientra in IMU_PACK_MAX_CHANNELS.
+* tools/imu_packbench misura il rapporto di compressione su entrambi
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "IMU_pack.h"
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static uint8_t *IMU_pack_put (uint8_t *q, uint32_t v);
+static uint16_t IMU_pack_get (const uint8_t *in, uint16_t n, uint32_t *v);
+
+/*******************************************************************************
+* Nome funzione     : IMU_pack_init
+* Descrizione  	    : Prepara codificatore o decodificatore
+* Argomenti         : (IMU_pack_struct) *p -
+* 						 stato
+* 					  (uint8_t) channels -
+* 					  	 canali per campione (al massimo IMU_PACK_MAX_CHANNELS)
+* 					  (uint8_t) streams -
+* 					  	 flussi interlacciati (al massimo IMU_PACK_MAX_STREAMS)
+* 					  (uint16_t) key_interval -
+* 					  	 campioni di un flusso tra due keyframe (1: solo keyframe)
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_pack_init(IMU_pack_struct *p, uint8_t channels, uint8_t streams, uint16_t key_interval)
+{
+	memset(p, 0, sizeof(*p));
+
+	p->channels = (channels > IMU_PACK_MAX_CHANNELS) ? IMU_PACK_MAX_CHANNELS : channels;
+	p->streams = (streams > IMU_PACK_MAX_STREAMS) ? IMU_PACK_MAX_STREAMS : streams;
+	p->key_interval = (0 == key_interval) ? 1 : key_interval;
+
+	while ((1 << p->stream_bits) < p->streams) {
+		p->stream_bits++;
+	}
+
+} /* Fine IMU_pack_init() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_pack_resync
+* Descrizione  	    : Dimentica i riferimenti dopo una perdita di dati: il
+* 					  decodificatore attende un keyframe per ogni flusso (il
+* 					  codificatore, chiamata sul suo stato, ne emette uno)
+* Argomenti         : (IMU_pack_struct) *p -
+* 						 stato
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_pack_resync(IMU_pack_struct *p)
+{
+	p->started = false;
+	memset(p->valid, 0, sizeof(p->valid));
+
+} /* Fine IMU_pack_resync() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_pack_encode
+* Descrizione  	    : Codifica un campione
+* Argomenti         : (IMU_pack_struct) *p -
+* 						 stato del codificatore
+* 					  (uint8_t) stream -
+* 					  	 flusso
+* 					  (uint32_t) timestamp -
+* 					  	 istante (ms, non decrescente)
+* 					  (int16_t) *v -
+* 					  	 canali
+* 					  (uint8_t) *out -
+* 					  	 destinazione, almeno IMU_PACK_MAX_ENTRY(channels) byte
+* Valori restituiti : (uint16_t) -
+* 						 byte scritti (0 se il flusso non esiste)
+*******************************************************************************/
+uint16_t IMU_pack_encode(IMU_pack_struct *p, uint8_t stream, uint32_t timestamp, const int16_t *v, uint8_t *out)
+{
+	/* Definisce le variabili locali */
+	int16_t *prev;
+	uint32_t dt = timestamp - p->timestamp;
+	uint8_t *q = out;
+	int16_t d;
+	uint8_t k;
+	bool key;
+
+	if (stream >= p->streams) {
+		return 0;
+	}
+	prev = p->prev[stream];
+
+	/* Keyframe anche quando dt non sta nell'intestazione a 32 bit */
+	key = !p->started || !p->valid[stream] || (p->since_key[stream] + 1 >= p->key_interval) ||
+		  (dt >> (31 - p->stream_bits));
+
+	if (key)
+	{
+		q = IMU_pack_put(q, ((uint32_t)stream << 1) | 1);
+		q = IMU_pack_put(q, timestamp);
+		for (k = 0; k < p->channels; k++) {
+			q = IMU_pack_put(q, (uint16_t)((v[k] << 1) ^ (v[k] >> 15)));
+		}
+		p->since_key[stream] = 0;
+	}
+	else
+	{
+		q = IMU_pack_put(q, ((dt << p->stream_bits) | stream) << 1);
+		for (k = 0; k < p->channels; k++)
+		{
+			/* Differenza modulo 2^16: esatta anche tra valori agli estremi */
+			d = (int16_t)(uint16_t)(v[k] - prev[k]);
+			q = IMU_pack_put(q, (uint16_t)((d << 1) ^ (d >> 15)));
+		}
+		p->since_key[stream]++;
+	}
+
+	memcpy(prev, v, p->channels * sizeof(int16_t));
+	p->timestamp = timestamp;
+	p->started = true;
+	p->valid[stream] = true;
+
+	return (uint16_t)(q - out);
+
+} /* Fine IMU_pack_encode() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_pack_decode
+* Descrizione  	    : Decodifica un campione. Un campione differenziale senza
+* 					  riferimento (dopo IMU_pack_resync) viene consumato ma
+* 					  restituito non valido
+* Argomenti         : (IMU_pack_struct) *p -
+* 						 stato del decodificatore
+* 					  (uint8_t) *in -
+* 					  	 dati codificati
+* 					  (uint16_t) n -
+* 					  	 byte disponibili
+* 					  (IMU_pack_sample_struct) *s -
+* 					  	 campione decodificato
+* Valori restituiti : (uint16_t) -
+* 						 byte consumati (0 se i dati sono troncati o errati)
+*******************************************************************************/
+uint16_t IMU_pack_decode(IMU_pack_struct *p, const uint8_t *in, uint16_t n, IMU_pack_sample_struct *s)
+{
+	/* Definisce le variabili locali */
+	uint16_t used = 0, len;
+	uint32_t u, z;
+	uint8_t k;
+
+	len = IMU_pack_get(in, n, &u);
+	if (0 == len) {
+		return 0;
+	}
+	used += len;
+
+	s->key = (u & 1);
+	s->stream = (uint8_t)((u >> 1) & ((1 << p->stream_bits) - 1));
+	if (s->stream >= p->streams) {
+		return 0;
+	}
+
+	if (s->key)
+	{
+		len = IMU_pack_get(in + used, n - used, &s->timestamp);
+		if (0 == len) {
+			return 0;
+		}
+		used += len;
+	}
+	else {
+		s->timestamp = p->timestamp + (u >> (1 + p->stream_bits));
+	}
+
+	for (k = 0; k < p->channels; k++)
+	{
+		len = IMU_pack_get(in + used, n - used, &z);
+		if ((0 == len) || (z > 0xFFFF)) {
+			return 0;
+		}
+		used += len;
+		s->v[k] = (int16_t)((z >> 1) ^ (0 - (z & 1)));
+		if (!s->key) {
+			s->v[k] = (int16_t)(uint16_t)(p->prev[s->stream][k] + s->v[k]);
+		}
+	}
+
+	/* Anche un campione senza riferimento sposta l'istante, comune ai flussi */
+	if (s->key || p->started)
+	{
+		p->timestamp = s->timestamp;
+		p->started = true;
+	}
+
+	s->valid = s->key || (p->started && p->valid[s->stream]);
+	if (s->valid)
+	{
+		memcpy(p->prev[s->stream], s->v, p->channels * sizeof(int16_t));
+		p->valid[s->stream] = true;
+	}
+
+	return used;
+
+} /* Fine IMU_pack_decode() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_pack_put
+* Descrizione  	    : Scrive un varint (al massimo 5 byte)
+* Argomenti         : (uint8_t) *q -
+* 						 destinazione
+* 					  (uint32_t) v -
+* 					  	 valore
+* Valori restituiti : (uint8_t) * -
+* 						 posizione successiva
+*******************************************************************************/
+static uint8_t *IMU_pack_put(uint8_t *q, uint32_t v)
+{
+	while (v >= 0x80)
+	{
+		*q++ = (uint8_t)(v | 0x80);
+		v >>= 7;
+	}
+	*q++ = (uint8_t)v;
+
+	return q;
+
+} /* Fine IMU_pack_put() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_pack_get
+* Descrizione  	    : Legge un varint
+* Argomenti         : (uint8_t) *in -
+* 						 dati
+* 					  (uint16_t) n -
+* 					  	 byte disponibili
+* 					  (uint32_t) *v -
+* 					  	 valore letto
+* Valori restituiti : (uint16_t) -
+* 						 byte letti (0 se troncato o piu' lungo di 5 byte)
+*******************************************************************************/
+static uint16_t IMU_pack_get(const uint8_t *in, uint16_t n, uint32_t *v)
+{
+	/* Definisce le variabili locali */
+	uint16_t i;
+
+	*v = 0;
+	for (i = 0; (i < n) && (i < 5); i++)
+	{
+		*v |= (uint32_t)(in[i] & 0x7F) << (7 * i);
+		if (0 == (in[i] & 0x80)) {
+			return i + 1;
+		}
+	}
+
+	return 0;
+
+} /* Fine IMU_pack_get() */
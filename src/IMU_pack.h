@@ -0,0 +1,61 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _IMU_PACK_H_
+#define _IMU_PACK_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_PACK_MAX_CHANNELS				16		/* canali a 16 bit per campione (un campione della scatola nera ne ha 14) */
+#define IMU_PACK_MAX_STREAMS				4		/* flussi interlacciati (un flusso per sensore) */
+#define IMU_PACK_KEY_INTERVAL				64		/* campioni di un flusso tra due keyframe */
+
+/* Byte massimi di un campione: intestazione e istante (5 + 5), tre per canale */
+#define IMU_PACK_MAX_ENTRY(channels)		(10 + 3 * (channels))
+
+/*******************************************************************************
+Definizione strutture
+*******************************************************************************/
+/* Stato del codificatore o del decodificatore (uno per lato). Ogni flusso
+   ricorda l'ultimo campione, da cui si calcolano le differenze; l'istante e'
+   comune a tutti i flussi */
+typedef struct
+{
+	uint8_t  channels;
+	uint8_t  streams;
+	uint8_t  stream_bits;						/* bit del flusso nell'intestazione */
+	uint16_t key_interval;
+	bool     started;							/* istante di riferimento valido */
+	uint32_t timestamp;
+	bool     valid[IMU_PACK_MAX_STREAMS];		/* campione di riferimento valido */
+	uint16_t since_key[IMU_PACK_MAX_STREAMS];
+	int16_t  prev[IMU_PACK_MAX_STREAMS][IMU_PACK_MAX_CHANNELS];
+
+} IMU_pack_struct;
+
+/* Campione decodificato */
+typedef struct
+{
+	uint32_t timestamp;
+	uint8_t  stream;
+	bool     key;
+	bool     valid;								/* false in attesa di un keyframe del flusso */
+	int16_t  v[IMU_PACK_MAX_CHANNELS];
+
+} IMU_pack_sample_struct;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+void IMU_pack_init(IMU_pack_struct *p, uint8_t channels, uint8_t streams, uint16_t key_interval);
+void IMU_pack_resync(IMU_pack_struct *p);
+uint16_t IMU_pack_encode(IMU_pack_struct *p, uint8_t stream, uint32_t timestamp, const int16_t *v, uint8_t *out);
+uint16_t IMU_pack_decode(IMU_pack_struct *p, const uint8_t *in, uint16_t n, IMU_pack_sample_struct *s);
+
+#endif /* _IMU_PACK_H_ */
@@ -0,0 +1,729 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Parametri modificabili a runtime dall'host, senza ricompilare: fondo scala,
+* filtro del sensore, frequenza, decimazione, filtro software, modello di
+* calibrazione (bias, scala e disallineamento) e guadagni della fusione.
+*
+* I comandi arrivano sulla stessa seriale della telemetria (IMU_telem_receive)
+* e hanno IMU_PARAM_CMD_LEN byte (little-endian):
+*   0  operazione (IMU_param_op_e)     1  etichetta, ripetuta nella risposta
+*   2  parametro (IMU_param_id_e)      3  sensore (IMU_PARAM_ALL_SENSORS: tutti)
+*   4  valore (solo IMU_PARAM_SET): int32 o bit di un float
+* Ogni comando riceve una risposta IMU_TELEM_PARAM con l'esito e il valore in
+* vigore; IMU_PARAM_GET di IMU_PARAM_ALL risponde con tutti i parametri.
+* Una modifica riceve la risposta solo dopo essere stata applicata.
+* Anche il firmware puo' inviare comandi (IMU_param_command, etichetta 0):
+* il potenziometro regola cosi' un parametro con SW2 premuto (main.c)
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "CMT.h"
+#include "IMU.h"
+#include "IMU_bias.h"
+#include "IMU_calib.h"
+#include "IMU_filter.h"
+#include "IMU_decim.h"
+#include "IMU_mag.h"
+#include "IMU_telem.h"
+#include "IMU_param.h"
+#include "IMU_log.h"
+#include "IMU_mem.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_PARAM_DEV(field)				offsetof(IMU_dev_struct, field), 0
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static bool IMU_param_apply_config (IMU_dev_struct *dev, uint8_t id);
+static bool IMU_param_apply_bias (IMU_dev_struct *dev, uint8_t id);
+static bool IMU_param_apply_model (IMU_dev_struct *dev, uint8_t id);
+static bool IMU_param_apply_filter (IMU_dev_struct *dev, uint8_t id);
+static bool IMU_param_apply_notch (IMU_dev_struct *dev, uint8_t id);
+static bool IMU_param_filter_ok (const IMU_filter_config_struct *cfg, uint32_t fs);
+static void IMU_param_apply (void);
+static void IMU_param_send (void);
+static void IMU_param_reply (uint8_t tag, uint8_t status, uint8_t id, uint8_t sensor);
+static void IMU_param_set (const IMU_param_def_struct *def, IMU_dev_struct *dev, IMU_param_value_u v);
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+const IMU_param_def_struct IMU_param_table[NUM_IMU_PARAM - 1] = {
+	{IMU_PARAM_ACCEL_FS,       IMU_PARAM_U8,   IMU_PARAM_PER_SENSOR, "accel_fs",       0.0f, 3.0f,
+	 IMU_PARAM_DEV(config.accel_fs),        IMU_param_apply_config},
+	{IMU_PARAM_GYRO_FS,        IMU_PARAM_U8,   IMU_PARAM_PER_SENSOR, "gyro_fs",        0.0f, 3.0f,
+	 IMU_PARAM_DEV(config.gyro_fs),         IMU_param_apply_config},
+	{IMU_PARAM_DLPF,           IMU_PARAM_U8,   IMU_PARAM_PER_SENSOR, "dlpf",           0.0f, 7.0f,
+	 IMU_PARAM_DEV(config.dlpf),            IMU_param_apply_config},
+	{IMU_PARAM_RATE_HZ,        IMU_PARAM_U16,  IMU_PARAM_PER_SENSOR, "rate_hz",        4.0f, 1000.0f,
+	 IMU_PARAM_DEV(config.rate_hz),         IMU_param_apply_config},
+	{IMU_PARAM_DECIM,          IMU_PARAM_U8,   IMU_PARAM_PER_SENSOR, "decim",          0.0f, IMU_DECIM_MAX_FACTOR,
+	 IMU_PARAM_DEV(config.decim),           IMU_param_apply_config},
+	{IMU_PARAM_BIAS_ZMOT,      IMU_PARAM_BOOL, IMU_PARAM_PER_SENSOR, "bias_zmot",      0.0f, 1.0f,
+	 IMU_PARAM_DEV(config.bias_zmot),       IMU_param_apply_bias},
+	{IMU_PARAM_LOWPASS_HZ,     IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "lowpass_hz",     0.0f, 500.0f,
+	 IMU_PARAM_DEV(config.filter.lowpass_hz),     IMU_param_apply_filter},
+	{IMU_PARAM_LOWPASS_STAGES, IMU_PARAM_U8,   IMU_PARAM_PER_SENSOR, "lowpass_stages", 0.0f, IMU_FILTER_MAX_LOWPASS,
+	 IMU_PARAM_DEV(config.filter.lowpass_stages), IMU_param_apply_filter},
+	{IMU_PARAM_NOTCH_Q,        IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "notch_q",        0.0f, 50.0f,
+	 IMU_PARAM_DEV(config.filter.notch_q),        IMU_param_apply_filter},
+	{IMU_PARAM_NOTCH0_HZ,      IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "notch0_hz",      0.0f, 500.0f,
+	 IMU_PARAM_DEV(config.filter.notch_hz[0]),    IMU_param_apply_notch},
+	{IMU_PARAM_NOTCH1_HZ,      IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "notch1_hz",      0.0f, 500.0f,
+	 IMU_PARAM_DEV(config.filter.notch_hz[1]),    IMU_param_apply_notch},
+	{IMU_PARAM_ACCEL_BIAS_X,   IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "accel_bias_x",   -32768.0f, 32767.0f,
+	 IMU_PARAM_DEV(calib.accel.b[0]),       0},
+	{IMU_PARAM_ACCEL_BIAS_Y,   IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "accel_bias_y",   -32768.0f, 32767.0f,
+	 IMU_PARAM_DEV(calib.accel.b[1]),       0},
+	{IMU_PARAM_ACCEL_BIAS_Z,   IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "accel_bias_z",   -32768.0f, 32767.0f,
+	 IMU_PARAM_DEV(calib.accel.b[2]),       0},
+	{IMU_PARAM_GYRO_BIAS_X,    IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "gyro_bias_x",    -32768.0f, 32767.0f,
+	 IMU_PARAM_DEV(calib.gyro.b[0]),        0},
+	{IMU_PARAM_GYRO_BIAS_Y,    IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "gyro_bias_y",    -32768.0f, 32767.0f,
+	 IMU_PARAM_DEV(calib.gyro.b[1]),        0},
+	{IMU_PARAM_GYRO_BIAS_Z,    IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "gyro_bias_z",    -32768.0f, 32767.0f,
+	 IMU_PARAM_DEV(calib.gyro.b[2]),        0},
+	{IMU_PARAM_VOTE_ANGLE_TOL, IMU_PARAM_F32,  0,                    "vote_angle_tol", 0.001f, 3.1416f,
+	 0, &IMU_vote_angle_tol,                0},
+	{IMU_PARAM_VOTE_OMEGA_TOL, IMU_PARAM_F32,  0,                    "vote_omega_tol", 0.001f, 35.0f,
+	 0, &IMU_vote_omega_tol,                0},
+	{IMU_PARAM_MAG_YAW_GAIN,   IMU_PARAM_F32,  0,                    "mag_yaw_gain",   0.0f, 1.0f,
+	 0, &IMU_mag_yaw_gain,                  0},
+	{IMU_PARAM_ACCEL_M_XX,     IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "accel_m_xx",     0.5f, 1.5f,
+	 IMU_PARAM_DEV(calib.accel.M[0][0]),     IMU_param_apply_model},
+	{IMU_PARAM_ACCEL_M_XY,     IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "accel_m_xy",     -0.5f, 0.5f,
+	 IMU_PARAM_DEV(calib.accel.M[0][1]),     IMU_param_apply_model},
+	{IMU_PARAM_ACCEL_M_XZ,     IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "accel_m_xz",     -0.5f, 0.5f,
+	 IMU_PARAM_DEV(calib.accel.M[0][2]),     IMU_param_apply_model},
+	{IMU_PARAM_ACCEL_M_YX,     IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "accel_m_yx",     -0.5f, 0.5f,
+	 IMU_PARAM_DEV(calib.accel.M[1][0]),     IMU_param_apply_model},
+	{IMU_PARAM_ACCEL_M_YY,     IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "accel_m_yy",     0.5f, 1.5f,
+	 IMU_PARAM_DEV(calib.accel.M[1][1]),     IMU_param_apply_model},
+	{IMU_PARAM_ACCEL_M_YZ,     IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "accel_m_yz",     -0.5f, 0.5f,
+	 IMU_PARAM_DEV(calib.accel.M[1][2]),     IMU_param_apply_model},
+	{IMU_PARAM_ACCEL_M_ZX,     IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "accel_m_zx",     -0.5f, 0.5f,
+	 IMU_PARAM_DEV(calib.accel.M[2][0]),     IMU_param_apply_model},
+	{IMU_PARAM_ACCEL_M_ZY,     IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "accel_m_zy",     -0.5f, 0.5f,
+	 IMU_PARAM_DEV(calib.accel.M[2][1]),     IMU_param_apply_model},
+	{IMU_PARAM_ACCEL_M_ZZ,     IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "accel_m_zz",     0.5f, 1.5f,
+	 IMU_PARAM_DEV(calib.accel.M[2][2]),     IMU_param_apply_model},
+	{IMU_PARAM_GYRO_M_XX,      IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "gyro_m_xx",      0.5f, 1.5f,
+	 IMU_PARAM_DEV(calib.gyro.M[0][0]),      IMU_param_apply_model},
+	{IMU_PARAM_GYRO_M_XY,      IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "gyro_m_xy",      -0.5f, 0.5f,
+	 IMU_PARAM_DEV(calib.gyro.M[0][1]),      IMU_param_apply_model},
+	{IMU_PARAM_GYRO_M_XZ,      IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "gyro_m_xz",      -0.5f, 0.5f,
+	 IMU_PARAM_DEV(calib.gyro.M[0][2]),      IMU_param_apply_model},
+	{IMU_PARAM_GYRO_M_YX,      IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "gyro_m_yx",      -0.5f, 0.5f,
+	 IMU_PARAM_DEV(calib.gyro.M[1][0]),      IMU_param_apply_model},
+	{IMU_PARAM_GYRO_M_YY,      IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "gyro_m_yy",      0.5f, 1.5f,
+	 IMU_PARAM_DEV(calib.gyro.M[1][1]),      IMU_param_apply_model},
+	{IMU_PARAM_GYRO_M_YZ,      IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "gyro_m_yz",      -0.5f, 0.5f,
+	 IMU_PARAM_DEV(calib.gyro.M[1][2]),      IMU_param_apply_model},
+	{IMU_PARAM_GYRO_M_ZX,      IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "gyro_m_zx",      -0.5f, 0.5f,
+	 IMU_PARAM_DEV(calib.gyro.M[2][0]),      IMU_param_apply_model},
+	{IMU_PARAM_GYRO_M_ZY,      IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "gyro_m_zy",      -0.5f, 0.5f,
+	 IMU_PARAM_DEV(calib.gyro.M[2][1]),      IMU_param_apply_model},
+	{IMU_PARAM_GYRO_M_ZZ,      IMU_PARAM_F32,  IMU_PARAM_PER_SENSOR, "gyro_m_zz",      0.5f, 1.5f,
+	 IMU_PARAM_DEV(calib.gyro.M[2][2]),      IMU_param_apply_model}
+};
+
+IMU_param_struct IMU_param;
+
+/*******************************************************************************
+* Nome funzione     : IMU_param_init
+* Descrizione  	    : Prepara il canale dei comandi sui sensori indicati
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 vettore degli handle dei sensori
+* 					  (uint8_t) num_dev -
+* 					  	 numero di sensori
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_param_init(IMU_dev_struct *dev, uint8_t num_dev)
+{
+	memset(&IMU_param, 0, sizeof(IMU_param));
+	IMU_param.dev = dev;
+	IMU_param.num_dev = num_dev;
+
+} /* Fine IMU_param_init() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_param_poll
+* Descrizione  	    : Punto sicuro del ciclo principale, tra due campioni:
+* 					  esegue un comando ricevuto, applica al piu' una
+* 					  modifica (su un sensore) e invia al piu' una risposta
+* Argomenti         : No
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_param_poll(void)
+{
+	/* Definisce le variabili locali */
+	uint8_t *cmd;
+	uint16_t n;
+
+	/* Senza un blocco libero il comando aspetta il prossimo ciclo */
+	cmd = (uint8_t *)IMU_pool_alloc(&IMU_mem_cmds);
+	if (0 != cmd)
+	{
+		n = IMU_telem_receive(cmd);
+		if (n > 0) {
+			IMU_param_command(cmd, n);
+		}
+		IMU_pool_free(&IMU_mem_cmds, cmd);
+	}
+
+	IMU_param_apply();
+	IMU_param_send();
+
+} /* Fine IMU_param_poll() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_param_find
+* Descrizione  	    : Cerca un parametro nella tabella
+* Argomenti         : (uint8_t) id -
+* 						 parametro (IMU_param_id_e)
+* Valori restituiti : (IMU_param_def_struct) * -
+* 						 descrizione (0 se non esiste)
+*******************************************************************************/
+const IMU_param_def_struct *IMU_param_find(uint8_t id)
+{
+	/* Definisce le variabili locali */
+	uint8_t i;
+
+	for (i = 0; i < NUM_IMU_PARAM - 1; i++)
+	{
+		if (IMU_param_table[i].id == id) {
+			return &IMU_param_table[i];
+		}
+	}
+
+	return 0;
+
+} /* Fine IMU_param_find() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_param_get
+* Descrizione  	    : Valore attuale di un parametro
+* Argomenti         : (IMU_param_def_struct) *def -
+* 						 parametro
+* 					  (IMU_dev_struct) *dev -
+* 					  	 sensore (ignorato per i parametri globali)
+* Valori restituiti : (IMU_param_value_u) -
+* 						 valore
+*******************************************************************************/
+IMU_param_value_u IMU_param_get(const IMU_param_def_struct *def, const IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	const void *p = (def->flags & IMU_PARAM_PER_SENSOR) ? (const uint8_t *)dev + def->offset : def->var;
+	IMU_param_value_u v;
+
+	switch (def->type)
+	{
+		case IMU_PARAM_U8:   v.i = *(const uint8_t *)p;  break;
+		case IMU_PARAM_U16:  v.i = *(const uint16_t *)p; break;
+		case IMU_PARAM_BOOL: v.i = *(const bool *)p;     break;
+		default:             v.f = *(const float *)p;    break;
+	}
+
+	return v;
+
+} /* Fine IMU_param_get() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_param_command
+* Descrizione  	    : Controlla un comando, dalla seriale o dal firmware. Le
+* 					  letture vengono accodate come risposte, le modifiche
+* 					  valide come modifiche in attesa (applicate da
+* 					  IMU_param_poll)
+* Argomenti         : (uint8_t) *cmd -
+* 						 contenuto del comando
+* 					  (uint16_t) n -
+* 					  	 lunghezza
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_param_command(const uint8_t *cmd, uint16_t n)
+{
+	/* Definisce le variabili locali */
+	IMU_param_struct *p = &IMU_param;
+	const IMU_param_def_struct *def;
+	IMU_param_cmd_struct *q;
+	IMU_param_value_u v;
+	float x;
+	uint8_t op, tag, id, sensor, i;
+
+	if (n != IMU_PARAM_CMD_LEN)
+	{
+		p->rejected++;
+		IMU_param_reply((n > 1) ? cmd[1] : 0, IMU_PARAM_BAD_COMMAND, (n > 2) ? cmd[2] : 0, 0);
+		return;
+	}
+	op = cmd[0];
+	tag = cmd[1];
+	id = cmd[2];
+	sensor = cmd[3];
+	v.bits = (uint32_t)cmd[4] | ((uint32_t)cmd[5] << 8) | ((uint32_t)cmd[6] << 16) | ((uint32_t)cmd[7] << 24);
+
+	/* Lettura di tutti i parametri: una risposta per chiamata di IMU_param_send */
+	if ((IMU_PARAM_GET == op) && (IMU_PARAM_ALL == id))
+	{
+		p->dumping = true;
+		p->dump_tag = tag;
+		p->dump_index = 0;
+		p->dump_sensor = 0;
+		return;
+	}
+
+	def = IMU_param_find(id);
+	if ((IMU_PARAM_GET != op) && (IMU_PARAM_SET != op))
+	{
+		p->rejected++;
+		IMU_param_reply(tag, IMU_PARAM_BAD_COMMAND, id, sensor);
+		return;
+	}
+	if (0 == def)
+	{
+		p->rejected++;
+		IMU_param_reply(tag, IMU_PARAM_BAD_ID, id, sensor);
+		return;
+	}
+	if (!(def->flags & IMU_PARAM_PER_SENSOR)) {
+		sensor = 0;
+	}
+	else if ((IMU_PARAM_ALL_SENSORS != sensor) && (sensor >= p->num_dev))
+	{
+		p->rejected++;
+		IMU_param_reply(tag, IMU_PARAM_BAD_SENSOR, id, sensor);
+		return;
+	}
+
+	if (IMU_PARAM_GET == op)
+	{
+		/* Per tutti i sensori una risposta per sensore */
+		if (IMU_PARAM_ALL_SENSORS == sensor)
+		{
+			for (i = 0; i < p->num_dev; i++) {
+				IMU_param_reply(tag, IMU_PARAM_OK, id, i);
+			}
+		}
+		else {
+			IMU_param_reply(tag, IMU_PARAM_OK, id, sensor);
+		}
+		return;
+	}
+
+	/* Intervallo: un NaN fallisce entrambi i confronti */
+	x = (IMU_PARAM_F32 == def->type) ? v.f : (float)v.i;
+	if (!((x >= def->min) && (x <= def->max)))
+	{
+		p->rejected++;
+		IMU_param_reply(tag, IMU_PARAM_RANGE, id, sensor);
+		return;
+	}
+
+	if (p->queue_count >= IMU_PARAM_QUEUE)
+	{
+		p->rejected++;
+		IMU_param_reply(tag, IMU_PARAM_BUSY, id, sensor);
+		return;
+	}
+
+	q = &p->queue[(p->queue_first + p->queue_count) % IMU_PARAM_QUEUE];
+	q->tag = tag;
+	q->status = IMU_PARAM_OK;
+	q->id = id;
+	q->sensor = sensor;
+	q->next = (IMU_PARAM_ALL_SENSORS == sensor) ? 0 : sensor;
+	q->value = v;
+	p->queue_count++;
+
+} /* Fine IMU_param_command() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_param_apply
+* Descrizione  	    : Applica la prima modifica in attesa a un sensore. Se
+* 					  l'applicazione fallisce il valore precedente viene
+* 					  riscritto e riapplicato. Finiti i sensori la modifica
+* 					  diventa una risposta
+* Argomenti         : No
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_param_apply(void)
+{
+	/* Definisce le variabili locali */
+	IMU_param_struct *p = &IMU_param;
+	IMU_param_cmd_struct *q = &p->queue[p->queue_first];
+	const IMU_param_def_struct *def;
+	IMU_dev_struct *dev;
+	IMU_param_value_u old;
+	uint16_t start, elapsed;
+
+	if (0 == p->queue_count) {
+		return;
+	}
+
+	def = IMU_param_find(q->id);
+	dev = &p->dev[q->next];
+
+	start = CMT_counter();
+	old = IMU_param_get(def, dev);
+	IMU_param_set(def, dev, q->value);
+	if ((0 != def->apply) && !def->apply(dev, q->id))
+	{
+		IMU_param_set(def, dev, old);
+		def->apply(dev, q->id);
+		q->status = IMU_PARAM_FAILED;
+		p->rejected++;
+		IMU_LOG2(IMU_LOG_PARAM_FAILED, q->id, q->next);
+	}
+	else
+	{
+		p->applied++;
+		IMU_LOG3(IMU_LOG_PARAM_APPLIED, q->id, q->next, q->value.bits);
+	}
+	elapsed = CMT_counter() - start;
+	if (elapsed > p->apply_max) {
+		p->apply_max = elapsed;
+	}
+
+	/* Prossimo sensore, o fine della modifica */
+	if ((IMU_PARAM_ALL_SENSORS == q->sensor) && (def->flags & IMU_PARAM_PER_SENSOR) && (q->next + 1 < p->num_dev))
+	{
+		q->next++;
+		return;
+	}
+
+	IMU_param_reply(q->tag, q->status, q->id, q->sensor);
+	p->queue_first = (p->queue_first + 1) % IMU_PARAM_QUEUE;
+	p->queue_count--;
+
+} /* Fine IMU_param_apply() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_param_send
+* Descrizione  	    : Invia la prima risposta in attesa, o il prossimo
+* 					  parametro della lettura completa, se la linea e' libera.
+* 					  Il valore e' letto al momento dell'invio
+* Argomenti         : No
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_param_send(void)
+{
+	/* Definisce le variabili locali */
+	IMU_param_struct *p = &IMU_param;
+	IMU_param_cmd_struct *r = &p->reply[p->reply_first];
+	const IMU_param_def_struct *def;
+	IMU_param_value_u v;
+	uint8_t sensor;
+
+	if (p->reply_count > 0)
+	{
+		def = IMU_param_find(r->id);
+		sensor = (IMU_PARAM_ALL_SENSORS == r->sensor) ? 0 : r->sensor;
+		v.bits = 0;
+		if ((0 != def) && (IMU_PARAM_BAD_SENSOR != r->status)) {
+			v = IMU_param_get(def, &p->dev[sensor]);
+		}
+		if (IMU_telem_send_param(r->tag, r->status, r->id, r->sensor, (0 != def) ? def->type : 0, v.bits))
+		{
+			p->reply_first = (p->reply_first + 1) % IMU_PARAM_REPLIES;
+			p->reply_count--;
+		}
+		return;
+	}
+
+	if (!p->dumping) {
+		return;
+	}
+
+	def = &IMU_param_table[p->dump_index];
+	v = IMU_param_get(def, &p->dev[p->dump_sensor]);
+	if (!IMU_telem_send_param(p->dump_tag, IMU_PARAM_OK, def->id,
+							  (def->flags & IMU_PARAM_PER_SENSOR) ? p->dump_sensor : 0, def->type, v.bits)) {
+		return;
+	}
+
+	if ((def->flags & IMU_PARAM_PER_SENSOR) && (p->dump_sensor + 1 < p->num_dev)) {
+		p->dump_sensor++;
+	}
+	else
+	{
+		p->dump_sensor = 0;
+		if (++p->dump_index >= NUM_IMU_PARAM - 1) {
+			p->dumping = false;
+		}
+	}
+
+} /* Fine IMU_param_send() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_param_reply
+* Descrizione  	    : Accoda una risposta; a coda piena viene persa (l'host
+* 					  ripete il comando)
+* Argomenti         : (uint8_t) tag -
+* 						 etichetta del comando
+* 					  (uint8_t) status -
+* 					  	 esito
+* 					  (uint8_t) id -
+* 					  	 parametro
+* 					  (uint8_t) sensor -
+* 					  	 sensore
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_param_reply(uint8_t tag, uint8_t status, uint8_t id, uint8_t sensor)
+{
+	/* Definisce le variabili locali */
+	IMU_param_struct *p = &IMU_param;
+	IMU_param_cmd_struct *r;
+
+	if (p->reply_count >= IMU_PARAM_REPLIES)
+	{
+		p->lost_replies++;
+		return;
+	}
+
+	r = &p->reply[(p->reply_first + p->reply_count) % IMU_PARAM_REPLIES];
+	r->tag = tag;
+	r->status = status;
+	r->id = id;
+	r->sensor = sensor;
+	p->reply_count++;
+
+} /* Fine IMU_param_reply() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_param_set
+* Descrizione  	    : Scrive il valore di un parametro (gia' controllato)
+* Argomenti         : (IMU_param_def_struct) *def -
+* 						 parametro
+* 					  (IMU_dev_struct) *dev -
+* 					  	 sensore
+* 					  (IMU_param_value_u) v -
+* 					  	 valore
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_param_set(const IMU_param_def_struct *def, IMU_dev_struct *dev, IMU_param_value_u v)
+{
+	/* Definisce le variabili locali */
+	void *p = (def->flags & IMU_PARAM_PER_SENSOR) ? (uint8_t *)dev + def->offset : def->var;
+
+	switch (def->type)
+	{
+		case IMU_PARAM_U8:   *(uint8_t *)p  = (uint8_t)v.i;  break;
+		case IMU_PARAM_U16:  *(uint16_t *)p = (uint16_t)v.i; break;
+		case IMU_PARAM_BOOL: *(bool *)p     = (0 != v.i);    break;
+		default:             *(float *)p    = v.f;           break;
+	}
+
+} /* Fine IMU_param_set() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_param_apply_config
+* Descrizione  	    : Riconfigura il sensore (IMU_set_config: una scrittura
+* 					  dei registri, il filtro e la FIFO se cambia la
+* 					  decimazione). Rifiuta le frequenze che il divisore del
+* 					  sensore non puo' ottenere e quelle a cui il filtro
+* 					  software configurato non e' piu' realizzabile. Con un
+* 					  nuovo fondo scala il bias statico (LSB) viene portato
+* 					  sulla nuova sensibilita' e la stima continua del bias
+* 					  riparte; offset e bias termico sono in unita' fisiche
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 sensore
+* 					  (uint8_t) id -
+* 					  	 parametro modificato
+* Valori restituiti : (bool) -
+* 						 false se la configurazione non e' valida o fallisce
+*******************************************************************************/
+static bool IMU_param_apply_config(IMU_dev_struct *dev, uint8_t id)
+{
+	/* Definisce le variabili locali */
+	IMU_config_struct config = dev->config;
+	float accel_scale = dev->accel_scale;
+	float gyro_scale = dev->gyro_scale;
+	riic_ret_t ret;
+	uint16_t base_hz;
+	uint32_t odr_hz;
+	uint8_t k;
+
+	(void)id;
+
+	/* Stesso calcolo di IMU_config: SMPLRT_DIV ha 8 bit */
+	base_hz = ((INV_MPU6050_FILTER_256HZ_NODLPF == config.dlpf) ||
+			   (INV_MPU6050_FILTER_2100HZ_NODLPF == config.dlpf)) ? INV_MPU6050_EIGHT_K_HZ : INV_MPU6050_ONE_K_HZ;
+	odr_hz = (uint32_t)config.rate_hz * ((config.decim > 1) ? config.decim : 1);
+	if ((odr_hz > base_hz) || (base_hz / odr_hz > 256)) {
+		return false;
+	}
+
+	/* Il filtro lavora a odr_hz, o a rate_hz senza decimazione */
+	if (!IMU_param_filter_ok(&config.filter, odr_hz)) {
+		return false;
+	}
+
+	ret = IMU_set_config(dev, &config);
+
+	/* IMU_config aggiorna i fattori di scala solo dopo aver scritto i registri:
+	 il rapporto vale anche se la riconfigurazione fallisce dopo */
+	if ((accel_scale != dev->accel_scale) || (gyro_scale != dev->gyro_scale))
+	{
+		for (k = 0; k < 3; k++)
+		{
+			dev->calib.accel.b[k] *= accel_scale / dev->accel_scale;
+			dev->calib.gyro.b[k]  *= gyro_scale / dev->gyro_scale;
+		}
+		if (RIIC_OK == ret) {
+			ret = IMU_bias_init(dev);
+		}
+	}
+
+	return (RIIC_OK == ret);
+
+} /* Fine IMU_param_apply_config() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_param_apply_bias
+* Descrizione  	    : Riavvia la stima del bias con o senza il rilevatore
+* 					  zero-motion del sensore
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 sensore
+* 					  (uint8_t) id -
+* 					  	 parametro modificato
+* Valori restituiti : (bool) -
+* 						 false se la scrittura dei registri fallisce
+*******************************************************************************/
+static bool IMU_param_apply_bias(IMU_dev_struct *dev, uint8_t id)
+{
+	(void)id;
+
+	return (RIIC_OK == IMU_bias_init(dev));
+
+} /* Fine IMU_param_apply_bias() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_param_apply_model
+* Descrizione  	    : Ricarica il modello con la matrice di scala e
+* 					  disallineamento modificata (IMU_calib_set_model ricalcola
+* 					  le matrici in Q14). Il livellamento viene riapplicato
+* 					  con la stessa direzione della gravita': per misurarlo
+* 					  con il nuovo modello serve una ricalibrazione
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 sensore
+* 					  (uint8_t) id -
+* 					  	 parametro modificato
+* Valori restituiti : (bool) -
+* 						 true
+*******************************************************************************/
+static bool IMU_param_apply_model(IMU_dev_struct *dev, uint8_t id)
+{
+	/* Definisce le variabili locali */
+	float g[3];
+	uint8_t k;
+
+	(void)id;
+
+	/* level porta la gravita' sull'asse z: la sua direzione e' la terza riga */
+	for (k = 0; k < 3; k++) {
+		g[k] = dev->calib.level[2][k];
+	}
+
+	IMU_calib_set_model(dev, &dev->calib.accel, &dev->calib.gyro);
+	IMU_calib_set_level(dev, g);
+
+	return true;
+
+} /* Fine IMU_param_apply_model() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_param_apply_filter
+* Descrizione  	    : Ricalcola il filtro software alla sua frequenza di
+* 					  lavoro (lo stato riparte da zero). Rifiuta taglio e
+* 					  centri dei notch oltre il limite di Nyquist di quella
+* 					  frequenza, che il filtro altrimenti limiterebbe o
+* 					  spegnerebbe senza avvisare
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 sensore
+* 					  (uint8_t) id -
+* 					  	 parametro modificato
+* Valori restituiti : (bool) -
+* 						 false se il filtro non e' realizzabile
+*******************************************************************************/
+static bool IMU_param_apply_filter(IMU_dev_struct *dev, uint8_t id)
+{
+	(void)id;
+
+	if (!IMU_param_filter_ok(&dev->config.filter, IMU_filter_rate(dev))) {
+		return false;
+	}
+
+	IMU_filter_init(&dev->filter, &dev->config.filter, IMU_filter_rate(dev));
+
+	return true;
+
+} /* Fine IMU_param_apply_filter() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_param_apply_notch
+* Descrizione  	    : Sposta un notch conservando lo stato del filtro.
+* 					  Rifiuta i centri oltre il limite di Nyquist della
+* 					  frequenza del filtro (IMU_filter_set_notch spegnerebbe
+* 					  il notch)
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 sensore
+* 					  (uint8_t) id -
+* 					  	 IMU_PARAM_NOTCH0_HZ o IMU_PARAM_NOTCH1_HZ
+* Valori restituiti : (bool) -
+* 						 false se il centro e' oltre il limite
+*******************************************************************************/
+static bool IMU_param_apply_notch(IMU_dev_struct *dev, uint8_t id)
+{
+	/* Definisce le variabili locali */
+	uint8_t idx = id - IMU_PARAM_NOTCH0_HZ;
+
+	if (dev->config.filter.notch_hz[idx] >= IMU_FILTER_NYQUIST_MARGIN * IMU_filter_rate(dev)) {
+		return false;
+	}
+
+	IMU_filter_set_notch(&dev->filter, idx, dev->config.filter.notch_hz[idx]);
+
+	return true;
+
+} /* Fine IMU_param_apply_notch() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_param_filter_ok
+* Descrizione  	    : Controlla che taglio del passa basso e centri dei notch
+* 					  stiano sotto IMU_FILTER_NYQUIST_MARGIN * fs
+* Argomenti         : (IMU_filter_config_struct) *cfg -
+* 						 configurazione del filtro
+* 					  (uint32_t) fs -
+* 					  	 frequenza di lavoro del filtro (Hz)
+* Valori restituiti : (bool) -
+* 						 true se il filtro e' realizzabile
+*******************************************************************************/
+static bool IMU_param_filter_ok(const IMU_filter_config_struct *cfg, uint32_t fs)
+{
+	/* Definisce le variabili locali */
+	float limit = IMU_FILTER_NYQUIST_MARGIN * (float)fs;
+	uint8_t k;
+
+	if ((cfg->lowpass_stages > 0) && (cfg->lowpass_hz >= limit)) {
+		return false;
+	}
+	for (k = 0; (k < IMU_FILTER_MAX_NOTCH) && (cfg->notch_q > 0.0f); k++)
+	{
+		if (cfg->notch_hz[k] >= limit) {
+			return false;
+		}
+	}
+
+	return true;
+
+} /* Fine IMU_param_filter_ok() */
@@ -0,0 +1,182 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _IMU_PARAM_H_
+#define _IMU_PARAM_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "main.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_PARAM_QUEUE						8		/* modifiche in attesa del punto sicuro */
+#define IMU_PARAM_REPLIES					8		/* risposte in attesa della linea */
+#define IMU_PARAM_CMD_LEN					8		/* operazione, etichetta, parametro, sensore, valore */
+#define IMU_PARAM_ALL						0		/* parametro: tutti (solo IMU_PARAM_GET) */
+#define IMU_PARAM_ALL_SENSORS				0xFF	/* sensore: tutti */
+#define IMU_PARAM_PER_SENSOR				0x01	/* il valore e' diverso per ogni sensore */
+
+#if IMU_FILTER_MAX_NOTCH != 2
+#error "la tabella dei parametri prevede due notch"
+#endif
+
+/*******************************************************************************
+Definizione enumerazioni
+*******************************************************************************/
+/* Parametri (l'identificativo fa parte del protocollo: solo aggiunte in coda) */
+enum IMU_param_id_e {
+	IMU_PARAM_ACCEL_FS = 1,
+	IMU_PARAM_GYRO_FS,
+	IMU_PARAM_DLPF,
+	IMU_PARAM_RATE_HZ,
+	IMU_PARAM_DECIM,
+	IMU_PARAM_BIAS_ZMOT,
+	IMU_PARAM_LOWPASS_HZ,
+	IMU_PARAM_LOWPASS_STAGES,
+	IMU_PARAM_NOTCH_Q,
+	IMU_PARAM_NOTCH0_HZ,
+	IMU_PARAM_NOTCH1_HZ,
+	IMU_PARAM_ACCEL_BIAS_X,
+	IMU_PARAM_ACCEL_BIAS_Y,
+	IMU_PARAM_ACCEL_BIAS_Z,
+	IMU_PARAM_GYRO_BIAS_X,
+	IMU_PARAM_GYRO_BIAS_Y,
+	IMU_PARAM_GYRO_BIAS_Z,
+	IMU_PARAM_VOTE_ANGLE_TOL,
+	IMU_PARAM_VOTE_OMEGA_TOL,
+	IMU_PARAM_MAG_YAW_GAIN,
+	IMU_PARAM_ACCEL_M_XX,
+	IMU_PARAM_ACCEL_M_XY,
+	IMU_PARAM_ACCEL_M_XZ,
+	IMU_PARAM_ACCEL_M_YX,
+	IMU_PARAM_ACCEL_M_YY,
+	IMU_PARAM_ACCEL_M_YZ,
+	IMU_PARAM_ACCEL_M_ZX,
+	IMU_PARAM_ACCEL_M_ZY,
+	IMU_PARAM_ACCEL_M_ZZ,
+	IMU_PARAM_GYRO_M_XX,
+	IMU_PARAM_GYRO_M_XY,
+	IMU_PARAM_GYRO_M_XZ,
+	IMU_PARAM_GYRO_M_YX,
+	IMU_PARAM_GYRO_M_YY,
+	IMU_PARAM_GYRO_M_YZ,
+	IMU_PARAM_GYRO_M_ZX,
+	IMU_PARAM_GYRO_M_ZY,
+	IMU_PARAM_GYRO_M_ZZ,
+	NUM_IMU_PARAM
+};
+
+/* Tipo del valore: gli interi viaggiano come int32, i float con i loro bit */
+enum IMU_param_type_e {
+	IMU_PARAM_U8 = 1,
+	IMU_PARAM_U16,
+	IMU_PARAM_BOOL,
+	IMU_PARAM_F32,
+	NUM_IMU_PARAM_TYPE
+};
+
+/* Operazione del comando */
+enum IMU_param_op_e {
+	IMU_PARAM_GET = 1,
+	IMU_PARAM_SET,
+	NUM_IMU_PARAM_OP
+};
+
+/* Esito nella risposta */
+enum IMU_param_status_e {
+	IMU_PARAM_OK = 0,
+	IMU_PARAM_BAD_COMMAND,			/* operazione o lunghezza errata */
+	IMU_PARAM_BAD_ID,
+	IMU_PARAM_BAD_SENSOR,
+	IMU_PARAM_RANGE,				/* valore fuori dall'intervallo */
+	IMU_PARAM_BUSY,					/* troppe modifiche in attesa */
+	IMU_PARAM_FAILED,				/* applicazione fallita (bus), valore precedente ripristinato */
+	NUM_IMU_PARAM_STATUS
+};
+
+/*******************************************************************************
+Definizione strutture
+*******************************************************************************/
+/* Valore di un parametro */
+typedef union
+{
+	int32_t i;
+	float   f;
+	uint32_t bits;
+
+} IMU_param_value_u;
+
+/* Descrizione di un parametro. Il valore sta in un campo di IMU_dev_struct
+   (parametri per sensore, offset) o in una variabile globale (var); apply ne
+   propaga l'effetto dopo la scrittura, al punto sicuro del ciclo principale */
+typedef struct
+{
+	uint8_t  id;					/* IMU_param_id_e */
+	uint8_t  type;					/* IMU_param_type_e */
+	uint8_t  flags;					/* IMU_PARAM_PER_SENSOR */
+	const char *name;
+	float    min;
+	float    max;
+	uint16_t offset;				/* campo in IMU_dev_struct */
+	void    *var;
+	bool   (*apply)(IMU_dev_struct *dev, uint8_t id);	/* 0: basta scrivere il valore */
+
+} IMU_param_def_struct;
+
+/* Modifica o risposta in attesa */
+typedef struct
+{
+	uint8_t  tag;					/* etichetta scelta dall'host, ripetuta nella risposta */
+	uint8_t  status;
+	uint8_t  id;
+	uint8_t  sensor;
+	uint8_t  next;					/* prossimo sensore da modificare (IMU_PARAM_ALL_SENSORS) */
+	IMU_param_value_u value;
+
+} IMU_param_cmd_struct;
+
+/* Canale dei comandi. Le letture rispondono subito; le modifiche vengono
+   accodate e applicate da IMU_param_poll una alla volta, un sensore per
+   chiamata, tra due campioni: il ciclo non aspetta mai piu' di una
+   transazione di configurazione */
+typedef struct
+{
+	IMU_dev_struct *dev;
+	uint8_t  num_dev;
+	IMU_param_cmd_struct queue[IMU_PARAM_QUEUE];
+	uint8_t  queue_first;
+	uint8_t  queue_count;
+	IMU_param_cmd_struct reply[IMU_PARAM_REPLIES];
+	uint8_t  reply_first;
+	uint8_t  reply_count;
+	bool     dumping;				/* lettura di tutti i parametri in corso */
+	uint8_t  dump_tag;
+	uint8_t  dump_index;			/* posizione in IMU_param_table */
+	uint8_t  dump_sensor;
+	uint32_t applied;
+	uint32_t rejected;
+	uint32_t lost_replies;			/* risposte scartate a coda piena */
+	uint16_t apply_max;				/* durata massima di un'applicazione (unita' di CMT_counter) */
+
+} IMU_param_struct;
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+extern const IMU_param_def_struct IMU_param_table[NUM_IMU_PARAM - 1];
+extern IMU_param_struct IMU_param;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+void IMU_param_init(IMU_dev_struct *dev, uint8_t num_dev);
+void IMU_param_poll(void);
+void IMU_param_command(const uint8_t *cmd, uint16_t n);
+const IMU_param_def_struct *IMU_param_find(uint8_t id);
+IMU_param_value_u IMU_param_get(const IMU_param_def_struct *def, const IMU_dev_struct *dev);
+
+#endif /* _IMU_PARAM_H_ */
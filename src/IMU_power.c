@@ -0,0 +1,248 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Gestione dell'alimentazione del sensore tramite PWR_MGMT_1 (SLEEP, CYCLE,
+* TEMP_DIS) e PWR_MGMT_2 (standby per asse, frequenza di risveglio). Negli
+* stati a ciclo l'accelerometro si accende solo per un campione ad ogni
+* risveglio: il robot parcheggiato assorbe una frazione della corrente e con
+* il wake-on-motion il sensore segnala da solo la prima spinta.
+* Le uscite dagli stati a bassa potenza non bloccano: i registri vengono
+* scritti subito e il sensore non viene letto (IMU_power_ready) finche' non e'
+* trascorso il tempo di avvio dei sensori
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdbool.h>
+#include "platform.h"
+#include "CMT.h"
+#include "IMU.h"
+#include "IMU_regmap.h"
+#include "IMU_decim.h"
+#include "IMU_power.h"
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static riic_ret_t IMU_power_arm_motion (IMU_dev_struct *dev);
+
+/*******************************************************************************
+* Nome funzione     : IMU_power_set
+* Descrizione  	    : Porta il sensore in uno stato di alimentazione. Uscendo
+* 					  da uno stato a ciclo o dallo sleep il giroscopio riparte
+* 					  e i campioni sono validi dopo INV_MPU6050_SENSOR_UP_TIME;
+* 					  la FIFO della decimazione viene fermata negli stati a
+* 					  ciclo e riavviata, vuota, al ritorno. Il DMP richiede
+* 					  il sensore a 6 assi
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (uint8_t) state -
+* 					  	 IMU_power_state_e
+* 					  (uint8_t) wake_rate -
+* 					  	 inv_mpu6050_lp_wake_e, usato negli stati a ciclo
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della comunicazione, RIIC_MODE_ERR per uno
+* 						 stato non valido o con il DMP attivo
+*******************************************************************************/
+riic_ret_t IMU_power_set(IMU_dev_struct *dev, uint8_t state, uint8_t wake_rate)
+{
+	/* Definisce le variabili locali */
+	IMU_power_struct *p = &dev->power;
+	bool cycle = (IMU_POWER_ACCEL_CYCLE == state) || (IMU_POWER_WAKE_ON_MOTION == state);
+	bool was_cycle = (IMU_POWER_ACCEL_CYCLE == p->state) || (IMU_POWER_WAKE_ON_MOTION == p->state);
+	bool gyro_was_off = (IMU_POWER_FULL != p->state);
+	uint8_t pwr1, pwr2;
+	riic_ret_t ret;
+
+	if ((state >= NUM_IMU_POWER) || (wake_rate >= NUM_MPU6050_LP_WAKE) ||
+		((IMU_POWER_FULL != state) && dev->dmp.enabled)) {
+		return RIIC_MODE_ERR;
+	}
+	if ((state == p->state) && (!cycle || (wake_rate == p->wake_rate))) {
+		return RIIC_OK;
+	}
+
+	/* Uscendo dal wake-on-motion tornano il filtro configurato e il passa alto
+	 salvato, e l'interrupt di movimento si spegne */
+	if (IMU_POWER_WAKE_ON_MOTION == p->state)
+	{
+		IMU_reg_update_bits(dev, INV_MPU6050_REG_INT_ENABLE, INV_MPU6050_BIT_MOT_EN, 0);
+		IMU_reg_update_bits(dev, INV_MPU6050_REG_CONFIG, INV_MPU6050_BITS_DLPF_CFG, dev->config.dlpf);
+		IMU_reg_update_bits(dev, INV_MPU6050_REG_ACCEL_CONFIG, INV_MPU6050_BITS_ACCEL_HPF, p->hpf);
+	}
+
+	/* Negli stati a ciclo la FIFO si riempirebbe di campioni sparsi */
+	if (cycle && dev->decim.enabled)
+	{
+		ret = IMU_decim_stop(dev);
+		if (RIIC_OK != ret) {
+			return ret;
+		}
+	}
+
+	/* Il riferimento del rilevatore di movimento va bloccato con l'accelerometro acceso */
+	if (IMU_POWER_WAKE_ON_MOTION == state)
+	{
+		ret = IMU_power_arm_motion(dev);
+		if (RIIC_OK != ret) {
+			return ret;
+		}
+	}
+
+	/* Bit di PWR_MGMT_1 e PWR_MGMT_2 per lo stato richiesto (il sensore della
+	 temperatura resta acceso fuori dagli stati a ciclo, serve al modello termico) */
+	switch (state)
+	{
+		case IMU_POWER_GYRO_STANDBY:
+			pwr1 = 0;
+			pwr2 = INV_MPU6050_BIT_PWR_GYRO_STBY;
+			break;
+
+		case IMU_POWER_ACCEL_CYCLE:
+		case IMU_POWER_WAKE_ON_MOTION:
+			pwr1 = INV_MPU6050_BIT_CYCLE | INV_MPU6050_BIT_TEMP_DIS;
+			pwr2 = (wake_rate << INV_MPU6050_LP_WAKE_CTRL_SHIFT) | INV_MPU6050_BIT_PWR_GYRO_STBY;
+			break;
+
+		case IMU_POWER_SLEEP:
+			pwr1 = INV_MPU6050_BIT_SLEEP;
+			pwr2 = 0;
+			break;
+
+		default:
+			pwr1 = 0;
+			pwr2 = 0;
+			break;
+	}
+
+	/* PWR_MGMT_1 e PWR_MGMT_2 sono contigui: una sola scrittura */
+	IMU_reg_update_bits(dev, INV_MPU6050_REG_PWR_MGMT_1,
+						INV_MPU6050_BIT_SLEEP | INV_MPU6050_BIT_CYCLE | INV_MPU6050_BIT_TEMP_DIS, pwr1);
+	IMU_reg_set(dev, INV_MPU6050_REG_PWR_MGMT_2, pwr2);
+	ret = IMU_reg_flush(dev);
+	if (RIIC_OK != ret) {
+		return ret;
+	}
+
+	/* Ripartenza dei sensori: i dati sono validi solo dopo il tempo di avvio */
+	if (((IMU_POWER_FULL == state) && gyro_was_off) ||
+		((IMU_POWER_GYRO_STANDBY == state) && (was_cycle || (IMU_POWER_SLEEP == p->state)))) {
+		p->ready_ms = get_ms() + INV_MPU6050_SENSOR_UP_TIME;
+	}
+
+	/* Al ritorno i campioni riprendono dopo una pausa: la FIFO riparte vuota e
+	 il filtro software si riallinea al primo campione */
+	if (!cycle && (IMU_POWER_SLEEP != state) && (was_cycle || (IMU_POWER_SLEEP == p->state)))
+	{
+		dev->filter.primed = false;
+		if (dev->config.decim > 1)
+		{
+			ret = IMU_decim_start(dev);
+			if (RIIC_OK != ret) {
+				return ret;
+			}
+		}
+	}
+
+	p->state = state;
+	p->wake_rate = wake_rate;
+	p->transitions++;
+
+	return RIIC_OK;
+
+} /* Fine IMU_power_set() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_power_poll
+* Descrizione  	    : In wake-on-motion legge INT_STATUS (la lettura azzera i
+* 					  flag) e al primo movimento riporta il sensore a 6 assi.
+* 					  Negli altri stati non fa nulla
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della comunicazione
+*******************************************************************************/
+riic_ret_t IMU_power_poll(IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	uint8_t status;
+	riic_ret_t ret;
+
+	if (!dev->ready || (IMU_POWER_WAKE_ON_MOTION != dev->power.state)) {
+		return RIIC_OK;
+	}
+
+	ret = IMU_read(dev, INV_MPU6050_REG_INT_STATUS, &status, 1);
+	if ((RIIC_OK != ret) || (0 == (status & INV_MPU6050_BIT_MOT_INT))) {
+		return ret;
+	}
+
+	dev->power.wakeups++;
+
+	return IMU_power_set(dev, IMU_POWER_FULL, dev->power.wake_rate);
+
+} /* Fine IMU_power_poll() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_power_ready
+* Descrizione  	    : Indica se il sensore produce campioni validi: e' acceso
+* 					  con l'accelerometro a frequenza piena ed e' trascorso il
+* 					  tempo di avvio dopo l'ultima ripartenza
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : (bool) -
+* 						 true se il sensore puo' essere letto
+*******************************************************************************/
+bool IMU_power_ready(const IMU_dev_struct *dev)
+{
+	return ((IMU_POWER_FULL == dev->power.state) || (IMU_POWER_GYRO_STANDBY == dev->power.state)) &&
+		   (get_ms() - dev->power.ready_ms >= 0);
+
+} /* Fine IMU_power_ready() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_power_arm_motion
+* Descrizione  	    : Prepara il rilevatore di movimento come nella sequenza
+* 					  del produttore: accelerometro acceso a frequenza piena,
+* 					  filtro del sensore aperto, passa alto azzerato, soglia e
+* 					  durata, interrupt di movimento; dopo un campione il passa
+* 					  alto in HOLD blocca il riferimento e il rilevatore
+* 					  confronta ogni campione a ciclo con la posizione di
+* 					  parcheggio
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della comunicazione
+*******************************************************************************/
+static riic_ret_t IMU_power_arm_motion(IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	IMU_power_struct *p = &dev->power;
+	bool accel_off = (IMU_POWER_ACCEL_CYCLE == p->state) || (IMU_POWER_SLEEP == p->state);
+	uint16_t thr = IMU_POWER_MOT_THR_MG / IMU_POWER_MOT_MG_PER_LSB;
+	riic_ret_t ret;
+
+	p->hpf = IMU_reg_get(dev, INV_MPU6050_REG_ACCEL_CONFIG) & INV_MPU6050_BITS_ACCEL_HPF;
+
+	IMU_reg_update_bits(dev, INV_MPU6050_REG_PWR_MGMT_1,
+						INV_MPU6050_BIT_SLEEP | INV_MPU6050_BIT_CYCLE | INV_MPU6050_BIT_TEMP_DIS, 0);
+	IMU_reg_set(dev, INV_MPU6050_REG_PWR_MGMT_2, INV_MPU6050_BIT_PWR_GYRO_STBY);
+	IMU_reg_update_bits(dev, INV_MPU6050_REG_CONFIG, INV_MPU6050_BITS_DLPF_CFG, INV_MPU6050_FILTER_256HZ_NODLPF);
+	IMU_reg_update_bits(dev, INV_MPU6050_REG_ACCEL_CONFIG, INV_MPU6050_BITS_ACCEL_HPF, 0);
+	IMU_reg_set(dev, INV_MPU6050_REG_MOT_THR, (thr > 0xFF) ? 0xFF : ((0 == thr) ? 1 : (uint8_t)thr));
+	IMU_reg_set(dev, INV_MPU6050_REG_MOT_DUR, IMU_POWER_MOT_DUR);
+	IMU_reg_update_bits(dev, INV_MPU6050_REG_INT_ENABLE, INV_MPU6050_BIT_MOT_EN, INV_MPU6050_BIT_MOT_EN);
+	ret = IMU_reg_flush(dev);
+	if (RIIC_OK != ret) {
+		return ret;
+	}
+
+	/* Un campione a frequenza piena, dopo l'avvio se l'accelerometro era spento */
+	ms_delay(accel_off ? INV_MPU6050_SENSOR_UP_TIME : INV_MPU6050_REG_UP_TIME);
+
+	IMU_reg_update_bits(dev, INV_MPU6050_REG_ACCEL_CONFIG, INV_MPU6050_BITS_ACCEL_HPF, INV_MPU6050_ACCEL_HPF_HOLD);
+
+	return IMU_reg_flush(dev);
+
+} /* Fine IMU_power_arm_motion() */
@@ -0,0 +1,41 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _IMU_POWER_H_
+#define _IMU_POWER_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdbool.h>
+#include "main.h"
+#include "r_riic_rx600.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_POWER_MOT_THR_MG				64		/* soglia del wake-on-motion (mg) */
+#define IMU_POWER_MOT_MG_PER_LSB			32		/* unita' di MOT_THR, come nel driver del produttore */
+#define IMU_POWER_MOT_DUR					1		/* campioni sopra soglia per il risveglio */
+
+/*******************************************************************************
+Definizione enumerazioni
+*******************************************************************************/
+/* Assorbimento tipico dal datasheet: 3.9 mA a 6 assi, 0.5 mA con il solo
+   accelerometro, da 10 uA (1.25 Hz) a 140 uA (40 Hz) a ciclo, 5 uA in sleep */
+enum IMU_power_state_e {
+	IMU_POWER_FULL = 0,							/* accelerometro e giroscopio */
+	IMU_POWER_GYRO_STANDBY,						/* solo accelerometro, alla frequenza configurata */
+	IMU_POWER_ACCEL_CYCLE,						/* solo accelerometro, un campione ad ogni risveglio */
+	IMU_POWER_WAKE_ON_MOTION,					/* come ACCEL_CYCLE, torna a FULL al primo movimento */
+	IMU_POWER_SLEEP,
+	NUM_IMU_POWER
+};
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+riic_ret_t IMU_power_set(IMU_dev_struct *dev, uint8_t state, uint8_t wake_rate);
+riic_ret_t IMU_power_poll(IMU_dev_struct *dev);
+bool IMU_power_ready(const IMU_dev_struct *dev);
+
+#endif /* _IMU_POWER_H_ */
@@ -0,0 +1,428 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdbool.h>
+#include <string.h>
+#include "platform.h"
+#include "IMU.h"
+#include "IMU_regmap.h"
+#include "r_riic_rx600.h"
+#include "r_riic_rx600_master.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_REG_INDEX(reg)					((reg) - IMU_REG_SHADOW_FIRST)
+#define IMU_REG_IS_DIRTY(map, i)			((map)->dirty[(i) >> 3] & (1 << ((i) & 7)))
+#define IMU_REG_MAX_GAP						2	/* registri puliti che conviene riscrivere per unire due burst */
+
+/*******************************************************************************
+Definizione strutture
+*******************************************************************************/
+/* Una configurazione IIC per ogni canale, inizializzata dal primo sensore che lo usa */
+static riic_config_t riic_master_config[RIIC_NUM_CHANNELS];
+static bool riic_channel_ready[RIIC_NUM_CHANNELS];
+
+/* Intervalli di registri scrivibili senza effetti collaterali sulla lettura dei dati */
+static const uint8_t IMU_reg_writable[][2] = {
+	{0x0D, 0x10},		/* SELF_TEST_X .. SELF_TEST_A */
+	{0x19, 0x1C},		/* SMPLRT_DIV .. ACCEL_CONFIG */
+	{0x1F, 0x34},		/* MOT_THR .. I2C_SLV4_CTRL */
+	{0x37, 0x38},		/* INT_PIN_CFG, INT_ENABLE */
+	{0x63, 0x6C}		/* I2C_SLV0_DO .. PWR_MGMT_2 */
+};
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static bool IMU_reg_is_writable (uint8_t reg);
+static uint8_t IMU_reg_self_clear (uint8_t reg);
+
+/*******************************************************************************
+* Nome funzione     : IMU_bus_init
+* Descrizione  	    : Inizializza il canale IIC, una sola volta anche se
+* 					  condiviso da piu' sensori
+* Argomenti         : (uint8_t) riic_channel -
+* 						 canale iic da inizializzare
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato dell'inizializzazione
+*******************************************************************************/
+riic_ret_t IMU_bus_init(uint8_t riic_channel)
+{
+	/* Definisce le variabili locali */
+	riic_config_t *cfg;
+	riic_ret_t ret;
+
+	if (riic_channel >= RIIC_NUM_CHANNELS) {
+		return RIIC_NO_CHANNEL;
+	}
+
+	if (riic_channel_ready[riic_channel]) {
+		return RIIC_OK;
+	}
+
+	cfg = &riic_master_config[riic_channel];
+	cfg->riic_channel        = riic_channel;
+	cfg->configuration       = RIIC_MASTER_CONFIG;
+	cfg->receive_queue_ptr   = 0;
+	cfg->receive_queue_size  = 0;
+	cfg->transmit_queue_ptr  = 0;
+	cfg->transmit_queue_size = 0;
+	cfg->self_slave_addr_lo  = MASTER_IIC_ADDRESS_LO;
+	cfg->self_slave_addr_hi  = MASTER_IIC_ADDRESS_HI;
+
+	ret = R_RIIC_Init(cfg);
+	if (RIIC_OK == ret) {
+		riic_channel_ready[riic_channel] = true;
+	}
+
+	return ret;
+
+} /* Fine IMU_bus_init() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_write
+* Descrizione  	    : Scrive un numero specifico di byte sull'IMU, ripetendo la
+* 					  transazione al massimo IMU_MAX_RETRY volte
+* Argomenti         : (IMU_dev_struct) *dev -
+* 					  	 handle del sensore (canale e indirizzo slave)
+* 					  (uint8_t) register_number -
+* 					  	 registro slave su cui scrive il master
+* 					  (uint8_t) *source_buff -
+* 					  	 puntatore al vettore da cui vengono copiati i dati
+* 					  	 da scrivere
+* 					  (uint32_t) num_byte -
+* 					     numero di byte da scrivere
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della comunicazione
+*******************************************************************************/
+riic_ret_t IMU_write (IMU_dev_struct *dev, uint8_t register_number, uint8_t *source_buff, uint32_t num_bytes)
+{
+	/* Definisce le variabili locali */
+    uint8_t   addr_and_register[2] = {dev->slave_address, register_number};
+    riic_ret_t  ret = RIIC_OK;
+    uint8_t   retry;
+
+    for (retry = 0; retry < IMU_MAX_RETRY; retry++)
+    {
+    	/* Il master trasmette indirizzo e numero di registro dello slave su cui vuole scrivere */
+    	ret = R_RIIC_MasterTransmitHead(dev->channel, addr_and_register, 2);
+
+    	/* Il master trasmette i dati presi dal source_buff sul registro */
+    	if (RIIC_OK == ret) {
+    		ret = R_RIIC_MasterTransmit(dev->channel, source_buff, num_bytes);
+    	}
+
+    	/* Controlla se si sono verificati errori */
+    	if (RIIC_OK == ret) {
+    		break;
+    	}
+    	dev->stats.write_errors++;
+    }
+
+    return ret;
+
+} /* Fine IMU_write() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_read
+* Descrizione  	    : Legge un numero specifico di byte dall'IMU, ripetendo la
+* 					  transazione al massimo IMU_MAX_RETRY volte
+* Argomenti         : (IMU_dev_struct) *dev -
+* 					  	 handle del sensore (canale e indirizzo slave)
+* 					  (uint8_t) register_number -
+* 					  	 registro slave da cui legge il master
+* 					  (uint8_t) *dest_buff -
+* 					  	 puntatore al vettore su cui vengono copiati i dati
+* 					  	 letti
+* 					  (uint32_t) num_byte -
+* 					  	 numero di byte da leggere
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della comunicazione
+*******************************************************************************/
+riic_ret_t IMU_read(IMU_dev_struct *dev, uint8_t register_number, uint8_t *dest_buff, uint32_t num_bytes)
+{
+	/* Definisce le variabili locali */
+	riic_ret_t  ret = RIIC_OK;
+	uint8_t     addr_and_register[2] = {dev->slave_address, register_number};
+	uint8_t     retry;
+
+	for (retry = 0; retry < IMU_MAX_RETRY; retry++)
+	{
+		/* Il master trasmette indirizzo e numero di registro dello slave da cui vuole leggere */
+		ret = R_RIIC_MasterTransmitHead(dev->channel, addr_and_register, 2);
+
+		/* Il master riceve i dati presi dal registro sul dest_buff  */
+		if (RIIC_OK == ret) {
+			ret = R_RIIC_MasterReceive(dev->channel, dev->slave_address, dest_buff, num_bytes);
+		}
+
+		/* Controlla se si sono verificati errori */
+		if (RIIC_OK == ret) {
+			break;
+		}
+		dev->stats.read_errors++;
+	}
+
+	return ret;
+
+} /* Fine IMU_read() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_reg_reset_shadow
+* Descrizione  	    : Riporta la copia locale ai valori di reset del sensore
+* 					  (tutti 0 tranne PWR_MGMT_1 = SLEEP). Va chiamata dopo
+* 					  ogni H_RESET
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_reg_reset_shadow(IMU_dev_struct *dev)
+{
+	memset(dev->regmap.shadow, 0, sizeof(dev->regmap.shadow));
+	memset(dev->regmap.dirty, 0, sizeof(dev->regmap.dirty));
+	dev->regmap.shadow[IMU_REG_INDEX(INV_MPU6050_REG_PWR_MGMT_1)] = INV_MPU6050_BIT_SLEEP;
+
+} /* Fine IMU_reg_reset_shadow() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_reg_load
+* Descrizione  	    : Rilegge dal sensore tutti i registri della copia locale
+* 					  con una sola transazione (per un sensore non resettato)
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della lettura
+*******************************************************************************/
+riic_ret_t IMU_reg_load(IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	riic_ret_t ret;
+
+	ret = IMU_read(dev, IMU_REG_SHADOW_FIRST, dev->regmap.shadow, IMU_REG_SHADOW_SIZE);
+	if (RIIC_OK == ret) {
+		memset(dev->regmap.dirty, 0, sizeof(dev->regmap.dirty));
+	}
+
+	return ret;
+
+} /* Fine IMU_reg_load() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_reg_get
+* Descrizione  	    : Restituisce il valore di un registro dalla copia locale,
+* 					  senza accedere al bus
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (uint8_t) reg -
+* 					  	 registro
+* Valori restituiti : (uint8_t) -
+* 						 valore del registro (0 se fuori dalla copia locale)
+*******************************************************************************/
+uint8_t IMU_reg_get(const IMU_dev_struct *dev, uint8_t reg)
+{
+	if ((reg < IMU_REG_SHADOW_FIRST) || (reg > IMU_REG_SHADOW_LAST)) {
+		return 0;
+	}
+
+	return dev->regmap.shadow[IMU_REG_INDEX(reg)];
+
+} /* Fine IMU_reg_get() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_reg_set
+* Descrizione  	    : Aggiorna un registro nella copia locale e lo segna da
+* 					  scrivere solo se il valore cambia. La scrittura avviene
+* 					  con IMU_reg_flush
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (uint8_t) reg -
+* 					  	 registro
+* 					  (uint8_t) value -
+* 					  	 nuovo valore
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_reg_set(IMU_dev_struct *dev, uint8_t reg, uint8_t value)
+{
+	/* Definisce le variabili locali */
+	uint8_t i;
+
+	if (!IMU_reg_is_writable(reg)) {
+		return;
+	}
+
+	i = IMU_REG_INDEX(reg);
+
+	/* I bit autoazzeranti (reset, avvio trasferimenti) vanno sempre riscritti */
+	if ((dev->regmap.shadow[i] != value) || (value & IMU_reg_self_clear(reg)))
+	{
+		dev->regmap.shadow[i] = value;
+		dev->regmap.dirty[i >> 3] |= (uint8_t)(1 << (i & 7));
+	}
+
+} /* Fine IMU_reg_set() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_reg_update_bits
+* Descrizione  	    : Read-modify-write di un registro servito dalla copia
+* 					  locale, senza letture sul bus
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (uint8_t) reg -
+* 					  	 registro
+* 					  (uint8_t) mask -
+* 					  	 bit da modificare
+* 					  (uint8_t) value -
+* 					  	 nuovo valore dei bit in mask
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_reg_update_bits(IMU_dev_struct *dev, uint8_t reg, uint8_t mask, uint8_t value)
+{
+	IMU_reg_set(dev, reg, (uint8_t)((IMU_reg_get(dev, reg) & ~mask) | (value & mask)));
+
+} /* Fine IMU_reg_update_bits() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_reg_write
+* Descrizione  	    : Aggiorna un registro e scrive subito tutti i registri
+* 					  in sospeso
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (uint8_t) reg -
+* 					  	 registro
+* 					  (uint8_t) value -
+* 					  	 nuovo valore
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della scrittura
+*******************************************************************************/
+riic_ret_t IMU_reg_write(IMU_dev_struct *dev, uint8_t reg, uint8_t value)
+{
+	IMU_reg_set(dev, reg, value);
+
+	return IMU_reg_flush(dev);
+
+} /* Fine IMU_reg_write() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_reg_flush
+* Descrizione  	    : Scrive i registri in sospeso. Registri sporchi contigui
+* 					  (o separati da al massimo IMU_REG_MAX_GAP registri
+* 					  scrivibili) vengono uniti in una sola scrittura con
+* 					  auto-incremento dell'indirizzo
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della prima scrittura fallita, RIIC_OK
+* 						 altrimenti (i registri non scritti restano sporchi)
+*******************************************************************************/
+riic_ret_t IMU_reg_flush(IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	IMU_regmap_struct *map = &dev->regmap;
+	riic_ret_t ret = RIIC_OK;
+	uint8_t start, end, next, i;
+	bool bridge;
+
+	for (start = 0; start < IMU_REG_SHADOW_SIZE; start++)
+	{
+		if (!IMU_REG_IS_DIRTY(map, start)) {
+			continue;
+		}
+
+		/* Estende il burst finche' il prossimo registro sporco e' abbastanza vicino
+		 e i registri intermedi si possono riscrivere con il valore della copia */
+		end = start;
+		for (next = start + 1; next < IMU_REG_SHADOW_SIZE; next++)
+		{
+			if (!IMU_REG_IS_DIRTY(map, next)) {
+				continue;
+			}
+			if ((next - end - 1) > IMU_REG_MAX_GAP) {
+				break;
+			}
+			bridge = true;
+			for (i = end + 1; i < next; i++)
+			{
+				if (!IMU_reg_is_writable(i + IMU_REG_SHADOW_FIRST)) {
+					bridge = false;
+				}
+			}
+			if (!bridge) {
+				break;
+			}
+			end = next;
+		}
+
+		/* Scrive start..end con una sola transazione */
+		ret = IMU_write(dev, start + IMU_REG_SHADOW_FIRST, &map->shadow[start], end - start + 1);
+		if (RIIC_OK != ret) {
+			return ret;
+		}
+		map->bursts++;
+
+		/* Pulisce i bit sporchi e, nella copia, i bit che il sensore azzera da solo */
+		for (i = start; i <= end; i++)
+		{
+			map->dirty[i >> 3] &= (uint8_t)~(1 << (i & 7));
+			map->shadow[i] &= (uint8_t)~IMU_reg_self_clear(i + IMU_REG_SHADOW_FIRST);
+		}
+
+		start = end;
+	}
+
+	return ret;
+
+} /* Fine IMU_reg_flush() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_reg_is_writable
+* Descrizione  	    : Indica se un registro fa parte della copia locale
+* Argomenti         : (uint8_t) reg -
+* 					  	 registro
+* Valori restituiti : (bool) -
+* 						 true se il registro e' scrivibile
+*******************************************************************************/
+static bool IMU_reg_is_writable(uint8_t reg)
+{
+	/* Definisce le variabili locali */
+	uint8_t i;
+
+	for (i = 0; i < sizeof(IMU_reg_writable) / sizeof(IMU_reg_writable[0]); i++)
+	{
+		if ((reg >= IMU_reg_writable[i][0]) && (reg <= IMU_reg_writable[i][1])) {
+			return true;
+		}
+	}
+
+	return false;
+
+} /* Fine IMU_reg_is_writable() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_reg_self_clear
+* Descrizione  	    : Restituisce i bit del registro che il sensore azzera
+* 					  da solo dopo la scrittura
+* Argomenti         : (uint8_t) reg -
+* 					  	 registro
+* Valori restituiti : (uint8_t) -
+* 						 maschera dei bit autoazzeranti
+*******************************************************************************/
+static uint8_t IMU_reg_self_clear(uint8_t reg)
+{
+	switch (reg)
+	{
+		case INV_MPU6050_REG_PWR_MGMT_1:
+			return INV_MPU6050_BIT_H_RESET;
+		case INV_MPU6050_REG_USER_CTRL:
+			return INV_MPU6050_BIT_DMP_RST | INV_MPU6050_BIT_FIFO_RST | INV_MPU6050_BIT_I2C_MST_RST | INV_MPU6050_BIT_SIG_COND_RST;
+		case INV_MPU6050_REG_SIGNAL_PATH_RESET:
+			return INV_MPU6050_BITS_PATH_RESET;
+		case INV_MPU6050_REG_I2C_SLV4_CTRL:
+			return INV_MPU6050_BIT_SLV_EN;
+		default:
+			return 0;
+	}
+
+} /* Fine IMU_reg_self_clear() */
@@ -0,0 +1,29 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _IMU_REGMAP_H_
+#define _IMU_REGMAP_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include "main.h"
+#include "r_riic_rx600.h"
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+/* Accesso diretto al bus */
+riic_ret_t IMU_bus_init(uint8_t riic_channel);
+riic_ret_t IMU_write(IMU_dev_struct *dev, uint8_t register_number, uint8_t *source_buff, uint32_t num_bytes);
+riic_ret_t IMU_read(IMU_dev_struct *dev, uint8_t register_number, uint8_t *dest_buff, uint32_t num_bytes);
+
+/* Copia locale dei registri con scritture differite */
+void IMU_reg_reset_shadow(IMU_dev_struct *dev);
+riic_ret_t IMU_reg_load(IMU_dev_struct *dev);
+uint8_t IMU_reg_get(const IMU_dev_struct *dev, uint8_t reg);
+void IMU_reg_set(IMU_dev_struct *dev, uint8_t reg, uint8_t value);
+void IMU_reg_update_bits(IMU_dev_struct *dev, uint8_t reg, uint8_t mask, uint8_t value);
+riic_ret_t IMU_reg_write(IMU_dev_struct *dev, uint8_t reg, uint8_t value);
+riic_ret_t IMU_reg_flush(IMU_dev_struct *dev);
+
+#endif /* _IMU_REGMAP_H_ */
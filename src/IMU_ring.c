@@ -0,0 +1,106 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "IMU_ring.h"
+
+/*******************************************************************************
+* Nome funzione     : IMU_ring_init
+* Descrizione  	    : Svuota la coda. Va chiamata prima di avviare produttore
+* 					  e consumatore
+* Argomenti         : (IMU_ring_struct) *ring -
+* 						 coda
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_ring_init(IMU_ring_struct *ring)
+{
+	ring->head = 0;
+	ring->tail = 0;
+	ring->overruns = 0;
+
+} /* Fine IMU_ring_init() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_ring_push
+* Descrizione  	    : Accoda un campione (solo il produttore). Il campione viene
+* 					  copiato prima di pubblicare il nuovo head, cosi' il
+* 					  consumatore non vede mai uno slot scritto a meta'.
+* 					  A coda piena il campione viene scartato: il produttore
+* 					  non puo' spostare tail
+* Argomenti         : (IMU_ring_struct) *ring -
+* 						 coda
+* 					  (IMU_sample_struct) *sample -
+* 					  	 campione da accodare
+* Valori restituiti : (bool) -
+* 						 false se la coda era piena
+*******************************************************************************/
+bool IMU_ring_push(IMU_ring_struct *ring, const IMU_sample_struct *sample)
+{
+	/* Definisce le variabili locali */
+	uint16_t head = ring->head;
+
+	if ((uint16_t)(head - ring->tail) >= IMU_RING_SIZE)
+	{
+		ring->overruns++;
+		return false;
+	}
+
+	ring->buf[head & IMU_RING_MASK] = *sample;
+	ring->head = head + 1;
+
+	return true;
+
+} /* Fine IMU_ring_push() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_ring_pop
+* Descrizione  	    : Estrae fino a max campioni, dal piu' vecchio (solo il
+* 					  consumatore). tail viene pubblicato una volta sola alla
+* 					  fine, dopo aver copiato tutti gli slot
+* Argomenti         : (IMU_ring_struct) *ring -
+* 						 coda
+* 					  (IMU_sample_struct) *out -
+* 					  	 vettore dei campioni estratti
+* 					  (uint16_t) max -
+* 					  	 dimensione di out
+* Valori restituiti : (uint16_t) n -
+* 						 campioni estratti
+*******************************************************************************/
+uint16_t IMU_ring_pop(IMU_ring_struct *ring, IMU_sample_struct *out, uint16_t max)
+{
+	/* Definisce le variabili locali */
+	uint16_t tail = ring->tail;
+	uint16_t n = (uint16_t)(ring->head - tail);
+	uint16_t i;
+
+	if (n > max) {
+		n = max;
+	}
+
+	for (i = 0; i < n; i++) {
+		out[i] = ring->buf[(uint16_t)(tail + i) & IMU_RING_MASK];
+	}
+
+	ring->tail = tail + n;
+
+	return n;
+
+} /* Fine IMU_ring_pop() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_ring_count
+* Descrizione  	    : Campioni in coda (valore indicativo se letto dal lato
+* 					  che non possiede l'indice che cambia)
+* Argomenti         : (IMU_ring_struct) *ring -
+* 						 coda
+* Valori restituiti : (uint16_t) -
+* 						 campioni in coda
+*******************************************************************************/
+uint16_t IMU_ring_count(const IMU_ring_struct *ring)
+{
+	return (uint16_t)(ring->head - ring->tail);
+
+} /* Fine IMU_ring_count() */
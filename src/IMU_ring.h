@@ -0,0 +1,58 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _IMU_RING_H_
+#define _IMU_RING_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "main.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_RING_SIZE						64		/* campioni per coda (potenza di 2, al massimo 32768) */
+#define IMU_RING_MASK						(IMU_RING_SIZE - 1)
+
+#if (IMU_RING_SIZE & IMU_RING_MASK) != 0
+#error "IMU_RING_SIZE deve essere una potenza di 2"
+#endif
+
+/*******************************************************************************
+Definizione strutture
+*******************************************************************************/
+/* Campione grezzo con l'istante di acquisizione */
+typedef struct
+{
+	uint32_t timestamp;				/* ms da CMT */
+	uint8_t  sensor;				/* indice del sensore */
+	IMU_raw_struct raw;
+
+} IMU_sample_struct;
+
+/* Coda a un produttore e un consumatore. head e' scritto solo dal produttore,
+   tail solo dal consumatore: gli indici corrono liberi a 16 bit e la
+   posizione e' indice & IMU_RING_MASK, quindi la coda contiene head - tail
+   campioni. Sull'RX la scrittura di un indice a 16 bit e' atomica e gli
+   accessi volatile non vengono riordinati, quindi non serve disabilitare gli
+   interrupt. Ogni consumatore ha la sua coda */
+typedef struct
+{
+	volatile uint16_t head;
+	volatile uint16_t tail;
+	volatile uint32_t overruns;		/* campioni scartati a coda piena (scritto dal produttore) */
+	volatile IMU_sample_struct buf[IMU_RING_SIZE];
+
+} IMU_ring_struct;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+void IMU_ring_init(IMU_ring_struct *ring);
+bool IMU_ring_push(IMU_ring_struct *ring, const IMU_sample_struct *sample);
+uint16_t IMU_ring_pop(IMU_ring_struct *ring, IMU_sample_struct *out, uint16_t max);
+uint16_t IMU_ring_count(const IMU_ring_struct *ring);
+
+#endif /* _IMU_RING_H_ */
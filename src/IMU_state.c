@@ -0,0 +1,78 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "IMU_state.h"
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+/* Assetto fuso, pubblicato da IMU_result */
+IMU_state_struct IMU_state;
+
+/*******************************************************************************
+* Nome funzione     : IMU_state_publish
+* Descrizione  	    : Pubblica un nuovo assetto (solo lo scrittore). Il
+* 					  contatore diventa dispari prima della copia e torna pari
+* 					  dopo; il campo seq dell'assetto riceve il numero della
+* 					  pubblicazione
+* Argomenti         : (IMU_state_struct) *state -
+* 						 stato condiviso
+* 					  (IMU_attitude_struct) *attitude -
+* 					  	 assetto da pubblicare
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_state_publish(IMU_state_struct *state, const IMU_attitude_struct *attitude)
+{
+	/* Definisce le variabili locali */
+	uint32_t seq = state->seq;
+
+	state->seq = seq + 1;
+
+	state->snap = *attitude;
+	state->snap.seq = (seq + 2) >> 1;
+
+	state->seq = seq + 2;
+
+} /* Fine IMU_state_publish() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_state_read
+* Descrizione  	    : Copia l'ultimo assetto pubblicato. Se lo scrittore lo
+* 					  aggiorna durante la copia (interrupt) la lettura viene
+* 					  ripetuta, al massimo IMU_STATE_MAX_RETRY volte
+* Argomenti         : (IMU_state_struct) *state -
+* 						 stato condiviso
+* 					  (IMU_attitude_struct) *attitude -
+* 					  	 copia coerente dell'assetto
+* Valori restituiti : (bool) -
+* 						 false se non e' stato possibile ottenere una copia
+* 						 coerente (attitude non e' valido)
+*******************************************************************************/
+bool IMU_state_read(const IMU_state_struct *state, IMU_attitude_struct *attitude)
+{
+	/* Definisce le variabili locali */
+	uint32_t before, after;
+	uint8_t retry;
+
+	for (retry = 0; retry < IMU_STATE_MAX_RETRY; retry++)
+	{
+		before = state->seq;
+		if (0 != (before & 1)) {
+			continue;
+		}
+
+		*attitude = state->snap;
+
+		after = state->seq;
+		if (before == after) {
+			return true;
+		}
+	}
+
+	return false;
+
+} /* Fine IMU_state_read() */
@@ -0,0 +1,53 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _IMU_STATE_H_
+#define _IMU_STATE_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_STATE_MAX_RETRY					8		/* tentativi di lettura prima di rinunciare */
+
+/*******************************************************************************
+Definizione strutture
+*******************************************************************************/
+/* Assetto pubblicato dallo stimatore */
+typedef struct
+{
+	uint32_t seq;					/* numero della pubblicazione */
+	uint32_t timestamp;				/* ms da CMT */
+	float angle[3];					/* rollio, beccheggio, imbardata (rad) */
+	float omega[3];					/* velocita' angolari (rad/s) */
+	uint8_t sensors;				/* sensori usati nella fusione */
+
+} IMU_attitude_struct;
+
+/* Ultimo assetto protetto da un contatore di sequenza (seqlock): dispari mentre
+   lo scrittore aggiorna la copia, pari quando e' stabile. Il lettore copia e
+   riprova se il contatore era dispari o e' cambiato durante la copia. Un solo
+   scrittore, lettori senza limite, nessun interrupt disabilitato */
+typedef struct
+{
+	volatile uint32_t seq;
+	volatile IMU_attitude_struct snap;
+
+} IMU_state_struct;
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+extern IMU_state_struct IMU_state;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+void IMU_state_publish(IMU_state_struct *state, const IMU_attitude_struct *attitude);
+bool IMU_state_read(const IMU_state_struct *state, IMU_attitude_struct *attitude);
+
+#endif /* _IMU_STATE_H_ */
@@ -0,0 +1,324 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Pulsanti SW1-SW3 senza attese attive. Gli interrupt dei pin (r_switches, su
+* entrambi i fronti) registrano solo l'istante dei fronti; il tick di CMT0
+* (1 ms) accetta il nuovo livello dopo IMU_SWITCH_DEBOUNCE_MS di quiete,
+* riconosce click, doppio click e pressione lunga e li mette in una piccola
+* coda che il ciclo principale svuota con IMU_switch_get nel punto che
+* preferisce, senza toccare i tempi dell'acquisizione. Ogni evento finisce
+* anche nel registro differito (IMU_LOG_SWITCH).
+*
+* Va inizializzato dopo R_SWITCHES_Init: i pulsanti tenuti premuti in quel
+* momento (scelte all'avvio) non producono eventi fino al rilascio.
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <machine.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "platform.h"
+#include "CMT.h"
+#include "IMU_log.h"
+#include "IMU_switch.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_SWITCH_PSW_I					0x00010000	/* bit I della PSW: interrupt abilitati */
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+IMU_switch_struct IMU_switch;
+
+/*******************************************************************************
+Prototipi funzioni locali
+*******************************************************************************/
+static bool IMU_switch_level(uint8_t sw);
+static void IMU_switch_edge(uint8_t sw);
+static void IMU_switch_push(uint8_t sw, uint8_t type, int32_t ms);
+
+/*******************************************************************************
+* Nome funzione     : IMU_switch_init
+* Descrizione  	    : Legge il livello attuale dei pulsanti, svuota la coda e
+* 					  avvia il riconoscimento degli eventi nel tick
+* Argomenti         : No
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_switch_init(void)
+{
+	/* Definisce le variabili locali */
+	IMU_switch_state_struct *s;
+	uint8_t i;
+
+	IMU_switch.running = false;
+
+	for (i = 0; i < NUM_IMU_SWITCHES; i++)
+	{
+		s = &IMU_switch.sw[i];
+		s->pending = false;
+		s->down = IMU_switch_level(i);
+		s->long_sent = s->down;
+		s->clicks = 0;
+		s->down_ms = get_ms();
+	}
+	IMU_switch.head = 0;
+	IMU_switch.tail = 0;
+	IMU_switch.drops = 0;
+
+	IMU_switch.running = true;
+
+} /* Fine IMU_switch_init() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_switch_get
+* Descrizione  	    : Estrae l'evento piu' vecchio (solo il ciclo principale)
+* Argomenti         : (IMU_switch_event_struct) *event -
+* 						 evento estratto
+* Valori restituiti : (bool) -
+* 						 false se la coda e' vuota
+*******************************************************************************/
+bool IMU_switch_get(IMU_switch_event_struct *event)
+{
+	/* Definisce le variabili locali */
+	uint8_t tail = IMU_switch.tail;
+	volatile IMU_switch_event_struct *e;
+
+	if (tail == IMU_switch.head) {
+		return false;
+	}
+
+	e = &IMU_switch.queue[tail & IMU_SWITCH_QUEUE_MASK];
+	event->sw = e->sw;
+	event->type = e->type;
+	event->ms = e->ms;
+	IMU_switch.tail = tail + 1;
+
+	return true;
+
+} /* Fine IMU_switch_get() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_switch_down
+* Descrizione  	    : Livello filtrato di un pulsante
+* Argomenti         : (uint8_t) sw -
+* 						 IMU_switch_e
+* Valori restituiti : (bool) -
+* 						 true se premuto
+*******************************************************************************/
+bool IMU_switch_down(uint8_t sw)
+{
+	return (sw < NUM_IMU_SWITCHES) && IMU_switch.sw[sw].down;
+
+} /* Fine IMU_switch_down() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_switch_tick
+* Descrizione  	    : Chiamata dall'interrupt di CMT0 ogni millisecondo
+* 					  (CMT_TICK_CALLBACK_FUNCTION). Senza fronti e senza click
+* 					  in attesa costa qualche confronto per pulsante
+* Argomenti         : No
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_switch_tick(void)
+{
+	/* Definisce le variabili locali */
+	IMU_switch_state_struct *s;
+	int32_t now, first_ms = 0;
+	uint32_t psw;
+	uint8_t i;
+	bool settled, level;
+
+	if (!IMU_switch.running) {
+		return;
+	}
+	now = get_ms();
+
+	for (i = 0; i < NUM_IMU_SWITCHES; i++)
+	{
+		s = &IMU_switch.sw[i];
+
+		/* Nessun fronte da IMU_SWITCH_DEBOUNCE_MS: il livello del pin e'
+		   quello buono, i rimbalzi che tornano al livello di prima non
+		   producono niente. Gli interrupt dei pin hanno priorita' piu' alta
+		   del tick: controllo e azzeramento di pending, con la lettura di
+		   first_ms, vanno fatti a interrupt mascherati, altrimenti un fronte
+		   arrivato in mezzo andrebbe perso */
+		psw = get_psw();
+		clrpsw_i();
+		settled = s->pending && (now - s->edge_ms >= IMU_SWITCH_DEBOUNCE_MS);
+		if (settled)
+		{
+			s->pending = false;
+			first_ms = s->first_ms;
+		}
+		if (psw & IMU_SWITCH_PSW_I) {
+			setpsw_i();
+		}
+
+		if (settled)
+		{
+			level = IMU_switch_level(i);
+
+			if (level && !s->down)
+			{
+				s->down = true;
+				s->down_ms = first_ms;
+				s->long_sent = false;
+			}
+			else if (!level && s->down)
+			{
+				s->down = false;
+				if (s->long_sent) {
+					/* Rilascio di una pressione lunga: gia' segnalata */
+				}
+				else if (s->clicks)
+				{
+					IMU_switch_push(i, IMU_SWITCH_DOUBLE, s->click_ms);
+					s->clicks = 0;
+				}
+				else
+				{
+					s->clicks = 1;
+					s->click_ms = s->down_ms;
+					s->up_ms = first_ms;
+				}
+			}
+		}
+
+		/* Pressione lunga, segnalata con il pulsante ancora premuto; un
+		   click in attesa esce prima come click singolo */
+		if (s->down && !s->long_sent && (now - s->down_ms >= IMU_SWITCH_LONG_MS))
+		{
+			if (s->clicks)
+			{
+				IMU_switch_push(i, IMU_SWITCH_PRESS, s->click_ms);
+				s->clicks = 0;
+			}
+			IMU_switch_push(i, IMU_SWITCH_LONG, s->down_ms);
+			s->long_sent = true;
+		}
+
+		/* Nessun secondo click in tempo: click singolo */
+		if (s->clicks && !s->down && !s->pending && (now - s->up_ms >= IMU_SWITCH_DOUBLE_MS))
+		{
+			IMU_switch_push(i, IMU_SWITCH_PRESS, s->click_ms);
+			s->clicks = 0;
+		}
+	}
+
+} /* Fine IMU_switch_tick() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_switch_sw1, IMU_switch_sw2, IMU_switch_sw3
+* Descrizione  	    : Chiamate dagli interrupt dei pin (SWn_CALLBACK_FUNCTION
+* 					  di r_switches_config.h) a ogni fronte
+* Argomenti         : No
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_switch_sw1(void)
+{
+	IMU_switch_edge(IMU_SW1);
+
+} /* Fine IMU_switch_sw1() */
+
+void IMU_switch_sw2(void)
+{
+	IMU_switch_edge(IMU_SW2);
+
+} /* Fine IMU_switch_sw2() */
+
+void IMU_switch_sw3(void)
+{
+	IMU_switch_edge(IMU_SW3);
+
+} /* Fine IMU_switch_sw3() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_switch_level
+* Descrizione  	    : Livello del pin di un pulsante, senza filtro
+* Argomenti         : (uint8_t) sw -
+* 						 IMU_switch_e
+* Valori restituiti : (bool) -
+* 						 true se premuto
+*******************************************************************************/
+static bool IMU_switch_level(uint8_t sw)
+{
+	switch (sw)
+	{
+		case IMU_SW1:
+			return SW_ACTIVE == SW1;
+
+		case IMU_SW2:
+			return SW_ACTIVE == SW2;
+
+		case IMU_SW3:
+			return SW_ACTIVE == SW3;
+
+		default:
+			return false;
+	}
+
+} /* Fine IMU_switch_level() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_switch_edge
+* Descrizione  	    : Registra un fronte: l'istante del primo della serie
+* 					  (inizio della pressione o del rilascio) e dell'ultimo
+* 					  (fine dei rimbalzi)
+* Argomenti         : (uint8_t) sw -
+* 						 IMU_switch_e
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_switch_edge(uint8_t sw)
+{
+	/* Definisce le variabili locali */
+	IMU_switch_state_struct *s = &IMU_switch.sw[sw];
+	int32_t now = get_ms();
+
+	if (!s->pending)
+	{
+		s->first_ms = now;
+		s->pending = true;
+	}
+	s->edge_ms = now;
+
+} /* Fine IMU_switch_edge() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_switch_push
+* Descrizione  	    : Accoda un evento (solo il tick). Lo slot viene scritto
+* 					  prima di pubblicare il nuovo head; a coda piena
+* 					  l'evento e' scartato e contato
+* Argomenti         : (uint8_t) sw -
+* 						 IMU_switch_e
+* 					  (uint8_t) type -
+* 					  	 IMU_switch_event_e
+* 					  (int32_t) ms -
+* 					  	 istante della pressione
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_switch_push(uint8_t sw, uint8_t type, int32_t ms)
+{
+	/* Definisce le variabili locali */
+	uint8_t head = IMU_switch.head;
+	volatile IMU_switch_event_struct *e;
+
+	IMU_LOG2(IMU_LOG_SWITCH, sw + 1, type);
+
+	if ((uint8_t)(head - IMU_switch.tail) >= IMU_SWITCH_QUEUE_SIZE)
+	{
+		IMU_switch.drops++;
+		return;
+	}
+
+	e = &IMU_switch.queue[head & IMU_SWITCH_QUEUE_MASK];
+	e->sw = sw;
+	e->type = type;
+	e->ms = ms;
+	IMU_switch.head = head + 1;
+
+} /* Fine IMU_switch_push() */
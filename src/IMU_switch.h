@@ -0,0 +1,106 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _IMU_SWITCH_H_
+#define _IMU_SWITCH_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_SWITCH_DEBOUNCE_MS				20		/* quiete dopo l'ultimo fronte prima di accettare il livello */
+#define IMU_SWITCH_LONG_MS					800		/* pressione lunga */
+#define IMU_SWITCH_DOUBLE_MS				300		/* attesa del secondo click dopo il rilascio */
+#define IMU_SWITCH_QUEUE_SIZE				8		/* eventi in coda (potenza di 2) */
+#define IMU_SWITCH_QUEUE_MASK				(IMU_SWITCH_QUEUE_SIZE - 1)
+
+#if (IMU_SWITCH_QUEUE_SIZE & IMU_SWITCH_QUEUE_MASK) != 0
+#error "IMU_SWITCH_QUEUE_SIZE deve essere una potenza di 2"
+#endif
+
+/*******************************************************************************
+Definizione enumerazioni
+*******************************************************************************/
+/* Pulsanti della scheda */
+enum IMU_switch_e {
+	IMU_SW1 = 0,
+	IMU_SW2,
+	IMU_SW3,
+	NUM_IMU_SWITCHES
+};
+
+/* Eventi. Un click breve diventa IMU_SWITCH_PRESS solo quando e' scaduta
+   l'attesa del secondo click; la pressione lunga e' segnalata appena
+   raggiunge IMU_SWITCH_LONG_MS, con il pulsante ancora premuto, e il suo
+   rilascio non produce altri eventi */
+enum IMU_switch_event_e {
+	IMU_SWITCH_NONE = 0,
+	IMU_SWITCH_PRESS,
+	IMU_SWITCH_LONG,
+	IMU_SWITCH_DOUBLE
+};
+
+/*******************************************************************************
+Definizione strutture
+*******************************************************************************/
+/* Evento in coda */
+typedef struct
+{
+	uint8_t sw;						/* IMU_switch_e */
+	uint8_t type;					/* IMU_switch_event_e */
+	int32_t ms;						/* istante del primo fronte della pressione */
+
+} IMU_switch_event_struct;
+
+/* Stato di un pulsante. edge_ms, first_ms e pending sono scritti
+   dall'interrupt del pin, il resto dal tick di CMT0: le due routine non si
+   interrompono a vicenda (nessun annidamento) */
+typedef struct
+{
+	volatile int32_t edge_ms;		/* ultimo fronte */
+	volatile int32_t first_ms;		/* primo fronte della serie di rimbalzi */
+	volatile bool    pending;		/* fronti non ancora risolti dal tick */
+	volatile bool down;				/* livello filtrato (letto anche da IMU_switch_down) */
+	bool    long_sent;				/* pressione corrente gia' segnalata come lunga */
+	uint8_t clicks;					/* click brevi in attesa del secondo */
+	int32_t down_ms;				/* inizio della pressione corrente */
+	int32_t click_ms;				/* inizio del click in attesa */
+	int32_t up_ms;					/* rilascio del click in attesa */
+
+} IMU_switch_state_struct;
+
+/* Pulsanti e coda degli eventi, a un produttore (tick di CMT0) e un
+   consumatore (ciclo principale): head e' scritto solo dal tick, tail solo
+   dal ciclo principale, quindi non serve disabilitare gli interrupt */
+typedef struct
+{
+	IMU_switch_state_struct sw[NUM_IMU_SWITCHES];
+	volatile IMU_switch_event_struct queue[IMU_SWITCH_QUEUE_SIZE];
+	volatile uint8_t  head;
+	volatile uint8_t  tail;
+	volatile uint16_t drops;		/* eventi scartati a coda piena */
+	volatile bool     running;
+
+} IMU_switch_struct;
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+extern IMU_switch_struct IMU_switch;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+void IMU_switch_init(void);
+bool IMU_switch_get(IMU_switch_event_struct *event);
+bool IMU_switch_down(uint8_t sw);
+void IMU_switch_tick(void);
+void IMU_switch_sw1(void);
+void IMU_switch_sw2(void);
+void IMU_switch_sw3(void);
+
+#endif /* _IMU_SWITCH_H_ */
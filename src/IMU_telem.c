@@ -0,0 +1,784 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Telemetria binaria su SCI2 (TXD2 su P50, connettore seriale della scheda) a
+* 1.5 Mbaud. Ogni frame contiene istante, campioni grezzi dei sensori, assetto
+* fuso e tempi del ciclo principale; e' protetto da un CRC-16 e codificato
+* COBS, quindi lo zero compare solo come delimitatore e il ricevitore si
+* risincronizza al primo zero dopo un errore. Il DMAC copia i byte nel TDR ad
+* ogni TXI: la CPU prepara il frame nel buffer libero e non attende la linea.
+*
+* Contenuto del frame (little-endian, prima del CRC):
+*   0  tipo (IMU_TELEM_STATE)         1  sensori usati nella fusione
+*   2  numero del frame (16 bit)      4  istante (ms, 32 bit)
+*   8  durata di IMU_result          10 periodo dal frame precedente
+*      (in unita' di CMT_counter, CMT_COUNTER_CYCLES cicli di CPU)
+*   12 per ogni sensore: accelerometro xyz, giroscopio xyz (int16, LSB)
+*   .. rollio, beccheggio, imbardata (rad), velocita' angolari (rad/s) (float)
+*   .. solo con IMU_USE_DMP, per ogni sensore: ritardo del quaternione (ms,
+*      16 bit, IMU_TELEM_DMP_INVALID senza quaternione valido) e rollio,
+*      beccheggio, imbardata del DMP (rad, float), per confrontarli con la
+*      fusione sull'MCU rieseguita sull'host (tools/imu_telemrec.c -r -m)
+*   .. CRC-16/CCITT-FALSE del contenuto
+* I campioni della scatola nera viaggiano in frame della stessa lunghezza, di
+* tipo IMU_TELEM_BBOX (IMU_telem_send_bbox). Tutti i campioni grezzi letti,
+* non solo l'ultimo di ogni ciclo, viaggiano compressi con IMU_pack in frame
+* a lunghezza variabile di tipo IMU_TELEM_SAMPLES (IMU_telem_send_samples).
+*
+* RXD2 (P52) riceve i comandi dell'host con lo stesso formato; l'interrupt
+* RXI2 accoda i byte e il ciclo principale ricompone i comandi
+* (IMU_telem_receive). Le risposte sono frame di tipo IMU_TELEM_PARAM.
+* I messaggi del registro differito (IMU_log) escono in frame di tipo
+* IMU_TELEM_LOG quando la linea non serve ad altro (IMU_telem_send_log)
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <machine.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "platform.h"
+#include "CMT.h"
+#include "IMU_state.h"
+#include "IMU_telem.h"
+#include "IMU_bbox.h"
+#include "IMU.h"
+#include "IMU_pack.h"
+#include "IMU_log.h"
+#include "IMU_mem.h"
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+IMU_telem_struct IMU_telem;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static void IMU_telem_queue (int8_t b, uint8_t *frame, uint16_t n);
+static void IMU_telem_start (int8_t b);
+static uint8_t *IMU_telem_put16 (uint8_t *p, uint16_t v);
+static uint8_t *IMU_telem_put32 (uint8_t *p, uint32_t v);
+static uint16_t IMU_telem_uncobs (const uint8_t *in, uint16_t n, uint8_t *out);
+
+/*******************************************************************************
+* Nome funzione     : IMU_telem_init
+* Descrizione  	    : Configura SCI2 in asincrono 8N1 (trasmissione e
+* 					  ricezione dei comandi) e il canale 0 del DMAC,
+* 					  attivato da TXI2, con il TDR come destinazione fissa.
+* 					  TE e TIE vengono accesi insieme: la richiesta TXI resta
+* 					  in attesa nell'ICU finche' il primo frame non abilita
+* 					  il DMAC. Registra la coda dei campioni grezzi da
+* 					  comprimere
+* Argomenti         : No
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_telem_init(void)
+{
+	memset(&IMU_telem, 0, sizeof(IMU_telem));
+	IMU_telem.sending = -1;
+	IMU_telem.pending = -1;
+	IMU_telem.last_count = CMT_counter();
+
+	IMU_ring_init(&IMU_telem.ring);
+	IMU_attach_ring(&IMU_telem.ring);
+	IMU_pack_init(&IMU_telem.pack, IMU_TELEM_SAMPLES_CHANNELS, IMU_NUM_SENSORS, IMU_PACK_KEY_INTERVAL);
+
+	SYSTEM.PRCR.WORD = 0xA50B;
+	MSTP(SCI2) = 0;
+	MSTP(DMAC) = 0;
+	SYSTEM.PRCR.WORD = 0xA500;
+
+	/* SCI2: P50 e' gia' un'uscita (hwsetup), P52 un ingresso; passano alla periferica */
+	SCI2.SCR.BYTE = 0x00;
+	MPC.P50PFS.BYTE = 0x0A;
+	MPC.P52PFS.BYTE = 0x0A;
+	PORT5.PMR.BIT.B0 = 1;
+	PORT5.PMR.BIT.B2 = 1;
+
+	/* Asincrono, 8 bit, nessuna parita', 1 stop, PCLK, 16 campioni per bit */
+	SCI2.SMR.BYTE = 0x00;
+	SCI2.SCMR.BYTE = 0xF2;
+	SCI2.SEMR.BYTE = 0x00;
+	SCI2.BRR = IMU_TELEM_BRR;
+	ms_delay(1);
+
+	/* DMAC0: modo normale, 8 bit, sorgente incrementata, interrupt a fine trasferimento */
+	DMAC0.DMCNT.BIT.DTE = 0;
+	ICU.DMRSR0.BYTE = VECT(SCI2, TXI2);
+	DMAC0.DMDAR = (uint32_t)&SCI2.TDR;
+	DMAC0.DMTMD.WORD = 0x0001;
+	DMAC0.DMAMD.WORD = 0x8000;
+	DMAC0.DMINT.BYTE = 0x10;
+	DMAC.DMAST.BIT.DMST = 1;
+
+	IPR(DMAC, DMAC0I) = 0x02;
+	IEN(DMAC, DMAC0I) = 1;
+
+	/* TXI2 va al DMAC (DMRSR0), ma deve essere abilitata nell'ICU */
+	IR(SCI2, TXI2) = 0;
+	IEN(SCI2, TXI2) = 1;
+
+	/* RXI2 accoda i byte ricevuti */
+	IPR(SCI2, RXI2) = 0x03;
+	IR(SCI2, RXI2) = 0;
+	IEN(SCI2, RXI2) = 1;
+
+	/* TIE, RIE, TE e RE con una sola scrittura */
+	SCI2.SCR.BYTE = 0xF0;
+	IMU_telem.rx_ready = true;
+
+} /* Fine IMU_telem_init() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_telem_send
+* Descrizione  	    : Prepara il frame di stato nel buffer libero e lo mette
+* 					  in uscita (subito se la linea e' libera, alla fine del
+* 					  frame in corso altrimenti). Con un frame gia' in attesa
+* 					  il nuovo viene scartato e contato in drops: il ciclo
+* 					  principale non si ferma mai per la telemetria
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 vettore degli handle dei sensori
+* 					  (uint8_t) num_dev -
+* 					  	 numero di sensori (al massimo IMU_NUM_SENSORS)
+* 					  (uint16_t) work -
+* 					  	 durata dell'elaborazione (unita' di CMT_counter)
+* Valori restituiti : (bool) -
+* 						 false se il frame e' stato scartato
+*******************************************************************************/
+bool IMU_telem_send(const IMU_dev_struct *dev, uint8_t num_dev, uint16_t work)
+{
+	/* Definisce le variabili locali */
+	IMU_telem_struct *t = &IMU_telem;
+	uint8_t *frame, *p;
+	IMU_attitude_struct att;
+	uint16_t now = CMT_counter();
+	int8_t b;
+	uint8_t i, k;
+
+	/* Il numero avanza anche per i frame scartati: il ricevitore vede il buco */
+	frame = (t->pending >= 0) ? 0 : (uint8_t *)IMU_pool_alloc(&IMU_mem_frames);
+	if (0 == frame)
+	{
+		t->seq++;
+		t->drops++;
+		return false;
+	}
+	b = (0 == t->sending) ? 1 : 0;
+	p = frame;
+
+	if (!IMU_state_read(&IMU_state, &att)) {
+		memset(&att, 0, sizeof(att));
+	}
+
+	*p++ = IMU_TELEM_STATE;
+	*p++ = att.sensors;
+	p = IMU_telem_put16(p, t->seq++);
+	p = IMU_telem_put32(p, att.timestamp);
+	p = IMU_telem_put16(p, work);
+	p = IMU_telem_put16(p, (uint16_t)(now - t->last_count));
+	t->last_count = now;
+
+	for (i = 0; i < IMU_NUM_SENSORS; i++)
+	{
+		for (k = 0; k < 3; k++) {
+			p = IMU_telem_put16(p, (i < num_dev) ? (uint16_t)dev[i].raw.accel[k] : 0);
+		}
+		for (k = 0; k < 3; k++) {
+			p = IMU_telem_put16(p, (i < num_dev) ? (uint16_t)dev[i].raw.gyro[k] : 0);
+		}
+	}
+
+	/* I float dell'RX sono gia' IEEE 754 little-endian */
+	memcpy(p, att.angle, sizeof(att.angle));
+	p += sizeof(att.angle);
+	memcpy(p, att.omega, sizeof(att.omega));
+	p += sizeof(att.omega);
+
+#if IMU_USE_DMP
+	for (i = 0; i < IMU_NUM_SENSORS; i++)
+	{
+		if ((i < num_dev) && dev[i].dmp.enabled && dev[i].dmp.valid)
+		{
+			p = IMU_telem_put16(p, dev[i].dmp.latency_ms);
+			memcpy(p, dev[i].dmp.angle, sizeof(dev[i].dmp.angle));
+		}
+		else
+		{
+			p = IMU_telem_put16(p, IMU_TELEM_DMP_INVALID);
+			memset(p, 0, sizeof(dev[i].dmp.angle));
+		}
+		p += sizeof(dev[i].dmp.angle);
+	}
+#endif
+
+	IMU_telem_queue(b, frame, IMU_TELEM_PAYLOAD);
+	IMU_pool_free(&IMU_mem_frames, frame);
+
+	return true;
+
+} /* Fine IMU_telem_send() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_telem_send_bbox
+* Descrizione  	    : Invia un campione di una registrazione della scatola
+* 					  nera (IMU_bbox_dump), con le stesse regole dei frame di
+* 					  stato. Contenuto del frame:
+* 					    0  tipo (IMU_TELEM_BBOX)    1  causa della registrazione
+* 					    2  numero del frame         4  progressivo della registrazione
+* 					    8  indice del campione     10  campioni registrati
+* 					    12 campione (IMU_bbox_record_struct), poi zeri
+* Argomenti         : (IMU_bbox_header_struct) *h -
+* 						 intestazione della registrazione
+* 					  (uint16_t) index -
+* 					  	 indice del campione
+* 					  (IMU_bbox_record_struct) *r -
+* 					  	 campione
+* Valori restituiti : (bool) -
+* 						 false se il frame e' stato scartato
+*******************************************************************************/
+bool IMU_telem_send_bbox(const IMU_bbox_header_struct *h, uint16_t index, const IMU_bbox_record_struct *r)
+{
+	/* Definisce le variabili locali */
+	IMU_telem_struct *t = &IMU_telem;
+	uint8_t *frame, *p;
+	int8_t b;
+
+	frame = (t->pending >= 0) ? 0 : (uint8_t *)IMU_pool_alloc(&IMU_mem_frames);
+	if (0 == frame)
+	{
+		t->seq++;
+		t->drops++;
+		return false;
+	}
+	b = (0 == t->sending) ? 1 : 0;
+	p = frame;
+
+	memset(frame, 0, IMU_TELEM_MAX_FRAME);
+	*p++ = IMU_TELEM_BBOX;
+	*p++ = h->trigger;
+	p = IMU_telem_put16(p, t->seq++);
+	p = IMU_telem_put32(p, h->number);
+	p = IMU_telem_put16(p, index);
+	p = IMU_telem_put16(p, h->count);
+
+	/* Il campione e' gia' little-endian e senza riempimenti */
+	memcpy(p, r, sizeof(*r));
+
+	IMU_telem_queue(b, frame, IMU_TELEM_PAYLOAD);
+	IMU_pool_free(&IMU_mem_frames, frame);
+
+	return true;
+
+} /* Fine IMU_telem_send_bbox() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_telem_send_samples
+* Descrizione  	    : Comprime i campioni grezzi in coda e li invia. Con la
+* 					  linea occupata non fa nulla: i campioni restano nella
+* 					  coda e il codificatore non avanza, quindi ogni frame
+* 					  compresso viene trasmesso. Un frame contiene al piu'
+* 					  IMU_TELEM_SAMPLES_DATA byte, percio' il costo per
+* 					  chiamata e' limitato. Contenuto del frame:
+* 					    0  tipo (IMU_TELEM_SAMPLES)  1  campioni nel frame
+* 					    2  numero del frame          4  numero del frame dei campioni
+* 					    6  campioni (IMU_pack_encode, flusso = sensore,
+* 					       canali: accelerometro xyz, temperatura, giroscopio xyz)
+* Argomenti         : No
+* Valori restituiti : (bool) -
+* 						 true se e' stato messo in uscita un frame
+*******************************************************************************/
+bool IMU_telem_send_samples(void)
+{
+	/* Definisce le variabili locali */
+	IMU_telem_struct *t = &IMU_telem;
+	uint8_t *frame, *p;
+	IMU_sample_struct sample;
+	uint8_t entries = 0;
+	int8_t b;
+
+	if ((t->pending >= 0) || (0 == IMU_ring_count(&t->ring))) {
+		return false;
+	}
+	frame = (uint8_t *)IMU_pool_alloc(&IMU_mem_frames);
+	if (0 == frame) {
+		return false;
+	}
+	b = (0 == t->sending) ? 1 : 0;
+	p = frame + IMU_TELEM_SAMPLES_HEADER;
+
+	/* I primi 7 campi di IMU_raw_struct sono contigui: accelerometro, temperatura, giroscopio */
+	while ((p + IMU_PACK_MAX_ENTRY(IMU_TELEM_SAMPLES_CHANNELS) <= frame + IMU_TELEM_SAMPLES_PAYLOAD) &&
+		   (entries < 0xFF) && (1 == IMU_ring_pop(&t->ring, &sample, 1)))
+	{
+		p += IMU_pack_encode(&t->pack, sample.sensor, sample.timestamp, sample.raw.accel, p);
+		entries++;
+	}
+
+	frame[0] = IMU_TELEM_SAMPLES;
+	frame[1] = entries;
+	IMU_telem_put16(&frame[2], t->seq++);
+	IMU_telem_put16(&frame[4], t->samples_seq++);
+	t->samples += entries;
+	t->packed_bytes += (uint32_t)(p - frame - IMU_TELEM_SAMPLES_HEADER);
+
+	IMU_telem_queue(b, frame, (uint16_t)(p - frame));
+	IMU_pool_free(&IMU_mem_frames, frame);
+
+	return true;
+
+} /* Fine IMU_telem_send_samples() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_telem_send_param
+* Descrizione  	    : Risposta a un comando (IMU_param), con le stesse regole
+* 					  dei frame di stato. Contenuto del frame:
+* 					    0  tipo (IMU_TELEM_PARAM)    1  esito
+* 					    2  numero del frame          4  etichetta del comando
+* 					    5  parametro                 6  sensore
+* 					    7  tipo del valore           8  valore (32 bit)
+* Argomenti         : (uint8_t) tag -
+* 						 etichetta scelta dall'host
+* 					  (uint8_t) status -
+* 					  	 esito (IMU_param_status_e)
+* 					  (uint8_t) id -
+* 					  	 parametro
+* 					  (uint8_t) sensor -
+* 					  	 sensore
+* 					  (uint8_t) type -
+* 					  	 tipo del valore (IMU_param_type_e)
+* 					  (uint32_t) value -
+* 					  	 valore attuale: intero o bit di un float
+* Valori restituiti : (bool) -
+* 						 false se la linea e' occupata (la risposta non e'
+* 						 consumata: va ripetuta)
+*******************************************************************************/
+bool IMU_telem_send_param(uint8_t tag, uint8_t status, uint8_t id, uint8_t sensor, uint8_t type, uint32_t value)
+{
+	/* Definisce le variabili locali */
+	IMU_telem_struct *t = &IMU_telem;
+	uint8_t *frame, *p;
+	int8_t b;
+
+	frame = (t->pending >= 0) ? 0 : (uint8_t *)IMU_pool_alloc(&IMU_mem_frames);
+	if (0 == frame) {
+		return false;
+	}
+	b = (0 == t->sending) ? 1 : 0;
+	p = frame;
+
+	*p++ = IMU_TELEM_PARAM;
+	*p++ = status;
+	p = IMU_telem_put16(p, t->seq++);
+	*p++ = tag;
+	*p++ = id;
+	*p++ = sensor;
+	*p++ = type;
+	IMU_telem_put32(p, value);
+
+	IMU_telem_queue(b, frame, IMU_TELEM_PARAM_PAYLOAD);
+	IMU_pool_free(&IMU_mem_frames, frame);
+
+	return true;
+
+} /* Fine IMU_telem_send_param() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_telem_send_log
+* Descrizione  	    : Svuota il registro in un frame, se la linea e' libera e
+* 					  ci sono messaggi. Contenuto del frame:
+* 					    0  tipo (IMU_TELEM_LOG)      1  parole di messaggi
+* 					    2  numero del frame          4  messaggi scartati (32 bit)
+* 					    8  messaggi (parole a 32 bit, formato in IMU_log.c)
+* Argomenti         : No
+* Valori restituiti : (bool) -
+* 						 true se e' stato accodato un frame
+*******************************************************************************/
+bool IMU_telem_send_log(void)
+{
+	/* Definisce le variabili locali */
+	IMU_telem_struct *t = &IMU_telem;
+	uint8_t *frame, *p;
+	uint32_t *words;
+	uint16_t n, k;
+	int8_t b;
+
+	if ((t->pending >= 0) || (IMU_log.tail == IMU_log.head)) {
+		return false;
+	}
+
+	/* Con un pool vuoto i messaggi restano nel registro */
+	frame = (uint8_t *)IMU_pool_alloc(&IMU_mem_frames);
+	words = (uint32_t *)IMU_pool_alloc(&IMU_mem_batches);
+	n = ((0 != frame) && (0 != words)) ? IMU_log_pop(words, IMU_TELEM_LOG_WORDS) : 0;
+	if (0 == n)
+	{
+		IMU_pool_free(&IMU_mem_batches, words);
+		IMU_pool_free(&IMU_mem_frames, frame);
+		return false;
+	}
+	b = (0 == t->sending) ? 1 : 0;
+	p = frame;
+
+	*p++ = IMU_TELEM_LOG;
+	*p++ = (uint8_t)n;
+	p = IMU_telem_put16(p, t->seq++);
+	p = IMU_telem_put32(p, IMU_log.drops);
+	for (k = 0; k < n; k++) {
+		p = IMU_telem_put32(p, words[k]);
+	}
+	IMU_pool_free(&IMU_mem_batches, words);
+
+	IMU_telem_queue(b, frame, (uint16_t)(p - frame));
+	IMU_pool_free(&IMU_mem_frames, frame);
+
+	return true;
+
+} /* Fine IMU_telem_send_log() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_telem_rx
+* Descrizione  	    : Accoda un byte ricevuto (dall'interrupt RXI2). A coda
+* 					  piena il byte e' perso: il comando viene scartato dal
+* 					  controllo del CRC
+* Argomenti         : (uint8_t) c -
+* 						 byte ricevuto
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_telem_rx(uint8_t c)
+{
+	/* Definisce le variabili locali */
+	IMU_telem_struct *t = &IMU_telem;
+	uint16_t head = t->rx_head;
+
+	if ((uint16_t)(head - t->rx_tail) >= IMU_TELEM_RX_SIZE)
+	{
+		t->rx_overruns++;
+		IMU_LOG1(IMU_LOG_RX_OVERRUN, t->rx_overruns);
+		return;
+	}
+
+	t->rx[head & IMU_TELEM_RX_MASK] = c;
+	t->rx_head = head + 1;
+
+} /* Fine IMU_telem_rx() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_telem_receive
+* Descrizione  	    : Consuma i byte ricevuti fino al primo comando completo
+* 					  (delimitato dallo zero) con CRC corretto. Un errore
+* 					  della SCI (overrun, framing, parita') ferma la
+* 					  ricezione: viene azzerato qui e il comando in corso e'
+* 					  perso
+* Argomenti         : (uint8_t) *cmd -
+* 						 contenuto del comando, almeno IMU_TELEM_CMD_MAX byte
+* Valori restituiti : (uint16_t) -
+* 						 lunghezza del contenuto (0: nessun comando)
+*******************************************************************************/
+uint16_t IMU_telem_receive(uint8_t *cmd)
+{
+	/* Definisce le variabili locali */
+	IMU_telem_struct *t = &IMU_telem;
+	uint8_t *dec;
+	uint16_t n;
+	uint8_t c;
+
+	/* ORER, FER e PER si azzerano scrivendo 0 (i bit 7 e 6 si scrivono a 1) */
+	if (t->rx_ready && (0 != (SCI2.SSR.BYTE & 0x38)))
+	{
+		SCI2.SSR.BYTE = 0xC0;
+		t->rx_overruns++;
+		t->cmd_overflow = true;
+	}
+
+	/* Senza un blocco libero i byte restano in coda fino alla prossima chiamata */
+	if (t->rx_tail == t->rx_head) {
+		return 0;
+	}
+	dec = (uint8_t *)IMU_pool_alloc(&IMU_mem_cmds);
+	if (0 == dec) {
+		return 0;
+	}
+
+	while (t->rx_tail != t->rx_head)
+	{
+		c = t->rx[t->rx_tail & IMU_TELEM_RX_MASK];
+		t->rx_tail++;
+
+		if (0 != c)
+		{
+			if (t->cmd_len < IMU_TELEM_CMD_ENCODED) {
+				t->cmd[t->cmd_len++] = c;
+			}
+			else {
+				t->cmd_overflow = true;
+			}
+			continue;
+		}
+
+		/* Delimitatore: zeri consecutivi non sono un comando */
+		if ((0 == t->cmd_len) && !t->cmd_overflow) {
+			continue;
+		}
+		n = t->cmd_overflow ? 0 : IMU_telem_uncobs(t->cmd, t->cmd_len, dec);
+		t->cmd_len = 0;
+		t->cmd_overflow = false;
+
+		if ((n < 3) ||
+			(IMU_telem_crc16(dec, n - 2, IMU_TELEM_CRC_INIT) != (uint16_t)(dec[n - 2] | (dec[n - 1] << 8))))
+		{
+			t->rx_errors++;
+			continue;
+		}
+
+		memcpy(cmd, dec, n - 2);
+		IMU_pool_free(&IMU_mem_cmds, dec);
+		t->commands++;
+		return n - 2;
+	}
+	IMU_pool_free(&IMU_mem_cmds, dec);
+
+	return 0;
+
+} /* Fine IMU_telem_receive() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_telem_crc16
+* Descrizione  	    : CRC-16/CCITT (polinomio 0x1021, non riflesso) senza
+* 					  tabella: la divisione di un byte si riduce a tre
+* 					  scorrimenti e quattro XOR
+* Argomenti         : (uint8_t) *data -
+* 						 dati
+* 					  (uint16_t) n -
+* 					  	 numero di byte
+* 					  (uint16_t) crc -
+* 					  	 valore iniziale (IMU_TELEM_CRC_INIT) o CRC parziale
+* Valori restituiti : (uint16_t) -
+* 						 CRC aggiornato
+*******************************************************************************/
+uint16_t IMU_telem_crc16(const uint8_t *data, uint16_t n, uint16_t crc)
+{
+	/* Definisce le variabili locali */
+	uint16_t x;
+
+	while (n--)
+	{
+		x = (uint8_t)((crc >> 8) ^ *data++);
+		x ^= x >> 4;
+		crc = (uint16_t)((crc << 8) ^ (x << 12) ^ (x << 5) ^ x);
+	}
+
+	return crc;
+
+} /* Fine IMU_telem_crc16() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_telem_cobs
+* Descrizione  	    : Codifica COBS: ogni gruppo di al piu' 254 byte non nulli
+* 					  e' preceduto dalla distanza dal prossimo zero, che viene
+* 					  tolto. Il risultato non contiene zeri ed e' lungo al
+* 					  piu' n + n / 254 + 1 byte (delimitatore escluso)
+* Argomenti         : (uint8_t) *in -
+* 						 dati
+* 					  (uint16_t) n -
+* 					  	 numero di byte
+* 					  (uint8_t) *out -
+* 					  	 dati codificati
+* Valori restituiti : (uint16_t) -
+* 						 lunghezza codificata
+*******************************************************************************/
+uint16_t IMU_telem_cobs(const uint8_t *in, uint16_t n, uint8_t *out)
+{
+	/* Definisce le variabili locali */
+	uint8_t *code = out;
+	uint8_t *q = out + 1;
+	uint8_t run = 1;
+
+	while (n--)
+	{
+		if (0 != *in)
+		{
+			*q++ = *in;
+			run++;
+		}
+		if ((0 == *in) || (0xFF == run))
+		{
+			*code = run;
+			code = q++;
+			run = 1;
+		}
+		in++;
+	}
+	*code = run;
+
+	return (uint16_t)(q - out);
+
+} /* Fine IMU_telem_cobs() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_telem_uncobs
+* Descrizione  	    : Inverso di IMU_telem_cobs (delimitatore escluso)
+* Argomenti         : (uint8_t) *in -
+* 						 dati codificati
+* 					  (uint16_t) n -
+* 					  	 numero di byte
+* 					  (uint8_t) *out -
+* 					  	 dati decodificati (al piu' n - 1 byte)
+* Valori restituiti : (uint16_t) -
+* 						 lunghezza decodificata (0 se malformato)
+*******************************************************************************/
+static uint16_t IMU_telem_uncobs(const uint8_t *in, uint16_t n, uint8_t *out)
+{
+	/* Definisce le variabili locali */
+	uint16_t i = 0, o = 0;
+	uint8_t code, k;
+
+	while (i < n)
+	{
+		code = in[i++];
+		if ((0 == code) || (i + code - 1 > n)) {
+			return 0;
+		}
+		for (k = 1; k < code; k++) {
+			out[o++] = in[i++];
+		}
+		/* Lo zero implicito manca dopo l'ultimo gruppo e dopo un gruppo pieno */
+		if ((0xFF != code) && (i < n)) {
+			out[o++] = 0;
+		}
+	}
+
+	return o;
+
+} /* Fine IMU_telem_uncobs() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_telem_queue
+* Descrizione  	    : Completa il frame con il CRC, lo codifica nel buffer e
+* 					  lo mette in uscita
+* Argomenti         : (int8_t) b -
+* 						 indice del buffer libero
+* 					  (uint8_t) *frame -
+* 					  	 frame, con 2 byte liberi dopo il contenuto per il CRC
+* 					  (uint16_t) n -
+* 					  	 lunghezza del contenuto
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_telem_queue(int8_t b, uint8_t *frame, uint16_t n)
+{
+	/* Definisce le variabili locali */
+	IMU_telem_struct *t = &IMU_telem;
+	uint16_t crc;
+
+	crc = IMU_telem_crc16(frame, n, IMU_TELEM_CRC_INIT);
+	IMU_telem_put16(&frame[n], crc);
+
+	t->len[b] = IMU_telem_cobs(frame, n + 2, t->buf[b]);
+	t->buf[b][t->len[b]++] = 0x00;
+	t->frames++;
+
+	/* La linea si libera nell'interrupt: controllo e accodamento senza interruzioni */
+	clrpsw_i();
+	if (t->sending < 0) {
+		IMU_telem_start(b);
+	}
+	else {
+		t->pending = b;
+	}
+	setpsw_i();
+
+} /* Fine IMU_telem_queue() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_telem_start
+* Descrizione  	    : Avvia il DMAC su un buffer. Se la richiesta TXI e' gia'
+* 					  in attesa (TDR vuoto) il primo byte parte subito,
+* 					  altrimenti al TXI dell'ultimo byte del frame precedente
+* Argomenti         : (int8_t) b -
+* 						 indice del buffer
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_telem_start(int8_t b)
+{
+	IMU_telem.sending = b;
+
+	DMAC0.DMSAR = (uint32_t)IMU_telem.buf[b];
+	DMAC0.DMCRA = IMU_telem.len[b];
+	DMAC0.DMCNT.BIT.DTE = 1;
+
+} /* Fine IMU_telem_start() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_telem_dmac_isr
+* Descrizione  	    : Fine del trasferimento: l'ultimo byte e' nel TDR. Passa
+* 					  al buffer in attesa, se c'e'
+* Argomenti         : No
+* Valori restituiti : No
+*******************************************************************************/
+#pragma interrupt (IMU_telem_dmac_isr(vect = VECT(DMAC, DMAC0I)))
+static void IMU_telem_dmac_isr(void)
+{
+	DMAC0.DMSTS.BIT.DTIF = 0;
+
+	if (IMU_telem.pending >= 0)
+	{
+		IMU_telem_start(IMU_telem.pending);
+		IMU_telem.pending = -1;
+	}
+	else {
+		IMU_telem.sending = -1;
+	}
+
+} /* Fine IMU_telem_dmac_isr() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_telem_rxi_isr
+* Descrizione  	    : Byte ricevuto su RXD2
+* Argomenti         : No
+* Valori restituiti : No
+*******************************************************************************/
+#pragma interrupt (IMU_telem_rxi_isr(vect = VECT(SCI2, RXI2)))
+static void IMU_telem_rxi_isr(void)
+{
+	IMU_telem_rx(SCI2.RDR);
+
+} /* Fine IMU_telem_rxi_isr() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_telem_put16
+* Descrizione  	    : Scrive un valore a 16 bit little-endian
+* Argomenti         : (uint8_t) *p -
+* 						 destinazione
+* 					  (uint16_t) v -
+* 					  	 valore
+* Valori restituiti : (uint8_t) * -
+* 						 posizione successiva
+*******************************************************************************/
+static uint8_t *IMU_telem_put16(uint8_t *p, uint16_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+
+	return p + 2;
+
+} /* Fine IMU_telem_put16() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_telem_put32
+* Descrizione  	    : Scrive un valore a 32 bit little-endian
+* Argomenti         : (uint8_t) *p -
+* 						 destinazione
+* 					  (uint32_t) v -
+* 					  	 valore
+* Valori restituiti : (uint8_t) * -
+* 						 posizione successiva
+*******************************************************************************/
+static uint8_t *IMU_telem_put32(uint8_t *p, uint32_t v)
+{
+	p = IMU_telem_put16(p, (uint16_t)v);
+
+	return IMU_telem_put16(p, (uint16_t)(v >> 16));
+
+} /* Fine IMU_telem_put32() */
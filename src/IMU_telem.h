@@ -0,0 +1,156 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _IMU_TELEM_H_
+#define _IMU_TELEM_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "main.h"
+#include "IMU_bbox.h"
+#include "IMU_ring.h"
+#include "IMU_pack.h"
+#include "IMU_log.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_TELEM_BAUD						1500000	/* PCLK / 32: divisore esatto, BRR = 0 */
+#define IMU_TELEM_BRR						(PCLK_HZ / (32 * IMU_TELEM_BAUD) - 1)
+
+/* Frame di stato: intestazione, campioni grezzi, assetto, assetto del DMP
+   (solo con IMU_USE_DMP), CRC */
+#define IMU_TELEM_HEADER					12
+#if IMU_USE_DMP
+#define IMU_TELEM_DMP_BYTES					(IMU_NUM_SENSORS * (2 + 3 * 4))
+#else
+#define IMU_TELEM_DMP_BYTES					0
+#endif
+#define IMU_TELEM_DMP_INVALID				0xFFFF	/* ritardo di un sensore senza quaternione valido */
+#define IMU_TELEM_PAYLOAD					(IMU_TELEM_HEADER + IMU_NUM_SENSORS * 12 + 6 * 4 + IMU_TELEM_DMP_BYTES)
+#define IMU_TELEM_FRAME						(IMU_TELEM_PAYLOAD + 2)
+
+/* Frame dei campioni compressi: intestazione e campioni di IMU_pack, a
+   lunghezza variabile. Ogni campione ha i 7 canali di IMU_raw_struct fino al
+   giroscopio, un flusso per sensore */
+#define IMU_TELEM_SAMPLES_HEADER			6
+#define IMU_TELEM_SAMPLES_CHANNELS			7
+#define IMU_TELEM_SAMPLES_DATA				192		/* byte di campioni compressi per frame */
+#define IMU_TELEM_SAMPLES_PAYLOAD			(IMU_TELEM_SAMPLES_HEADER + IMU_TELEM_SAMPLES_DATA)
+
+#if IMU_TELEM_SAMPLES_PAYLOAD > IMU_TELEM_PAYLOAD
+#define IMU_TELEM_MAX_PAYLOAD				IMU_TELEM_SAMPLES_PAYLOAD
+#else
+#define IMU_TELEM_MAX_PAYLOAD				IMU_TELEM_PAYLOAD
+#endif
+#define IMU_TELEM_MAX_FRAME					(IMU_TELEM_MAX_PAYLOAD + 2)
+#define IMU_TELEM_ENCODED					(IMU_TELEM_MAX_FRAME + IMU_TELEM_MAX_FRAME / 254 + 2)	/* COBS e delimitatore */
+
+/* Frame di risposta ai comandi (IMU_telem_send_param) */
+#define IMU_TELEM_PARAM_PAYLOAD				12
+
+/* Frame del registro (IMU_telem_send_log): intestazione e messaggi interi */
+#define IMU_TELEM_LOG_HEADER				8
+#define IMU_TELEM_LOG_WORDS					32		/* parole di messaggi per frame */
+#define IMU_TELEM_LOG_PAYLOAD				(IMU_TELEM_LOG_HEADER + 4 * IMU_TELEM_LOG_WORDS)
+
+#if IMU_TELEM_LOG_PAYLOAD > IMU_TELEM_MAX_PAYLOAD
+#error "frame del registro piu' lungo del buffer"
+#endif
+#if IMU_TELEM_LOG_WORDS < IMU_LOG_MAX_RECORD
+#error "frame troppo corto per un messaggio del registro"
+#endif
+
+/* Comandi in arrivo su RXD2, con lo stesso formato (CRC e COBS) */
+#define IMU_TELEM_RX_SIZE					128		/* byte ricevuti in attesa (potenza di 2) */
+#define IMU_TELEM_RX_MASK					(IMU_TELEM_RX_SIZE - 1)
+#define IMU_TELEM_CMD_MAX					16		/* contenuto massimo di un comando */
+#define IMU_TELEM_CMD_ENCODED				(IMU_TELEM_CMD_MAX + 2 + 1)	/* CRC e COBS, senza delimitatore */
+
+#if (IMU_TELEM_RX_SIZE & IMU_TELEM_RX_MASK) != 0
+#error "IMU_TELEM_RX_SIZE deve essere una potenza di 2"
+#endif
+
+#if IMU_TELEM_SAMPLES_DATA < IMU_PACK_MAX_ENTRY(IMU_TELEM_SAMPLES_CHANNELS)
+#error "frame troppo corto per un campione compresso"
+#endif
+#if IMU_NUM_SENSORS > IMU_PACK_MAX_STREAMS
+#error "IMU_PACK_MAX_STREAMS insufficiente per i sensori"
+#endif
+
+#if IMU_TELEM_PAYLOAD < IMU_TELEM_HEADER + IMU_FLASH_BLOCK
+#error "frame troppo corto per un campione della scatola nera"
+#endif
+
+#define IMU_TELEM_CRC_INIT					0xFFFF	/* CRC-16/CCITT-FALSE */
+
+/*******************************************************************************
+Definizione enumerazioni
+*******************************************************************************/
+/* Tipo di frame (primo byte del contenuto) */
+enum IMU_telem_type_e {
+	IMU_TELEM_STATE = 1,
+	IMU_TELEM_BBOX,							/* campione della scatola nera */
+	IMU_TELEM_SAMPLES,						/* campioni grezzi compressi */
+	IMU_TELEM_PARAM,						/* risposta a un comando (IMU_param) */
+	IMU_TELEM_LOG,							/* messaggi del registro (IMU_log) */
+	NUM_IMU_TELEM
+};
+
+/*******************************************************************************
+Definizione strutture
+*******************************************************************************/
+/* Trasmissione a doppio buffer: uno e' in uscita con il DMAC mentre l'altro
+   viene preparato. sending e' l'indice del buffer in uscita (-1 se la linea
+   e' libera), pending quello pronto ad essere trasmesso (-1 se nessuno); li
+   modificano sia il ciclo principale sia l'interrupt di fine trasferimento */
+typedef struct
+{
+	uint8_t  buf[2][IMU_TELEM_ENCODED];
+	uint16_t len[2];
+	volatile int8_t sending;
+	volatile int8_t pending;
+	uint16_t seq;
+	uint16_t last_count;					/* CMT_counter() all'ultimo frame */
+	uint32_t frames;
+	uint32_t drops;							/* frame scartati con entrambi i buffer occupati */
+	IMU_ring_struct ring;					/* campioni grezzi da IMU_publish_sample */
+	IMU_pack_struct pack;
+	uint16_t samples_seq;					/* frame dei campioni: un buco impone la risincronizzazione */
+	uint32_t samples;						/* campioni inviati */
+	uint32_t packed_bytes;					/* byte compressi inviati */
+	bool     rx_ready;						/* SCI2 in ricezione (IMU_telem_init) */
+	uint8_t  rx[IMU_TELEM_RX_SIZE];			/* byte ricevuti: head scritto dall'interrupt RXI2, tail dal ciclo principale */
+	volatile uint16_t rx_head;
+	volatile uint16_t rx_tail;
+	uint8_t  cmd[IMU_TELEM_CMD_ENCODED];	/* comando codificato in arrivo */
+	uint8_t  cmd_len;
+	bool     cmd_overflow;					/* comando troppo lungo, scartato fino al delimitatore */
+	volatile uint32_t rx_overruns;			/* byte persi: coda piena o errore della SCI */
+	uint32_t rx_errors;						/* comandi scartati (lunghezza, COBS, CRC) */
+	uint32_t commands;
+
+} IMU_telem_struct;
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+extern IMU_telem_struct IMU_telem;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+void IMU_telem_init(void);
+bool IMU_telem_send(const IMU_dev_struct *dev, uint8_t num_dev, uint16_t work);
+bool IMU_telem_send_bbox(const IMU_bbox_header_struct *h, uint16_t index, const IMU_bbox_record_struct *r);
+bool IMU_telem_send_samples(void);
+bool IMU_telem_send_param(uint8_t tag, uint8_t status, uint8_t id, uint8_t sensor, uint8_t type, uint32_t value);
+bool IMU_telem_send_log(void);
+void IMU_telem_rx(uint8_t c);
+uint16_t IMU_telem_receive(uint8_t *cmd);
+uint16_t IMU_telem_crc16(const uint8_t *data, uint16_t n, uint16_t crc);
+uint16_t IMU_telem_cobs(const uint8_t *in, uint16_t n, uint8_t *out);
+
+#endif /* _IMU_TELEM_H_ */
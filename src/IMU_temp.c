@@ -0,0 +1,126 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdbool.h>
+#include <string.h>
+#include "platform.h"
+#include "IMU.h"
+#include "IMU_temp.h"
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static float IMU_temp_poly (const float *c, float dt);
+
+/*******************************************************************************
+* Nome funzione     : IMU_temp_set_model
+* Descrizione  	    : Carica il modello del bias in temperatura e lo valuta una
+* 					  volta per tutte ad ogni grado tra IMU_TEMP_LUT_MIN e
+* 					  IMU_TEMP_LUT_MAX. Va chiamata prima di IMU_init, cosi'
+* 					  anche la calibrazione iniziale e' compensata
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (IMU_tempmodel_struct) *model -
+* 					  	 coefficienti (0 per disattivare la compensazione)
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_temp_set_model(IMU_dev_struct *dev, const IMU_tempmodel_struct *model)
+{
+	/* Definisce le variabili locali */
+	IMU_tempcomp_struct *tc = &dev->tempcomp;
+	float dt;
+	uint8_t i, k;
+
+	memset(tc, 0, sizeof(*tc));
+
+	if (0 == model) {
+		return;
+	}
+
+	tc->model = *model;
+	for (i = 0; i < IMU_TEMP_LUT_SIZE; i++)
+	{
+		dt = (float)(IMU_TEMP_LUT_MIN + i) - model->ref_temp;
+		for (k = 0; k < 3; k++)
+		{
+			tc->lut[i][k]     = IMU_temp_poly(model->gyro[k], dt);
+			tc->lut[i][k + 3] = IMU_temp_poly(model->accel[k], dt);
+		}
+	}
+	tc->enabled = true;
+
+} /* Fine IMU_temp_set_model() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_temp_update
+* Descrizione  	    : Converte la temperatura dell'ultimo campione e ricava il
+* 					  bias di ogni asse per interpolazione lineare nella tabella
+* 					  (fuori dall'intervallo usa il valore all'estremo)
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_temp_update(IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	IMU_tempcomp_struct *tc = &dev->tempcomp;
+	const float *lo, *hi;
+	float pos, frac;
+	uint8_t i, k;
+
+	/* T = (raw + 12421) / 340 gradi C, cioe' raw/340 + 36.53 */
+	tc->temperature = ((float)dev->raw.temp + INV_MPU6050_TEMP_OFFSET) * (INV_MPU6050_TEMP_SCALE * 1.0e-6f);
+
+	if (!tc->enabled) {
+		return;
+	}
+
+	/* Posizione nella tabella, limitata agli estremi */
+	pos = tc->temperature - IMU_TEMP_LUT_MIN;
+	if (pos < 0.0f) {
+		pos = 0.0f;
+	}
+	if (pos > (float)(IMU_TEMP_LUT_SIZE - 1)) {
+		pos = (float)(IMU_TEMP_LUT_SIZE - 1);
+	}
+	i = (uint8_t)pos;
+	if (i == IMU_TEMP_LUT_SIZE - 1) {
+		i--;
+	}
+	frac = pos - (float)i;
+
+	lo = tc->lut[i];
+	hi = tc->lut[i + 1];
+	for (k = 0; k < 6; k++)
+	{
+		tc->bias[k] = lo[k] + frac * (hi[k] - lo[k]);
+	}
+
+} /* Fine IMU_temp_update() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_temp_poly
+* Descrizione  	    : Valuta il polinomio del modello con lo schema di Horner
+* Argomenti         : (float) *c -
+* 						 coefficienti, dal grado 0 al grado IMU_TEMP_POLY_ORDER
+* 					  (float) dt -
+* 					  	 distanza dalla temperatura di riferimento
+* Valori restituiti : (float) -
+* 						 valore del polinomio
+*******************************************************************************/
+static float IMU_temp_poly(const float *c, float dt)
+{
+	/* Definisce le variabili locali */
+	float y = 0.0f;
+	int8_t n;
+
+	for (n = IMU_TEMP_POLY_ORDER; n >= 0; n--)
+	{
+		y = y * dt + c[n];
+	}
+
+	return y;
+
+} /* Fine IMU_temp_poly() */
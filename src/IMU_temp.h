@@ -0,0 +1,17 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _IMU_TEMP_H_
+#define _IMU_TEMP_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include "main.h"
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+void IMU_temp_set_model(IMU_dev_struct *dev, const IMU_tempmodel_struct *model);
+void IMU_temp_update(IMU_dev_struct *dev);
+
+#endif /* _IMU_TEMP_H_ */
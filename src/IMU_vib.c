@@ -0,0 +1,449 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Analizzatore di vibrazioni per la messa a punto dei filtri. Con la
+* decimazione attiva acquisisce IMU_FFT_SIZE campioni consecutivi dalla FIFO
+* alla frequenza interna del sensore (1 kHz), ne calcola lo spettro per ogni
+* asse e riporta i picchi principali e il valore efficace per banda. Dai picchi
+* sopra la banda del controllo ricava i centri dei notch e il filtro interno
+* (DLPF) da impostare. L'acquisizione dura IMU_FFT_SIZE / fs e nel frattempo i
+* sensori non vengono letti: e' una modalita' di diagnosi, da usare con i
+* motori in moto ma senza il controllo in funzione
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <mathf.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "platform.h"
+#include "CMT.h"
+#include "IMU.h"
+#include "IMU_decim.h"
+#include "IMU_fft.h"
+#include "IMU_filter.h"
+#include "IMU_regmap.h"
+#include "IMU_vib.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_VIB_TIMEOUT_FACTOR				2		/* durata massima dell'acquisizione, in multipli di quella attesa */
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+/* Bordi delle bande (Hz): la prima e' quella del controllo, la continua e i
+   primi bin, dove cade la dispersione della finestra, sono esclusi */
+const float IMU_vib_band_hz[IMU_VIB_BANDS + 1] = {2.0f, IMU_VIB_CTRL_HZ, 50.0f, 100.0f, 200.0f, 500.0f};
+
+/* Banda dei filtri interni del sensore, per indice INV_MPU6050_FILTER_* */
+static const float IMU_vib_dlpf_hz[] = {256.0f, 188.0f, 98.0f, 42.0f, 20.0f};
+
+/* Campioni grezzi per asse (accelerometro xyz, giroscopio xyz) e spettro */
+static int16_t IMU_vib_buf[IMU_FILTER_CHANNELS][IMU_FFT_SIZE];
+static float IMU_vib_work[IMU_FFT_SIZE];
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static void IMU_vib_peaks (const float *p, float df, float scale, float *hz, float *amp);
+static void IMU_vib_suggest (IMU_vib_result_struct *r);
+
+/*******************************************************************************
+* Nome funzione     : IMU_vib_capture
+* Descrizione  	    : Acquisisce IMU_FFT_SIZE campioni consecutivi dalla FIFO.
+* 					  Se la FIFO trabocca la sequenza si interrompe e
+* 					  l'acquisizione riparte da capo, entro lo stesso tempo
+* 					  massimo complessivo. Al termine la
+* 					  decimazione viene riavviata, con FIFO e filtro vuoti
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato della comunicazione, RIIC_MODE_ERR senza
+* 						 decimazione, RIIC_RDRF_TMO se i campioni contigui non
+* 						 arrivano in tempo
+*******************************************************************************/
+riic_ret_t IMU_vib_capture(IMU_dev_struct *dev)
+{
+	/* Definisce le variabili locali */
+	uint8_t data[IMU_DECIM_BURST_FRAMES * IMU_DECIM_MAX_FRAME];
+	const uint8_t *f;
+	uint32_t overflows;
+	int32_t start, timeout;
+	uint16_t frames, n, i;
+	uint8_t c;
+	riic_ret_t ret;
+
+	if (!dev->decim.enabled) {
+		return RIIC_MODE_ERR;
+	}
+
+	timeout = IMU_VIB_TIMEOUT_FACTOR * IMU_FFT_SIZE * INV_MPU6050_ONE_K_HZ /
+			  ((int32_t)dev->config.rate_hz * dev->decim.factor);
+
+	ret = IMU_decim_start(dev);
+	if (RIIC_OK != ret) {
+		return ret;
+	}
+
+	start = get_ms();
+	overflows = dev->decim.overflows;
+	n = 0;
+	while (n < IMU_FFT_SIZE)
+	{
+		/* Il limite vale per ogni giro, anche per le ripartenze dopo una
+		   FIFO traboccata: con un bus lento non si arriverebbe mai in fondo */
+		if (get_ms() - start > timeout) {
+			return RIIC_RDRF_TMO;
+		}
+
+		ret = IMU_decim_fifo_frames(dev, &frames);
+		if (RIIC_OK != ret) {
+			return ret;
+		}
+
+		/* Campioni persi: la sequenza non e' piu' contigua */
+		if (overflows != dev->decim.overflows)
+		{
+			overflows = dev->decim.overflows;
+			n = 0;
+			continue;
+		}
+
+		if (0 == frames) {
+			continue;
+		}
+
+		if (frames > IMU_DECIM_BURST_FRAMES) {
+			frames = IMU_DECIM_BURST_FRAMES;
+		}
+		if (frames > IMU_FFT_SIZE - n) {
+			frames = IMU_FFT_SIZE - n;
+		}
+
+		ret = IMU_read(dev, INV_MPU6050_REG_FIFO_R_W, data, frames * dev->decim.frame);
+		if (RIIC_OK != ret) {
+			return ret;
+		}
+
+		/* Accelerometro ai byte 0-5, temperatura 6-7, giroscopio 8-13 */
+		for (i = 0, f = data; i < frames; i++, n++, f += dev->decim.frame)
+		{
+			for (c = 0; c < 3; c++)
+			{
+				IMU_vib_buf[c][n] = (int16_t)(((uint16_t)f[2 * c] << 8) | f[2 * c + 1]);
+				IMU_vib_buf[3 + c][n] = (int16_t)(((uint16_t)f[8 + 2 * c] << 8) | f[9 + 2 * c]);
+			}
+		}
+	}
+
+	return IMU_decim_start(dev);
+
+} /* Fine IMU_vib_capture() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_vib_analyze
+* Descrizione  	    : Spettro dei campioni acquisiti: per ogni asse toglie la
+* 					  media, applica la finestra di Hann e calcola la potenza
+* 					  per bin. Una sinusoide di ampiezza A nel bin k da'
+* 					  |X[k]| = A N / 4; la potenza di una banda e'
+* 					  2 sum |X[k]|^2 / (N sum w^2), con sum w^2 = 3 N / 8
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore (scale dei campioni)
+* 					  (IMU_vib_result_struct) *r -
+* 					  	 risultato
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_vib_analyze(IMU_dev_struct *dev, IMU_vib_result_struct *r)
+{
+	/* Definisce le variabili locali */
+	float *x = IMU_vib_work;
+	float df, scale, mean, sum;
+	uint32_t cycles = 0;
+	uint16_t n, k, lo, hi;
+	uint16_t t0;
+	uint8_t c, b;
+
+	memset(r, 0, sizeof(*r));
+	r->fs = (float)dev->config.rate_hz * dev->decim.factor;
+	df = r->fs / IMU_FFT_SIZE;
+
+	for (c = 0; c < IMU_FILTER_CHANNELS; c++)
+	{
+		scale = (c < 3) ? dev->accel_scale : dev->gyro_scale;
+
+		for (n = 0, sum = 0.0f; n < IMU_FFT_SIZE; n++) {
+			sum += (float)IMU_vib_buf[c][n];
+		}
+		mean = sum / IMU_FFT_SIZE;
+		for (n = 0; n < IMU_FFT_SIZE; n++) {
+			x[n] = (float)IMU_vib_buf[c][n] - mean;
+		}
+
+		t0 = CMT_counter();
+		IMU_fft_hann(x);
+		IMU_fft_real(x);
+		IMU_fft_power(x);
+		cycles += (uint16_t)(CMT_counter() - t0);
+
+		/* Valore efficace per banda */
+		for (b = 0; b < IMU_VIB_BANDS; b++)
+		{
+			lo = (uint16_t)ceilf(IMU_vib_band_hz[b] / df);
+			hi = (uint16_t)ceilf(IMU_vib_band_hz[b + 1] / df);
+			if (hi > IMU_FFT_BINS) {
+				hi = IMU_FFT_BINS;
+			}
+			for (k = lo, sum = 0.0f; k < hi; k++) {
+				sum += x[k];
+			}
+			r->band_rms[c][b] = sqrtf(16.0f * sum / (3.0f * IMU_FFT_SIZE * IMU_FFT_SIZE)) * scale;
+		}
+
+		IMU_vib_peaks(x, df, scale, r->peak_hz[c], r->peak_amp[c]);
+	}
+
+	r->fft_cycles = cycles * CMT_COUNTER_CYCLES / IMU_FILTER_CHANNELS;
+
+	IMU_vib_suggest(r);
+
+} /* Fine IMU_vib_analyze() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_vib_run
+* Descrizione  	    : Acquisizione e analisi
+* Argomenti         : (IMU_dev_struct) *dev -
+* 						 handle del sensore
+* 					  (IMU_vib_result_struct) *r -
+* 					  	 risultato
+* Valori restituiti : (riic_ret_t) ret -
+* 						 risultato dell'acquisizione
+*******************************************************************************/
+riic_ret_t IMU_vib_run(IMU_dev_struct *dev, IMU_vib_result_struct *r)
+{
+	/* Definisce le variabili locali */
+	riic_ret_t ret;
+
+	CMT_counter_init();
+
+	ret = IMU_vib_capture(dev);
+	if (RIIC_OK != ret) {
+		return ret;
+	}
+
+	IMU_vib_analyze(dev, r);
+
+	return RIIC_OK;
+
+} /* Fine IMU_vib_run() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_vib_show
+* Descrizione  	    : Stampa sul display il picco principale di ogni asse del
+* 					  giroscopio e dell'asse piu' disturbato dell'accelerometro,
+* 					  il valore efficace delle vibrazioni del giroscopio sopra
+* 					  la banda del controllo, i filtri suggeriti e il tempo di
+* 					  calcolo della FFT
+* Argomenti         : (IMU_vib_result_struct) *r -
+* 						 risultato
+* Valori restituiti : No
+*******************************************************************************/
+void IMU_vib_show(const IMU_vib_result_struct *r)
+{
+	/* Definisce le variabili locali */
+	static const char axis[3] = {'X', 'Y', 'Z'};
+	static const uint8_t line[3] = {LCD_LINE2, LCD_LINE3, LCD_LINE4};
+	uint8_t lcd_buffer[13];
+	uint32_t kc = r->fft_cycles / 1000;
+	float ms = 0.0f;
+	uint8_t c, b, a = 0;
+
+	sprintf((char *)lcd_buffer, "FFT %5lukc", (unsigned long)((kc > 99999) ? 99999 : kc));
+	lcd_display(LCD_LINE1, lcd_buffer);
+
+	for (c = 0; c < 3; c++)
+	{
+		sprintf((char *)lcd_buffer, "g%c%4.0fHz%4.1f", axis[c], r->peak_hz[3 + c][0],
+				(r->peak_amp[3 + c][0] < 99.9f) ? r->peak_amp[3 + c][0] : 99.9f);
+		lcd_display(line[c], lcd_buffer);
+
+		if (r->peak_amp[c][0] > r->peak_amp[a][0]) {
+			a = c;
+		}
+		for (b = 1; b < IMU_VIB_BANDS; b++) {
+			ms += r->band_rms[3 + c][b] * r->band_rms[3 + c][b];
+		}
+	}
+
+	sprintf((char *)lcd_buffer, "a%c%4.0fHz%4.2f", axis[a], r->peak_hz[a][0],
+			(r->peak_amp[a][0] < 9.99f) ? r->peak_amp[a][0] : 9.99f);
+	lcd_display(LCD_LINE5, lcd_buffer);
+
+	sprintf((char *)lcd_buffer, "Grms %5.2f", sqrtf(ms));
+	lcd_display(LCD_LINE6, lcd_buffer);
+
+	sprintf((char *)lcd_buffer, "DLPF %3.0fHz", IMU_vib_dlpf_hz[r->dlpf]);
+	lcd_display(LCD_LINE7, lcd_buffer);
+
+	sprintf((char *)lcd_buffer, "N %4.0f %4.0f", r->notch_hz[0], r->notch_hz[1]);
+	lcd_display(LCD_LINE8, lcd_buffer);
+
+} /* Fine IMU_vib_show() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_vib_peaks
+* Descrizione  	    : I IMU_VIB_PEAKS massimi locali piu' alti dello spettro
+* 					  sopra la prima banda, con frequenza interpolata da una
+* 					  parabola sulle ampiezze dei tre bin intorno al massimo
+* Argomenti         : (float) *p -
+* 						 potenza per bin
+* 					  (float) df -
+* 					  	 larghezza di un bin (Hz)
+* 					  (float) scale -
+* 					  	 unita' fisiche per LSB
+* 					  (float) *hz -
+* 					  	 frequenze dei picchi
+* 					  (float) *amp -
+* 					  	 ampiezze dei picchi
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_vib_peaks(const float *p, float df, float scale, float *hz, float *amp)
+{
+	/* Definisce le variabili locali */
+	float best[IMU_VIB_PEAKS] = {0.0f};
+	float ym, y0, yp, den, d;
+	uint16_t k, lo;
+	uint8_t i, j;
+
+	lo = (uint16_t)ceilf(IMU_vib_band_hz[0] / df);
+	if (lo < 1) {
+		lo = 1;
+	}
+
+	for (k = lo; k < IMU_FFT_BINS - 1; k++)
+	{
+		if ((p[k] <= p[k - 1]) || (p[k] < p[k + 1]) || (p[k] <= best[IMU_VIB_PEAKS - 1])) {
+			continue;
+		}
+
+		/* Inserimento ordinato */
+		for (i = IMU_VIB_PEAKS - 1; (i > 0) && (p[k] > best[i - 1]); i--)
+		{
+			best[i] = best[i - 1];
+			hz[i] = hz[i - 1];
+			amp[i] = amp[i - 1];
+		}
+
+		ym = sqrtf(p[k - 1]);
+		y0 = sqrtf(p[k]);
+		yp = sqrtf(p[k + 1]);
+		den = ym - 2.0f * y0 + yp;
+		d = (den < 0.0f) ? 0.5f * (ym - yp) / den : 0.0f;
+
+		best[i] = p[k];
+		hz[i] = ((float)k + d) * df;
+		amp[i] = 4.0f * y0 / IMU_FFT_SIZE * scale;
+	}
+
+	for (j = 0; j < IMU_VIB_PEAKS; j++)
+	{
+		if (0.0f == best[j])
+		{
+			hz[j] = 0.0f;
+			amp[j] = 0.0f;
+		}
+	}
+
+} /* Fine IMU_vib_peaks() */
+
+/*******************************************************************************
+* Nome funzione     : IMU_vib_suggest
+* Descrizione  	    : Filtri suggeriti. I picchi significativi sopra la banda
+* 					  del controllo, pesati con la soglia del proprio sensore,
+* 					  vanno ai notch a partire dal piu' forte, purche' sotto
+* 					  il limite di IMU_filter_set_notch alla frequenza del
+* 					  filtro software (quella della FIFO, fs dell'analisi);
+* 					  il primo picco rimasto fuori dai notch fissa il DLPF, con banda non
+* 					  oltre meta' della sua frequenza ma non sotto quella del
+* 					  controllo. Senza picchi residui il sensore resta senza
+* 					  DLPF e il filtro software fa il resto
+* Argomenti         : (IMU_vib_result_struct) *r -
+* 						 risultato
+* Valori restituiti : No
+*******************************************************************************/
+static void IMU_vib_suggest(IMU_vib_result_struct *r)
+{
+	/* Definisce le variabili locali */
+	float score, best, low = 0.0f, f;
+	float notch_max = IMU_FILTER_NYQUIST_MARGIN * r->fs;
+	bool used[IMU_FILTER_CHANNELS][IMU_VIB_PEAKS];
+	uint8_t c, p, n, bc = 0, bp = 0, d;
+
+	/* Picchi significativi */
+	for (c = 0; c < IMU_FILTER_CHANNELS; c++)
+	{
+		for (p = 0; p < IMU_VIB_PEAKS; p++) {
+			used[c][p] = (r->peak_hz[c][p] < IMU_VIB_CTRL_HZ) ||
+						 (r->peak_amp[c][p] < ((c < 3) ? IMU_VIB_ACCEL_MIN : IMU_VIB_GYRO_MIN));
+		}
+	}
+
+	/* Notch sui picchi piu' forti, uno per gruppo di frequenze vicine */
+	for (n = 0; n < IMU_FILTER_MAX_NOTCH; n++)
+	{
+		best = 0.0f;
+		for (c = 0; c < IMU_FILTER_CHANNELS; c++)
+		{
+			for (p = 0; p < IMU_VIB_PEAKS; p++)
+			{
+				/* I picchi oltre il limite del notch restano al DLPF */
+				score = r->peak_amp[c][p] / ((c < 3) ? IMU_VIB_ACCEL_MIN : IMU_VIB_GYRO_MIN);
+				if (!used[c][p] && (r->peak_hz[c][p] < notch_max) && (score > best))
+				{
+					best = score;
+					bc = c;
+					bp = p;
+				}
+			}
+		}
+		if (0.0f == best) {
+			break;
+		}
+
+		f = r->peak_hz[bc][bp];
+		r->notch_hz[n] = f;
+		for (c = 0; c < IMU_FILTER_CHANNELS; c++)
+		{
+			for (p = 0; p < IMU_VIB_PEAKS; p++) {
+				used[c][p] |= (fabsf(r->peak_hz[c][p] - f) < IMU_VIB_NOTCH_SEP);
+			}
+		}
+	}
+
+	/* Picco residuo piu' basso */
+	for (c = 0; c < IMU_FILTER_CHANNELS; c++)
+	{
+		for (p = 0; p < IMU_VIB_PEAKS; p++)
+		{
+			if (!used[c][p] && ((0.0f == low) || (r->peak_hz[c][p] < low))) {
+				low = r->peak_hz[c][p];
+			}
+		}
+	}
+
+	r->dlpf = INV_MPU6050_FILTER_256HZ_NODLPF;
+	if (low > 0.0f)
+	{
+		for (d = INV_MPU6050_FILTER_188HZ; d < INV_MPU6050_FILTER_20HZ; d++)
+		{
+			if (2.0f * IMU_vib_dlpf_hz[d] <= low) {
+				break;
+			}
+		}
+		r->dlpf = d;
+	}
+
+} /* Fine IMU_vib_suggest() */
@@ -0,0 +1,52 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _IMU_VIB_H_
+#define _IMU_VIB_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdint.h>
+#include "main.h"
+#include "r_riic_rx600.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_VIB_PEAKS						3		/* picchi riportati per asse */
+#define IMU_VIB_BANDS						5		/* bande di IMU_vib_band_hz */
+#define IMU_VIB_CTRL_HZ						20.0f	/* sotto: moto del robot, non vibrazione */
+#define IMU_VIB_ACCEL_MIN					0.02f	/* ampiezza minima di un picco significativo (g) */
+#define IMU_VIB_GYRO_MIN					0.5f	/* ampiezza minima di un picco significativo (grad/s) */
+#define IMU_VIB_NOTCH_SEP					5.0f	/* picchi piu' vicini (Hz) cadono nello stesso notch */
+
+/*******************************************************************************
+Definizione strutture
+*******************************************************************************/
+/* Risultato di un'analisi: gli assi sono accelerometro xyz (g) e giroscopio
+   xyz (grad/s), i picchi in ordine di ampiezza decrescente (0 Hz se assenti) */
+typedef struct
+{
+	float fs;										/* frequenza dei campioni acquisiti (Hz) */
+	float peak_hz[IMU_FILTER_CHANNELS][IMU_VIB_PEAKS];
+	float peak_amp[IMU_FILTER_CHANNELS][IMU_VIB_PEAKS];
+	float band_rms[IMU_FILTER_CHANNELS][IMU_VIB_BANDS];
+	float notch_hz[IMU_FILTER_MAX_NOTCH];			/* centri suggeriti, 0 = non serve */
+	uint8_t dlpf;									/* INV_MPU6050_FILTER_* suggerito */
+	uint32_t fft_cycles;							/* cicli CPU per asse (finestra, FFT, potenza) */
+} IMU_vib_result_struct;
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+extern const float IMU_vib_band_hz[IMU_VIB_BANDS + 1];
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+riic_ret_t IMU_vib_capture(IMU_dev_struct *dev);
+void IMU_vib_analyze(IMU_dev_struct *dev, IMU_vib_result_struct *r);
+riic_ret_t IMU_vib_run(IMU_dev_struct *dev, IMU_vib_result_struct *r);
+void IMU_vib_show(const IMU_vib_result_struct *r);
+
+#endif /* _IMU_VIB_H_ */
@@ -5,8 +5,23 @@ Includes   <System Includes> , "Project Includes"
 #include <stdint.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <machine.h>
 #include "platform.h"
-#include "s12adc.h"
+#include "CMT.h"
+#include "S12ADC.h"
+
+/******************************************************************************
+Exported global variables
+******************************************************************************/
+s12adc_scan_t S12ADC_scan;
+
+/******************************************************************************
+Private functions
+******************************************************************************/
+static void S12ADC_dmac_isr (void) ;
+static void S12ADC_addition_set (void) ;
+static void S12ADC_window_reset (void) ;
+static void S12ADC_window_publish (void) ;
 
 /*******************************************************************************
 * Function name: S12ADC_init
@@ -132,6 +147,433 @@ uint16_t S12ADC_read (void)
     return adc_result;    
 } /* End of function S12ADC_read() */
 
+/*******************************************************************************
+* Function name: S12ADC_scan_addition
+* Description  : Selects the value addition mode: each scan converts the
+*                given channels times times in a row and ADDRn holds the
+*                sum. Before S12ADC_scan_start it only records the setting;
+*                while scanning, the DMAC1 interrupt applies it between two
+*                scans and discards the window in progress
+* Arguments    : channels -
+*                   bit n set for ANn, within S12ADC_SCAN_MASK
+*                times -
+*                   conversions per scan, 1 (addition off) to S12ADC_ADD_MAX
+* Return value : true -
+*                   setting accepted
+*                false -
+*                   channel not scanned or times out of range
+*******************************************************************************/
+bool S12ADC_scan_addition (uint16_t channels, uint8_t times)
+{
+    if ((times < 1) || (times > S12ADC_ADD_MAX) || (channels & ~S12ADC_SCAN_MASK)) {
+        return false;
+    }
+
+    S12ADC_scan.add_mask = (times > 1) ? channels : 0;
+    S12ADC_scan.add_times = times;
+    if (S12ADC_scan.running) {
+        S12ADC_scan.reconfig = true;
+    }
+
+    return true;
+} /* End of function S12ADC_scan_addition() */
+
+
+/*******************************************************************************
+* Function name: S12ADC_scan_start
+* Description  : Switches the S12ADC to timer-triggered scanning of the pot,
+*                battery and motor current inputs. Every MTU0 TGRA compare
+*                match (TRG0AN) starts one single scan; the scan-end request
+*                S12ADI0 activates DMAC1, which copies ADDR2..ADDR5 as one
+*                block into S12ADC_scan.raw, and the DMAC1 transfer-end
+*                interrupt sums decim scans before publishing them. No CPU
+*                polling: reading the latest result is S12ADC_scan_read.
+*                Call S12ADC_init first (protect registers, AN002 pin) and
+*                S12ADC_scan_addition to use the value addition mode.
+* Arguments    : period_us -
+*                   result period when S12ADC_scan_sync is not called (us;
+*                   the scans, period_us / decim apart, up to 65535 MTU0
+*                   counts = 87 ms)
+*                decim -
+*                   scans summed per result, 1 to S12ADC_DECIM_MAX
+* Return value : none
+*******************************************************************************/
+void S12ADC_scan_start (uint32_t period_us, uint8_t decim)
+{
+    uint32_t counts;
+
+    if (decim < 1) {
+        decim = 1;
+    }
+    if (decim > S12ADC_DECIM_MAX) {
+        decim = S12ADC_DECIM_MAX;
+    }
+    if (0 == S12ADC_scan.add_times) {
+        S12ADC_scan.add_times = 1;
+    }
+    counts = period_us / decim * (S12ADC_TIMER_HZ / 1000) / 1000;
+
+    S12ADC_scan.sync = (uint16_t)(S12ADC_SYNC_US * (S12ADC_TIMER_HZ / 1000) / 1000);
+    if (counts > 0xFFFF) {
+        counts = 0xFFFF;
+    }
+    if (counts < 2 * (uint32_t)S12ADC_scan.sync) {
+        counts = 2 * (uint32_t)S12ADC_scan.sync;
+    }
+    S12ADC_scan.period = (uint16_t)counts;
+    S12ADC_scan.decim = decim;
+    S12ADC_scan.ready = 1;
+    S12ADC_scan.count = 0;
+    S12ADC_scan.running = false;
+    S12ADC_scan.reconfig = false;
+
+#ifdef PLATFORM_BOARD_RDKRX63N
+    SYSTEM.PRCR.WORD = 0xA50B; /* Protect off */
+#endif
+    MSTP(S12AD) = 0;
+    MSTP(MTU0) = 0;
+    MSTP(DMAC) = 0;
+
+    /* AN003 (P43) and AN005 (P45) as analog inputs, like AN002 in S12ADC_init */
+    PORT4.PDR.BIT.B3 = 0;
+    PORT4.PMR.BIT.B3 = 0;
+    MPC.P43PFS.BYTE = 0x80;
+    PORT4.PDR.BIT.B5 = 0;
+    PORT4.PMR.BIT.B5 = 0;
+    MPC.P45PFS.BYTE = 0x80;
+#ifdef PLATFORM_BOARD_RDKRX63N
+    SYSTEM.PRCR.WORD = 0xA500; /* Protect on  */
+#endif
+
+    /* Stop everything before reconfiguring */
+    MTU.TSTR.BIT.CST0 = 0;
+    S12AD.ADCSR.BYTE = 0x00;
+    DMAC1.DMCNT.BIT.DTE = 0;
+
+    S12AD.ADANS0.WORD = S12ADC_SCAN_MASK;
+    S12AD.ADANS1.WORD = 0x0000;
+    S12AD.ADADS1.WORD = 0x0000;
+    S12AD.ADCER.WORD = 0x0000;
+    S12ADC_addition_set();
+    S12ADC_window_reset();
+
+    /* ADSTRGR: ADSTRS = 1, TRG0AN (MTU0 TGRA compare match) */
+    S12AD.ADSTRGR.BYTE = 0x01;
+
+    /* DMAC1: block mode, source is the block area (back to ADDR2 after each
+       block), 16 bit, both addresses incremented, activated by S12ADI0,
+       interrupt at the end of the (single) block */
+    ICU.DMRSR1.BYTE = VECT(S12AD0, S12ADI0);
+    DMAC1.DMTMD.WORD = 0x9101;
+    DMAC1.DMAMD.WORD = 0x8080;
+    DMAC1.DMINT.BYTE = 0x10;
+    DMAC1.DMSAR = (uint32_t)(uintptr_t)(&S12AD.ADDR0 + S12ADC_CH_FIRST);
+    DMAC1.DMDAR = (uint32_t)(uintptr_t)S12ADC_scan.raw;
+    DMAC1.DMCRA = ((uint32_t)S12ADC_SCAN_WORDS << 16) | S12ADC_SCAN_WORDS;
+    DMAC1.DMCRB = 1;
+    DMAC.DMAST.BIT.DMST = 1;
+
+    IPR(DMAC, DMAC1I) = 0x02;
+    IR(DMAC, DMAC1I) = 0;
+    IEN(DMAC, DMAC1I) = 1;
+
+    /* S12ADI0 goes to the DMAC (DMRSR1) but must be enabled in the ICU */
+    IR(S12AD0, S12ADI0) = 0;
+    IEN(S12AD0, S12ADI0) = 1;
+    DMAC1.DMCNT.BIT.DTE = 1;
+
+    /* ADCSR: single scan, ADIE = 1, CKS = PCLK, TRGE = 1, EXTRG = 0 (timer) */
+    S12AD.ADCSR.BYTE = 0x1E;
+
+    /* MTU0: PCLK/64, cleared by TGRA compare match, TTGE = 1 (A/D start request) */
+    MTU0.TCR.BYTE = 0x23;
+    MTU0.TMDR.BYTE = 0x00;
+    MTU0.TIORH.BYTE = 0x00;
+    MTU0.TIORL.BYTE = 0x00;
+    MTU0.TIER.BYTE = 0x80;
+    MTU0.TGRA = S12ADC_scan.period - 1;
+    MTU0.TCNT = 0;
+    S12ADC_scan.running = true;
+    MTU.TSTR.BIT.CST0 = 1;
+} /* End of function S12ADC_scan_start() */
+
+
+/*******************************************************************************
+* Function name: S12ADC_scan_sync
+* Description  : Marks the IMU sample instant: the next scan starts
+*                S12ADC_SYNC_US from now, the following ones every period
+*                unless this is called again, and a new window of decim
+*                scans begins. The scans of an incomplete window are
+*                published as they are (samples gives the real count), so
+*                a cycle shorter or later than decim periods still gets a
+*                result. Interrupts are masked for a few instructions, so
+*                that the DMAC1 interrupt never sees half a reset
+* Arguments    : none
+* Return value : none
+*******************************************************************************/
+void S12ADC_scan_sync (void)
+{
+    clrpsw_i();
+    MTU0.TCNT = S12ADC_scan.period - 1 - S12ADC_scan.sync;
+    if (S12ADC_scan.scans > 0) {
+        S12ADC_window_publish();
+    }
+    S12ADC_window_reset();
+    setpsw_i();
+} /* End of function S12ADC_scan_sync() */
+
+
+/*******************************************************************************
+* Function name: S12ADC_scan_read
+* Description  : Copies the latest published result. The interrupt only
+*                writes the other buffer; if a new result is published
+*                during the copy (count changes) the copy is repeated
+* Arguments    : result -
+*                   latest result
+* Return value : true -
+*                   at least one result published since S12ADC_scan_start
+*                false -
+*                   otherwise
+*******************************************************************************/
+bool S12ADC_scan_read (s12adc_result_t *result)
+{
+    uint32_t count;
+    uint8_t b, i;
+
+    do
+    {
+        count = S12ADC_scan.count;
+        b = S12ADC_scan.ready;
+        for (i = 0; i < S12ADC_SCAN_WORDS; i++)
+        {
+            result->sum[i] = S12ADC_scan.buf[b][i];
+            result->samples[i] = S12ADC_scan.samples[b][i];
+        }
+        result->timestamp = S12ADC_scan.timestamp[b];
+    } while (count != S12ADC_scan.count);
+
+    result->count = count;
+
+    return count != 0;
+} /* End of function S12ADC_scan_read() */
+
+
+/*******************************************************************************
+* Function name: S12ADC_counts
+* Description  : Mean conversion value of a channel, on the 12-bit scale
+*                whatever the additions and the decimation
+* Arguments    : result -
+*                   result of S12ADC_scan_read
+*                channel -
+*                   n for ANn, S12ADC_CH_FIRST to S12ADC_CH_LAST
+* Return value : float -
+*                   counts, 0 to MAX_COUNTS (0 without samples)
+*******************************************************************************/
+float S12ADC_counts (const s12adc_result_t *result, uint8_t channel)
+{
+    uint8_t i = (uint8_t)(channel - S12ADC_CH_FIRST);
+
+    if ((i >= S12ADC_SCAN_WORDS) || (0 == result->samples[i])) {
+        return 0.0f;
+    }
+
+    return (float)result->sum[i] / result->samples[i];
+} /* End of function S12ADC_counts() */
+
+
+/*******************************************************************************
+* Function name: S12ADC_counts_ext
+* Description  : Mean conversion value of a channel with S12ADC_EXT_BITS
+*                bits, rounded to nearest: the sum of n samples carries
+*                log2(n) more bits than one conversion, as far as the noise
+*                spreads the input over more than one count
+* Arguments    : result -
+*                   result of S12ADC_scan_read
+*                channel -
+*                   n for ANn, S12ADC_CH_FIRST to S12ADC_CH_LAST
+* Return value : uint16_t -
+*                   counts << S12ADC_EXT_SHIFT (0 without samples)
+*******************************************************************************/
+uint16_t S12ADC_counts_ext (const s12adc_result_t *result, uint8_t channel)
+{
+    uint8_t i = (uint8_t)(channel - S12ADC_CH_FIRST);
+    uint32_t n;
+
+    if ((i >= S12ADC_SCAN_WORDS) || (0 == result->samples[i])) {
+        return 0;
+    }
+    n = result->samples[i];
+
+    return (uint16_t)(((result->sum[i] << S12ADC_EXT_SHIFT) + n / 2) / n);
+} /* End of function S12ADC_counts_ext() */
+
+
+/*******************************************************************************
+* Function name: S12ADC_battery_volts
+* Description  : Battery voltage from a scan
+* Arguments    : result -
+*                   scan
+* Return value : float -
+*                   volts
+*******************************************************************************/
+float S12ADC_battery_volts (const s12adc_result_t *result)
+{
+    return S12ADC_counts(result, S12ADC_CH_BATTERY) * (float)(VREFH / MAX_COUNTS) * S12ADC_BATTERY_DIVIDER;
+} /* End of function S12ADC_battery_volts() */
+
+
+/*******************************************************************************
+* Function name: S12ADC_motor_amps
+* Description  : Motor current from a scan (signed, bidirectional sensor)
+* Arguments    : result -
+*                   scan
+* Return value : float -
+*                   amperes
+*******************************************************************************/
+float S12ADC_motor_amps (const s12adc_result_t *result)
+{
+    return (S12ADC_counts(result, S12ADC_CH_MOTOR) * (float)(VREFH / MAX_COUNTS) - S12ADC_MOTOR_ZERO_V) /
+           S12ADC_MOTOR_V_PER_A;
+} /* End of function S12ADC_motor_amps() */
+
+
+/*******************************************************************************
+* Function name: S12ADC_pot
+* Description  : Potentiometer position from a scan
+* Arguments    : result -
+*                   scan
+* Return value : float -
+*                   0 (fully counter-clockwise) to 1
+*******************************************************************************/
+float S12ADC_pot (const s12adc_result_t *result)
+{
+    return S12ADC_counts(result, S12ADC_CH_POT) * (float)(1.0 / MAX_COUNTS);
+} /* End of function S12ADC_pot() */
+
+
+/*******************************************************************************
+* Function name: S12ADC_show
+* Description  : Shows battery voltage, motor current and pot on the LCD
+*                lines below the attitude (IMU_update)
+* Arguments    : result -
+*                   scan
+* Return value : none
+*******************************************************************************/
+void S12ADC_show (const s12adc_result_t *result)
+{
+    uint8_t lcd_buffer[13];
+
+    sprintf((char *)lcd_buffer, "Vb:%5.2f ", S12ADC_battery_volts(result));
+    lcd_display(LCD_LINE5, lcd_buffer);
+
+    sprintf((char *)lcd_buffer, "Im:%5.2f ", S12ADC_motor_amps(result));
+    lcd_display(LCD_LINE6, lcd_buffer);
+
+    sprintf((char *)lcd_buffer, "Pot:%4.2f ", S12ADC_pot(result));
+    lcd_display(LCD_LINE7, lcd_buffer);
+} /* End of function S12ADC_show() */
+
+
+/*******************************************************************************
+* Function name: S12ADC_addition_set
+* Description  : Writes the value addition setting to the converter and the
+*                conversions per scan of each channel. Only between scans
+* Arguments    : none
+* Return value : none
+*******************************************************************************/
+static void S12ADC_addition_set (void)
+{
+    uint8_t i;
+
+    /* ADADS0: channels converted add_times times, ADADC: add_times - 1 */
+    S12AD.ADADS0.WORD = S12ADC_scan.add_mask;
+    S12AD.ADADC.BYTE = S12ADC_scan.add_times - 1;
+
+    for (i = 0; i < S12ADC_SCAN_WORDS; i++) {
+        S12ADC_scan.additions[i] = (S12ADC_scan.add_mask & (1 << (S12ADC_CH_FIRST + i))) ? S12ADC_scan.add_times : 1;
+    }
+} /* End of function S12ADC_addition_set() */
+
+
+/*******************************************************************************
+* Function name: S12ADC_window_reset
+* Description  : Drops the scans summed so far
+* Arguments    : none
+* Return value : none
+*******************************************************************************/
+static void S12ADC_window_reset (void)
+{
+    uint8_t i;
+
+    for (i = 0; i < S12ADC_SCAN_WORDS; i++) {
+        S12ADC_scan.acc[i] = 0;
+    }
+    S12ADC_scan.scans = 0;
+} /* End of function S12ADC_window_reset() */
+
+
+/*******************************************************************************
+* Function name: S12ADC_window_publish
+* Description  : Publishes the scans summed so far in buf[1 - ready]. Called
+*                by the DMAC1 interrupt or with interrupts masked
+* Arguments    : none
+* Return value : none
+*******************************************************************************/
+static void S12ADC_window_publish (void)
+{
+    uint8_t done, i;
+
+    done = 1 - S12ADC_scan.ready;
+    for (i = 0; i < S12ADC_SCAN_WORDS; i++)
+    {
+        S12ADC_scan.buf[done][i] = S12ADC_scan.acc[i];
+        S12ADC_scan.samples[done][i] = S12ADC_scan.additions[i] * S12ADC_scan.scans;
+    }
+    S12ADC_scan.timestamp[done] = (uint32_t)get_ms();
+    S12ADC_scan.ready = done;
+    S12ADC_scan.count++;
+} /* End of function S12ADC_window_publish() */
+
+
+/*******************************************************************************
+* Function name: S12ADC_dmac_isr
+* Description  : DMAC1 transfer end: a scan is in raw. Adds it to the window
+*                and every decim scans publishes the sums in buf[1 - ready].
+*                The next scan is at least S12ADC_SYNC_US away, so a new
+*                value addition setting is applied here
+* Arguments    : none
+* Return value : none
+*******************************************************************************/
+#pragma interrupt (S12ADC_dmac_isr(vect = VECT(DMAC, DMAC1I)))
+static void S12ADC_dmac_isr (void)
+{
+    uint8_t i;
+
+    DMAC1.DMSTS.BIT.DTIF = 0;
+
+    for (i = 0; i < S12ADC_SCAN_WORDS; i++) {
+        S12ADC_scan.acc[i] += S12ADC_scan.raw[i];
+    }
+    if (++S12ADC_scan.scans >= S12ADC_scan.decim)
+    {
+        S12ADC_window_publish();
+        S12ADC_window_reset();
+    }
+
+    if (S12ADC_scan.reconfig)
+    {
+        S12ADC_addition_set();
+        S12ADC_window_reset();
+        S12ADC_scan.reconfig = false;
+    }
+
+    DMAC1.DMSAR = (uint32_t)(uintptr_t)(&S12AD.ADDR0 + S12ADC_CH_FIRST);
+    DMAC1.DMDAR = (uint32_t)(uintptr_t)S12ADC_scan.raw;
+    DMAC1.DMCRA = ((uint32_t)S12ADC_SCAN_WORDS << 16) | S12ADC_SCAN_WORDS;
+    DMAC1.DMCRB = 1;
+    DMAC1.DMCNT.BIT.DTE = 1;
+} /* End of function S12ADC_dmac_isr() */
+
 /*******************************************************************************
 * End of file s12adc.c
 *******************************************************************************/
@@ -1,6 +1,8 @@
 /*******************************************************************************
 * History : DD.MM.YYYY     Version     Description
 *         : 15.02.2012     1.00        First release
+*         : 19.10.2026     1.10        Timer-triggered scan, DMAC double buffer
+*         : 19.10.2026     1.20        Value addition mode, software decimation
 *******************************************************************************/
 #ifndef _S12ADC_H_
 #define _S12ADC_H_
@@ -8,6 +10,7 @@
 /*******************************************************************************
 Includes   <System Includes> , "Project Includes"
 *******************************************************************************/
+#include <stdint.h>
 #include <stdbool.h>
 
 /* Values for conversion of S12ADC counts to voltage */
@@ -15,6 +18,82 @@ Includes   <System Includes> , "Project Includes"
 #define VREFH 3.3
 #define VREFL 0.0
 
+/* Continuous scan: a MTU0 compare match starts a single scan of the analog
+   inputs, DMAC1 copies the result registers and its transfer-end interrupt
+   adds them to the current window; every S12ADC_scan.decim scans the window
+   sums are published in one half of a double buffer. The main loop aligns
+   the timer phase to the IMU sample instant (S12ADC_scan_sync), which also
+   publishes an incomplete window */
+#define S12ADC_CH_POT           2       /* AN002 (P42): potentiometer on the board */
+#define S12ADC_CH_BATTERY       3       /* AN003 (P43): battery voltage divider */
+#define S12ADC_CH_MOTOR         5       /* AN005 (P45): motor current sense amplifier */
+#define S12ADC_CH_FIRST         2       /* result registers copied by the DMAC: */
+#define S12ADC_CH_LAST          5       /* ADDR2..ADDR5, AN004 is not scanned */
+#define S12ADC_SCAN_WORDS       (S12ADC_CH_LAST - S12ADC_CH_FIRST + 1)
+#define S12ADC_SCAN_MASK        ((1 << S12ADC_CH_POT) | (1 << S12ADC_CH_BATTERY) | (1 << S12ADC_CH_MOTOR))
+
+#define S12ADC_TIMER_HZ         (PCLK_HZ / 64)  /* MTU0 count clock, PCLK/64 */
+#define S12ADC_DECIM_MAX        16      /* scans summed per published result */
+
+/* Value addition: the converter repeats the conversion of the selected
+   channels 2 to 4 times in a row and ADDRn holds the sum (up to 14 bits).
+   Results carry the raw sums over additions and decimated scans; scale
+   them with S12ADC_counts (12 bits) or S12ADC_counts_ext (16 bits) */
+#define S12ADC_ADD_MAX          4       /* ADADC: 1 to 4 conversions */
+#define S12ADC_EXT_BITS         16      /* resolution of S12ADC_counts_ext */
+#define S12ADC_EXT_SHIFT        (S12ADC_EXT_BITS - 12)
+#define S12ADC_SYNC_US          100     /* scan start after the IMU sample instant */
+
+/* Analog front ends (board wiring of the robot) */
+#define S12ADC_BATTERY_DIVIDER  4.0f    /* battery voltage / ADC input voltage */
+#define S12ADC_MOTOR_ZERO_V     1.65f   /* sense amplifier output at zero current */
+#define S12ADC_MOTOR_V_PER_A    0.11f   /* sense amplifier gain */
+
+#if (S12ADC_CH_POT < S12ADC_CH_FIRST) || (S12ADC_CH_POT > S12ADC_CH_LAST) || \
+    (S12ADC_CH_BATTERY < S12ADC_CH_FIRST) || (S12ADC_CH_BATTERY > S12ADC_CH_LAST) || \
+    (S12ADC_CH_MOTOR < S12ADC_CH_FIRST) || (S12ADC_CH_MOTOR > S12ADC_CH_LAST)
+#error "scanned channels must lie in S12ADC_CH_FIRST..S12ADC_CH_LAST"
+#endif
+
+/******************************************************************************
+Typedef definitions
+******************************************************************************/
+/* One published result: the sum of samples[i] conversions per channel */
+typedef struct
+{
+    uint32_t sum[S12ADC_SCAN_WORDS];        /* ADDRn sums, index n - S12ADC_CH_FIRST */
+    uint8_t  samples[S12ADC_SCAN_WORDS];    /* conversions in each sum (additions x scans) */
+    uint32_t timestamp;                     /* get_ms() at the end of the last scan */
+    uint32_t count;                         /* results published since S12ADC_scan_start */
+} s12adc_result_t;
+
+/* The DMAC writes raw, the interrupt adds it to acc and publishes the
+   window in buf[1 - ready] while buf[ready] is read */
+typedef struct
+{
+    volatile uint16_t raw[S12ADC_SCAN_WORDS];
+    volatile uint32_t buf[2][S12ADC_SCAN_WORDS];
+    volatile uint8_t  samples[2][S12ADC_SCAN_WORDS];
+    volatile uint32_t timestamp[2];
+    volatile uint8_t  ready;
+    volatile uint32_t count;
+    uint32_t acc[S12ADC_SCAN_WORDS];        /* sums of the current window */
+    uint8_t  scans;                         /* scans in acc */
+    uint8_t  decim;                         /* scans per published result */
+    uint8_t  additions[S12ADC_SCAN_WORDS];  /* conversions per scan of each channel */
+    uint16_t add_mask;                      /* ADADS0 */
+    uint8_t  add_times;                     /* ADADC + 1 */
+    bool     running;
+    volatile bool reconfig;                 /* new addition setting for the interrupt */
+    uint16_t period;                        /* MTU0 counts between scans */
+    uint16_t sync;                          /* MTU0 counts from the sample instant to the scan */
+} s12adc_scan_t;
+
+/******************************************************************************
+Exported global variables
+******************************************************************************/
+extern s12adc_scan_t S12ADC_scan;
+
 /******************************************************************************
 Prototypes for exported functions
 ******************************************************************************/
@@ -22,5 +101,15 @@ void S12ADC_init (void) ;
 void S12ADC_start (void) ;
 bool S12ADC_conversion_complete (void) ;
 uint16_t S12ADC_read (void) ;
+bool S12ADC_scan_addition (uint16_t channels, uint8_t times) ;
+void S12ADC_scan_start (uint32_t period_us, uint8_t decim) ;
+void S12ADC_scan_sync (void) ;
+bool S12ADC_scan_read (s12adc_result_t *result) ;
+float S12ADC_counts (const s12adc_result_t *result, uint8_t channel) ;
+uint16_t S12ADC_counts_ext (const s12adc_result_t *result, uint8_t channel) ;
+float S12ADC_battery_volts (const s12adc_result_t *result) ;
+float S12ADC_motor_amps (const s12adc_result_t *result) ;
+float S12ADC_pot (const s12adc_result_t *result) ;
+void S12ADC_show (const s12adc_result_t *result) ;
 
 #endif
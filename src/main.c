@@ -4,12 +4,96 @@
 Includes: <System Includes> , "Project Includes"
 *******************************************************************************/
 #include "platform.h"
+#include "CMT.h"
 #include "S12ADC.h"
 #include "main.h"
+#include "IMU.h"
+#include "IMU_temp.h"
+#include "IMU_calib.h"
+#include "IMU_dmp.h"
+#include "IMU_state.h"
+#include "IMU_power.h"
+#include "IMU_vib.h"
+#include "IMU_mag.h"
+#include "IMU_telem.h"
+#include "IMU_bbox.h"
+#include "IMU_param.h"
+#include "IMU_log.h"
+#include "IMU_switch.h"
+#include "IMU_mem.h"
+#include "r_switches.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define IMU_DECIM_FACTOR					10		/* 1 kHz dal sensore, 100 Hz in uscita */
+#define IMU_MAG_TYPE						IMU_MAG_NONE	/* magnetometro sul bus ausiliario di ogni sensore */
+#define IMU_PARK_TIME						30000	/* robot fermo (ms) prima del wake-on-motion */
+#define IMU_PARK_WAKE_RATE					INV_MPU6050_LP_WAKE_40HZ	/* risveglio entro 25 ms dalla spinta */
+#define IMU_KNOB_PARAM						IMU_PARAM_LOWPASS_HZ	/* parametro regolato dal potenziometro con SW2 tenuto premuto */
+#define IMU_KNOB_MIN						5.0f	/* valore con il potenziometro tutto a sinistra */
+#define IMU_KNOB_MAX						50.0f	/* valore con il potenziometro tutto a destra */
+#define IMU_KNOB_STEP						1.0f	/* variazione minima che produce una modifica */
+#define IMU_ADC_DECIM						8		/* scansioni analogiche sommate per ciclo */
+#define IMU_ADC_ADDITIONS					4		/* conversioni sommate in hardware per batteria e motori */
+#define IMU_PAGE_ATTITUDE					0		/* pagine del display, cambiate con SW2 */
+#define IMU_PAGE_STATUS						1
+#define IMU_PAGE_MEMORY						2
+#define IMU_NUM_PAGES						3
 
 /*******************************************************************************
 Definizione strutture
 *******************************************************************************/
+/* Sensori montati: stesso canale RIIC, indirizzi distinti tramite il pin AD0.
+   Il sensore campiona a 1 kHz con il filtro interno aperto (256 Hz) e la
+   decimazione riporta i campioni a 100 Hz; il taglio vero e' quello del
+   filtro software, con meno ritardo di gruppo del filtro del sensore.
+   Il magnetometro va montato su entrambi i sensori o su nessuno: il voting
+   confronta l'imbardata dei due */
+IMU_dev_struct IMU_dev[IMU_NUM_SENSORS] = {
+	{.channel = CHANNEL_0, .slave_address = IMU_ADDRESS_AD0_LOW,
+	 .config = {INV_MPU6050_FS_02G, INV_MPU6050_FSR_250DPS, INV_MPU6050_FILTER_256HZ_NODLPF, INV_MPU6050_INIT_FIFO_RATE,
+				.decim = IMU_DECIM_FACTOR, .filter = IMU_FILTER_CONFIG, .mag = IMU_MAG_TYPE}},
+	{.channel = CHANNEL_0, .slave_address = IMU_ADDRESS_AD0_HIGH,
+	 .config = {INV_MPU6050_FS_02G, INV_MPU6050_FSR_250DPS, INV_MPU6050_FILTER_256HZ_NODLPF, INV_MPU6050_INIT_FIFO_RATE,
+				.decim = IMU_DECIM_FACTOR, .filter = IMU_FILTER_CONFIG, .mag = IMU_MAG_TYPE}}
+};
+
+/* Modelli del bias in temperatura dei sensori, ricavati con tools/imu_tempfit.c
+   dai log a riposo durante il riscaldamento (tutti zero: nessuna correzione) */
+static const IMU_tempmodel_struct IMU_tempmodel[IMU_NUM_SENSORS] = {
+	{25.0f, {{0}}, {{0}}},
+	{25.0f, {{0}}, {{0}}}
+};
+
+/* Modelli di calibrazione dei sensori, v = M * (raw - b), ricavati con
+   tools/imu_calfit.c o con la procedura a pulsanti (identita': nessuna correzione) */
+static const IMU_calmodel_struct IMU_calmodel[IMU_NUM_SENSORS][2] = {
+	{{{{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}}, {0.0f, 0.0f, 0.0f}},
+	 {{{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}}, {0.0f, 0.0f, 0.0f}}},
+	{{{{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}}, {0.0f, 0.0f, 0.0f}},
+	 {{{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}}, {0.0f, 0.0f, 0.0f}}}
+};
+
+/* Modelli del magnetometro (ferro duro b in LSB, ferro dolce M), ricavati con
+   la procedura a pulsanti (identita': nessuna correzione) */
+static const IMU_calmodel_struct IMU_magmodel[IMU_NUM_SENSORS] = {
+	{{{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}}, {0.0f, 0.0f, 0.0f}},
+	{{{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}}, {0.0f, 0.0f, 0.0f}}
+};
+
+#if IMU_USE_DMP
+/* Firmware del DMP: src/IMU_dmp_image.c, generato dal pacchetto del produttore (non incluso) */
+extern const IMU_dmp_image_struct IMU_dmp_image;
+
+/* Configurazione richiesta dal DMP: 200 Hz interni, giroscopio a 2000 grad/s */
+static const IMU_config_struct IMU_dmp_config = {
+	INV_MPU6050_FS_02G, INV_MPU6050_FSR_2000DPS, INV_MPU6050_FILTER_42HZ, IMU_DMP_SAMPLE_RATE,
+	.filter = IMU_FILTER_CONFIG
+};
+#endif
+
+/* Risultato fuso dei sensori */
 IMU_data_struct IMU;
 
 /*******************************************************************************
@@ -18,8 +102,25 @@ IMU_data_struct IMU;
 * Argomenti         : No
 * Valori restituiti : No
 *******************************************************************************/
-void main(void)
+void main(void)
 {
+	/* Definisce le variabili locali */
+	uint8_t i, online, parked = 0;
+	int32_t display_ms, still_ms, period;
+	uint16_t start, work, adc_rate_hz;
+	bool still, woken, sampling, knob_on = false;
+	uint8_t page = IMU_PAGE_ATTITUDE, calibrated = 0;
+	uint8_t recal = IMU_NUM_SENSORS, recal_mask = 0;
+	IMU_switch_event_struct sw_event;
+	IMU_vib_result_struct vib;
+	s12adc_result_t analog;
+	uint8_t knob_cmd[IMU_PARAM_CMD_LEN];
+	IMU_param_value_u knob;
+	float knob_last = -1.0f;
+
+    /* Riempie gli stack per misurarne l'uso (prima di ogni altra chiamata) */
+    IMU_mem_paint();
+
     /* Inizializza il display LCD */
 	lcd_initialize();
     
@@ -29,16 +130,300 @@ void main(void)
     /* Inizializza l'A/D converter 12-bit */
     S12ADC_init();
 
-    /* Inizializza l'IMU */
-    IMU_init(&IMU);
+    /* Carica i modelli termici e di calibrazione (prima della calibrazione iniziale) */
+    for (i = 0; i < IMU_NUM_SENSORS; i++)
+    {
+    	IMU_temp_set_model(&IMU_dev[i], &IMU_tempmodel[i]);
+    	IMU_calib_set_model(&IMU_dev[i], &IMU_calmodel[i][0], &IMU_calmodel[i][1]);
+    	IMU_calib_set_mag_model(&IMU_dev[i], &IMU_magmodel[i]);
+    }
+
+    /* Inizializza i sensori */
+    IMU_init(IMU_dev, IMU_NUM_SENSORS);
+
+    /* Con SW2 premuto all'avvio esegue la calibrazione guidata di ogni sensore */
+    if (SW_ACTIVE == SW2)
+    {
+    	for (i = 0; i < IMU_NUM_SENSORS; i++)
+    	{
+    		if (IMU_dev[i].online) {
+    			IMU_calib_run(&IMU_dev[i]);
+    		}
+    	}
+    	lcd_clear();
+    }
+
+    /* Con SW3 premuto all'avvio analizza le vibrazioni del primo sensore, a
+       ciclo continuo e con i motori in moto, finche' SW3 non viene premuto di nuovo */
+    if (SW_ACTIVE == SW3)
+    {
+    	while (SW_ACTIVE == SW3);
+    	while (IMU_dev[0].online && (SW_ACTIVE != SW3))
+    	{
+    		if (RIIC_OK == IMU_vib_run(&IMU_dev[0], &vib)) {
+    			IMU_vib_show(&vib);
+    		}
+    	}
+    	while (SW_ACTIVE == SW3);
+    	lcd_clear();
+    }
+
+#if IMU_USE_DMP
+    /* Carica e avvia il DMP, poi ripete la calibrazione con la nuova configurazione */
+    for (i = 0; i < IMU_NUM_SENSORS; i++)
+    {
+    	if (IMU_dev[i].online &&
+    		(RIIC_OK == IMU_set_config(&IMU_dev[i], &IMU_dmp_config)) &&
+    		(RIIC_OK == IMU_dmp_load(&IMU_dev[i], &IMU_dmp_image)) &&
+    		(RIIC_OK == IMU_dmp_start(&IMU_dev[i], INV_MPU6050_INIT_FIFO_RATE))) {
+    		IMU_dev_calibrate(&IMU_dev[i]);
+    	}
+    }
+#endif
+
+    /* Telemetria su SCI2, un frame per ciclo; CMT1 misura la durata dell'elaborazione */
+    CMT_counter_init();
+    IMU_telem_init();
+
+    /* Parametri modificabili dall'host sulla stessa seriale (tools/imu_param.c) */
+    IMU_param_init(IMU_dev, IMU_NUM_SENSORS);
+
+    /* Registro differito: esce sulla telemetria nei cicli con la linea libera
+       (tools/imu_telemrec.c -g) */
+    for (i = 0, online = 0; i < IMU_NUM_SENSORS; i++) {
+    	online += IMU_dev[i].online;
+    }
+    IMU_LOG2(IMU_LOG_BOOT, online, IMU_NUM_SENSORS);
+
+    /* Ingressi analogici (batteria, corrente dei motori, potenziometro):
+       scansioni avviate da MTU0 e copiate dal DMAC, IMU_ADC_DECIM per ciclo,
+       allineate all'istante del campione da S12ADC_scan_sync. Batteria e
+       motori sommano IMU_ADC_ADDITIONS conversioni nel convertitore, senza
+       cicli di CPU in piu': 32 campioni per ciclo */
+    S12ADC_scan_addition((1 << S12ADC_CH_BATTERY) | (1 << S12ADC_CH_MOTOR), IMU_ADC_ADDITIONS);
+    adc_rate_hz = IMU_dev[0].config.rate_hz;
+    S12ADC_scan_start(1000000UL / adc_rate_hz, IMU_ADC_DECIM);
+
+    /* Scatola nera in data flash; con SW1 premuto all'avvio invia prima le
+       registrazioni sulla telemetria (tools/imu_telemrec.c -b) */
+    if (IMU_bbox_init() && (SW_ACTIVE == SW1))
+    {
+    	IMU_bbox_dump_start();
+    	while (IMU_bbox_dump());
+    	while (SW_ACTIVE == SW1);
+    }
+
+    /* Pulsanti a eventi, da qui in poi: le scelte all'avvio qui sopra leggono
+       ancora il livello dei pin */
+    R_SWITCHES_Init();
+    IMU_switch_init();
 
     /* Loop principale*/
+    display_ms = get_ms();
+    still_ms = get_ms();
     while (1)
     {
-    	/* Acquisisce i risultati dall'IMU*/
-    	IMU_result(&IMU);
+    	/* Acquisisce i risultati dai sensori e li fonde */
+    	start = CMT_counter();
+    	IMU_result(IMU_dev, IMU_NUM_SENSORS, &IMU);
+    	S12ADC_scan_sync();
+    	work = CMT_counter() - start;
+
+    	/* Ricalibrazione chiesta con SW3: un passo per ciclo sul campione
+    	   appena letto, un sensore alla volta (recal); gli altri restano nel
+    	   voting. Con un solo sensore in linea il ciclo procede senza
+    	   telemetria ne' scatola nera fino alla fine, registrata nel log */
+    	if ((recal < IMU_NUM_SENSORS) && !IMU_dev_calibrate_step(&IMU_dev[recal]))
+    	{
+    		if (IMU_dev[recal].online) {
+    			calibrated |= 1 << recal;
+    		}
+    		recal = IMU_NUM_SENSORS;
+    		if (0 == recal_mask)
+    		{
+    			IMU_LOG1(IMU_LOG_RECALIBRATE, calibrated);
+    			lcd_clear();
+    			still_ms = get_ms();
+    		}
+    	}
+    	if ((IMU_NUM_SENSORS == recal) && (0 != recal_mask))
+    	{
+    		for (recal = 0; 0 == (recal_mask & (1 << recal)); recal++);
+    		recal_mask &= ~(1 << recal);
+    		IMU_dev_calibrate_start(&IMU_dev[recal]);
+    	}
+
+    	/* Nessun sensore ha dato un campione (parcheggiati, in avvio o
+    	   esclusi): manca la lettura che tiene il ciclo al passo del sensore,
+    	   quindi attende il prossimo periodo di campionamento invece di
+    	   girare a vuoto, senza frame di stato ne' record della scatola nera */
+    	for (i = 0, sampling = false; i < IMU_NUM_SENSORS; i++) {
+    		sampling = sampling || IMU_dev[i].online;
+    	}
+    	if (sampling) {
+    		IMU_telem_send(IMU_dev, IMU_NUM_SENSORS, work);
+    	}
+    	else
+    	{
+    		period = INV_MPU6050_ONE_K_HZ / IMU_dev[0].config.rate_hz;
+    		ms_delay(period - get_ms() % period);
+    	}
+    	IMU_telem_send_samples();
+
+    	/* Punto sicuro tra due campioni: comandi e modifiche dei parametri */
+    	IMU_param_poll();
+
+    	/* Con una nuova frequenza di campionamento le scansioni analogiche
+    	   ripartono con il periodo del ciclo */
+    	if (IMU_dev[0].config.rate_hz != adc_rate_hz)
+    	{
+    		adc_rate_hz = IMU_dev[0].config.rate_hz;
+    		S12ADC_scan_start(1000000UL / adc_rate_hz, IMU_ADC_DECIM);
+    	}
+
+    	/* Messaggi del registro differito, se la linea e' ancora libera */
+    	IMU_telem_send_log();
+
+    	/* Scatola nera: registra ogni campione, scrive in data flash alla caduta o
+    	   al click di SW1 */
+    	if (sampling) {
+    		IMU_bbox_log(&IMU, IMU_dev, IMU_NUM_SENSORS, work);
+    	}
+
+    	/* Eventi dei pulsanti, gia' filtrati nel tick di CMT0: SW1 scrive la
+    	   scatola nera, SW2 cambia pagina del display (doppio click: torna
+    	   all'assetto; tenuto premuto: il potenziometro regola
+    	   IMU_KNOB_PARAM), SW3 tenuto premuto avvia la ricalibrazione dei
+    	   sensori in linea, con il robot fermo in piedi */
+    	while (IMU_switch_get(&sw_event))
+    	{
+    		if ((IMU_SW1 == sw_event.sw) && (IMU_SWITCH_PRESS == sw_event.type)) {
+    			IMU_bbox_trigger(IMU_BBOX_SWITCH);
+    		}
+    		else if ((IMU_SW2 == sw_event.sw) && (IMU_SWITCH_PRESS == sw_event.type))
+    		{
+    			page = (page + 1) % IMU_NUM_PAGES;
+    			lcd_clear();
+    		}
+    		else if ((IMU_SW2 == sw_event.sw) && (IMU_SWITCH_DOUBLE == sw_event.type))
+    		{
+    			page = IMU_PAGE_ATTITUDE;
+    			lcd_clear();
+    		}
+    		else if ((IMU_SW2 == sw_event.sw) && (IMU_SWITCH_LONG == sw_event.type)) {
+    			knob_on = true;
+    		}
+    		else if ((IMU_SW3 == sw_event.sw) && (IMU_SWITCH_LONG == sw_event.type) && (0 == parked) &&
+    				 (IMU_NUM_SENSORS == recal) && (0 == recal_mask))
+    		{
+    			for (i = 0, calibrated = 0; i < IMU_NUM_SENSORS; i++)
+    			{
+    				if (IMU_dev[i].online) {
+    					recal_mask |= 1 << i;
+    				}
+    			}
+    			IMU_LOG1(IMU_LOG_RECALIBRATE_START, recal_mask);
+    			if (0 != recal_mask)
+    			{
+    				lcd_clear();
+    				lcd_display(LCD_LINE1, (const uint8_t *)"Calibra...");
+    			}
+    		}
+    	}
+    	knob_on = knob_on && IMU_switch_down(IMU_SW2);
+
+    	/* Stampa i risultati sul display LCD, alla sua frequenza */
+    	if (get_ms() - display_ms >= IMU_DISPLAY_PERIOD)
+    	{
+    		display_ms = get_ms();
+    		IMU_mem_check();
+    		if ((IMU_NUM_SENSORS != recal) || (0 != recal_mask)) {
+    			lcd_display(LCD_LINE1, (const uint8_t *)"Calibra...");
+    		}
+    		else if (IMU_PAGE_STATUS == page) {
+    			IMU_show_status(IMU_dev, IMU_NUM_SENSORS);
+    		}
+    		else if (IMU_PAGE_MEMORY == page) {
+    			IMU_mem_show();
+    		}
+    		else {
+    			IMU_update(&IMU_state);
+    		}
+
+    		if (S12ADC_scan_read(&analog))
+    		{
+    			if (IMU_PAGE_ATTITUDE == page) {
+    				S12ADC_show(&analog);
+    			}
+
+    			/* Con SW2 tenuto premuto il potenziometro regola IMU_KNOB_PARAM
+    			   su tutti i sensori, come un comando dell'host (etichetta 0) */
+    			knob.f = IMU_KNOB_MIN + S12ADC_pot(&analog) * (IMU_KNOB_MAX - IMU_KNOB_MIN);
+    			if (knob_on &&
+    				((knob.f > knob_last + IMU_KNOB_STEP) || (knob.f < knob_last - IMU_KNOB_STEP)))
+    			{
+    				knob_cmd[0] = IMU_PARAM_SET;
+    				knob_cmd[1] = 0;
+    				knob_cmd[2] = IMU_KNOB_PARAM;
+    				knob_cmd[3] = IMU_PARAM_ALL_SENSORS;
+    				knob_cmd[4] = (uint8_t)knob.bits;
+    				knob_cmd[5] = (uint8_t)(knob.bits >> 8);
+    				knob_cmd[6] = (uint8_t)(knob.bits >> 16);
+    				knob_cmd[7] = (uint8_t)(knob.bits >> 24);
+    				IMU_param_command(knob_cmd, IMU_PARAM_CMD_LEN);
+    				knob_last = knob.f;
+    			}
+    		}
+    	}
+
+    	/* Con il robot fermo per IMU_PARK_TIME i sensori passano in wake-on-motion;
+    	   il primo che rileva una spinta torna a 6 assi e riporta anche gli altri
+    	   (parked: un bit per ogni sensore parcheggiato) */
+    	if (0 == parked)
+    	{
+    		for (i = 0, online = 0, still = true; i < IMU_NUM_SENSORS; i++)
+    		{
+    			if (IMU_dev[i].online)
+    			{
+    				online++;
+    				still = still && IMU_dev[i].bias.still;
+    			}
+    		}
+
+    		if (!still || (0 == online) || (IMU_NUM_SENSORS != recal) || (0 != recal_mask)) {
+    			still_ms = get_ms();
+    		}
+    		else if (get_ms() - still_ms >= IMU_PARK_TIME)
+    		{
+    			for (i = 0; i < IMU_NUM_SENSORS; i++)
+    			{
+    				if (IMU_dev[i].online &&
+    					(RIIC_OK == IMU_power_set(&IMU_dev[i], IMU_POWER_WAKE_ON_MOTION, IMU_PARK_WAKE_RATE))) {
+    					parked |= 1 << i;
+    				}
+    			}
+    			IMU_LOG1(IMU_LOG_PARK, parked);
+    			still_ms = get_ms();
+    		}
+    	}
+    	else
+    	{
+    		for (i = 0, woken = false; i < IMU_NUM_SENSORS; i++) {
+    			woken = woken || ((parked & (1 << i)) && (IMU_POWER_FULL == IMU_dev[i].power.state));
+    		}
 
-    	/* Stampa i risultati sul display LCD*/
-    	IMU_update(&IMU);
+    		if (woken)
+    		{
+    			for (i = 0; i < IMU_NUM_SENSORS; i++)
+    			{
+    				if (parked & (1 << i)) {
+    					IMU_power_set(&IMU_dev[i], IMU_POWER_FULL, IMU_PARK_WAKE_RATE);
+    				}
+    			}
+    			IMU_LOG1(IMU_LOG_WAKE, parked);
+    			parked = 0;
+    			still_ms = get_ms();
+    		}
+    	}
     }
 } /* Fine main() */
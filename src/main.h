@@ -1,44 +1,346 @@
 /* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
 
+#ifndef _MAIN_H_
+#define _MAIN_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "IMU_state.h"
+
+/*******************************************************************************
+Configurazione dei sensori
+*******************************************************************************/
+#define IMU_NUM_SENSORS						2		/* sensori MPU-6050 montati */
+#define IMU_MAX_SENSORS						4		/* massimo numero di sensori gestiti dal voting */
+#define IMU_ADDRESS_AD0_LOW					0xD0	/* indirizzo con il pin AD0 a massa */
+#define IMU_ADDRESS_AD0_HIGH				0xD2	/* indirizzo con il pin AD0 a VCC */
+#define IMU_REG_SHADOW_FIRST				0x0D	/* primo registro scrivibile (SELF_TEST_X) */
+#define IMU_REG_SHADOW_LAST					0x6C	/* ultimo registro scrivibile (PWR_MGMT_2) */
+#define IMU_REG_SHADOW_SIZE					(IMU_REG_SHADOW_LAST - IMU_REG_SHADOW_FIRST + 1)
+#define IMU_BIAS_WINDOW						64		/* campioni della finestra del rilevatore di quiete (potenza di 2) */
+#define IMU_TEMP_POLY_ORDER					3		/* grado del modello del bias in temperatura */
+#define IMU_TEMP_LUT_MIN					(-10)	/* temperatura minima della tabella (gradi C) */
+#define IMU_TEMP_LUT_MAX					80		/* temperatura massima della tabella (gradi C) */
+#define IMU_TEMP_LUT_SIZE					(IMU_TEMP_LUT_MAX - IMU_TEMP_LUT_MIN + 1)	/* un punto per grado */
+#define IMU_CALIB_Q							14		/* bit frazionari delle matrici di calibrazione */
+#define IMU_DECIM_ORDER						2		/* stadi del CIC di decimazione */
+#define IMU_DECIM_CHANNELS					10		/* campi di IMU_raw_struct */
+#define IMU_FILTER_CHANNELS					6		/* accelerometro xyz, giroscopio xyz */
+#define IMU_FILTER_MAX_LOWPASS				2		/* biquad del passa basso (fino al 4 ordine) */
+#define IMU_FILTER_MAX_NOTCH				2		/* notch per le armoniche dei motori */
+#define IMU_FILTER_MAX_STAGES				(IMU_FILTER_MAX_LOWPASS + IMU_FILTER_MAX_NOTCH)
+#define IMU_DISPLAY_PERIOD					200		/* aggiornamento del display (ms) */
+#define IMU_USE_DMP							0		/* 1: carica il DMP e ne legge i quaternioni (serve l'immagine del firmware) */
+
+/* Filtro software: passa basso del secondo ordine a 20 Hz, notch spenti finche'
+   il controllo dei motori non ne imposta il centro (IMU_filter_set_notch).
+   Usato anche da tools/imu_telemrec.c per rieseguire le registrazioni */
+#define IMU_FILTER_CONFIG					{20.0f, 1, {0.0f, 0.0f}, 5.0f}
+
 /*******************************************************************************
 Definzione struttura principale dell'IMU
 *******************************************************************************/
+/* Indici degli assi nei vettori di IMU_data_struct */
+#define IMU_ROLL							0
+#define IMU_PITCH							1
+#define IMU_YAW								2
+
+/* Stato in unita' SI, un vettore contiguo per grandezza (i gradi si ricavano
+   solo quando servono con IMU_angle_deg e IMU_omega_deg) */
 typedef struct
 {
-	float off_RollRad;
-	float off_PitchRad;
-	float off_YawRad;
-	float off_RollDeg;
-	float off_PitchDeg;
-	float off_YawDeg;
-	float off_omegaRollRad;
-	float off_omegaPitchRad;
-	float off_omegaYawRad;
-	float off_omegaRollDeg;
-	float off_omegaPitchDeg;
-	float off_omegaYawDeg;
-	float RollRad;
-	float PitchRad;
-	float YawRad;
-	float RollDeg;
-	float PitchDeg;
-	float YawDeg;
-	float omegaRollRad;
-	float omegaPitchRad;
-	float omegaYawRad;
-	float omegaRollDeg;
-	float omegaPitchDeg;
-	float omegaYawDeg;
-	uint8_t channel;
-	uint8_t slave_address;
-	uint8_t register_number;
+	float angle[3];				/* rollio, beccheggio, imbardata (rad) */
+	float omega[3];				/* velocita' angolari (rad/s) */
+	float off_angle[3];			/* angoli della posizione di riposo (rad) */
+	float off_omega[3];			/* bias del giroscopio (rad/s) */
 
 } IMU_data_struct;
 
+/*******************************************************************************
+Definzione strutture del driver (una istanza per ogni sensore)
+*******************************************************************************/
+/* Campione grezzo, nello stesso ordine dei registri 0x3B-0x4E (il magnetometro
+   arriva da EXT_SENS_DATA, nell'ordine dei registri del magnetometro) */
+typedef struct
+{
+	int16_t accel[3];
+	int16_t temp;
+	int16_t gyro[3];
+	int16_t mag[3];
+
+} IMU_raw_struct;
+
+/* Configurazione del filtro software */
+typedef struct
+{
+	float   lowpass_hz;							/* taglio del passa basso Butterworth (0: spento) */
+	uint8_t lowpass_stages;						/* biquad in cascata: ordine 2 * lowpass_stages */
+	float   notch_hz[IMU_FILTER_MAX_NOTCH];		/* centro dei notch (0: spento, modificabile con IMU_filter_set_notch) */
+	float   notch_q;							/* selettivita' dei notch (0: nessun notch) */
+
+} IMU_filter_config_struct;
+
+/* Configurazione del sensore */
+typedef struct
+{
+	uint8_t  accel_fs;		/* inv_mpu6050_accl_fs_e */
+	uint8_t  gyro_fs;		/* inv_mpu6050_fsr_e */
+	uint8_t  dlpf;			/* inv_mpu6050_filter_e */
+	uint16_t rate_hz;		/* frequenza dei campioni elaborati */
+	uint8_t  decim;			/* sovracampionamento: il sensore campiona a rate_hz * decim (0 o 1: lettura diretta) */
+	bool     bias_zmot;		/* conferma la quiete con il rilevatore zero-motion del sensore */
+	IMU_filter_config_struct filter;
+	uint8_t  mag;			/* magnetometro sul bus ausiliario, IMU_mag_type_e */
+
+} IMU_config_struct;
+
+/* Statistiche di comunicazione e di salute del sensore */
+typedef struct
+{
+	uint32_t samples;
+	uint32_t read_errors;
+	uint32_t write_errors;
+	uint32_t vote_rejects;
+	uint16_t consecutive_errors;
+	uint16_t stuck_count;
+
+} IMU_stats_struct;
+
+/* Copia locale dei registri scrivibili del sensore */
+typedef struct
+{
+	uint8_t shadow[IMU_REG_SHADOW_SIZE];			/* ultimo valore scritto (o da scrivere) */
+	uint8_t dirty[(IMU_REG_SHADOW_SIZE + 7) / 8];	/* un bit per ogni registro ancora da scrivere */
+	uint32_t bursts;								/* transazioni di scrittura eseguite da IMU_reg_flush */
+
+} IMU_regmap_struct;
+
+/* Stima continua del bias del giroscopio */
+typedef struct
+{
+	int16_t  window[IMU_BIAS_WINDOW][6];	/* ultimi campioni grezzi: accelerometro xyz, giroscopio xyz */
+	int32_t  sum[6];						/* somme sulla finestra */
+	int64_t  sumsq[6];						/* somme dei quadrati sulla finestra */
+	uint16_t head;							/* posizione del campione piu' vecchio */
+	uint16_t count;							/* campioni presenti nella finestra */
+	uint16_t zmot_poll;						/* campioni dall'ultima lettura di MOT_DETECT_STATUS */
+	bool     zmot;							/* ultimo stato zero-motion letto dal sensore */
+	bool     still;							/* il sensore e' fermo */
+	uint32_t last_sample;					/* valore di stats.samples all'ultimo aggiornamento */
+	uint32_t updates;						/* aggiornamenti del bias eseguiti */
+
+} IMU_bias_struct;
+
+/* Modello polinomiale del bias in funzione della temperatura, per ogni asse:
+   bias(T) = c[0] + c[1]*dT + c[2]*dT^2 + c[3]*dT^3, con dT = T - ref_temp */
+typedef struct
+{
+	float ref_temp;								/* temperatura di riferimento (gradi C) */
+	float gyro[3][IMU_TEMP_POLY_ORDER + 1];		/* coefficienti del giroscopio (grad/s) */
+	float accel[3][IMU_TEMP_POLY_ORDER + 1];	/* coefficienti dell'accelerometro (g) */
+
+} IMU_tempmodel_struct;
+
+/* Compensazione in temperatura */
+typedef struct
+{
+	bool  enabled;								/* e' stato caricato un modello */
+	IMU_tempmodel_struct model;
+	float lut[IMU_TEMP_LUT_SIZE][6];			/* modello valutato ad ogni grado: giroscopio xyz, accelerometro xyz */
+	float temperature;							/* temperatura dell'ultimo campione (gradi C) */
+	float bias[6];								/* bias all'ultima temperatura: giroscopio xyz, accelerometro xyz */
+
+} IMU_tempcomp_struct;
+
+/* Modello di calibrazione di un sensore a tre assi: v = M * (raw - b).
+   M corregge scala, disallineamento e sensibilita' incrociata (adimensionale,
+   identita' per un sensore ideale), b e' il bias in LSB */
+typedef struct
+{
+	float M[3][3];
+	float b[3];
+
+} IMU_calmodel_struct;
+
+/* Calibrazione del sensore */
+typedef struct
+{
+	bool    loaded;								/* e' stato caricato un modello */
+	IMU_calmodel_struct accel;					/* da calibrazione a sei posizioni */
+	IMU_calmodel_struct gyro;					/* da calibrazione di scala */
+	float   level[3][3];						/* rotazione sensore -> robot misurata all'avvio */
+	int16_t accel_q[3][3];						/* level * accel.M in Q14, usata ad ogni campione */
+	int16_t gyro_q[3][3];						/* level * gyro.M in Q14, usata ad ogni campione */
+	IMU_calmodel_struct mag;					/* ferro duro (b) e dolce (M) del magnetometro */
+	int16_t mag_q[3][3];						/* level * mag.M in Q14 */
+
+} IMU_calib_struct;
+
+/* Acquisizione dalla FIFO con decimazione (CIC), canali nell'ordine di IMU_raw_struct */
+typedef struct
+{
+	bool     enabled;
+	uint8_t  frame;									/* byte per campione nella FIFO (con o senza magnetometro) */
+	uint8_t  channels;								/* canali a 16 bit per campione */
+	uint8_t  factor;								/* campioni in ingresso per ogni uscita */
+	uint8_t  phase;									/* campioni dall'ultima uscita */
+	uint8_t  settle;								/* uscite da scartare dopo un azzeramento */
+	int32_t  gain;									/* guadagno del CIC, factor ^ IMU_DECIM_ORDER */
+	uint32_t integ[IMU_DECIM_ORDER][IMU_DECIM_CHANNELS];	/* integratori (aritmetica modulo 2^32) */
+	uint32_t comb[IMU_DECIM_ORDER][IMU_DECIM_CHANNELS];		/* ritardi dei derivatori */
+	float    out[IMU_DECIM_CHANNELS];				/* ultima uscita in LSB, senza arrotondamento */
+	uint32_t frames;								/* campioni letti dalla FIFO */
+	uint32_t outputs;
+	uint32_t overflows;								/* FIFO piena o disallineata, svuotata */
+	uint16_t noise_count;							/* uscite accumulate nel blocco di stima del rumore */
+	float    noise_ref[6];							/* primo valore del blocco (riduce la cancellazione) */
+	float    noise_sum[6];
+	float    noise_sumsq[6];
+	float    noise_density[6];						/* rumore in uscita: g/sqrt(Hz) xyz, grad/s/sqrt(Hz) xyz */
+
+} IMU_decim_struct;
+
+/* Coefficienti di un biquad, normalizzati con a0 = 1 */
+typedef struct
+{
+	float b0, b1, b2;
+	float a1, a2;
+
+} IMU_biquad_struct;
+
+/* Banco di biquad in forma diretta II trasposta: coefficienti comuni ai sei
+   canali, stato separato per ogni canale */
+typedef struct
+{
+	uint8_t num_stages;							/* passa basso, poi i notch */
+	uint8_t notch_first;						/* indice del primo notch */
+	bool    active[IMU_FILTER_MAX_STAGES];		/* gli stadi spenti vengono saltati */
+	bool    primed;								/* stato inizializzato sul primo campione */
+	float   fs;									/* frequenza di campionamento (Hz) */
+	float   notch_q;
+	float   notch_hz[IMU_FILTER_MAX_NOTCH];		/* centro attuale dei notch */
+	IMU_biquad_struct coef[IMU_FILTER_MAX_STAGES];
+	float   z1[IMU_FILTER_MAX_STAGES][IMU_FILTER_CHANNELS];
+	float   z2[IMU_FILTER_MAX_STAGES][IMU_FILTER_CHANNELS];
+
+} IMU_filter_struct;
+
+/* Scrittura di configurazione nella memoria del DMP */
+typedef struct
+{
+	uint16_t addr;
+	uint8_t  len;
+	const uint8_t *data;
+
+} IMU_dmp_key_struct;
+
+/* Firmware del DMP (fornito dal produttore, non incluso nel progetto) */
+typedef struct
+{
+	const uint8_t *code;						/* immagine da caricare dall'indirizzo 0 */
+	uint16_t size;
+	uint16_t start;								/* indirizzo di partenza del programma */
+	const IMU_dmp_key_struct *keys;				/* configurazione dell'uscita a quaternioni a 6 assi */
+	uint8_t  num_keys;
+	uint8_t  packet_len;						/* byte di un pacchetto nella FIFO (quaternione in testa) */
+
+} IMU_dmp_image_struct;
+
+/* Stato del DMP */
+typedef struct
+{
+	bool     enabled;							/* il DMP e' caricato e scrive nella FIFO */
+	uint8_t  packet_len;
+	uint16_t rate_hz;							/* frequenza dei pacchetti */
+	float    quat[4];							/* ultimo quaternione: w, x, y, z */
+	float    angle[3];							/* angoli negli assi del robot (rad, IMU_ROLL..IMU_YAW) */
+	bool     valid;								/* angle viene da un quaternione valido */
+	float    off_angle[3];						/* angoli del primo quaternione valido (posizione di riposo) */
+	bool     off_valid;							/* off_angle e' stato misurato */
+	bool     restarting;						/* FIFO e DMP in reset dopo un overflow */
+	int32_t  restart_ms;						/* istante (get_ms) in cui riaccenderli */
+	uint16_t latency_ms;						/* ritardo dell'ultimo pacchetto (pacchetti rimasti in FIFO) */
+	uint32_t packets;
+	uint32_t overflows;							/* FIFO piena o disallineata, svuotata */
+	uint32_t bad_packets;						/* quaternioni con norma lontana da 1 */
+
+} IMU_dmp_struct;
+
+/* Stato di alimentazione del sensore (IMU_power_set) */
+typedef struct
+{
+	uint8_t  state;								/* IMU_power_state_e */
+	uint8_t  wake_rate;							/* inv_mpu6050_lp_wake_e, negli stati a ciclo */
+	uint8_t  hpf;								/* filtro passa alto da ripristinare dopo il wake-on-motion */
+	int32_t  ready_ms;							/* get_ms() da cui i dati sono validi dopo l'avvio */
+	uint32_t transitions;
+	uint32_t wakeups;							/* risvegli per movimento */
+
+} IMU_power_struct;
+
+/* Magnetometro sul bus ausiliario, letto dal master I2C del sensore */
+typedef struct
+{
+	bool     enabled;							/* trovato e configurato */
+	uint8_t  type;								/* IMU_mag_type_e */
+	float    scale;								/* gauss per LSB */
+	float    field[3];							/* campo calibrato, assi del robot (gauss) */
+	float    heading;							/* direzione del nord magnetico compensata in inclinazione (rad) */
+	float    yaw;								/* imbardata fusa con il giroscopio (rad, [-pi, pi]) */
+	bool     fused;								/* yaw inizializzata dalla prima misura */
+	uint32_t samples;
+	uint32_t saturated;							/* campioni fuori scala, scartati */
+	uint32_t errors;							/* magnetometro non trovato o transazioni fallite */
+
+} IMU_mag_struct;
+
+/* Calibrazione a passi, un passo per periodo di campionamento */
+typedef struct
+{
+	uint8_t  phase;								/* IMU_recal_phase_e */
+	uint8_t  count;								/* passi della fase */
+	uint8_t  valid;								/* campioni sommati nella fase */
+	uint16_t result;							/* riic_ret_t dell'ultima calibrazione */
+	uint32_t last_sample;						/* stats.samples al passo precedente */
+	float    sum[3];							/* somma dei campioni calibrati */
+
+} IMU_recal_struct;
+
+/* Handle del sensore */
+typedef struct
+{
+	uint8_t channel;			/* canale RIIC (CHANNEL_0, CHANNEL_2, ...) */
+	uint8_t slave_address;		/* IMU_ADDRESS_AD0_LOW o IMU_ADDRESS_AD0_HIGH */
+	bool ready;					/* inizializzazione e calibrazione completate */
+	bool online;				/* il sensore partecipa al voting */
+	uint16_t recovery_count;	/* slot trascorsi dall'ultimo tentativo su un sensore escluso */
+	float accel_scale;			/* g per LSB, dipende da config.accel_fs */
+	float gyro_scale;			/* grad/s per LSB, dipende da config.gyro_fs */
+	IMU_config_struct config;
+	IMU_regmap_struct regmap;
+	IMU_raw_struct raw;
+	IMU_data_struct data;		/* calibrazione e risultati del singolo sensore */
+	IMU_bias_struct bias;
+	IMU_tempcomp_struct tempcomp;
+	IMU_calib_struct calib;
+	IMU_mag_struct mag;
+	IMU_decim_struct decim;
+	IMU_filter_struct filter;
+	IMU_dmp_struct dmp;
+	IMU_power_struct power;
+	IMU_recal_struct recal;
+	IMU_stats_struct stats;
+
+} IMU_dev_struct;
+
 /*******************************************************************************
 Prototipi funzioni
 *******************************************************************************/
-void IMU_init(IMU_data_struct *x);
-void IMU_result(IMU_data_struct *x);
-void IMU_update(IMU_data_struct *x);
+void IMU_init(IMU_dev_struct *dev, uint8_t num_dev);
+void IMU_result(IMU_dev_struct *dev, uint8_t num_dev, IMU_data_struct *x);
+void IMU_update(const IMU_state_struct *state);
+void IMU_show_status(const IMU_dev_struct *dev, uint8_t num_dev);
+float IMU_angle_deg(const IMU_data_struct *x, uint8_t axis);
+float IMU_omega_deg(const IMU_data_struct *x, uint8_t axis);
 
+#endif /* _MAIN_H_ */
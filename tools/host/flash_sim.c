@@ -0,0 +1,222 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Emulatore host della data flash E2: sostituisce src/IMU_flash.c.
+* Cancellazioni e programmazioni durano un tempo simulato e terminano in
+* flash_sim_advance, che chiama la funzione registrata come farebbe
+* l'interrupt FRDYI (anche piu' volte, se le operazioni concatenate finiscono
+* entro l'intervallo). Come nel dispositivo reale le celle cancellate hanno
+* contenuto indefinito (qui casuale) e si puo' programmare solo una zona
+* cancellata. flash_sim_power_cut interrompe l'operazione in corso lasciando
+* la zona con contenuto casuale. Conta le cancellazioni di ogni blocco per
+* verificare la distribuzione dell'usura.
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <string.h>
+#include "IMU_flash.h"
+#include "flash_sim.h"
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+flash_sim_struct flash_sim;
+
+static uint8_t sim_status = IMU_FLASH_ERROR;
+static void (*sim_done)(void);
+static uint32_t sim_rand_state = 1;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static void sim_garbage (uint8_t *p, uint32_t n);
+static void sim_complete (void);
+
+/*******************************************************************************
+* Nome funzione     : flash_sim_reset
+* Descrizione  	    : Data flash mai cancellata (contenuto casuale), contatori
+* 					  azzerati, FCU da inizializzare
+*******************************************************************************/
+void flash_sim_reset(uint32_t seed)
+{
+	memset(&flash_sim, 0, sizeof(flash_sim));
+	sim_rand_state = seed ? seed : 1;
+	sim_garbage(flash_sim.mem, IMU_FLASH_SIZE);
+	sim_status = IMU_FLASH_ERROR;
+	sim_done = 0;
+
+} /* Fine flash_sim_reset() */
+
+/*******************************************************************************
+* Nome funzione     : flash_sim_advance
+* Descrizione  	    : Avanza il tempo simulato e completa le operazioni che
+* 					  finiscono nell'intervallo
+*******************************************************************************/
+void flash_sim_advance(uint32_t us)
+{
+	uint32_t target = flash_sim.now_us + us;
+
+	while (flash_sim.busy && ((int32_t)(flash_sim.done_us - target) <= 0))
+	{
+		/* La prossima operazione parte alla fine di questa */
+		flash_sim.now_us = flash_sim.done_us;
+		sim_complete();
+		if (sim_done) {
+			sim_done();
+		}
+	}
+	flash_sim.now_us = target;
+
+} /* Fine flash_sim_advance() */
+
+/*******************************************************************************
+* Nome funzione     : flash_sim_power_cut
+* Descrizione  	    : Mancanza di alimentazione: l'operazione in corso lascia
+* 					  la zona con contenuto casuale e il FCU va reinizializzato
+*******************************************************************************/
+void flash_sim_power_cut(void)
+{
+	uint32_t off = flash_sim.op_offset;
+	uint32_t n = ('E' == flash_sim.op) ? IMU_FLASH_BLOCK : IMU_FLASH_WRITE;
+	uint32_t i;
+
+	if (flash_sim.busy)
+	{
+		sim_garbage(&flash_sim.mem[off], n);
+		for (i = 0; i < n / IMU_FLASH_WRITE; i++) {
+			flash_sim.blank[off / IMU_FLASH_WRITE + i] = false;
+		}
+	}
+	flash_sim.busy = false;
+	sim_status = IMU_FLASH_ERROR;
+	sim_done = 0;
+
+} /* Fine flash_sim_power_cut() */
+
+/*******************************************************************************
+* Funzioni di src/IMU_flash.c
+*******************************************************************************/
+bool IMU_flash_init(void (*done)(void))
+{
+	sim_done = done;
+	sim_status = IMU_FLASH_OK;
+	flash_sim.busy = false;
+
+	return true;
+}
+
+bool IMU_flash_erase(uint32_t offset)
+{
+	if (flash_sim.busy)
+	{
+		flash_sim.busy_calls++;
+		return false;
+	}
+	if ((offset >= IMU_FLASH_SIZE) || (offset % IMU_FLASH_BLOCK))
+	{
+		flash_sim.errors++;
+		offset -= offset % IMU_FLASH_BLOCK;
+		if (offset >= IMU_FLASH_SIZE) {
+			return false;
+		}
+	}
+
+	flash_sim.busy = true;
+	flash_sim.op = 'E';
+	flash_sim.op_offset = offset;
+	flash_sim.done_us = flash_sim.now_us + FLASH_SIM_ERASE_US;
+	sim_status = IMU_FLASH_BUSY;
+
+	return true;
+}
+
+bool IMU_flash_program(uint32_t offset, const uint8_t *data)
+{
+	if (flash_sim.busy)
+	{
+		flash_sim.busy_calls++;
+		return false;
+	}
+	if ((offset >= IMU_FLASH_SIZE) || (offset % IMU_FLASH_WRITE))
+	{
+		flash_sim.errors++;
+		return false;
+	}
+
+	flash_sim.busy = true;
+	flash_sim.op = 'P';
+	flash_sim.op_offset = offset;
+	memcpy(flash_sim.op_data, data, IMU_FLASH_WRITE);
+	flash_sim.done_us = flash_sim.now_us + FLASH_SIM_PROGRAM_US;
+	sim_status = IMU_FLASH_BUSY;
+
+	return true;
+}
+
+uint8_t IMU_flash_status(void)
+{
+	return sim_status;
+}
+
+void IMU_flash_read(uint32_t offset, void *out, uint16_t n)
+{
+	/* Durante un'operazione la data flash non e' leggibile */
+	if (flash_sim.busy || (offset + n > IMU_FLASH_SIZE))
+	{
+		flash_sim.errors++;
+		sim_garbage(out, n);
+		return;
+	}
+	memcpy(out, &flash_sim.mem[offset], n);
+}
+
+/*******************************************************************************
+* Nome funzione     : sim_complete
+* Descrizione  	    : Effetto dell'operazione terminata
+*******************************************************************************/
+static void sim_complete(void)
+{
+	uint32_t off = flash_sim.op_offset;
+	uint32_t i;
+
+	flash_sim.busy = false;
+	sim_status = IMU_FLASH_OK;
+
+	if ('E' == flash_sim.op)
+	{
+		sim_garbage(&flash_sim.mem[off], IMU_FLASH_BLOCK);
+		for (i = 0; i < IMU_FLASH_BLOCK / IMU_FLASH_WRITE; i++) {
+			flash_sim.blank[off / IMU_FLASH_WRITE + i] = true;
+		}
+		flash_sim.erase_count[off / IMU_FLASH_BLOCK]++;
+		flash_sim.erases++;
+	}
+	else if (flash_sim.blank[off / IMU_FLASH_WRITE])
+	{
+		memcpy(&flash_sim.mem[off], flash_sim.op_data, IMU_FLASH_WRITE);
+		flash_sim.blank[off / IMU_FLASH_WRITE] = false;
+		flash_sim.programs++;
+	}
+	else
+	{
+		flash_sim.errors++;
+		sim_status = IMU_FLASH_ERROR;
+	}
+
+} /* Fine sim_complete() */
+
+/*******************************************************************************
+* Nome funzione     : sim_garbage
+* Descrizione  	    : Contenuto indefinito (generatore congruenziale)
+*******************************************************************************/
+static void sim_garbage(uint8_t *p, uint32_t n)
+{
+	while (n-- > 0)
+	{
+		sim_rand_state = sim_rand_state * 1103515245UL + 12345UL;
+		*p++ = (uint8_t)(sim_rand_state >> 16);
+	}
+
+} /* Fine sim_garbage() */
@@ -0,0 +1,52 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _FLASH_SIM_H_
+#define _FLASH_SIM_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "IMU_flash.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define FLASH_SIM_ERASE_US					2000	/* cancellazione di un blocco (tempo simulato) */
+#define FLASH_SIM_PROGRAM_US				400		/* programmazione di IMU_FLASH_WRITE byte */
+
+/*******************************************************************************
+Definizione strutture
+*******************************************************************************/
+typedef struct
+{
+	uint8_t  mem[IMU_FLASH_SIZE];
+	bool     blank[IMU_FLASH_SIZE / IMU_FLASH_WRITE];	/* unita' cancellate e non ancora programmate */
+	uint32_t erase_count[IMU_FLASH_BLOCKS];
+	uint32_t now_us;				/* tempo simulato */
+	uint32_t done_us;				/* fine dell'operazione in corso */
+	bool     busy;
+	uint8_t  op;					/* operazione in corso: 'E' o 'P' */
+	uint32_t op_offset;
+	uint8_t  op_data[IMU_FLASH_WRITE];
+	uint32_t erases;
+	uint32_t programs;
+	uint32_t errors;				/* programmazioni su zone non cancellate, indirizzi errati */
+	uint32_t busy_calls;			/* comandi rifiutati con il FCU occupato */
+
+} flash_sim_struct;
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+extern flash_sim_struct flash_sim;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+void flash_sim_reset(uint32_t seed);
+void flash_sim_advance(uint32_t us);
+void flash_sim_power_cut(void);
+
+#endif /* _FLASH_SIM_H_ */
@@ -0,0 +1,49 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Sostituto di <machine.h> di CC-RX: le funzioni intrinseche usate dal firmware
+* riscritte in C, con lo stesso risultato delle istruzioni RX
+*******************************************************************************/
+
+#ifndef _HOST_MACHINE_H_
+#define _HOST_MACHINE_H_
+
+static inline void nop(void) {}
+static inline void setpsw_i(void) {}
+static inline void clrpsw_i(void) {}
+static inline void wait(void) {}
+static inline unsigned long get_psw(void) { return 0; }
+static inline void set_psw(unsigned long psw) { (void)psw; }
+
+static inline long xchg(long *a, long *b)
+{
+	long t = *a;
+	*a = *b;
+	*b = t;
+	return t;
+}
+
+/* MULLO/MACLO: somma dei prodotti 16x16 bit */
+static inline long macl(short *a, short *b, unsigned long n)
+{
+	long s = 0;
+	unsigned long i;
+
+	for (i = 0; i < n; i++) {
+		s += (long)a[i] * b[i];
+	}
+	return s;
+}
+
+/* RMPA.W: somma dei prodotti 16x16 bit con accumulatore a 64 bit */
+static inline long long rmpaw(long long init, unsigned long n, short *a, short *b)
+{
+	unsigned long i;
+
+	for (i = 0; i < n; i++) {
+		init += (long long)a[i] * b[i];
+	}
+	return init;
+}
+
+#endif /* _HOST_MACHINE_H_ */
@@ -0,0 +1,10 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/* Sostituto di <mathf.h> di CC-RX: sull'host le funzioni float sono in <math.h> */
+
+#ifndef _HOST_MATHF_H_
+#define _HOST_MATHF_H_
+
+#include <math.h>
+
+#endif /* _HOST_MATHF_H_ */
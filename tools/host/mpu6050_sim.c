@@ -0,0 +1,380 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Simulatore host di MPU-6050 collegati al bus IIC: sostituisce le funzioni del
+* driver RIIC, del CMT e di sbrk usate dal firmware, cosi' i moduli in src/ possono
+* essere eseguiti e verificati sull'host senza modifiche.
+* Modella i registri, la memoria a banchi del DMP (BANK_SEL, MEM_START_ADDR,
+* MEM_R_W) e la FIFO. Come nel sensore reale, il puntatore al registro avanza
+* ad ogni byte tranne che su MEM_R_W e FIFO_R_W.
+* Un magnetometro sul bus ausiliario (mag_addr, mag_regs) risponde al master
+* I2C: lo slave 4 esegue subito la transazione alla scrittura di SLV_EN e lo
+* slave 0 copia i suoi registri in EXT_SENS_DATA a ogni lettura.
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <string.h>
+#include "platform.h"
+#include "CMT.h"
+#include "r_riic_rx600.h"
+#include "r_riic_rx600_master.h"
+#include "mpu6050_sim.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define SIM_REG_BANK_SEL					0x6D
+#define SIM_REG_MEM_START_ADDR				0x6E
+#define SIM_REG_MEM_R_W						0x6F
+#define SIM_REG_FIFO_COUNT_H				0x72
+#define SIM_REG_FIFO_COUNT_L				0x73
+#define SIM_REG_FIFO_R_W					0x74
+#define SIM_REG_USER_CTRL					0x6A
+#define SIM_REG_PWR_MGMT_1					0x6B
+#define SIM_REG_WHO_AM_I					0x75
+#define SIM_REG_I2C_SLV0_ADDR				0x25
+#define SIM_REG_I2C_SLV0_REG				0x26
+#define SIM_REG_I2C_SLV0_CTRL				0x27
+#define SIM_REG_I2C_SLV4_ADDR				0x31
+#define SIM_REG_I2C_SLV4_REG				0x32
+#define SIM_REG_I2C_SLV4_DO					0x33
+#define SIM_REG_I2C_SLV4_CTRL				0x34
+#define SIM_REG_I2C_SLV4_DI					0x35
+#define SIM_REG_I2C_MST_STATUS				0x36
+#define SIM_REG_EXT_SENS_DATA_00			0x49
+#define SIM_EXT_SENS_DATA_LEN				24
+#define SIM_USER_CTRL_SELF_CLEAR			0x0F
+#define SIM_USER_CTRL_FIFO_RST				0x04
+#define SIM_USER_CTRL_I2C_MST_EN			0x20
+#define SIM_SLV_EN							0x80
+#define SIM_SLV_BYTE_SW						0x40
+#define SIM_SLV_LEN							0x0F
+#define SIM_I2C_READ						0x80
+#define SIM_MST_STATUS_SLV4_DONE			0x40
+#define SIM_MST_STATUS_SLV4_NACK			0x10
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+mpu6050_sim_struct mpu6050_sim[MPU6050_SIM_DEVICES];
+
+static int32_t sim_ms;				/* tempo simulato */
+static int8_t  sim_dev = -1;		/* sensore indirizzato dall'ultima intestazione */
+static uint8_t sim_reg;				/* registro corrente */
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static void sim_power_on (mpu6050_sim_struct *s);
+static void sim_write (mpu6050_sim_struct *s, uint8_t reg, uint8_t value);
+static uint8_t sim_read (mpu6050_sim_struct *s, uint8_t reg);
+static void sim_slv4 (mpu6050_sim_struct *s);
+static uint8_t sim_ext_sens (const mpu6050_sim_struct *s, uint8_t k);
+
+/*******************************************************************************
+* Nome funzione     : mpu6050_sim_reset
+* Descrizione  	    : Riporta tutti i sensori simulati allo stato di accensione
+*******************************************************************************/
+void mpu6050_sim_reset(void)
+{
+	uint8_t i;
+
+	for (i = 0; i < MPU6050_SIM_DEVICES; i++)
+	{
+		memset(&mpu6050_sim[i], 0, sizeof(mpu6050_sim[i]));
+		sim_power_on(&mpu6050_sim[i]);
+	}
+	sim_dev = -1;
+
+} /* Fine mpu6050_sim_reset() */
+
+/*******************************************************************************
+* Nome funzione     : mpu6050_sim_fifo_push
+* Descrizione  	    : Accoda dati nella FIFO, come farebbe il DMP; i byte in
+* 					  eccesso vengono persi come nel sensore
+*******************************************************************************/
+void mpu6050_sim_fifo_push(uint8_t dev, const uint8_t *data, uint16_t len)
+{
+	mpu6050_sim_struct *s = &mpu6050_sim[dev];
+
+	while ((len-- > 0) && (s->fifo_count < MPU6050_SIM_FIFO_SIZE)) {
+		s->fifo[s->fifo_count++] = *data++;
+	}
+
+} /* Fine mpu6050_sim_fifo_push() */
+
+/*******************************************************************************
+* Funzioni del driver RIIC
+*******************************************************************************/
+riic_ret_t R_RIIC_Init(riic_config_t *settings)
+{
+	(void)settings;
+	return RIIC_OK;
+}
+
+riic_ret_t R_RIIC_MasterTransmitHead(uint8_t channel, uint8_t *p_data_buff, const uint32_t num_bytes)
+{
+	(void)channel;
+	sim_dev = -1;
+	if ((num_bytes < 2) || (0xD0 != (p_data_buff[0] & 0xFC))) {
+		return RIIC_NACK_ERR;
+	}
+	sim_dev = (p_data_buff[0] >> 1) & 0x01;
+	sim_reg = p_data_buff[1];
+	mpu6050_sim[sim_dev].transactions++;
+	return RIIC_OK;
+}
+
+riic_ret_t R_RIIC_MasterTransmit(uint8_t channel, uint8_t *p_data_buff, const uint32_t num_bytes)
+{
+	mpu6050_sim_struct *s;
+	uint32_t i;
+
+	(void)channel;
+	if (sim_dev < 0) {
+		return RIIC_NACK_ERR;
+	}
+	s = &mpu6050_sim[sim_dev];
+
+	if (SIM_REG_MEM_R_W == sim_reg)
+	{
+		s->mem_bursts++;
+		if (s->mem_addr + num_bytes > 256) {
+			s->bank_wraps++;
+		}
+	}
+	for (i = 0; i < num_bytes; i++)
+	{
+		sim_write(s, sim_reg, p_data_buff[i]);
+		if ((SIM_REG_MEM_R_W != sim_reg) && (SIM_REG_FIFO_R_W != sim_reg)) {
+			sim_reg++;
+		}
+	}
+	return RIIC_OK;
+}
+
+riic_ret_t R_RIIC_MasterReceive(uint8_t channel, uint8_t slave_addr, uint8_t *p_data_buff, const uint32_t num_bytes)
+{
+	mpu6050_sim_struct *s;
+	uint32_t i;
+
+	(void)channel;
+	if ((sim_dev < 0) || (((slave_addr >> 1) & 0x01) != sim_dev)) {
+		return RIIC_NACK_ERR;
+	}
+	s = &mpu6050_sim[sim_dev];
+
+	for (i = 0; i < num_bytes; i++)
+	{
+		p_data_buff[i] = sim_read(s, sim_reg);
+		if ((SIM_REG_MEM_R_W != sim_reg) && (SIM_REG_FIFO_R_W != sim_reg)) {
+			sim_reg++;
+		}
+	}
+	return RIIC_OK;
+}
+
+/*******************************************************************************
+* Funzioni del CMT (tempo simulato)
+*******************************************************************************/
+void CMT_init(void)
+{
+}
+
+int32_t get_ms(void)
+{
+	return sim_ms;
+}
+
+void ms_delay(int32_t t)
+{
+	sim_ms += t;
+}
+
+void CMT_counter_init(void)
+{
+}
+
+uint16_t CMT_counter(void)
+{
+	return (uint16_t)(sim_ms * (PCLK_HZ / 8 / 1000));
+}
+
+/*******************************************************************************
+* Heap della BSP (sbrk.c): sull'host la libreria C usa il suo
+*******************************************************************************/
+size_t sbrk_used(void)
+{
+	return 0;
+}
+
+/*******************************************************************************
+* Nome funzione     : sim_power_on
+* Descrizione  	    : Valori dei registri all'accensione
+*******************************************************************************/
+static void sim_power_on(mpu6050_sim_struct *s)
+{
+	memset(s->regs, 0, sizeof(s->regs));
+	s->regs[SIM_REG_PWR_MGMT_1] = 0x40;
+	s->regs[SIM_REG_WHO_AM_I] = 0x68;
+	s->fifo_count = 0;
+
+} /* Fine sim_power_on() */
+
+/*******************************************************************************
+* Nome funzione     : sim_write
+* Descrizione  	    : Scrittura di un byte in un registro
+*******************************************************************************/
+static void sim_write(mpu6050_sim_struct *s, uint8_t reg, uint8_t value)
+{
+	switch (reg)
+	{
+		case SIM_REG_BANK_SEL:
+			s->bank = value;
+			break;
+		case SIM_REG_MEM_START_ADDR:
+			s->mem_addr = value;
+			break;
+		case SIM_REG_MEM_R_W:
+			if (s->corrupt_writes > 0)
+			{
+				s->corrupt_writes--;
+				value ^= 0x01;
+			}
+			s->mem[((uint16_t)(s->bank & 0x0F) << 8) | s->mem_addr] = value;
+			s->mem_addr++;
+			break;
+		case SIM_REG_USER_CTRL:
+			if (value & SIM_USER_CTRL_FIFO_RST) {
+				s->fifo_count = 0;
+			}
+			s->regs[reg] = value & ~SIM_USER_CTRL_SELF_CLEAR;
+			break;
+		case SIM_REG_PWR_MGMT_1:
+			if (value & 0x80) {
+				sim_power_on(s);
+			}
+			else {
+				s->regs[reg] = value;
+			}
+			break;
+		case SIM_REG_I2C_SLV4_CTRL:
+			s->regs[reg] = value;
+			if (value & SIM_SLV_EN) {
+				sim_slv4(s);
+			}
+			break;
+		case SIM_REG_FIFO_R_W:
+		case SIM_REG_WHO_AM_I:
+		case SIM_REG_I2C_SLV4_DI:
+		case SIM_REG_I2C_MST_STATUS:
+			break;
+		default:
+			if (reg < sizeof(s->regs)) {
+				s->regs[reg] = value;
+			}
+			break;
+	}
+
+} /* Fine sim_write() */
+
+/*******************************************************************************
+* Nome funzione     : sim_read
+* Descrizione  	    : Lettura di un byte da un registro
+*******************************************************************************/
+static uint8_t sim_read(mpu6050_sim_struct *s, uint8_t reg)
+{
+	uint8_t value;
+
+	switch (reg)
+	{
+		case SIM_REG_BANK_SEL:
+			return s->bank;
+		case SIM_REG_MEM_START_ADDR:
+			return s->mem_addr;
+		case SIM_REG_MEM_R_W:
+			value = s->mem[((uint16_t)(s->bank & 0x0F) << 8) | s->mem_addr];
+			s->mem_addr++;
+			return value;
+		case SIM_REG_FIFO_COUNT_H:
+			return (uint8_t)(s->fifo_count >> 8);
+		case SIM_REG_FIFO_COUNT_L:
+			return (uint8_t)(s->fifo_count & 0xFF);
+		case SIM_REG_FIFO_R_W:
+			if (0 == s->fifo_count) {
+				return 0;
+			}
+			value = s->fifo[0];
+			memmove(s->fifo, s->fifo + 1, --s->fifo_count);
+			return value;
+		case SIM_REG_I2C_MST_STATUS:
+			/* Si azzera con la lettura */
+			value = s->regs[reg];
+			s->regs[reg] = 0;
+			return value;
+		default:
+			if ((reg >= SIM_REG_EXT_SENS_DATA_00) && (reg < SIM_REG_EXT_SENS_DATA_00 + SIM_EXT_SENS_DATA_LEN)) {
+				return sim_ext_sens(s, reg - SIM_REG_EXT_SENS_DATA_00);
+			}
+			return (reg < sizeof(s->regs)) ? s->regs[reg] : 0;
+	}
+
+} /* Fine sim_read() */
+
+/*******************************************************************************
+* Nome funzione     : sim_slv4
+* Descrizione  	    : Transazione dello slave 4 sul bus ausiliario: un byte
+* 					  letto in SLV4_DI o scritto da SLV4_DO; SLV_EN si azzera
+* 					  e I2C_MST_STATUS riporta la fine o il NACK
+*******************************************************************************/
+static void sim_slv4(mpu6050_sim_struct *s)
+{
+	uint8_t addr = s->regs[SIM_REG_I2C_SLV4_ADDR];
+	uint8_t reg = s->regs[SIM_REG_I2C_SLV4_REG];
+
+	s->regs[SIM_REG_I2C_SLV4_CTRL] &= (uint8_t)~SIM_SLV_EN;
+
+	if (!(s->regs[SIM_REG_USER_CTRL] & SIM_USER_CTRL_I2C_MST_EN) || (0 == s->mag_addr) ||
+		((addr & ~SIM_I2C_READ) != s->mag_addr) || (reg >= MPU6050_SIM_MAG_REGS))
+	{
+		s->regs[SIM_REG_I2C_MST_STATUS] |= SIM_MST_STATUS_SLV4_NACK;
+		return;
+	}
+
+	if (addr & SIM_I2C_READ) {
+		s->regs[SIM_REG_I2C_SLV4_DI] = s->mag_regs[reg];
+	}
+	else
+	{
+		s->mag_regs[reg] = s->regs[SIM_REG_I2C_SLV4_DO];
+		s->mag_writes++;
+	}
+	s->regs[SIM_REG_I2C_MST_STATUS] |= SIM_MST_STATUS_SLV4_DONE;
+
+} /* Fine sim_slv4() */
+
+/*******************************************************************************
+* Nome funzione     : sim_ext_sens
+* Descrizione  	    : Byte k di EXT_SENS_DATA: i registri del magnetometro
+* 					  letti dallo slave 0, con le coppie invertite da BYTE_SW
+*******************************************************************************/
+static uint8_t sim_ext_sens(const mpu6050_sim_struct *s, uint8_t k)
+{
+	uint8_t ctrl = s->regs[SIM_REG_I2C_SLV0_CTRL];
+	uint8_t addr = s->regs[SIM_REG_I2C_SLV0_ADDR];
+	uint16_t reg;
+
+	if (!(s->regs[SIM_REG_USER_CTRL] & SIM_USER_CTRL_I2C_MST_EN) || !(ctrl & SIM_SLV_EN) ||
+		!(addr & SIM_I2C_READ) || (0 == s->mag_addr) || ((addr & ~SIM_I2C_READ) != s->mag_addr) ||
+		(k >= (ctrl & SIM_SLV_LEN)))
+	{
+		return 0;
+	}
+
+	reg = s->regs[SIM_REG_I2C_SLV0_REG] + ((ctrl & SIM_SLV_BYTE_SW) ? (k ^ 1) : k);
+
+	return (reg < MPU6050_SIM_MAG_REGS) ? s->mag_regs[reg] : 0;
+
+} /* Fine sim_ext_sens() */
@@ -0,0 +1,51 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+#ifndef _MPU6050_SIM_H_
+#define _MPU6050_SIM_H_
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdint.h>
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define MPU6050_SIM_DEVICES					2		/* AD0 basso e AD0 alto */
+#define MPU6050_SIM_MEM_SIZE				4096	/* memoria del DMP: 16 banchi da 256 byte */
+#define MPU6050_SIM_FIFO_SIZE				1024
+#define MPU6050_SIM_MAG_REGS				16		/* registri del magnetometro sul bus ausiliario */
+
+/*******************************************************************************
+Definizione strutture
+*******************************************************************************/
+typedef struct
+{
+	uint8_t  regs[128];
+	uint8_t  mem[MPU6050_SIM_MEM_SIZE];
+	uint8_t  fifo[MPU6050_SIM_FIFO_SIZE];
+	uint16_t fifo_count;
+	uint8_t  bank;
+	uint8_t  mem_addr;
+	uint32_t transactions;					/* transazioni IIC ricevute */
+	uint32_t mem_bursts;					/* scritture in MEM_R_W */
+	uint32_t bank_wraps;					/* scritture che hanno superato la fine di un banco */
+	uint16_t corrupt_writes;				/* prossime scritture in MEM_R_W da alterare */
+	uint8_t  mag_addr;						/* magnetometro sul bus ausiliario (7 bit, 0: assente) */
+	uint8_t  mag_regs[MPU6050_SIM_MAG_REGS];
+	uint16_t mag_writes;					/* scritture dello slave 4 nel magnetometro */
+
+} mpu6050_sim_struct;
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+extern mpu6050_sim_struct mpu6050_sim[MPU6050_SIM_DEVICES];
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+void mpu6050_sim_reset(void);
+void mpu6050_sim_fifo_push(uint8_t dev, const uint8_t *data, uint16_t len);
+
+#endif /* _MPU6050_SIM_H_ */
@@ -0,0 +1,28 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Sostituto di r_bsp/platform.h per compilare i moduli del firmware sull'host
+* con gcc (gli include di r_bsp usano percorsi Windows e estensioni di CC-RX).
+* I registri di iodefine.h restano dichiarati ma non vanno mai toccati: i
+* simulatori in tools/host sostituiscono le funzioni che li usano.
+*******************************************************************************/
+
+#ifndef _HOST_PLATFORM_H_
+#define _HOST_PLATFORM_H_
+
+#define PLATFORM_BOARD_RDKRX63N
+#define PLATFORM_DEFINED
+#define __evenaccess
+
+/* Sezioni del linker: sull'host non esistono (vuote) */
+#define __sectop(s)							((void *)0)
+#define __secend(s)							((void *)0)
+
+#include "iodefine.h"
+#include "yrdkrx63n.h"
+#include "mcu_info.h"
+#include "hwsetup.h"
+#include "lcd.h"
+#include "sbrk.h"
+
+#endif /* _HOST_PLATFORM_H_ */
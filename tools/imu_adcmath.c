@@ -0,0 +1,332 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Strumento host: verifica la matematica degli ingressi analogici di
+* src/S12ADC.c (modo di addizione del convertitore e decimazione software)
+*   - S12ADC_counts e S12ADC_counts_ext rispetto al calcolo esatto, per ogni
+*     numero di addizioni (1..S12ADC_ADD_MAX) e di scansioni sommate
+*     (1..S12ADC_DECIM_MAX), senza traboccamenti a fondo scala
+*   - riduzione del rumore con il numero di campioni, su un ingresso
+*     simulato con rumore gaussiano
+*   - conversioni in volt, ampere e posizione del potenziometro
+*   - controlli di S12ADC_scan_addition e casi limite (canale fuori dalla
+*     scansione, risultato senza campioni)
+* Le somme sono costruite come le costruiscono il convertitore (ADDRn) e
+* l'interrupt del DMAC1; i registri non vengono toccati.
+*
+* Compilazione: gcc -O2 -D__evenaccess= -Ihost -I../src -I../r_bsp/mcu/rx63n
+*               -I../r_bsp/board/rdkrx63n -o imu_adcmath imu_adcmath.c ../src/S12ADC.c -lm
+* Uso:          ./imu_adcmath   (termina con 0 se tutte le verifiche passano)
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include "S12ADC.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define SWEEP_STEPS		20000
+#define NOISE_COUNTS	1.0			/* rumore dell'ingresso simulato (conteggi rms) */
+#define CHECK(cond)		check((cond), #cond)
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+static uint32_t seed = 12345;
+static int failures;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static void check (int ok, const char *what);
+static double gauss (void);
+static uint16_t convert (double x);
+static void acquire (s12adc_result_t *r, const double *x, const uint8_t *additions, uint8_t decim);
+
+/*******************************************************************************
+* Funzioni della scheda non presenti sull'host
+*******************************************************************************/
+void lcd_display(uint8_t line, const uint8_t *text)
+{
+	(void)line;
+	(void)text;
+}
+
+int32_t get_ms(void)
+{
+	return 0;
+}
+
+/*******************************************************************************
+* Nome funzione     : main
+*******************************************************************************/
+int main(void)
+{
+	s12adc_result_t r;
+	double x[S12ADC_SCAN_WORDS], err, rms, ref;
+	uint8_t additions[S12ADC_SCAN_WORDS];
+	uint8_t times, decim, i;
+	uint32_t n, ext;
+	int k, bad;
+
+	/* Somme esatte: ogni combinazione di addizioni e decimazione, ingresso
+	   su tutto il campo */
+	bad = 0;
+	for (times = 1; times <= S12ADC_ADD_MAX; times++)
+	{
+		for (decim = 1; decim <= S12ADC_DECIM_MAX; decim++)
+		{
+			for (i = 0; i < S12ADC_SCAN_WORDS; i++) {
+				additions[i] = (i & 1) ? times : 1;
+			}
+			for (k = 0; k < 200; k++)
+			{
+				for (i = 0; i < S12ADC_SCAN_WORDS; i++) {
+					x[i] = -2.0 + (MAX_COUNTS + 4.0) * ((k * 37 + i * 11) % 200) / 199.0;
+				}
+				acquire(&r, x, additions, decim);
+				for (i = 0; i < S12ADC_SCAN_WORDS; i++)
+				{
+					n = r.samples[i];
+					ext = (uint32_t)(((uint64_t)r.sum[i] * (1 << S12ADC_EXT_SHIFT) + n / 2) / n);
+					if ((n != (uint32_t)additions[i] * decim) ||
+						(S12ADC_counts(&r, S12ADC_CH_FIRST + i) != (float)r.sum[i] / n) ||
+						(S12ADC_counts_ext(&r, S12ADC_CH_FIRST + i) != ext) ||
+						(fabs(S12ADC_counts_ext(&r, S12ADC_CH_FIRST + i) / (double)(1 << S12ADC_EXT_SHIFT) -
+							  (double)r.sum[i] / n) > 0.5 / (1 << S12ADC_EXT_SHIFT) + 1e-9)) {
+						bad++;
+					}
+				}
+			}
+		}
+	}
+	printf("somme:       %d risultati diversi dal calcolo esatto\n", bad);
+	CHECK(0 == bad);
+
+	/* Fondo scala con il massimo dei campioni: nessun traboccamento */
+	for (i = 0; i < S12ADC_SCAN_WORDS; i++)
+	{
+		additions[i] = S12ADC_ADD_MAX;
+		x[i] = MAX_COUNTS + 10.0;
+	}
+	acquire(&r, x, additions, S12ADC_DECIM_MAX);
+	printf("fondo scala: somma %lu su %u campioni, %.1f conteggi, esteso %u\n",
+		   (unsigned long)r.sum[0], r.samples[0], S12ADC_counts(&r, S12ADC_CH_FIRST),
+		   S12ADC_counts_ext(&r, S12ADC_CH_FIRST));
+	CHECK(S12ADC_counts(&r, S12ADC_CH_FIRST) == (float)MAX_COUNTS);
+	CHECK(S12ADC_counts_ext(&r, S12ADC_CH_FIRST) == (uint16_t)MAX_COUNTS << S12ADC_EXT_SHIFT);
+	CHECK(S12ADC_ADD_MAX * (uint32_t)MAX_COUNTS <= 0xFFFF);
+	for (i = 0; i < S12ADC_SCAN_WORDS; i++) {
+		x[i] = -10.0;
+	}
+	acquire(&r, x, additions, S12ADC_DECIM_MAX);
+	CHECK(0.0f == S12ADC_counts(&r, S12ADC_CH_FIRST));
+	CHECK(0 == S12ADC_counts_ext(&r, S12ADC_CH_FIRST));
+
+	/* Rumore: errore rms rispetto all'ingresso vero, atteso circa
+	   sqrt(rumore^2 + 1/12) / sqrt(campioni) */
+	printf("rumore %.1f conteggi rms:\n", NOISE_COUNTS);
+	printf("  add dec camp   rms 12 bit  rms esteso  atteso\n");
+	for (times = 1; times <= S12ADC_ADD_MAX; times *= 2)
+	{
+		for (decim = 1; decim <= S12ADC_DECIM_MAX; decim *= 4)
+		{
+			double rms_ext = 0.0;
+
+			for (i = 0; i < S12ADC_SCAN_WORDS; i++) {
+				additions[i] = times;
+			}
+			rms = 0.0;
+			for (k = 0; k < SWEEP_STEPS; k++)
+			{
+				for (i = 0; i < S12ADC_SCAN_WORDS; i++) {
+					x[i] = 100.0 + (MAX_COUNTS - 200.0) * k / SWEEP_STEPS + 0.37 * i;
+				}
+				acquire(&r, x, additions, decim);
+				err = S12ADC_counts(&r, S12ADC_CH_FIRST) - x[0];
+				rms += err * err;
+				err = S12ADC_counts_ext(&r, S12ADC_CH_FIRST) / (double)(1 << S12ADC_EXT_SHIFT) - x[0];
+				rms_ext += err * err;
+			}
+			rms = sqrt(rms / SWEEP_STEPS);
+			rms_ext = sqrt(rms_ext / SWEEP_STEPS);
+			n = (uint32_t)times * decim;
+			ref = sqrt(NOISE_COUNTS * NOISE_COUNTS + 1.0 / 12.0) / sqrt((double)n);
+			printf("  %3u %3u %4lu  %11.4f %11.4f %7.4f\n", times, decim, (unsigned long)n, rms, rms_ext, ref);
+			CHECK(fabs(rms - ref) < 0.1 * ref);
+			CHECK(rms_ext < rms + 1.0 / (1 << S12ADC_EXT_SHIFT));
+		}
+	}
+
+	/* Conversioni: volt, ampere e potenziometro dalla media */
+	for (i = 0; i < S12ADC_SCAN_WORDS; i++) {
+		additions[i] = S12ADC_ADD_MAX;
+	}
+	bad = 0;
+	for (k = 0; k <= 4095; k += 5)
+	{
+		double v;
+
+		for (i = 0; i < S12ADC_SCAN_WORDS; i++) {
+			x[i] = k;
+		}
+		acquire(&r, x, additions, 8);
+		v = (double)r.sum[S12ADC_CH_BATTERY - S12ADC_CH_FIRST] / r.samples[S12ADC_CH_BATTERY - S12ADC_CH_FIRST] * VREFH / MAX_COUNTS;
+		if (fabs(S12ADC_battery_volts(&r) - v * S12ADC_BATTERY_DIVIDER) > 1e-5 * VREFH * S12ADC_BATTERY_DIVIDER) {
+			bad++;
+		}
+		v = (double)r.sum[S12ADC_CH_MOTOR - S12ADC_CH_FIRST] / r.samples[S12ADC_CH_MOTOR - S12ADC_CH_FIRST] * VREFH / MAX_COUNTS;
+		if (fabs(S12ADC_motor_amps(&r) - (v - S12ADC_MOTOR_ZERO_V) / S12ADC_MOTOR_V_PER_A) > 1e-4) {
+			bad++;
+		}
+		v = (double)r.sum[S12ADC_CH_POT - S12ADC_CH_FIRST] / r.samples[S12ADC_CH_POT - S12ADC_CH_FIRST] / MAX_COUNTS;
+		if (fabs(S12ADC_pot(&r) - v) > 1e-6) {
+			bad++;
+		}
+	}
+	printf("conversioni: %d fuori tolleranza\n", bad);
+	CHECK(0 == bad);
+	for (i = 0; i < S12ADC_SCAN_WORDS; i++) {
+		x[i] = S12ADC_MOTOR_ZERO_V * MAX_COUNTS / VREFH;
+	}
+	acquire(&r, x, additions, 8);
+	printf("corrente a zero: %.4f A (un conteggio = %.4f A)\n", S12ADC_motor_amps(&r),
+		   VREFH / MAX_COUNTS / S12ADC_MOTOR_V_PER_A);
+	CHECK(fabs(S12ADC_motor_amps(&r)) < 0.5 * VREFH / MAX_COUNTS / S12ADC_MOTOR_V_PER_A);
+
+	/* Casi limite */
+	CHECK(0.0f == S12ADC_counts(&r, S12ADC_CH_FIRST - 1));
+	CHECK(0.0f == S12ADC_counts(&r, S12ADC_CH_LAST + 1));
+	CHECK(0 == S12ADC_counts_ext(&r, S12ADC_CH_LAST + 1));
+	r.samples[0] = 0;
+	CHECK(0.0f == S12ADC_counts(&r, S12ADC_CH_FIRST));
+	CHECK(0 == S12ADC_counts_ext(&r, S12ADC_CH_FIRST));
+
+	/* S12ADC_scan_addition a scansione ferma: registra soltanto */
+	CHECK(!S12ADC_scan_addition(1 << S12ADC_CH_BATTERY, 0));
+	CHECK(!S12ADC_scan_addition(1 << S12ADC_CH_BATTERY, S12ADC_ADD_MAX + 1));
+	CHECK(!S12ADC_scan_addition(1 << 4, 2));
+	CHECK(!S12ADC_scan_addition(1 << 0, 2));
+	CHECK(S12ADC_scan_addition((1 << S12ADC_CH_BATTERY) | (1 << S12ADC_CH_MOTOR), 4));
+	CHECK(((1 << S12ADC_CH_BATTERY) | (1 << S12ADC_CH_MOTOR)) == S12ADC_scan.add_mask);
+	CHECK(4 == S12ADC_scan.add_times);
+	CHECK(S12ADC_scan_addition(1 << S12ADC_CH_BATTERY, 1));
+	CHECK(0 == S12ADC_scan.add_mask);
+	CHECK(!S12ADC_scan.reconfig);
+
+	printf("%s (%d errori)\n", failures ? "FALLITO" : "OK", failures);
+
+	return failures ? 1 : 0;
+
+} /* Fine main() */
+
+/*******************************************************************************
+* Nome funzione     : check
+* Descrizione  	    : Conta e stampa una verifica fallita
+* Argomenti         : (int) ok -
+* 						 esito
+* 					  (const char) *what -
+* 					  	 condizione verificata
+* Valori restituiti : No
+*******************************************************************************/
+static void check(int ok, const char *what)
+{
+	if (!ok)
+	{
+		printf("verifica fallita: %s\n", what);
+		failures++;
+	}
+
+} /* Fine check() */
+
+/*******************************************************************************
+* Nome funzione     : gauss
+* Descrizione  	    : Numero casuale gaussiano a media nulla e varianza 1
+* 					  (Box-Muller su un generatore congruenziale)
+* Argomenti         : No
+* Valori restituiti : (double) -
+* 						 campione
+*******************************************************************************/
+static double gauss(void)
+{
+	/* Definisce le variabili locali */
+	double u1, u2;
+
+	seed = seed * 1103515245u + 12345u;
+	u1 = ((seed >> 8) + 1.0) / 16777217.0;
+	seed = seed * 1103515245u + 12345u;
+	u2 = (seed >> 8) / 16777216.0;
+
+	return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+
+} /* Fine gauss() */
+
+/*******************************************************************************
+* Nome funzione     : convert
+* Descrizione  	    : Una conversione a 12 bit dell'ingresso x (conteggi)
+* 					  con rumore, arrotondata e saturata come nel convertitore
+* Argomenti         : (double) x -
+* 						 ingresso vero (conteggi)
+* Valori restituiti : (uint16_t) -
+* 						 valore convertito
+*******************************************************************************/
+static uint16_t convert(double x)
+{
+	/* Definisce le variabili locali */
+	double v = floor(x + NOISE_COUNTS * gauss() + 0.5);
+
+	if (v < 0.0) {
+		return 0;
+	}
+	if (v > MAX_COUNTS) {
+		return (uint16_t)MAX_COUNTS;
+	}
+	return (uint16_t)v;
+
+} /* Fine convert() */
+
+/*******************************************************************************
+* Nome funzione     : acquire
+* Descrizione  	    : Costruisce un risultato come il firmware: ogni
+* 					  scansione somma additions[i] conversioni in ADDRn (modo
+* 					  di addizione), l'interrupt del DMAC1 somma decim
+* 					  scansioni
+* Argomenti         : (s12adc_result_t) *r -
+* 						 risultato
+* 					  (const double) *x -
+* 					  	 ingresso vero di ogni canale (conteggi)
+* 					  (const uint8_t) *additions -
+* 					  	 conversioni per scansione di ogni canale
+* 					  (uint8_t) decim -
+* 					  	 scansioni sommate
+* Valori restituiti : No
+*******************************************************************************/
+static void acquire(s12adc_result_t *r, const double *x, const uint8_t *additions, uint8_t decim)
+{
+	/* Definisce le variabili locali */
+	uint16_t addr;
+	uint8_t i, s, a;
+
+	for (i = 0; i < S12ADC_SCAN_WORDS; i++)
+	{
+		r->sum[i] = 0;
+		for (s = 0; s < decim; s++)
+		{
+			addr = 0;
+			for (a = 0; a < additions[i]; a++) {
+				addr += convert(x[i]);
+			}
+			r->sum[i] += addr;
+		}
+		r->samples[i] = additions[i] * decim;
+	}
+	r->timestamp = 0;
+	r->count = 1;
+
+} /* Fine acquire() */
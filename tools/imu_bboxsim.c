@@ -0,0 +1,378 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Strumento host: prova della scatola nera (src/IMU_bbox.c) sull'emulatore
+* della data flash (tools/host/flash_sim.c), con il ciclo principale a 100 Hz
+* in tempo simulato. Verifica che:
+*   - la caduta faccia scattare una registrazione una sola volta, con
+*     IMU_BBOX_POST campioni dopo l'evento, e che i campioni riletti dalla
+*     data flash coincidano con l'assetto registrato (entro la risoluzione)
+*   - la registrazione da pulsante funzioni con il robot rialzato
+*   - una mancanza di alimentazione durante la scrittura lasci intatte le
+*     registrazioni precedenti e la successiva riparta correttamente
+*   - le cancellazioni si distribuiscano in modo uniforme sui blocchi
+*   - nessun comando arrivi al FCU occupato e nessuna zona venga programmata
+*     senza essere stata cancellata
+* Con -o scrive le registrazioni lette con IMU_bbox_dump nel formato della
+* telemetria, da decodificare con ./imu_telemrec -b campioni.csv file
+*
+* Compilazione (dalla cartella tools):
+*   gcc -O2 -Ihost -I../src -I../r_riic_rx600 -I../r_riic_rx600/src
+*       -I../r_bsp/mcu/rx63n -I../r_bsp/board/rdkrx63n -o imu_bboxsim
+*       imu_bboxsim.c host/flash_sim.c host/mpu6050_sim.c ../src/IMU_bbox.c
+*       ../src/IMU_telem.c ../src/IMU_state.c ../src/IMU_ring.c ../src/IMU_pack.c
+*       ../src/IMU_log.c ../src/IMU_mem.c -lm
+* Uso:          ./imu_bboxsim [-o registrazioni.bin] [-n registrazioni]
+*               (termina con 0 se non ci sono errori)
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "platform.h"
+#include "CMT.h"
+#include "IMU.h"
+#include "IMU_bbox.h"
+#include "IMU_telem.h"
+#include "flash_sim.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define PERIOD_MS			10				/* ciclo principale a 100 Hz */
+#define FALL_MS				600				/* durata della caduta fino a terra */
+#define FALL_PITCH			1.4f			/* inclinazione a terra (rad) */
+#define COMMIT_TIMEOUT		60000			/* tempo massimo di una scrittura (ms) */
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+static IMU_dev_struct dev[IMU_NUM_SENSORS];
+static int32_t fall_start = -1;				/* inizio della caduta (ms), -1 in piedi */
+static uint32_t failures;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static float pitch_at (int32_t t);
+static void tick (void);
+static void run (int32_t ms);
+static int32_t commit (void);
+static void check (bool ok, const char *what);
+static void verify (uint32_t number, uint8_t trigger);
+static void dump (const char *path);
+
+/*******************************************************************************
+* Funzioni della scheda non presenti sull'host
+*******************************************************************************/
+void lcd_display(uint8_t line, const uint8_t *text)
+{
+	(void)line;
+	(void)text;
+}
+
+/* src/IMU.c non serve: nessun campione grezzo per la telemetria */
+bool IMU_attach_ring(IMU_ring_struct *ring)
+{
+	(void)ring;
+	return true;
+}
+
+/*******************************************************************************
+* Nome funzione     : main
+*******************************************************************************/
+int main(int argc, char **argv)
+{
+	const char *out = 0;
+	IMU_bbox_header_struct h;
+	uint32_t n = 120, i, kept, min, max;
+	int32_t ms;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "o:n:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'o': out = optarg; break;
+			case 'n': n = (uint32_t)atoi(optarg); break;
+			default:
+				fprintf(stderr, "uso: imu_bboxsim [-o registrazioni.bin] [-n registrazioni]\n");
+				return 1;
+		}
+	}
+
+	for (i = 0; i < IMU_NUM_SENSORS; i++) {
+		dev[i].online = true;
+	}
+
+	/* Data flash mai usata: nessuna registrazione */
+	flash_sim_reset(12345);
+	check(IMU_bbox_init(), "init");
+	check(0 == IMU_bbox.latest, "data flash vuota");
+
+	/* Caduta dopo 5 s in piedi */
+	run(5000);
+	fall_start = get_ms();
+	ms = commit();
+	printf("caduta: scrittura di %u blocchi in %ld ms\n", (unsigned)(IMU_bbox.header.count + 1), (long)ms);
+	verify(1, IMU_BBOX_FALL);
+
+	/* A terra la caduta non scatta di nuovo */
+	run(3000);
+	check(1 == IMU_bbox.commits, "caduta ripetuta a terra");
+
+	/* Rialzato, registrazione da pulsante */
+	fall_start = -1;
+	run(3000);
+	check(IMU_bbox_trigger(IMU_BBOX_SWITCH), "pulsante");
+	commit();
+	verify(2, IMU_BBOX_SWITCH);
+
+	/* Mancanza di alimentazione a meta' della scrittura */
+	run(3000);
+	IMU_bbox_trigger(IMU_BBOX_SWITCH);
+	while ((IMU_BBOX_COMMIT != IMU_bbox.state) || (IMU_bbox.step < 400)) {
+		tick();
+	}
+	flash_sim_power_cut();
+	check(IMU_bbox_init(), "init dopo l'interruzione");
+	check(2 == IMU_bbox.latest, "ultima registrazione dopo l'interruzione");
+	check(IMU_bbox_find(1, &h) && IMU_bbox_find(2, &h), "registrazioni precedenti intatte");
+	check(!IMU_bbox_find(3, &h), "registrazione interrotta ignorata");
+	run(3000);
+	IMU_bbox_trigger(IMU_BBOX_SWITCH);
+	commit();
+	verify(3, IMU_BBOX_SWITCH);
+
+	/* Usura: registrazioni di lunghezza variabile */
+	for (i = 0; i < n; i++)
+	{
+		run(PERIOD_MS * (1 + (i * 37) % (IMU_BBOX_RECORDS + 100)));
+		IMU_bbox_trigger(IMU_BBOX_SWITCH);
+		commit();
+	}
+	verify(IMU_bbox.latest, IMU_BBOX_SWITCH);
+
+	min = max = flash_sim.erase_count[0];
+	for (i = 1; i < IMU_FLASH_BLOCKS; i++)
+	{
+		if (flash_sim.erase_count[i] < min) {
+			min = flash_sim.erase_count[i];
+		}
+		if (flash_sim.erase_count[i] > max) {
+			max = flash_sim.erase_count[i];
+		}
+	}
+	for (kept = 0; IMU_bbox_find(IMU_bbox.latest - kept, &h); kept++);
+	printf("%u registrazioni, %u conservate; cancellazioni per blocco %u..%u\n",
+		   (unsigned)IMU_bbox.latest, (unsigned)kept, (unsigned)min, (unsigned)max);
+	check(max - min <= 2, "usura uniforme");
+	check(kept >= 2, "registrazioni conservate");
+
+	printf("FCU: %u cancellazioni, %u programmazioni, %u errori, %u comandi con il FCU occupato\n",
+		   (unsigned)flash_sim.erases, (unsigned)flash_sim.programs,
+		   (unsigned)flash_sim.errors, (unsigned)flash_sim.busy_calls);
+	check(0 == flash_sim.errors, "errori della data flash");
+	check(0 == flash_sim.busy_calls, "comandi con il FCU occupato");
+	check(0 == IMU_bbox.errors, "scritture fallite");
+
+	if (out) {
+		dump(out);
+	}
+
+	if (failures)
+	{
+		printf("FALLITO\n");
+		return 1;
+	}
+	printf("OK\n");
+
+	return 0;
+
+} /* Fine main() */
+
+/*******************************************************************************
+* Nome funzione     : pitch_at
+* Descrizione  	    : Beccheggio simulato: piccole oscillazioni in piedi,
+* 					  caduta con accelerazione costante fino a terra
+*******************************************************************************/
+static float pitch_at(int32_t t)
+{
+	float u;
+
+	if ((fall_start < 0) || (t <= fall_start)) {
+		return 0.02f * sinf(t * 0.0031f);
+	}
+	u = (t - fall_start) / (float)FALL_MS;
+	if (u > 1.0f) {
+		u = 1.0f;
+	}
+
+	return FALL_PITCH * u * u;
+
+} /* Fine pitch_at() */
+
+/*******************************************************************************
+* Nome funzione     : tick
+* Descrizione  	    : Un ciclo principale: il tempo avanza per sensori e FCU,
+* 					  poi il campione entra nella scatola nera
+*******************************************************************************/
+static void tick(void)
+{
+	IMU_data_struct x;
+	int32_t t;
+	uint8_t k;
+
+	ms_delay(PERIOD_MS);
+	flash_sim_advance(PERIOD_MS * 1000);
+	t = get_ms();
+
+	memset(&x, 0, sizeof(x));
+	x.angle[IMU_PITCH] = pitch_at(t);
+	x.omega[IMU_PITCH] = (pitch_at(t) - pitch_at(t - PERIOD_MS)) * (1000.0f / PERIOD_MS);
+	x.angle[IMU_ROLL] = 0.01f * cosf(t * 0.0017f);
+	for (k = 0; k < 3; k++) {
+		dev[0].raw.accel[k] = (int16_t)(t * (k + 1));
+	}
+
+	IMU_bbox_log(&x, dev, IMU_NUM_SENSORS, (uint16_t)t);
+
+} /* Fine tick() */
+
+/*******************************************************************************
+* Nome funzione     : run
+*******************************************************************************/
+static void run(int32_t ms)
+{
+	int32_t end = get_ms() + ms;
+
+	while (get_ms() < end) {
+		tick();
+	}
+
+} /* Fine run() */
+
+/*******************************************************************************
+* Nome funzione     : commit
+* Descrizione  	    : Prosegue fino alla fine della scrittura in corso o di
+* 					  quella che sta per partire
+* Valori restituiti : durata della scrittura (ms)
+*******************************************************************************/
+static int32_t commit(void)
+{
+	uint32_t commits = IMU_bbox.commits;
+	int32_t start = -1, limit = get_ms() + COMMIT_TIMEOUT;
+
+	while ((IMU_bbox.commits == commits) && (get_ms() < limit))
+	{
+		tick();
+		if ((start < 0) && (IMU_BBOX_COMMIT == IMU_bbox.state)) {
+			start = get_ms();
+		}
+	}
+	check(IMU_bbox.commits == commits + 1, "scrittura completata");
+
+	return get_ms() - start;
+
+} /* Fine commit() */
+
+/*******************************************************************************
+* Nome funzione     : verify
+* Descrizione  	    : Rilegge una registrazione e la confronta con l'assetto
+* 					  simulato
+*******************************************************************************/
+static void verify(uint32_t number, uint8_t trigger)
+{
+	IMU_bbox_header_struct h;
+	IMU_bbox_record_struct r, prev;
+	uint16_t i, k;
+	bool ok = true;
+	float err;
+
+	if (!IMU_bbox_find(number, &h))
+	{
+		check(false, "registrazione non trovata");
+		return;
+	}
+
+	check(h.trigger == trigger, "causa");
+	check(h.trigger_index + 1 + IMU_BBOX_POST == h.count, "campioni dopo l'evento");
+
+	/* fall_start non e' cambiato dalla registrazione */
+	for (i = 0; i < h.count; i++)
+	{
+		IMU_bbox_read(&h, i, &r);
+		err = fabsf(r.angle[IMU_PITCH] / IMU_BBOX_ANGLE_SCALE - pitch_at((int32_t)r.timestamp));
+		ok = ok && (err <= 0.5f / IMU_BBOX_ANGLE_SCALE + 1e-6f);
+		ok = ok && (r.work == (uint16_t)r.timestamp) && (IMU_NUM_SENSORS == r.sensors);
+		for (k = 0; k < 3; k++) {
+			ok = ok && (r.accel[k] == (int16_t)(r.timestamp * (k + 1)));
+		}
+		ok = ok && ((0 == i) || (r.timestamp == prev.timestamp + PERIOD_MS));
+		ok = ok && (((r.flags & IMU_BBOX_FLAG_TRIGGER) != 0) == (i == h.trigger_index));
+		prev = r;
+	}
+	check(ok, "campioni riletti");
+
+	if (IMU_BBOX_FALL == trigger)
+	{
+		IMU_bbox_read(&h, h.trigger_index, &r);
+		IMU_bbox_read(&h, h.trigger_index - 1, &prev);
+		check((r.angle[IMU_PITCH] > IMU_BBOX_FALL_ANGLE * IMU_BBOX_ANGLE_SCALE) &&
+			  (prev.angle[IMU_PITCH] <= IMU_BBOX_FALL_ANGLE * IMU_BBOX_ANGLE_SCALE), "istante della caduta");
+	}
+
+} /* Fine verify() */
+
+/*******************************************************************************
+* Nome funzione     : dump
+* Descrizione  	    : Legge tutte le registrazioni con IMU_bbox_dump. La linea
+* 					  viene liberata subito dopo ogni frame: il frame pronto
+* 					  e' nel buffer in attesa
+*******************************************************************************/
+static void dump(const char *path)
+{
+	FILE *f = fopen(path, "wb");
+	uint32_t frames = 0;
+
+	if (!f)
+	{
+		perror(path);
+		failures++;
+		return;
+	}
+
+	IMU_bbox_dump_start();
+	do
+	{
+		IMU_telem.sending = 0;
+		IMU_telem.pending = -1;
+		if (!IMU_bbox_dump()) {
+			break;
+		}
+		fwrite(IMU_telem.buf[1], 1, IMU_telem.len[1], f);
+		frames++;
+	} while (1);
+
+	fclose(f);
+	printf("%u campioni in %s\n", (unsigned)frames, path);
+
+} /* Fine dump() */
+
+/*******************************************************************************
+* Nome funzione     : check
+*******************************************************************************/
+static void check(bool ok, const char *what)
+{
+	if (!ok)
+	{
+		printf("errore: %s\n", what);
+		failures++;
+	}
+
+} /* Fine check() */
@@ -0,0 +1,240 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Strumento host: stima il modello di calibrazione v = M * (raw - b) di un
+* accelerometro o di un giroscopio ai minimi quadrati
+*
+* Ingresso (file o stdin): una riga CSV per ogni posizione (o prova):
+*     rx, ry, rz (valore atteso in unita' fisiche), mx, my, mz (media grezza, LSB)
+* Per l'accelerometro il valore atteso e' la gravita' (es. 0,0,1 con la scheda
+* piatta), per il giroscopio la velocita' di una tavola rotante o l'angolo di un
+* giro completo diviso per la durata. Servono almeno 4 righe non complanari;
+* le sei posizioni a +-1 g bastano, di piu' riducono il rumore.
+* Le righe che non iniziano con un numero vengono ignorate.
+*
+* Uscita: l'inizializzatore di IMU_calmodel_struct da copiare in main.c e il
+* residuo di ogni riga.
+*
+* Compilazione: gcc -O2 -o imu_calfit imu_calfit.c -lm
+* Uso:          ./imu_calfit [-s LSB_per_unita'] [posizioni.csv]
+*               (-s 16384 per l'accelerometro a 2 g, 131 per il giroscopio a 250 grad/s)
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define NPAR		4				/* una riga di M piu' il termine costante */
+#define MAX_ROWS	256
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static int solve (double a[NPAR][NPAR], double *b, double *x);
+static int invert3 (double m[3][3], double inv[3][3]);
+
+/*******************************************************************************
+* Nome funzione     : main
+*******************************************************************************/
+int main(int argc, char **argv)
+{
+	static double ref[MAX_ROWS][3], meas[MAX_ROWS][3];
+	FILE *in = stdin;
+	char line[256];
+	double lsb = 16384.0, a[NPAR][NPAR], y[NPAR], x[NPAR], p[NPAR];
+	double M[3][3], c[3], inv[3][3], b[3], v, err, rms = 0.0;
+	int n = 0, argi = 1;
+	int i, r, k, q;
+
+	if ((argi + 1 < argc) && (0 == strcmp(argv[argi], "-s")))
+	{
+		lsb = atof(argv[argi + 1]);
+		argi += 2;
+	}
+	if (argi < argc)
+	{
+		in = fopen(argv[argi], "r");
+		if (!in)
+		{
+			perror(argv[argi]);
+			return 1;
+		}
+	}
+
+	/* Legge le posizioni, riportando il valore atteso in LSB nominali */
+	while ((n < MAX_ROWS) && fgets(line, sizeof(line), in))
+	{
+		if (6 == sscanf(line, "%lf,%lf,%lf,%lf,%lf,%lf",
+						&ref[n][0], &ref[n][1], &ref[n][2], &meas[n][0], &meas[n][1], &meas[n][2]))
+		{
+			for (k = 0; k < 3; k++) {
+				ref[n][k] *= lsb;
+			}
+			n++;
+		}
+	}
+
+	if (n < NPAR)
+	{
+		fprintf(stderr, "servono almeno %d posizioni, lette %d\n", NPAR, n);
+		return 1;
+	}
+
+	/* Modello affine ref = M * meas + c, una riga alla volta (equazioni normali) */
+	for (r = 0; r < 3; r++)
+	{
+		memset(a, 0, sizeof(a));
+		memset(y, 0, sizeof(y));
+		for (i = 0; i < n; i++)
+		{
+			p[0] = meas[i][0];
+			p[1] = meas[i][1];
+			p[2] = meas[i][2];
+			p[3] = 1.0;
+			for (k = 0; k < NPAR; k++)
+			{
+				y[k] += p[k] * ref[i][r];
+				for (q = 0; q < NPAR; q++) {
+					a[k][q] += p[k] * p[q];
+				}
+			}
+		}
+		if (solve(a, y, x))
+		{
+			fprintf(stderr, "sistema singolare: le posizioni non coprono i tre assi\n");
+			return 1;
+		}
+		M[r][0] = x[0];
+		M[r][1] = x[1];
+		M[r][2] = x[2];
+		c[r] = x[3];
+	}
+
+	/* b = -M^-1 * c */
+	if (invert3(M, inv))
+	{
+		fprintf(stderr, "matrice di calibrazione singolare\n");
+		return 1;
+	}
+	for (r = 0; r < 3; r++) {
+		b[r] = -(inv[r][0] * c[0] + inv[r][1] * c[1] + inv[r][2] * c[2]);
+	}
+
+	/* Residui nelle unita' fisiche */
+	for (i = 0; i < n; i++)
+	{
+		err = 0.0;
+		for (r = 0; r < 3; r++)
+		{
+			v = 0.0;
+			for (k = 0; k < 3; k++) {
+				v += M[r][k] * (meas[i][k] - b[k]);
+			}
+			err += (v - ref[i][r]) * (v - ref[i][r]);
+		}
+		err = sqrt(err) / lsb;
+		rms += err * err;
+		printf("/* posizione %2d: residuo %.5f */\n", i + 1, err);
+	}
+	printf("/* residuo rms %.5f su %d posizioni */\n", sqrt(rms / n), n);
+
+	printf("{{{%.6ff, %.6ff, %.6ff},\n", M[0][0], M[0][1], M[0][2]);
+	printf("  {%.6ff, %.6ff, %.6ff},\n", M[1][0], M[1][1], M[1][2]);
+	printf("  {%.6ff, %.6ff, %.6ff}},\n", M[2][0], M[2][1], M[2][2]);
+	printf(" {%.3ff, %.3ff, %.3ff}}\n", b[0], b[1], b[2]);
+
+	return 0;
+
+} /* Fine main() */
+
+/*******************************************************************************
+* Nome funzione     : solve
+* Descrizione  	    : Eliminazione di Gauss con pivot parziale
+*******************************************************************************/
+static int solve(double a[NPAR][NPAR], double *b, double *x)
+{
+	double f, tmp;
+	int r, c, k, piv;
+
+	for (k = 0; k < NPAR; k++)
+	{
+		piv = k;
+		for (r = k + 1; r < NPAR; r++)
+		{
+			if (fabs(a[r][k]) > fabs(a[piv][k])) {
+				piv = r;
+			}
+		}
+		if (fabs(a[piv][k]) < 1e-12) {
+			return 1;
+		}
+		for (c = 0; c < NPAR; c++)
+		{
+			tmp = a[k][c]; a[k][c] = a[piv][c]; a[piv][c] = tmp;
+		}
+		tmp = b[k]; b[k] = b[piv]; b[piv] = tmp;
+
+		for (r = k + 1; r < NPAR; r++)
+		{
+			f = a[r][k] / a[k][k];
+			for (c = k; c < NPAR; c++) {
+				a[r][c] -= f * a[k][c];
+			}
+			b[r] -= f * b[k];
+		}
+	}
+
+	for (k = NPAR - 1; k >= 0; k--)
+	{
+		x[k] = b[k];
+		for (c = k + 1; c < NPAR; c++) {
+			x[k] -= a[k][c] * x[c];
+		}
+		x[k] /= a[k][k];
+	}
+
+	return 0;
+
+} /* Fine solve() */
+
+/*******************************************************************************
+* Nome funzione     : invert3
+* Descrizione  	    : Inversa di una matrice 3x3 per cofattori
+*******************************************************************************/
+static int invert3(double m[3][3], double inv[3][3])
+{
+	double det;
+	int r, c;
+
+	inv[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+	inv[0][1] = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+	inv[0][2] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+	inv[1][0] = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+	inv[1][1] = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+	inv[1][2] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+	inv[2][0] = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+	inv[2][1] = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+	inv[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+
+	det = m[0][0] * inv[0][0] + m[0][1] * inv[1][0] + m[0][2] * inv[2][0];
+	if (fabs(det) < 1e-12) {
+		return 1;
+	}
+
+	for (r = 0; r < 3; r++)
+	{
+		for (c = 0; c < 3; c++) {
+			inv[r][c] /= det;
+		}
+	}
+
+	return 0;
+
+} /* Fine invert3() */
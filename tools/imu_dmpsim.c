@@ -0,0 +1,202 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Strumento host: esegue src/IMU_dmp.c su un MPU-6050 simulato e verifica la
+* sequenza di caricamento del DMP:
+*   - l'immagine arriva intera in memoria, a blocchi che non superano un banco
+*   - un blocco alterato sul bus viene riconosciuto e riscritto
+*   - indirizzo di partenza, divisore della frequenza e USER_CTRL corretti
+*   - lettura dei quaternioni dalla FIFO, ritardo e gestione del disallineamento
+*   - angoli negli assi del robot (livellamento) e posizione di riposo
+* Al posto del firmware del produttore usa un'immagine pseudo-casuale della
+* stessa dimensione.
+*
+* Compilazione (dalla cartella tools):
+*   gcc -O2 -Ihost -I../src -I../r_riic_rx600 -I../r_riic_rx600/src
+*       -I../r_bsp/mcu/rx63n -I../r_bsp/board/rdkrx63n -o imu_dmpsim
+*       imu_dmpsim.c host/mpu6050_sim.c ../src/IMU_dmp.c ../src/IMU_regmap.c
+*       ../src/IMU_math.c -lm
+* Uso:          ./imu_dmpsim   (termina con 0 se tutte le verifiche passano)
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "platform.h"
+#include "IMU.h"
+#include "IMU_regmap.h"
+#include "IMU_dmp.h"
+#include "CMT.h"
+#include "mpu6050_sim.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define CODE_SIZE		3062			/* dimensione del firmware MotionApps */
+#define CODE_START		0x0400
+#define CHECK(cond)		check((cond), #cond)
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+static uint8_t code[CODE_SIZE];
+static uint8_t expected[CODE_SIZE];			/* immagine con le scritture di configurazione */
+static const uint8_t key_data[12] = {0xFE, 0xF2, 0xAB, 0xC4, 0xAA, 0xF1, 0xDF, 0xDF, 0xBB, 0xAF, 0xDF, 0xDF};
+static const IMU_dmp_key_struct keys[1] = {{2753, sizeof(key_data), key_data}};
+static int failures;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static void check (int ok, const char *what);
+static void push_quat (float w, float x, float y, float z);
+
+/*******************************************************************************
+* Nome funzione     : main
+*******************************************************************************/
+int main(void)
+{
+	static IMU_dev_struct dev;
+	IMU_dmp_image_struct image = {code, CODE_SIZE, CODE_START, keys, 1, IMU_DMP_QUAT_PACKET};
+	mpu6050_sim_struct *s = &mpu6050_sim[0];
+	uint32_t seed = 12345;
+	int32_t start;
+	uint16_t i;
+
+	for (i = 0; i < CODE_SIZE; i++)
+	{
+		seed = seed * 1103515245u + 12345u;
+		code[i] = (uint8_t)(seed >> 16);
+	}
+	memcpy(expected, code, CODE_SIZE);
+	memcpy(&expected[keys[0].addr], key_data, sizeof(key_data));
+
+	mpu6050_sim_reset();
+	dev.channel = CHANNEL_0;
+	dev.slave_address = IMU_ADDRESS_AD0_LOW;
+	dev.config.accel_fs = INV_MPU6050_FS_02G;
+	dev.config.gyro_fs = INV_MPU6050_FSR_2000DPS;
+	dev.config.dlpf = INV_MPU6050_FILTER_42HZ;
+	dev.config.rate_hz = IMU_DMP_SAMPLE_RATE;
+	dev.calib.level[0][0] = dev.calib.level[1][1] = dev.calib.level[2][2] = 1.0f;
+	IMU_bus_init(dev.channel);
+	IMU_reg_reset_shadow(&dev);
+	IMU_reg_load(&dev);
+
+	/* Caricamento */
+	CHECK(RIIC_OK == IMU_dmp_load(&dev, &image));
+	CHECK(0 == memcmp(s->mem, expected, CODE_SIZE));
+	CHECK(0 == s->bank_wraps);
+	CHECK((CODE_START >> 8) == s->regs[0x70] && (CODE_START & 0xFF) == s->regs[0x71]);
+	printf("caricamento: %lu transazioni, %lu burst in MEM_R_W\n",
+		   (unsigned long)s->transactions, (unsigned long)s->mem_bursts);
+
+	/* Un blocco alterato sul bus viene riscritto */
+	memset(s->mem, 0, sizeof(s->mem));
+	s->corrupt_writes = 1;
+	CHECK(RIIC_OK == IMU_dmp_load(&dev, &image));
+	CHECK(0 == memcmp(s->mem, expected, CODE_SIZE));
+
+	/* Avvio a 100 Hz */
+	CHECK(RIIC_OK == IMU_dmp_start(&dev, 100));
+	CHECK(0 == s->mem[IMU_DMP_KEY_RATE_DIV] && 1 == s->mem[IMU_DMP_KEY_RATE_DIV + 1]);
+	CHECK((INV_MPU6050_BIT_DMP_EN | INV_MPU6050_BIT_FIFO_EN) == s->regs[INV_MPU6050_REG_USER_CTRL]);
+	CHECK(0 == s->regs[INV_MPU6050_REG_FIFO_EN]);
+
+	/* Tre pacchetti: vale l'ultimo (rollio di 30 gradi), ritardo di due periodi */
+	push_quat(1.0f, 0.0f, 0.0f, 0.0f);
+	push_quat(1.0f, 0.0f, 0.0f, 0.0f);
+	push_quat(cosf(0.2618f), sinf(0.2618f), 0.0f, 0.0f);
+	CHECK(RIIC_OK == IMU_dmp_read(&dev));
+	CHECK(3 == dev.dmp.packets);
+	CHECK(dev.dmp.valid);
+	CHECK(fabsf(dev.dmp.angle[IMU_ROLL] - 0.5236f) < 1e-3f);
+	CHECK(fabsf(dev.dmp.angle[IMU_PITCH]) < 1e-3f && fabsf(dev.dmp.angle[IMU_YAW]) < 1e-3f);
+	CHECK(20 == dev.dmp.latency_ms);
+	CHECK(0 == s->fifo_count);
+	CHECK(dev.dmp.off_valid && fabsf(dev.dmp.off_angle[IMU_ROLL] - 0.5236f) < 1e-3f);
+
+	/* Sensore montato ruotato di 30 gradi sull'asse x: con il livellamento
+	 lo stesso quaternione e' il robot in piano */
+	dev.calib.level[1][1] = dev.calib.level[2][2] = cosf(0.5236f);
+	dev.calib.level[1][2] = -sinf(0.5236f);
+	dev.calib.level[2][1] = sinf(0.5236f);
+	push_quat(cosf(0.2618f), sinf(0.2618f), 0.0f, 0.0f);
+	CHECK(RIIC_OK == IMU_dmp_read(&dev));
+	CHECK(fabsf(dev.dmp.angle[IMU_ROLL]) < 1e-3f);
+	CHECK(fabsf(dev.dmp.angle[IMU_PITCH]) < 1e-3f && fabsf(dev.dmp.angle[IMU_YAW]) < 1e-3f);
+
+	/* Beccheggio di 20 gradi del robot sopra il montaggio */
+	push_quat(cosf(0.1745f) * cosf(0.2618f), cosf(0.1745f) * sinf(0.2618f),
+			  sinf(0.1745f) * cosf(0.2618f), -sinf(0.1745f) * sinf(0.2618f));
+	CHECK(RIIC_OK == IMU_dmp_read(&dev));
+	CHECK(fabsf(dev.dmp.angle[IMU_PITCH] - 0.3491f) < 1e-3f);
+	CHECK(fabsf(dev.dmp.angle[IMU_ROLL]) < 1e-3f && fabsf(dev.dmp.angle[IMU_YAW]) < 1e-3f);
+
+	/* FIFO disallineata (un pacchetto e 5 byte): viene svuotata senza attendere
+	 il reset; FIFO e DMP si riaccendono in una lettura successiva */
+	mpu6050_sim_fifo_push(0, code, IMU_DMP_QUAT_PACKET + 5);
+	start = get_ms();
+	CHECK(RIIC_OK == IMU_dmp_read(&dev));
+	CHECK(get_ms() == start);
+	CHECK(1 == dev.dmp.overflows);
+	CHECK(0 == s->fifo_count);
+	CHECK(!dev.dmp.valid);
+	CHECK(0 == (s->regs[INV_MPU6050_REG_USER_CTRL] & INV_MPU6050_BIT_DMP_EN));
+
+	ms_delay(IMU_DMP_RESET_TIME - 1);
+	CHECK(RIIC_OK == IMU_dmp_read(&dev));
+	CHECK(0 == (s->regs[INV_MPU6050_REG_USER_CTRL] & INV_MPU6050_BIT_DMP_EN));
+	ms_delay(1);
+	CHECK(RIIC_OK == IMU_dmp_read(&dev));
+	CHECK((INV_MPU6050_BIT_DMP_EN | INV_MPU6050_BIT_FIFO_EN) ==
+		  (s->regs[INV_MPU6050_REG_USER_CTRL] & (INV_MPU6050_BIT_DMP_EN | INV_MPU6050_BIT_FIFO_EN)));
+
+	push_quat(1.0f, 0.0f, 0.0f, 0.0f);
+	CHECK(RIIC_OK == IMU_dmp_read(&dev));
+	CHECK(dev.dmp.valid);
+
+	printf("%s (%d errori)\n", failures ? "FALLITO" : "OK", failures);
+
+	return failures ? 1 : 0;
+
+} /* Fine main() */
+
+/*******************************************************************************
+* Nome funzione     : check
+*******************************************************************************/
+static void check(int ok, const char *what)
+{
+	if (!ok)
+	{
+		printf("verifica fallita: %s\n", what);
+		failures++;
+	}
+
+} /* Fine check() */
+
+/*******************************************************************************
+* Nome funzione     : push_quat
+* Descrizione  	    : Accoda un pacchetto con il quaternione in Q30 big-endian
+*******************************************************************************/
+static void push_quat(float w, float x, float y, float z)
+{
+	float q[4] = {w, x, y, z};
+	uint8_t packet[IMU_DMP_QUAT_PACKET];
+	int32_t v;
+	int k;
+
+	for (k = 0; k < 4; k++)
+	{
+		v = (int32_t)lrintf(q[k] * 1073741824.0f);
+		packet[4*k]     = (uint8_t)(v >> 24);
+		packet[4*k + 1] = (uint8_t)(v >> 16);
+		packet[4*k + 2] = (uint8_t)(v >> 8);
+		packet[4*k + 3] = (uint8_t)v;
+	}
+	mpu6050_sim_fifo_push(0, packet, sizeof(packet));
+
+} /* Fine push_quat() */
@@ -0,0 +1,227 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Strumento host: verifica e misura la FFT reale di src/IMU_fft.c
+*   - errore di IMU_fft_real e IMU_fft_power rispetto a una DFT in doppia
+*     precisione, su rumore e su sinusoidi a frequenze intere e frazionarie
+*   - picco e ampiezza di una sinusoide dopo la finestra di Hann
+*   - tempo per trasformata (cicli del contatore TSC su x86, altrimenti
+*     nanosecondi), da confrontare con la misura sul target fatta con
+*     CMT_counter() e riportata da IMU_vib_show()
+*
+* Compilazione: gcc -O2 -I../src -o imu_fftbench imu_fftbench.c ../src/IMU_fft.c ../src/IMU_fft_twiddle.c -lm
+* Uso:          ./imu_fftbench   (termina con 0 se tutti gli errori sono entro le soglie)
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "IMU_fft.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define N				IMU_FFT_SIZE
+#define REL_TOL			1e-6	/* errore massimo rispetto al picco dello spettro */
+#define BENCH_LOOPS		20000
+#define CHECK(cond)		check((cond), #cond)
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+static float buf[N];
+static double ref_re[N / 2 + 1], ref_im[N / 2 + 1];
+static int failures;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static void check (int ok, const char *what);
+static void dft (const float *x);
+static double compare (const float *x, const char *what);
+static uint64_t ticks (void);
+
+/*******************************************************************************
+* Nome funzione     : main
+*******************************************************************************/
+int main(void)
+{
+	static const double freq[] = {1.0, 37.0, 37.25, 100.5, N / 2 - 1.0};
+	float in[N];
+	double err, peak, amp, t;
+	uint32_t seed = 12345;
+	uint64_t t0;
+	int i, k, best;
+
+	/* Rumore uniforme */
+	for (i = 0; i < N; i++)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		in[i] = (float)((int32_t)seed >> 16) / 32768.0f;
+	}
+	err = compare(in, "rumore");
+	CHECK(err <= REL_TOL);
+
+	/* Sinusoidi con offset, anche tra due bin */
+	for (k = 0; k < (int)(sizeof(freq) / sizeof(freq[0])); k++)
+	{
+		for (i = 0; i < N; i++) {
+			in[i] = (float)(0.25 + sin(2.0 * M_PI * freq[k] * i / N + 0.3));
+		}
+		err = compare(in, "sinusoide");
+		CHECK(err <= REL_TOL);
+	}
+
+	/* Finestra di Hann: picco nel bin giusto, ampiezza 4 |X| / N */
+	for (i = 0; i < N; i++) {
+		buf[i] = (float)(0.5 * sin(2.0 * M_PI * 64.0 * i / N));
+	}
+	IMU_fft_hann(buf);
+	IMU_fft_real(buf);
+	IMU_fft_power(buf);
+	for (k = 1, best = 0, peak = 0.0; k < N / 2 + 1; k++)
+	{
+		if (buf[k] > peak) {
+			peak = buf[k];
+			best = k;
+		}
+	}
+	amp = 4.0 * sqrt(peak) / N;
+	printf("Hann: picco nel bin %d, ampiezza %.6f (attesa 0.5)\n", best, amp);
+	CHECK(64 == best);
+	CHECK(fabs(amp - 0.5) < 1e-4);
+
+	/* Tempo per trasformata (finestra, FFT e potenza, come sul target) */
+	t0 = ticks();
+	for (k = 0; k < BENCH_LOOPS; k++)
+	{
+		memcpy(buf, in, sizeof(buf));
+		IMU_fft_hann(buf);
+		IMU_fft_real(buf);
+		IMU_fft_power(buf);
+	}
+	t = (double)(ticks() - t0) / BENCH_LOOPS;
+	printf("FFT reale %d punti: %.0f %s per trasformata\n", N,
+#if defined(__x86_64__) || defined(__i386__)
+		   t, "cicli TSC");
+#else
+		   t, "ns");
+#endif
+
+	if (failures) {
+		printf("FALLITO (%d errori)\n", failures);
+	} else {
+		printf("OK (0 errori)\n");
+	}
+
+	return failures ? 1 : 0;
+
+} /* Fine main() */
+
+/*******************************************************************************
+* Nome funzione     : check
+*******************************************************************************/
+static void check(int ok, const char *what)
+{
+	if (!ok)
+	{
+		printf("verifica fallita: %s\n", what);
+		failures++;
+	}
+
+} /* Fine check() */
+
+/*******************************************************************************
+* Nome funzione     : dft
+* Descrizione  	    : Trasformata di riferimento in doppia precisione, bin
+* 					  0 ... N/2
+*******************************************************************************/
+static void dft(const float *x)
+{
+	double w;
+	int k, n;
+
+	for (k = 0; k <= N / 2; k++)
+	{
+		ref_re[k] = 0.0;
+		ref_im[k] = 0.0;
+		for (n = 0; n < N; n++)
+		{
+			w = 2.0 * M_PI * (double)((k * n) % N) / N;
+			ref_re[k] += x[n] * cos(w);
+			ref_im[k] -= x[n] * sin(w);
+		}
+	}
+
+} /* Fine dft() */
+
+/*******************************************************************************
+* Nome funzione     : compare
+* Descrizione  	    : Errore massimo di spettro complesso e di potenza
+* 					  rispetto alla DFT, relativo al massimo del riferimento
+*******************************************************************************/
+static double compare(const float *x, const char *what)
+{
+	double re, im, e, scale = 0.0, err = 0.0, perr = 0.0;
+	int k;
+
+	dft(x);
+	memcpy(buf, x, sizeof(buf));
+	IMU_fft_real(buf);
+
+	for (k = 0; k <= N / 2; k++)
+	{
+		e = sqrt(ref_re[k] * ref_re[k] + ref_im[k] * ref_im[k]);
+		if (e > scale) {
+			scale = e;
+		}
+	}
+
+	for (k = 0; k <= N / 2; k++)
+	{
+		re = (0 == k) ? buf[0] : (N / 2 == k) ? buf[1] : buf[2 * k];
+		im = ((0 == k) || (N / 2 == k)) ? 0.0 : buf[2 * k + 1];
+		e = hypot(re - ref_re[k], im - ref_im[k]) / scale;
+		if (e > err) {
+			err = e;
+		}
+	}
+
+	IMU_fft_power(buf);
+	for (k = 0; k <= N / 2; k++)
+	{
+		e = fabs(buf[k] - (ref_re[k] * ref_re[k] + ref_im[k] * ref_im[k])) / (scale * scale);
+		if (e > perr) {
+			perr = e;
+		}
+	}
+
+	printf("%-10s errore massimo %.3g (potenza %.3g), relativo al picco\n", what, err, perr);
+
+	return (err > perr) ? err : perr;
+
+} /* Fine compare() */
+
+/*******************************************************************************
+* Nome funzione     : ticks
+*******************************************************************************/
+static uint64_t ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+
+} /* Fine ticks() */
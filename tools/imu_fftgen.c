@@ -0,0 +1,55 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Strumento host: genera src/IMU_fft_twiddle.c, la tabella dei coefficienti
+* della FFT (cos e sin di 2 pi k / N per k < N / 2) calcolati in doppia
+* precisione e arrotondati a float. La tabella e' const e resta in flash.
+* Va rigenerata se cambia IMU_FFT_SIZE in src/IMU_fft.h.
+*
+* Compilazione: gcc -O2 -I../src -o imu_fftgen imu_fftgen.c -lm
+* Uso:          ./imu_fftgen > ../src/IMU_fft_twiddle.c
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdio.h>
+#include <math.h>
+#include "IMU_fft.h"
+
+/*******************************************************************************
+* Nome funzione     : main
+*******************************************************************************/
+int main(void)
+{
+	/* Definisce le variabili locali */
+	const double pi = 3.14159265358979323846;
+	double w;
+	int k;
+
+	printf("/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */\n\n");
+	printf("/* File generato da tools/imu_fftgen.c per IMU_FFT_SIZE = %d: non modificare */\n\n", IMU_FFT_SIZE);
+	printf("/*******************************************************************************\n");
+	printf("Includes: <System Includes> , \"Project Includes\"\n");
+	printf("*******************************************************************************/\n");
+	printf("#include \"IMU_fft.h\"\n\n");
+	printf("#if IMU_FFT_SIZE != %d\n", IMU_FFT_SIZE);
+	printf("#error \"Tabella da rigenerare con tools/imu_fftgen.c\"\n");
+	printf("#endif\n\n");
+	printf("/*******************************************************************************\n");
+	printf("Variabili globali\n");
+	printf("*******************************************************************************/\n");
+	printf("const float IMU_fft_twiddle[IMU_FFT_SIZE / 2][2] = {\n");
+
+	for (k = 0; k < IMU_FFT_SIZE / 2; k++)
+	{
+		w = 2.0 * pi * k / IMU_FFT_SIZE;
+		printf("\t{%.9ef, %.9ef}%s\n", (float)cos(w), (float)sin(w),
+			   (k < IMU_FFT_SIZE / 2 - 1) ? "," : "");
+	}
+
+	printf("};\n");
+
+	return 0;
+
+} /* Fine main() */
@@ -0,0 +1,187 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Strumento host: esegue src/IMU_mag.c su un MPU-6050 simulato con un
+* magnetometro sul bus ausiliario e verifica:
+*   - identificazione e scritture di configurazione con lo slave 4, compreso
+*     il modo continuo dell'HMC5883L (all'accensione e' in misura singola)
+*   - lettura automatica con lo slave 0 e ordine degli assi, big-endian
+*     (HMC5883L) e little-endian con BYTE_SW (QMC5883L)
+*   - campione saturato, ritardo del master con la decimazione
+*   - magnetometro assente o sconosciuto: resta spento e viene contato
+*
+* Compilazione (dalla cartella tools):
+*   gcc -O2 -D__evenaccess= -Ihost -I../src -I../r_riic_rx600 -I../r_riic_rx600/src
+*       -I../r_bsp/mcu/rx63n -I../r_bsp/board/rdkrx63n -o imu_magsim
+*       imu_magsim.c host/mpu6050_sim.c ../src/IMU*.c -lm
+* Uso:          ./imu_magsim   (termina con 0 se tutte le verifiche passano)
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "platform.h"
+#include "IMU.h"
+#include "IMU_regmap.h"
+#include "IMU_mag.h"
+#include "mpu6050_sim.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define HMC5883L_ADDR	0x1E
+#define QMC5883L_ADDR	0x0D
+#define CHECK(cond)		check((cond), #cond)
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+static IMU_dev_struct dev;
+static int failures;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static void check (int ok, const char *what);
+static void setup (uint8_t type);
+static void put16 (uint8_t *p, int16_t v, int little_endian);
+
+/*******************************************************************************
+* Nome funzione     : lcd_display
+* Descrizione  	    : Il display non c'e': il firmware lo usa solo per le pagine
+*******************************************************************************/
+void lcd_display(uint8_t line, const uint8_t *text)
+{
+	(void)line;
+	(void)text;
+}
+
+/*******************************************************************************
+* Nome funzione     : main
+*******************************************************************************/
+int main(void)
+{
+	mpu6050_sim_struct *s = &mpu6050_sim[0];
+	int16_t r[3];
+
+	/* HMC5883L: registri all'accensione, misura singola */
+	setup(IMU_MAG_HMC5883L);
+	s->mag_addr = HMC5883L_ADDR;
+	s->mag_regs[0x00] = 0x10;
+	s->mag_regs[0x01] = 0x20;
+	s->mag_regs[0x02] = 0x01;
+	memcpy(&s->mag_regs[0x0A], "H43", 3);
+
+	CHECK(RIIC_OK == IMU_mag_start(&dev));
+	CHECK(dev.mag.enabled);
+	CHECK(0x78 == s->mag_regs[0x00] && 0x20 == s->mag_regs[0x01]);
+	CHECK(0x00 == s->mag_regs[0x02]);
+	CHECK(3 == s->mag_writes);
+	CHECK((HMC5883L_ADDR | INV_MPU6050_BIT_I2C_READ) == s->regs[INV_MPU6050_REG_I2C_SLV0_ADDR]);
+	CHECK(0x03 == s->regs[INV_MPU6050_REG_I2C_SLV0_REG]);
+	CHECK((INV_MPU6050_BIT_SLV_EN | IMU_MAG_BYTES) == s->regs[INV_MPU6050_REG_I2C_SLV0_CTRL]);
+
+	/* Dati x, z, y dopo il giroscopio, nella stessa lettura a raffica */
+	put16(&s->mag_regs[0x03], 100, 0);
+	put16(&s->mag_regs[0x05], -200, 0);
+	put16(&s->mag_regs[0x07], 300, 0);
+	CHECK(RIIC_OK == IMU_dev_sample(&dev));
+	CHECK(IMU_mag_raw(&dev, r));
+	CHECK(100 == r[0] && 300 == r[1] && -200 == r[2]);
+
+	/* Campione saturato */
+	put16(&s->mag_regs[0x05], -4096, 0);
+	CHECK(RIIC_OK == IMU_dev_sample(&dev));
+	CHECK(!IMU_mag_raw(&dev, r));
+
+	/* Con la decimazione il master legge il magnetometro un campione ogni 13 (1 kHz / 75 Hz, per difetto) */
+	dev.config.decim = 10;
+	CHECK(RIIC_OK == IMU_mag_start(&dev));
+	CHECK(12 == (s->regs[INV_MPU6050_REG_I2C_SLV4_CTRL] & INV_MPU6050_BITS_I2C_MST_DLY));
+	CHECK(s->regs[INV_MPU6050_REG_I2C_MST_DELAY_CTRL] & INV_MPU6050_BIT_SLV0_DLY_EN);
+	CHECK(3 == s->mag_writes);
+
+	/* QMC5883L: due scritture, dati x, y, z little-endian invertiti dal master */
+	setup(IMU_MAG_QMC5883L);
+	s->mag_addr = QMC5883L_ADDR;
+	s->mag_regs[0x0D] = 0xFF;
+
+	CHECK(RIIC_OK == IMU_mag_start(&dev));
+	CHECK(dev.mag.enabled);
+	CHECK(0x01 == s->mag_regs[0x0B] && 0x1D == s->mag_regs[0x09]);
+	CHECK(2 == s->mag_writes);
+	CHECK((INV_MPU6050_BIT_SLV_EN | INV_MPU6050_BIT_SLV_BYTE_SW | IMU_MAG_BYTES) ==
+		  s->regs[INV_MPU6050_REG_I2C_SLV0_CTRL]);
+
+	put16(&s->mag_regs[0x00], 1000, 1);
+	put16(&s->mag_regs[0x02], -2000, 1);
+	put16(&s->mag_regs[0x04], 3000, 1);
+	CHECK(RIIC_OK == IMU_dev_sample(&dev));
+	CHECK(IMU_mag_raw(&dev, r));
+	CHECK(1000 == r[0] && -2000 == r[1] && 3000 == r[2]);
+
+	/* Magnetometro assente: nessun errore del sensore, master spento */
+	setup(IMU_MAG_HMC5883L);
+	CHECK(RIIC_OK == IMU_mag_start(&dev));
+	CHECK(!dev.mag.enabled && 1 == dev.mag.errors);
+	CHECK(0 == (s->regs[INV_MPU6050_REG_USER_CTRL] & INV_MPU6050_BIT_I2C_MST_EN));
+
+	/* Identificazione sbagliata: nessuna scrittura di configurazione */
+	setup(IMU_MAG_HMC5883L);
+	s->mag_addr = HMC5883L_ADDR;
+	memcpy(&s->mag_regs[0x0A], "H44", 3);
+	CHECK(RIIC_OK == IMU_mag_start(&dev));
+	CHECK(!dev.mag.enabled && 1 == dev.mag.errors);
+	CHECK(0 == s->mag_writes);
+
+	printf("%s (%d errori)\n", failures ? "FALLITO" : "OK", failures);
+
+	return failures ? 1 : 0;
+
+} /* Fine main() */
+
+/*******************************************************************************
+* Nome funzione     : check
+*******************************************************************************/
+static void check(int ok, const char *what)
+{
+	if (!ok)
+	{
+		printf("verifica fallita: %s\n", what);
+		failures++;
+	}
+
+} /* Fine check() */
+
+/*******************************************************************************
+* Nome funzione     : setup
+* Descrizione  	    : Sensore simulato appena acceso, senza magnetometro, e
+* 					  handle configurato a 100 Hz per il tipo indicato
+*******************************************************************************/
+static void setup(uint8_t type)
+{
+	mpu6050_sim_reset();
+	memset(&dev, 0, sizeof(dev));
+	dev.channel = CHANNEL_0;
+	dev.slave_address = IMU_ADDRESS_AD0_LOW;
+	dev.config.rate_hz = 100;
+	dev.config.mag = type;
+	dev.ready = true;
+	IMU_bus_init(dev.channel);
+	IMU_reg_reset_shadow(&dev);
+	IMU_reg_load(&dev);
+
+} /* Fine setup() */
+
+/*******************************************************************************
+* Nome funzione     : put16
+* Descrizione  	    : Scrive un registro a 16 bit del magnetometro simulato
+*******************************************************************************/
+static void put16(uint8_t *p, int16_t v, int little_endian)
+{
+	p[little_endian ? 1 : 0] = (uint8_t)((uint16_t)v >> 8);
+	p[little_endian ? 0 : 1] = (uint8_t)v;
+
+} /* Fine put16() */
@@ -0,0 +1,341 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Strumento host: verifica e misura le funzioni di src/IMU_math.c
+*   - errore massimo di IMU_atan2f, IMU_asinf, IMU_rsqrtf e IMU_tilt rispetto
+*     alle funzioni in doppia precisione, su tutto il campo di ingresso
+*   - risultato finito nei punti singolari (vettore nullo, scheda in piano,
+*     valori denormalizzati e molto grandi)
+*   - tempo per chiamata rispetto alle funzioni della libreria C (cicli del
+*     contatore TSC su x86, altrimenti nanosecondi)
+* Le soglie sono quelle dichiarate in IMU_math.h.
+*
+* Compilazione: gcc -O2 -I../src -o imu_mathsweep imu_mathsweep.c ../src/IMU_math.c -lm
+* Uso:          ./imu_mathsweep   (termina con 0 se tutti gli errori sono entro le soglie)
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "main.h"
+#include "IMU_math.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define SWEEP_STEPS		1000000
+#define BENCH_SIZE		4096
+#define BENCH_LOOPS		256
+#define TILT_TOL		(2.0f * IMU_MATH_ATAN2_MAX_ERR)		/* atan2 piu' l'errore della radice */
+#define CHECK(cond)		check((cond), #cond)
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+static float bench_a[BENCH_SIZE][3];
+static volatile float sink;
+static int failures;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static void check (int ok, const char *what);
+static double wrap (double e);
+static void ref_tilt (const float *a, double *angle);
+static void lib_tilt (const float *a, float *angle);
+static uint64_t ticks (void);
+static double bench_atan2 (int fast);
+static double bench_tilt (int fast);
+static double bench_rsqrt (int fast);
+
+/*******************************************************************************
+* Nome funzione     : main
+*******************************************************************************/
+int main(void)
+{
+	double err, max_err, ref[3], fast_t, lib_t;
+	float a[3], angle[3], v, r;
+	uint32_t seed = 12345;
+	int i, k, bad;
+
+	/* atan2 sul cerchio, con raggi da denormalizzato a molto grande */
+	static const float radius[] = {1e-38f, 1e-6f, 1.0f, 16384.0f, 1e30f};
+	max_err = 0.0;
+	for (k = 0; k < (int)(sizeof(radius) / sizeof(radius[0])); k++)
+	{
+		for (i = 0; i < SWEEP_STEPS; i++)
+		{
+			double t = -M_PI + 2.0 * M_PI * i / SWEEP_STEPS;
+			float y = (float)(radius[k] * sin(t));
+			float x = (float)(radius[k] * cos(t));
+			err = fabs(wrap(IMU_atan2f(y, x) - atan2((double)y, (double)x)));
+			if (err > max_err) {
+				max_err = err;
+			}
+		}
+	}
+	printf("IMU_atan2f: errore massimo %.3g rad (%.3g grad)\n", max_err, max_err * 180.0 / M_PI);
+	CHECK(max_err <= IMU_MATH_ATAN2_MAX_ERR);
+	CHECK(0.0f == IMU_atan2f(0.0f, 0.0f));
+
+	/* asin su [-1, 1] e fuori campo */
+	max_err = 0.0;
+	for (i = 0; i <= SWEEP_STEPS; i++)
+	{
+		v = (float)(-1.0 + 2.0 * i / SWEEP_STEPS);
+		err = fabs(IMU_asinf(v) - asin((double)v));
+		if (err > max_err) {
+			max_err = err;
+		}
+	}
+	printf("IMU_asinf:  errore massimo %.3g rad\n", max_err);
+	CHECK(max_err <= TILT_TOL);
+	CHECK(fabsf(IMU_asinf(1.001f) - IMU_MATH_PI_2) <= TILT_TOL);
+	CHECK(fabsf(IMU_asinf(-1.001f) + IMU_MATH_PI_2) <= TILT_TOL);
+
+	/* rsqrt su 60 decadi */
+	max_err = 0.0;
+	for (i = 0; i <= SWEEP_STEPS; i++)
+	{
+		v = (float)pow(10.0, -30.0 + 60.0 * i / SWEEP_STEPS);
+		err = fabs(IMU_rsqrtf(v) * sqrt((double)v) - 1.0);
+		if (err > max_err) {
+			max_err = err;
+		}
+	}
+	printf("IMU_rsqrtf: errore relativo massimo %.3g\n", max_err);
+	CHECK(max_err <= IMU_MATH_RSQRT_MAX_REL_ERR);
+	CHECK(0.0f == IMU_sqrtf(0.0f));
+
+	/* tilt su vettori casuali */
+	max_err = 0.0;
+	for (i = 0; i < SWEEP_STEPS; i++)
+	{
+		for (k = 0; k < 3; k++)
+		{
+			seed = seed * 1103515245u + 12345u;
+			a[k] = (float)((int32_t)(seed >> 8) - (1 << 23)) / (1 << 23) * 2.0f;
+		}
+		IMU_tilt(a, angle);
+		ref_tilt(a, ref);
+		for (k = 0; k < 3; k++)
+		{
+			err = fabs(angle[k] - ref[k]);
+			if (err > max_err) {
+				max_err = err;
+			}
+		}
+	}
+	printf("IMU_tilt:   errore massimo %.3g rad\n", max_err);
+	CHECK(max_err <= TILT_TOL);
+
+	/* Punti singolari: il risultato deve essere finito */
+	{
+		static const float sing[][3] = {
+			{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, -1.0f},
+			{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {1e-40f, 0.0f, 1e-40f},
+			{1e-20f, -1e-20f, 0.0f}, {1e18f, 1e18f, 1e18f}, {-0.0f, 0.0f, -0.0f}};
+		bad = 0;
+		for (i = 0; i < (int)(sizeof(sing) / sizeof(sing[0])); i++)
+		{
+			IMU_tilt(sing[i], angle);
+			for (k = 0; k < 3; k++)
+			{
+				if (!isfinite(angle[k]) || (fabsf(angle[k]) > IMU_MATH_PI_2 + TILT_TOL)) {
+					bad++;
+				}
+			}
+		}
+		printf("IMU_tilt:   %d risultati non finiti nei punti singolari\n", bad);
+		CHECK(0 == bad);
+		IMU_tilt(sing[1], angle);
+		CHECK((0.0f == angle[IMU_ROLL]) && (0.0f == angle[IMU_PITCH]));
+		CHECK(fabsf(angle[IMU_YAW] - IMU_MATH_PI_2) <= TILT_TOL);
+		lib_tilt(sing[1], angle);
+		printf("libreria:   imbardata con la scheda in piano = %g\n", angle[IMU_YAW]);
+	}
+
+	/* Tempi */
+	for (i = 0; i < BENCH_SIZE; i++)
+	{
+		for (k = 0; k < 3; k++)
+		{
+			seed = seed * 1103515245u + 12345u;
+			bench_a[i][k] = (float)((int32_t)(seed >> 8) - (1 << 23)) / (1 << 23);
+		}
+	}
+	fast_t = bench_atan2(1);
+	lib_t = bench_atan2(0);
+	printf("atan2: %6.1f contro %6.1f per chiamata (x%.2f)\n", fast_t, lib_t, lib_t / fast_t);
+	fast_t = bench_rsqrt(1);
+	lib_t = bench_rsqrt(0);
+	printf("rsqrt: %6.1f contro %6.1f per chiamata (x%.2f)\n", fast_t, lib_t, lib_t / fast_t);
+	fast_t = bench_tilt(1);
+	lib_t = bench_tilt(0);
+	printf("tilt:  %6.1f contro %6.1f per chiamata (x%.2f)\n", fast_t, lib_t, lib_t / fast_t);
+#if defined(__x86_64__) || defined(__i386__)
+	printf("(cicli TSC)\n");
+#else
+	printf("(ns)\n");
+#endif
+
+	r = sink;
+	(void)r;
+	printf("%s (%d errori)\n", failures ? "FALLITO" : "OK", failures);
+
+	return failures ? 1 : 0;
+
+} /* Fine main() */
+
+/*******************************************************************************
+* Nome funzione     : check
+*******************************************************************************/
+static void check(int ok, const char *what)
+{
+	if (!ok)
+	{
+		printf("verifica fallita: %s\n", what);
+		failures++;
+	}
+
+} /* Fine check() */
+
+/*******************************************************************************
+* Nome funzione     : wrap
+* Descrizione  	    : Riporta una differenza di angoli in [-pi, pi]
+*******************************************************************************/
+static double wrap(double e)
+{
+	while (e > M_PI) {
+		e -= 2.0 * M_PI;
+	}
+	while (e < -M_PI) {
+		e += 2.0 * M_PI;
+	}
+
+	return e;
+
+} /* Fine wrap() */
+
+/*******************************************************************************
+* Nome funzione     : ref_tilt
+* Descrizione  	    : Angoli di riferimento in doppia precisione
+*******************************************************************************/
+static void ref_tilt(const float *a, double *angle)
+{
+	double x = a[0], y = a[1], z = a[2];
+
+	angle[IMU_ROLL]  = atan2(y, sqrt(x*x + z*z));
+	angle[IMU_PITCH] = atan2(-x, sqrt(y*y + z*z));
+	angle[IMU_YAW]   = atan2(z, sqrt(x*x + y*y));
+
+} /* Fine ref_tilt() */
+
+/*******************************************************************************
+* Nome funzione     : lib_tilt
+* Descrizione  	    : Formule usate prima di IMU_tilt, con la libreria C
+*******************************************************************************/
+static void lib_tilt(const float *a, float *angle)
+{
+	float ax = a[0], ay = a[1], az = a[2];
+
+	angle[IMU_ROLL]  = atanf(ay/sqrtf(ax*ax + az*az));
+	angle[IMU_PITCH] = atanf(-ax/sqrtf(ay*ay+az*az));
+	angle[IMU_YAW]   = atanf(az/sqrtf(ax*ax + ay*ay));
+
+} /* Fine lib_tilt() */
+
+/*******************************************************************************
+* Nome funzione     : ticks
+*******************************************************************************/
+static uint64_t ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+
+} /* Fine ticks() */
+
+/*******************************************************************************
+* Nome funzione     : bench_atan2
+*******************************************************************************/
+static double bench_atan2(int fast)
+{
+	uint64_t t0 = ticks();
+	float acc = 0.0f;
+	int n, i;
+
+	for (n = 0; n < BENCH_LOOPS; n++)
+	{
+		for (i = 0; i < BENCH_SIZE; i++) {
+			acc += fast ? IMU_atan2f(bench_a[i][0], bench_a[i][1]) : atan2f(bench_a[i][0], bench_a[i][1]);
+		}
+	}
+	sink = acc;
+
+	return (double)(ticks() - t0) / ((double)BENCH_LOOPS * BENCH_SIZE);
+
+} /* Fine bench_atan2() */
+
+/*******************************************************************************
+* Nome funzione     : bench_rsqrt
+*******************************************************************************/
+static double bench_rsqrt(int fast)
+{
+	uint64_t t0 = ticks();
+	float acc = 0.0f, v;
+	int n, i;
+
+	for (n = 0; n < BENCH_LOOPS; n++)
+	{
+		for (i = 0; i < BENCH_SIZE; i++)
+		{
+			v = bench_a[i][0] * bench_a[i][0] + 1e-3f;
+			acc += fast ? IMU_rsqrtf(v) : 1.0f / sqrtf(v);
+		}
+	}
+	sink = acc;
+
+	return (double)(ticks() - t0) / ((double)BENCH_LOOPS * BENCH_SIZE);
+
+} /* Fine bench_rsqrt() */
+
+/*******************************************************************************
+* Nome funzione     : bench_tilt
+*******************************************************************************/
+static double bench_tilt(int fast)
+{
+	uint64_t t0 = ticks();
+	float angle[3], acc = 0.0f;
+	int n, i;
+
+	for (n = 0; n < BENCH_LOOPS; n++)
+	{
+		for (i = 0; i < BENCH_SIZE; i++)
+		{
+			if (fast) {
+				IMU_tilt(bench_a[i], angle);
+			}
+			else {
+				lib_tilt(bench_a[i], angle);
+			}
+			acc += angle[0] + angle[1] + angle[2];
+		}
+	}
+	sink = acc;
+
+	return (double)(ticks() - t0) / ((double)BENCH_LOOPS * BENCH_SIZE);
+
+} /* Fine bench_tilt() */
@@ -0,0 +1,527 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Strumento host: verifica e misura la compressione di src/IMU_pack.c
+*   - rapporto di compressione, per vari intervalli tra keyframe, su due
+*     flussi: campioni grezzi (7 canali per sensore, come i frame
+*     IMU_TELEM_SAMPLES) e campioni della scatola nera (14 canali, i campi di
+*     IMU_bbox_record_struct dopo l'istante). I dati sono quelli registrati
+*     con imu_telemrec -a e -b, o sintetici (robot in equilibrio con rumore)
+*     se non si danno file. Il riferimento non compresso e' istante a 32
+*     bit e canali a 16 bit
+*   - decodifica esatta di ogni campione
+*   - risincronizzazione: tolto un campione codificato, il decodificatore
+*     (con IMU_pack_resync) non deve restituire valori errati e deve
+*     tornare valido entro un intervallo tra keyframe
+*   - caso peggiore su valori casuali a fondo scala, entro IMU_PACK_MAX_ENTRY
+*   - tempo di codifica e decodifica per campione (cicli del contatore TSC su
+*     x86, altrimenti nanosecondi)
+*
+* Compilazione: gcc -O2 -I../src -o imu_packbench imu_packbench.c ../src/IMU_pack.c -lm
+* Uso:          ./imu_packbench [-a campioni.csv] [-b scatola.csv]
+*               (termina con 0 se tutte le verifiche passano)
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "IMU_pack.h"
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define MAX_SAMPLES		200000
+#define RAW_CHANNELS	7
+#define BBOX_CHANNELS	14
+#define CHECK(cond)		check((cond), #cond)
+
+/*******************************************************************************
+Definizione strutture
+*******************************************************************************/
+/* Flusso di prova */
+typedef struct
+{
+	const char *name;
+	uint8_t  channels;
+	uint8_t  streams;
+	uint32_t n;
+	IMU_pack_sample_struct *s;
+
+} stream_struct;
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+static uint8_t packed[MAX_SAMPLES * IMU_PACK_MAX_ENTRY(IMU_PACK_MAX_CHANNELS)];
+static uint16_t entry_len[MAX_SAMPLES];
+static int failures;
+static uint32_t seed = 1;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static void check (int ok, const char *what);
+static int load_samples (const char *path, stream_struct *st);
+static int load_bbox (const char *path, stream_struct *st);
+static void synth_samples (stream_struct *st);
+static void synth_bbox (stream_struct *st);
+static uint32_t encode (const stream_struct *st, uint16_t key_interval);
+static void ratio (const stream_struct *st);
+static void resync (const stream_struct *st);
+static void worst_case (void);
+static void timing (const stream_struct *st);
+static int noise (int amplitude);
+static uint64_t ticks (void);
+
+/*******************************************************************************
+* Nome funzione     : main
+*******************************************************************************/
+int main(int argc, char **argv)
+{
+	stream_struct raw = {"grezzi", RAW_CHANNELS, 4, 0, 0};
+	stream_struct bbox = {"scatola nera", BBOX_CHANNELS, 1, 0, 0};
+	const char *raw_path = 0, *bbox_path = 0;
+	int i;
+
+	for (i = 1; i < argc; i++)
+	{
+		if ((0 == strcmp(argv[i], "-a")) && (i + 1 < argc)) {
+			raw_path = argv[++i];
+		}
+		else if ((0 == strcmp(argv[i], "-b")) && (i + 1 < argc)) {
+			bbox_path = argv[++i];
+		}
+		else
+		{
+			fprintf(stderr, "uso: imu_packbench [-a campioni.csv] [-b scatola.csv]\n");
+			return 1;
+		}
+	}
+
+	raw.s = calloc(MAX_SAMPLES, sizeof(IMU_pack_sample_struct));
+	bbox.s = calloc(MAX_SAMPLES, sizeof(IMU_pack_sample_struct));
+	if (!raw.s || !bbox.s) {
+		return 1;
+	}
+
+	if (raw_path ? load_samples(raw_path, &raw) : (synth_samples(&raw), 0)) {
+		return 1;
+	}
+	if (bbox_path ? load_bbox(bbox_path, &bbox) : (synth_bbox(&bbox), 0)) {
+		return 1;
+	}
+	printf("flusso %s: %u campioni (%s)\n", raw.name, raw.n, raw_path ? raw_path : "sintetici");
+	printf("flusso %s: %u campioni (%s)\n\n", bbox.name, bbox.n, bbox_path ? bbox_path : "sintetici");
+
+	ratio(&raw);
+	ratio(&bbox);
+	resync(&raw);
+	resync(&bbox);
+	worst_case();
+	timing(&raw);
+
+	printf("\n%s\n", failures ? "ERRORI" : "OK");
+
+	return failures ? 1 : 0;
+
+} /* Fine main() */
+
+/*******************************************************************************
+* Nome funzione     : check
+*******************************************************************************/
+static void check(int ok, const char *what)
+{
+	if (!ok)
+	{
+		printf("FALLITO: %s\n", what);
+		failures++;
+	}
+
+} /* Fine check() */
+
+/*******************************************************************************
+* Nome funzione     : load_samples
+* Descrizione  	    : CSV di imu_telemrec -a: t_ms,sensor,key,ax,ay,az,temp,gx,gy,gz
+*******************************************************************************/
+static int load_samples(const char *path, stream_struct *st)
+{
+	FILE *f = fopen(path, "r");
+	char line[512];
+	int v[RAW_CHANNELS], k, key;
+	unsigned t, sensor;
+
+	if (!f)
+	{
+		perror(path);
+		return 1;
+	}
+
+	st->streams = 1;
+	while (fgets(line, sizeof(line), f) && (st->n < MAX_SAMPLES))
+	{
+		if (10 != sscanf(line, "%u,%u,%d,%d,%d,%d,%d,%d,%d,%d", &t, &sensor, &key,
+						 &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6])) {
+			continue;
+		}
+		if (sensor >= IMU_PACK_MAX_STREAMS) {
+			continue;
+		}
+		st->s[st->n].timestamp = t;
+		st->s[st->n].stream = (uint8_t)sensor;
+		for (k = 0; k < RAW_CHANNELS; k++) {
+			st->s[st->n].v[k] = (int16_t)v[k];
+		}
+		if (sensor + 1 > st->streams) {
+			st->streams = (uint8_t)(sensor + 1);
+		}
+		st->n++;
+	}
+	fclose(f);
+
+	return (0 == st->n);
+
+} /* Fine load_samples() */
+
+/*******************************************************************************
+* Nome funzione     : load_bbox
+* Descrizione  	    : CSV di imu_telemrec -b, riportato nelle unita' del
+* 					  campione (IMU_BBOX_ANGLE_SCALE, IMU_BBOX_OMEGA_SCALE,
+* 					  unita' di CMT_counter per la durata, 16 cicli a 96 MHz)
+*******************************************************************************/
+static int load_bbox(const char *path, stream_struct *st)
+{
+	FILE *f = fopen(path, "r");
+	char line[512];
+	unsigned number, trigger, index, count, t, sensors, flags;
+	double a[6], work;
+	int c[6], k;
+	IMU_pack_sample_struct *s;
+
+	if (!f)
+	{
+		perror(path);
+		return 1;
+	}
+
+	while (fgets(line, sizeof(line), f) && (st->n < MAX_SAMPLES))
+	{
+		if (20 != sscanf(line, "%u,%u,%u,%u,%u,%lf,%lf,%lf,%lf,%lf,%lf,%d,%d,%d,%d,%d,%d,%lf,%u,%u",
+						 &number, &trigger, &index, &count, &t, &a[0], &a[1], &a[2], &a[3], &a[4], &a[5],
+						 &c[0], &c[1], &c[2], &c[3], &c[4], &c[5], &work, &sensors, &flags)) {
+			continue;
+		}
+		s = &st->s[st->n++];
+		s->timestamp = t;
+		s->stream = 0;
+		for (k = 0; k < 3; k++) {
+			s->v[k] = (int16_t)floor(a[k] * 10000.0 + 0.5);
+			s->v[3 + k] = (int16_t)floor(a[3 + k] * 1000.0 + 0.5);
+		}
+		for (k = 0; k < 6; k++) {
+			s->v[6 + k] = (int16_t)c[k];
+		}
+		s->v[12] = (int16_t)floor(work * 96.0 / 16.0 + 0.5);
+		s->v[13] = (int16_t)(sensors | (flags << 8));
+	}
+	fclose(f);
+
+	return (0 == st->n);
+
+} /* Fine load_bbox() */
+
+/*******************************************************************************
+* Nome funzione     : synth_samples
+* Descrizione  	    : Due sensori a 1 kHz su un robot in equilibrio: gravita'
+* 					  con oscillazione lenta, vibrazione dei motori e rumore
+*******************************************************************************/
+static void synth_samples(stream_struct *st)
+{
+	IMU_pack_sample_struct *s;
+	double t, pitch;
+	uint32_t i;
+	uint8_t k;
+
+	st->streams = 2;
+	for (i = 0; i < 60000; i++)
+	{
+		s = &st->s[st->n++];
+		s->stream = (uint8_t)(i & 1);
+		s->timestamp = i / 2;
+		t = s->timestamp * 1e-3;
+		pitch = 0.03 * sin(2 * M_PI * 0.7 * t);
+		s->v[0] = (int16_t)(16384 * sin(pitch) + 40 * sin(2 * M_PI * 47 * t) + noise(12));
+		s->v[1] = (int16_t)(noise(12) + 20);
+		s->v[2] = (int16_t)(16384 * cos(pitch) + noise(16));
+		s->v[3] = (int16_t)(-1500 + 10 * t + noise(2));
+		s->v[4] = (int16_t)(noise(6));
+		s->v[5] = (int16_t)(131 * 0.03 * 2 * M_PI * 0.7 * 57.3 * cos(2 * M_PI * 0.7 * t) + noise(6));
+		s->v[6] = (int16_t)(noise(6) - 12);
+		for (k = 0; k < RAW_CHANNELS; k++) {
+			s->v[k] = (int16_t)(s->v[k] + s->stream * 30);
+		}
+	}
+
+} /* Fine synth_samples() */
+
+/*******************************************************************************
+* Nome funzione     : synth_bbox
+* Descrizione  	    : Campioni della scatola nera a 100 Hz dello stesso moto
+*******************************************************************************/
+static void synth_bbox(stream_struct *st)
+{
+	IMU_pack_sample_struct *s;
+	double t, pitch, rate;
+	uint32_t i;
+
+	for (i = 0; i < 6000; i++)
+	{
+		s = &st->s[st->n++];
+		s->stream = 0;
+		s->timestamp = 10 * i;
+		t = s->timestamp * 1e-3;
+		pitch = 0.03 * sin(2 * M_PI * 0.7 * t);
+		rate = 0.03 * 2 * M_PI * 0.7 * cos(2 * M_PI * 0.7 * t);
+		s->v[0] = (int16_t)(10000 * 0.002 * sin(t) + noise(3));
+		s->v[1] = (int16_t)(10000 * pitch + noise(3));
+		s->v[2] = (int16_t)(10000 * 0.1 * t);
+		s->v[3] = (int16_t)(noise(8));
+		s->v[4] = (int16_t)(1000 * rate + noise(8));
+		s->v[5] = (int16_t)(100 + noise(8));
+		s->v[6] = (int16_t)(16384 * sin(pitch) + noise(12));
+		s->v[7] = (int16_t)(noise(12));
+		s->v[8] = (int16_t)(16384 * cos(pitch) + noise(16));
+		s->v[9] = (int16_t)(2000 * pitch + noise(4));
+		s->v[10] = (int16_t)(2000 * pitch + noise(4));
+		s->v[11] = 0;
+		s->v[12] = (int16_t)(2400 + noise(40));
+		s->v[13] = 2;
+	}
+
+} /* Fine synth_bbox() */
+
+/*******************************************************************************
+* Nome funzione     : encode
+* Descrizione  	    : Codifica tutto il flusso in packed, con la lunghezza di
+* 					  ogni campione in entry_len; restituisce i byte totali
+*******************************************************************************/
+static uint32_t encode(const stream_struct *st, uint16_t key_interval)
+{
+	IMU_pack_struct p;
+	uint32_t i, total = 0;
+
+	IMU_pack_init(&p, st->channels, st->streams, key_interval);
+	for (i = 0; i < st->n; i++)
+	{
+		entry_len[i] = IMU_pack_encode(&p, st->s[i].stream, st->s[i].timestamp, st->s[i].v, packed + total);
+		total += entry_len[i];
+	}
+
+	return total;
+
+} /* Fine encode() */
+
+/*******************************************************************************
+* Nome funzione     : ratio
+* Descrizione  	    : Rapporto di compressione e decodifica esatta per vari
+* 					  intervalli tra keyframe
+*******************************************************************************/
+static void ratio(const stream_struct *st)
+{
+	static const uint16_t intervals[] = {1, 8, 16, 64, 256};
+	IMU_pack_struct p;
+	IMU_pack_sample_struct d;
+	uint32_t raw_bytes = st->n * (4 + 2 * st->channels), total, pos, i;
+	uint16_t used;
+	unsigned k;
+	int bad;
+
+	printf("%s (%u canali, %u byte/campione non compressi)\n", st->name, st->channels, 4 + 2 * st->channels);
+	for (k = 0; k < sizeof(intervals) / sizeof(intervals[0]); k++)
+	{
+		total = encode(st, intervals[k]);
+
+		IMU_pack_init(&p, st->channels, st->streams, intervals[k]);
+		for (i = 0, pos = 0, bad = 0; i < st->n; i++)
+		{
+			used = IMU_pack_decode(&p, packed + pos, (uint16_t)((total - pos > 0xFFFF) ? 0xFFFF : total - pos), &d);
+			if ((used != entry_len[i]) || !d.valid || (d.timestamp != st->s[i].timestamp) ||
+				(d.stream != st->s[i].stream) || memcmp(d.v, st->s[i].v, st->channels * sizeof(int16_t)))
+			{
+				bad++;
+				break;
+			}
+			pos += used;
+		}
+
+		printf("  keyframe ogni %3u: %6.2f byte/campione, rapporto %.2f%s\n", intervals[k],
+			   (double)total / st->n, (double)raw_bytes / total, bad ? "  DECODIFICA ERRATA" : "");
+		CHECK(0 == bad);
+	}
+
+} /* Fine ratio() */
+
+/*******************************************************************************
+* Nome funzione     : resync
+* Descrizione  	    : Toglie un campione codificato in vari punti; il
+* 					  ricevitore sa della perdita (buco nei frame) e chiama
+* 					  IMU_pack_resync. Nessun campione valido deve essere
+* 					  errato e la decodifica deve tornare valida entro un
+* 					  intervallo tra keyframe per flusso
+*******************************************************************************/
+static void resync(const stream_struct *st)
+{
+	IMU_pack_struct p;
+	IMU_pack_sample_struct d;
+	uint32_t total, drop, i, pos, last_invalid, skipped = 0, worst = 0, wrong = 0;
+	uint16_t used;
+	int trial;
+
+	total = encode(st, IMU_PACK_KEY_INTERVAL);
+
+	for (trial = 0; trial < 50; trial++)
+	{
+		drop = 1 + (uint32_t)((uint64_t)(st->n - 2) * trial / 50);
+		IMU_pack_init(&p, st->channels, st->streams, IMU_PACK_KEY_INTERVAL);
+		last_invalid = drop;
+		for (i = 0, pos = 0; i < st->n; i++)
+		{
+			if (i == drop)
+			{
+				pos += entry_len[i];
+				IMU_pack_resync(&p);
+				continue;
+			}
+			used = IMU_pack_decode(&p, packed + pos, (uint16_t)((total - pos > 0xFFFF) ? 0xFFFF : total - pos), &d);
+			if (used != entry_len[i])
+			{
+				wrong++;
+				break;
+			}
+			pos += used;
+			if (!d.valid)
+			{
+				skipped++;
+				last_invalid = i;
+			}
+			else if ((d.timestamp != st->s[i].timestamp) || memcmp(d.v, st->s[i].v, st->channels * sizeof(int16_t))) {
+				wrong++;
+			}
+		}
+		if (last_invalid - drop > worst) {
+			worst = last_invalid - drop;
+		}
+	}
+
+	printf("%s, risincronizzazione: %u campioni scartati in 50 perdite, al piu' %u dopo la perdita, %u errati\n",
+		   st->name, skipped, worst, wrong);
+	CHECK(0 == wrong);
+	CHECK(worst <= (uint32_t)IMU_PACK_KEY_INTERVAL * st->streams);
+
+} /* Fine resync() */
+
+/*******************************************************************************
+* Nome funzione     : worst_case
+* Descrizione  	    : Valori casuali su tutta la scala a 16 bit e salti di
+* 					  tempo: lunghezza massima e decodifica esatta
+*******************************************************************************/
+static void worst_case(void)
+{
+	IMU_pack_struct e, p;
+	IMU_pack_sample_struct d;
+	int16_t v[IMU_PACK_MAX_CHANNELS];
+	uint8_t buf[IMU_PACK_MAX_ENTRY(IMU_PACK_MAX_CHANNELS)];
+	uint32_t t = 0xFFFFF000u, i;
+	uint16_t len, max = 0, used;
+	uint8_t k, stream;
+	int bad = 0;
+
+	IMU_pack_init(&e, IMU_PACK_MAX_CHANNELS, IMU_PACK_MAX_STREAMS, IMU_PACK_KEY_INTERVAL);
+	IMU_pack_init(&p, IMU_PACK_MAX_CHANNELS, IMU_PACK_MAX_STREAMS, IMU_PACK_KEY_INTERVAL);
+	for (i = 0; i < 1000000; i++)
+	{
+		stream = (uint8_t)(noise(1000) & (IMU_PACK_MAX_STREAMS - 1));
+		t += (0 == (i & 0xFFF)) ? 0x40000000u : (uint32_t)(noise(1000) + 1000);
+		for (k = 0; k < IMU_PACK_MAX_CHANNELS; k++) {
+			v[k] = (int16_t)(noise(0x8000) ^ ((i & 1) ? 0x8000 : 0));
+		}
+		len = IMU_pack_encode(&e, stream, t, v, buf);
+		if (len > max) {
+			max = len;
+		}
+		used = IMU_pack_decode(&p, buf, len, &d);
+		if ((used != len) || !d.valid || (d.timestamp != t) || memcmp(d.v, v, sizeof(v))) {
+			bad++;
+		}
+	}
+
+	printf("caso peggiore: %u byte con %u canali (limite %u), %d errati\n",
+		   max, IMU_PACK_MAX_CHANNELS, IMU_PACK_MAX_ENTRY(IMU_PACK_MAX_CHANNELS), bad);
+	CHECK(max <= IMU_PACK_MAX_ENTRY(IMU_PACK_MAX_CHANNELS));
+	CHECK(0 == bad);
+
+} /* Fine worst_case() */
+
+/*******************************************************************************
+* Nome funzione     : timing
+*******************************************************************************/
+static void timing(const stream_struct *st)
+{
+	IMU_pack_struct p;
+	IMU_pack_sample_struct d;
+	uint32_t total, i, pos;
+	uint64_t t0, t1, t2;
+
+	t0 = ticks();
+	total = encode(st, IMU_PACK_KEY_INTERVAL);
+	t1 = ticks();
+	IMU_pack_init(&p, st->channels, st->streams, IMU_PACK_KEY_INTERVAL);
+	for (i = 0, pos = 0; i < st->n; i++) {
+		pos += IMU_pack_decode(&p, packed + pos, (uint16_t)((total - pos > 0xFFFF) ? 0xFFFF : total - pos), &d);
+	}
+	t2 = ticks();
+
+#if defined(__x86_64__) || defined(__i386__)
+	printf("tempo per campione (%s): codifica %.1f, decodifica %.1f cicli TSC\n", st->name,
+#else
+	printf("tempo per campione (%s): codifica %.1f, decodifica %.1f ns\n", st->name,
+#endif
+		   (double)(t1 - t0) / st->n, (double)(t2 - t1) / st->n);
+
+} /* Fine timing() */
+
+/*******************************************************************************
+* Nome funzione     : noise
+* Descrizione  	    : Intero pseudocasuale uniforme in [-amplitude, amplitude]
+*******************************************************************************/
+static int noise(int amplitude)
+{
+	seed = seed * 1103515245u + 12345u;
+
+	return (int)((seed >> 8) % (uint32_t)(2 * amplitude + 1)) - amplitude;
+
+} /* Fine noise() */
+
+/*******************************************************************************
+* Nome funzione     : ticks
+*******************************************************************************/
+static uint64_t ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+
+} /* Fine ticks() */
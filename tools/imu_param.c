@@ -0,0 +1,610 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Strumento host: legge e modifica i parametri del firmware a runtime
+* (src/IMU_param.c) sulla seriale della telemetria, senza ricompilare
+*   - list: tutti i parametri con il valore in vigore, per ogni sensore
+*   - get <nome> [sensore]: un parametro (senza sensore: tutti i sensori)
+*   - set <nome> <valore> [sensore]: modifica un parametro (senza sensore:
+*     tutti i sensori); la risposta arriva quando la modifica e' applicata
+* Piu' comandi di seguito vengono eseguiti in ordine. Un comando senza
+* risposta viene ripetuto (le modifiche sono idempotenti).
+* I nomi, i tipi e gli intervalli vengono dalla tabella del firmware
+* (IMU_param_table), controllati anche sull'host prima dell'invio.
+* Con -l il firmware gira nel processo su MPU-6050 simulati, un ciclo per
+* ms: i comandi passano da IMU_telem_rx e le risposte dal buffer della
+* telemetria; alla fine si stampano i registri di configurazione simulati e
+* i contatori delle modifiche. I frame non di risposta (stato, campioni)
+* vengono ignorati.
+*
+* Compilazione (dalla cartella tools):
+*   gcc -O2 -Ihost -I../src -I../r_riic_rx600 -I../r_riic_rx600/src
+*       -I../r_bsp/mcu/rx63n -I../r_bsp/board/rdkrx63n -o imu_param
+*       imu_param.c host/mpu6050_sim.c ../src/IMU*.c -lm
+* Uso:          ./imu_param [-d /dev/ttyUSB0 | -l] [-t attesa_ms] comando...
+*               (termina con 0 se tutti i comandi hanno esito positivo)
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include "platform.h"
+#include "CMT.h"
+#include "IMU.h"
+#include "IMU_telem.h"
+#include "IMU_param.h"
+#include "mpu6050_sim.h"
+#include <termios.h>		/* dopo iodefine.h: definisce B0, nome di campo dei registri */
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define RETRIES			3
+#define MAX_REPLIES		(2 * (NUM_IMU_PARAM - 1) * IMU_NUM_SENSORS)
+
+/*******************************************************************************
+Definizione strutture
+*******************************************************************************/
+/* Risposta decodificata */
+typedef struct
+{
+	uint8_t  status;
+	uint8_t  tag;
+	uint8_t  id;
+	uint8_t  sensor;
+	uint8_t  type;
+	IMU_param_value_u value;
+
+} reply_struct;
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+static const char * const status_name[NUM_IMU_PARAM_STATUS] = {
+	"ok", "comando errato", "parametro inesistente", "sensore inesistente",
+	"fuori intervallo", "troppe modifiche in attesa", "applicazione fallita"
+};
+
+static int fd = -1;
+static bool loopback;
+static int timeout_ms = 500;
+static uint8_t next_tag;
+
+static reply_struct replies[MAX_REPLIES];
+static int num_replies;
+
+static IMU_dev_struct dev[IMU_NUM_SENSORS];
+static IMU_data_struct fused;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static int open_serial (const char *path);
+static void loop_init (void);
+static void loop_cycle (void);
+static int run (uint8_t op, const IMU_param_def_struct *def, uint8_t sensor, IMU_param_value_u v, int expected);
+static void send_command (const uint8_t *cmd, uint16_t n);
+static void receive (int wait_ms);
+static void feed (uint8_t c);
+static int cobs_decode (const uint8_t *in, int n, uint8_t *out, int max);
+static void print_reply (const reply_struct *r);
+static const IMU_param_def_struct *lookup (const char *name);
+static double now_ms (void);
+static void usage (void);
+
+/*******************************************************************************
+* Funzioni della scheda non presenti sull'host
+*******************************************************************************/
+void lcd_display(uint8_t line, const uint8_t *text)
+{
+	(void)line;
+	(void)text;
+}
+
+/*******************************************************************************
+* Nome funzione     : main
+*******************************************************************************/
+int main(int argc, char **argv)
+{
+	const char *path = 0;
+	const IMU_param_def_struct *def;
+	IMU_param_value_u v;
+	uint8_t sensor;
+	int opt, failures = 0, i, per;
+
+	while ((opt = getopt(argc, argv, "d:lt:h")) != -1)
+	{
+		switch (opt)
+		{
+			case 'd': path = optarg; break;
+			case 'l': loopback = true; break;
+			case 't': timeout_ms = atoi(optarg); break;
+			default: usage(); return 1;
+		}
+	}
+	if ((optind >= argc) || (!path && !loopback) || (path && loopback))
+	{
+		usage();
+		return 1;
+	}
+
+	if (loopback) {
+		loop_init();
+	}
+	else if ((fd = open_serial(path)) < 0) {
+		return 1;
+	}
+
+	for (i = optind; i < argc; i++)
+	{
+		v.bits = 0;
+		sensor = IMU_PARAM_ALL_SENSORS;
+
+		if (0 == strcmp(argv[i], "list"))
+		{
+			for (def = IMU_param_table, per = 0; def < IMU_param_table + NUM_IMU_PARAM - 1; def++) {
+				per += (def->flags & IMU_PARAM_PER_SENSOR) ? IMU_NUM_SENSORS : 1;
+			}
+			failures += run(IMU_PARAM_GET, 0, 0, v, per);
+			continue;
+		}
+
+		if ((0 == strcmp(argv[i], "get")) && (i + 1 < argc))
+		{
+			if (!(def = lookup(argv[++i]))) {
+				return 1;
+			}
+			if ((i + 1 < argc) && (argv[i + 1][0] >= '0') && (argv[i + 1][0] <= '9')) {
+				sensor = (uint8_t)atoi(argv[++i]);
+			}
+			per = ((def->flags & IMU_PARAM_PER_SENSOR) && (IMU_PARAM_ALL_SENSORS == sensor)) ? IMU_NUM_SENSORS : 1;
+			failures += run(IMU_PARAM_GET, def, sensor, v, per);
+			continue;
+		}
+
+		if ((0 == strcmp(argv[i], "set")) && (i + 2 < argc))
+		{
+			if (!(def = lookup(argv[++i]))) {
+				return 1;
+			}
+			if (IMU_PARAM_F32 == def->type) {
+				v.f = strtof(argv[++i], 0);
+			}
+			else {
+				v.i = (int32_t)strtol(argv[++i], 0, 0);
+			}
+			if ((i + 1 < argc) && (argv[i + 1][0] >= '0') && (argv[i + 1][0] <= '9')) {
+				sensor = (uint8_t)atoi(argv[++i]);
+			}
+
+			/* Lo stesso controllo del firmware, per un messaggio immediato */
+			if (!((((IMU_PARAM_F32 == def->type) ? v.f : (float)v.i) >= def->min) &&
+				  (((IMU_PARAM_F32 == def->type) ? v.f : (float)v.i) <= def->max)))
+			{
+				fprintf(stderr, "%s: valore fuori da [%g, %g]\n", def->name, def->min, def->max);
+				failures++;
+				continue;
+			}
+			failures += run(IMU_PARAM_SET, def, sensor, v, 1);
+			continue;
+		}
+
+		usage();
+		return 1;
+	}
+
+	if (loopback)
+	{
+		for (i = 0; i < IMU_NUM_SENSORS; i++)
+		{
+			printf("sensore %d simulato: SMPLRT_DIV 0x%02X CONFIG 0x%02X GYRO_CONFIG 0x%02X ACCEL_CONFIG 0x%02X\n", i,
+				   mpu6050_sim[i].regs[INV_MPU6050_REG_SAMPLE_RATE_DIV], mpu6050_sim[i].regs[INV_MPU6050_REG_CONFIG],
+				   mpu6050_sim[i].regs[INV_MPU6050_REG_GYRO_CONFIG], mpu6050_sim[i].regs[INV_MPU6050_REG_ACCEL_CONFIG]);
+		}
+		printf("modifiche applicate %u, rifiutate %u\n", (unsigned)IMU_param.applied, (unsigned)IMU_param.rejected);
+	}
+	else {
+		close(fd);
+	}
+
+	return failures ? 2 : 0;
+
+} /* Fine main() */
+
+/*******************************************************************************
+* Nome funzione     : open_serial
+* Descrizione  	    : Apre la seriale in modo raw alla velocita' della telemetria
+*******************************************************************************/
+static int open_serial(const char *path)
+{
+	struct termios tio;
+	int f;
+
+	f = open(path, O_RDWR | O_NOCTTY);
+	if (f < 0)
+	{
+		perror(path);
+		return -1;
+	}
+
+	if (tcgetattr(f, &tio) < 0)
+	{
+		perror(path);
+		close(f);
+		return -1;
+	}
+	cfmakeraw(&tio);
+	tio.c_cflag |= CLOCAL | CREAD;
+	tio.c_cc[VMIN] = 0;
+	tio.c_cc[VTIME] = 0;
+	cfsetispeed(&tio, B1500000);
+	cfsetospeed(&tio, B1500000);
+	if (tcsetattr(f, TCSANOW, &tio) < 0)
+	{
+		perror(path);
+		close(f);
+		return -1;
+	}
+	tcflush(f, TCIOFLUSH);
+
+	return f;
+
+} /* Fine open_serial() */
+
+/*******************************************************************************
+* Nome funzione     : loop_init
+* Descrizione  	    : Sensori simulati configurati come main.c (lettura
+* 					  diretta a 100 Hz) e canale dei comandi. La telemetria
+* 					  non tocca la SCI: le risposte restano nel buffer
+*******************************************************************************/
+static void loop_init(void)
+{
+	IMU_filter_config_struct filter = IMU_FILTER_CONFIG;
+	int i;
+
+	mpu6050_sim_reset();
+	for (i = 0; i < IMU_NUM_SENSORS; i++)
+	{
+		dev[i].channel = CHANNEL_0;
+		dev[i].slave_address = (0 == i) ? IMU_ADDRESS_AD0_LOW : IMU_ADDRESS_AD0_HIGH;
+		dev[i].config.accel_fs = INV_MPU6050_FS_02G;
+		dev[i].config.gyro_fs = INV_MPU6050_FSR_250DPS;
+		dev[i].config.dlpf = INV_MPU6050_FILTER_256HZ_NODLPF;
+		dev[i].config.rate_hz = 100;
+		dev[i].config.filter = filter;
+	}
+	IMU_init(dev, IMU_NUM_SENSORS);
+
+	memset(&IMU_telem, 0, sizeof(IMU_telem));
+	IMU_telem.sending = -1;
+	IMU_telem.pending = -1;
+	IMU_param_init(dev, IMU_NUM_SENSORS);
+
+} /* Fine loop_init() */
+
+/*******************************************************************************
+* Nome funzione     : loop_cycle
+* Descrizione  	    : Un ciclo del firmware. La linea risulta occupata: un
+* 					  frame inviato resta in attesa e viene letto da qui
+*******************************************************************************/
+static void loop_cycle(void)
+{
+	int b, k;
+
+	ms_delay(1);
+	IMU_result(dev, IMU_NUM_SENSORS, &fused);
+
+	IMU_telem.sending = 0;
+	IMU_telem.pending = -1;
+	IMU_param_poll();
+	b = IMU_telem.pending;
+	if (b >= 0)
+	{
+		for (k = 0; k < IMU_telem.len[b]; k++) {
+			feed(IMU_telem.buf[b][k]);
+		}
+	}
+	IMU_telem.sending = -1;
+	IMU_telem.pending = -1;
+
+} /* Fine loop_cycle() */
+
+/*******************************************************************************
+* Nome funzione     : run
+* Descrizione  	    : Invia un comando e attende le risposte con la sua
+* 					  etichetta; senza risposte lo ripete. Restituisce il
+* 					  numero di esiti negativi (o 1 se non arriva nulla)
+*******************************************************************************/
+static int run(uint8_t op, const IMU_param_def_struct *def, uint8_t sensor, IMU_param_value_u v, int expected)
+{
+	uint8_t cmd[IMU_PARAM_CMD_LEN];
+	uint8_t tag = ++next_tag;
+	int attempt, i, got, failures = 0;
+	double start;
+
+	cmd[0] = op;
+	cmd[1] = tag;
+	cmd[2] = def ? def->id : IMU_PARAM_ALL;
+	cmd[3] = sensor;
+	cmd[4] = (uint8_t)v.bits;
+	cmd[5] = (uint8_t)(v.bits >> 8);
+	cmd[6] = (uint8_t)(v.bits >> 16);
+	cmd[7] = (uint8_t)(v.bits >> 24);
+
+	for (attempt = 0; attempt < RETRIES; attempt++)
+	{
+		num_replies = 0;
+		send_command(cmd, sizeof(cmd));
+
+		/* Attende tutte le risposte attese o la fine del tempo */
+		start = now_ms();
+		for (got = 0; (got < expected) && (now_ms() - start < timeout_ms); )
+		{
+			receive(10);
+			for (i = 0, got = 0; i < num_replies; i++) {
+				got += (replies[i].tag == tag);
+			}
+		}
+		if (got > 0) {
+			break;
+		}
+	}
+
+	for (i = 0, got = 0; i < num_replies; i++)
+	{
+		if (replies[i].tag != tag) {
+			continue;
+		}
+		print_reply(&replies[i]);
+		failures += (IMU_PARAM_OK != replies[i].status);
+		got++;
+	}
+	if (got < expected)
+	{
+		fprintf(stderr, "%d risposte su %d\n", got, expected);
+		failures++;
+	}
+
+	return failures;
+
+} /* Fine run() */
+
+/*******************************************************************************
+* Nome funzione     : send_command
+* Descrizione  	    : CRC, COBS e delimitatore, come IMU_telem_queue
+*******************************************************************************/
+static void send_command(const uint8_t *cmd, uint16_t n)
+{
+	uint8_t frame[IMU_TELEM_CMD_MAX + 2], enc[IMU_TELEM_CMD_ENCODED + 2];
+	uint16_t crc, len, k;
+
+	memcpy(frame, cmd, n);
+	crc = IMU_telem_crc16(frame, n, IMU_TELEM_CRC_INIT);
+	frame[n] = (uint8_t)crc;
+	frame[n + 1] = (uint8_t)(crc >> 8);
+	enc[0] = 0;
+	len = (uint16_t)(1 + IMU_telem_cobs(frame, n + 2, enc + 1));
+	enc[len++] = 0;
+
+	/* Lo zero iniziale chiude un eventuale comando interrotto */
+	if (loopback)
+	{
+		for (k = 0; k < len; k++) {
+			IMU_telem_rx(enc[k]);
+		}
+	}
+	else if (write(fd, enc, len) != (ssize_t)len) {
+		perror("write");
+	}
+
+} /* Fine send_command() */
+
+/*******************************************************************************
+* Nome funzione     : receive
+* Descrizione  	    : Legge per circa wait_ms (dalla seriale, o facendo girare
+* 					  il firmware simulato un ms alla volta)
+*******************************************************************************/
+static void receive(int wait_ms)
+{
+	uint8_t buf[4096];
+	struct timeval tv;
+	fd_set set;
+	ssize_t n, i;
+	int k;
+
+	if (loopback)
+	{
+		for (k = 0; k < wait_ms; k++) {
+			loop_cycle();
+		}
+		return;
+	}
+
+	FD_ZERO(&set);
+	FD_SET(fd, &set);
+	tv.tv_sec = 0;
+	tv.tv_usec = wait_ms * 1000;
+	if (select(fd + 1, &set, 0, 0, &tv) <= 0) {
+		return;
+	}
+	n = read(fd, buf, sizeof(buf));
+	for (i = 0; i < n; i++) {
+		feed(buf[i]);
+	}
+
+} /* Fine receive() */
+
+/*******************************************************************************
+* Nome funzione     : feed
+* Descrizione  	    : Ricompone i frame della telemetria e conserva le
+* 					  risposte ai comandi con CRC corretto
+*******************************************************************************/
+static void feed(uint8_t c)
+{
+	static uint8_t enc[IMU_TELEM_ENCODED];
+	static int len;
+	static bool too_long;
+	uint8_t dec[IMU_TELEM_ENCODED];
+	reply_struct *r;
+	int n;
+
+	if (0 != c)
+	{
+		if (len < (int)sizeof(enc)) {
+			enc[len++] = c;
+		}
+		else {
+			too_long = true;
+		}
+		return;
+	}
+
+	n = (too_long || (0 == len)) ? -1 : cobs_decode(enc, len, dec, sizeof(dec));
+	len = 0;
+	too_long = false;
+
+	if ((n != IMU_TELEM_PARAM_PAYLOAD + 2) || (IMU_TELEM_PARAM != dec[0]) ||
+		(IMU_telem_crc16(dec, IMU_TELEM_PARAM_PAYLOAD, IMU_TELEM_CRC_INIT) != (uint16_t)(dec[n - 2] | (dec[n - 1] << 8))) ||
+		(num_replies >= MAX_REPLIES)) {
+		return;
+	}
+
+	r = &replies[num_replies++];
+	r->status = dec[1];
+	r->tag = dec[4];
+	r->id = dec[5];
+	r->sensor = dec[6];
+	r->type = dec[7];
+	r->value.bits = (uint32_t)dec[8] | ((uint32_t)dec[9] << 8) | ((uint32_t)dec[10] << 16) | ((uint32_t)dec[11] << 24);
+
+} /* Fine feed() */
+
+/*******************************************************************************
+* Nome funzione     : cobs_decode
+* Descrizione  	    : Inverso di IMU_telem_cobs; -1 se il frame e' malformato
+*******************************************************************************/
+static int cobs_decode(const uint8_t *in, int n, uint8_t *out, int max)
+{
+	int i = 0, o = 0, k, code;
+
+	while (i < n)
+	{
+		code = in[i++];
+		if ((i + code - 1 > n) || (o + code > max)) {
+			return -1;
+		}
+		for (k = 1; k < code; k++) {
+			out[o++] = in[i++];
+		}
+		if ((code < 0xFF) && (i < n)) {
+			out[o++] = 0;
+		}
+	}
+
+	return o;
+
+} /* Fine cobs_decode() */
+
+/*******************************************************************************
+* Nome funzione     : print_reply
+*******************************************************************************/
+static void print_reply(const reply_struct *r)
+{
+	const IMU_param_def_struct *def = IMU_param_find(r->id);
+	const char *status = (r->status < NUM_IMU_PARAM_STATUS) ? status_name[r->status] : "?";
+
+	if (!def)
+	{
+		printf("parametro %u: %s\n", r->id, status);
+		return;
+	}
+
+	if (def->flags & IMU_PARAM_PER_SENSOR)
+	{
+		if (IMU_PARAM_ALL_SENSORS == r->sensor) {
+			printf("%-16s[*] ", def->name);
+		}
+		else {
+			printf("%-16s[%u] ", def->name, r->sensor);
+		}
+	}
+	else {
+		printf("%-19s ", def->name);
+	}
+
+	if (IMU_PARAM_F32 == r->type) {
+		printf("= %-12g", r->value.f);
+	}
+	else {
+		printf("= %-12d", (int)r->value.i);
+	}
+	printf(" [%g, %g]  %s\n", def->min, def->max, status);
+
+} /* Fine print_reply() */
+
+/*******************************************************************************
+* Nome funzione     : lookup
+*******************************************************************************/
+static const IMU_param_def_struct *lookup(const char *name)
+{
+	int i;
+
+	for (i = 0; i < NUM_IMU_PARAM - 1; i++)
+	{
+		if (0 == strcmp(IMU_param_table[i].name, name)) {
+			return &IMU_param_table[i];
+		}
+	}
+
+	fprintf(stderr, "parametro sconosciuto: %s (parametri:", name);
+	for (i = 0; i < NUM_IMU_PARAM - 1; i++) {
+		fprintf(stderr, " %s", IMU_param_table[i].name);
+	}
+	fprintf(stderr, ")\n");
+
+	return 0;
+
+} /* Fine lookup() */
+
+/*******************************************************************************
+* Nome funzione     : now_ms
+* Descrizione  	    : Orologio dell'host; con -l il tempo simulato
+*******************************************************************************/
+static double now_ms(void)
+{
+	struct timespec ts;
+
+	if (loopback) {
+		return get_ms();
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+
+} /* Fine now_ms() */
+
+/*******************************************************************************
+* Nome funzione     : usage
+*******************************************************************************/
+static void usage(void)
+{
+	fprintf(stderr,
+			"uso: imu_param [-d seriale | -l] [-t attesa_ms] comando...\n"
+			"  -d  seriale della telemetria (%d baud)\n"
+			"  -l  firmware simulato nel processo\n"
+			"  -t  attesa delle risposte prima di ripetere il comando (ms)\n"
+			"comandi:\n"
+			"  list\n"
+			"  get <nome> [sensore]\n"
+			"  set <nome> <valore> [sensore]\n",
+			IMU_TELEM_BAUD);
+
+} /* Fine usage() */
@@ -0,0 +1,166 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Strumento host: prova di carico di src/IMU_ring.c con due thread, uno che
+* accoda (come l'interrupt di acquisizione) e uno che estrae a blocchi di
+* dimensione variabile (come la fusione o la telemetria).
+* Ogni campione porta un numero di sequenza nel timestamp e in tutti i campi
+* grezzi; il consumatore verifica che:
+*   - nessun campione sia scritto a meta' (campi coerenti tra loro)
+*   - la sequenza sia crescente e i buchi corrispondano ai campioni scartati
+*   - ogni campione scartato sia contato negli overrun della coda
+* A coda piena il produttore attende, tranne un campione su 16 che viene
+* perso per provare gli overrun.
+* Gli accessi volatile della coda bastano su x86 (ordine delle scritture
+* garantito dall'hardware), come sull'RX.
+*
+* Compilazione: gcc -O2 -pthread -I../src -o imu_ringstress imu_ringstress.c ../src/IMU_ring.c
+* Uso:          ./imu_ringstress [campioni]   (termina con 0 se non ci sono errori)
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include "IMU_ring.h"
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+static IMU_ring_struct ring;
+static uint32_t total = 10000000;
+static volatile uint32_t dropped;	/* campioni rinunciati dal produttore */
+static volatile int done;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static void *producer (void *arg);
+static int sample_ok (const IMU_sample_struct *s);
+
+/*******************************************************************************
+* Nome funzione     : main
+*******************************************************************************/
+int main(int argc, char **argv)
+{
+	IMU_sample_struct out[IMU_RING_SIZE];
+	pthread_t thread;
+	uint32_t received = 0, expected = 0, lost = 0, torn = 0, order = 0;
+	uint32_t seed = 1;
+	uint16_t n, i, max;
+
+	if (argc > 1) {
+		total = (uint32_t)strtoul(argv[1], 0, 0);
+	}
+
+	IMU_ring_init(&ring);
+	pthread_create(&thread, 0, producer, 0);
+
+	while (!done || (IMU_ring_count(&ring) > 0))
+	{
+		seed = seed * 1103515245u + 12345u;
+		max = (uint16_t)(1 + (seed >> 16) % IMU_RING_SIZE);
+		n = IMU_ring_pop(&ring, out, max);
+		if (0 == n) {
+			sched_yield();
+		}
+		for (i = 0; i < n; i++)
+		{
+			if (!sample_ok(&out[i])) {
+				torn++;
+			}
+			if (out[i].timestamp < expected) {
+				order++;
+			}
+			else {
+				lost += out[i].timestamp - expected;
+			}
+			expected = out[i].timestamp + 1;
+		}
+		received += n;
+	}
+	pthread_join(thread, 0);
+	lost += total - expected;
+
+	printf("inviati %lu, ricevuti %lu, scartati %lu, persi %lu, overrun %lu, corrotti %lu, fuori ordine %lu\n",
+		   (unsigned long)total, (unsigned long)received, (unsigned long)dropped, (unsigned long)lost,
+		   (unsigned long)ring.overruns, (unsigned long)torn, (unsigned long)order);
+
+	/* Ogni campione scartato e' un push fallito; gli altri push falliti sono stati ripetuti */
+	if (torn || order || (lost != dropped) || (received + dropped != total) || (ring.overruns < dropped))
+	{
+		printf("FALLITO\n");
+		return 1;
+	}
+	printf("OK\n");
+
+	return 0;
+
+} /* Fine main() */
+
+/*******************************************************************************
+* Nome funzione     : producer
+* Descrizione  	    : Accoda total campioni numerati, senza attese
+*******************************************************************************/
+static void *producer(void *arg)
+{
+	IMU_sample_struct s;
+	uint32_t seq;
+	int k;
+
+	(void)arg;
+	for (seq = 0; seq < total; seq++)
+	{
+		s.timestamp = seq;
+		s.sensor = (uint8_t)seq;
+		for (k = 0; k < 3; k++)
+		{
+			s.raw.accel[k] = (int16_t)(seq + k);
+			s.raw.gyro[k]  = (int16_t)(seq + 3 + k);
+		}
+		s.raw.temp = (int16_t)(seq >> 16);
+
+		/* A coda piena lascia spazio al consumatore, ma ogni tanto perde il campione
+		 per provare anche gli overrun */
+		if (!IMU_ring_push(&ring, &s))
+		{
+			if (0 == (seq & 0x0F)) {
+				dropped++;
+				continue;
+			}
+			while (!IMU_ring_push(&ring, &s)) {
+				sched_yield();
+			}
+		}
+	}
+	done = 1;
+
+	return 0;
+
+} /* Fine producer() */
+
+/*******************************************************************************
+* Nome funzione     : sample_ok
+* Descrizione  	    : Verifica che tutti i campi vengano dallo stesso campione
+*******************************************************************************/
+static int sample_ok(const IMU_sample_struct *s)
+{
+	uint32_t seq = s->timestamp;
+	int k;
+
+	if ((s->sensor != (uint8_t)seq) || (s->raw.temp != (int16_t)(seq >> 16))) {
+		return 0;
+	}
+	for (k = 0; k < 3; k++)
+	{
+		if ((s->raw.accel[k] != (int16_t)(seq + k)) || (s->raw.gyro[k] != (int16_t)(seq + 3 + k))) {
+			return 0;
+		}
+	}
+
+	return 1;
+
+} /* Fine sample_ok() */
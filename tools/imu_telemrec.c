@@ -0,0 +1,987 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Strumento host: registra e decodifica la telemetria di src/IMU_telem.c
+*   - legge dalla seriale (configurata a IMU_TELEM_BAUD, 8N1, modo raw), da un
+*     file registrato o da stdin, un byte alla volta con memoria costante:
+*     anche le registrazioni di ore passano senza crescere
+*   - salva i byte ricevuti cosi' come sono (-w), per rieseguirli in seguito
+*   - scrive i frame di stato validi in CSV (-o) e/o un file binario per
+*     canale (-c): <prefisso>_<canale>.f64, valori double little-endian, un
+*     elemento per frame (in numpy: np.fromfile(nome, '<f8'))
+*   - scrive in CSV (-b) i campioni della scatola nera letti da IMU_bbox_dump
+*   - decomprime i frame dei campioni grezzi (IMU_telem_send_samples) e li
+*     scrive in CSV (-a), uno per riga con il sensore; dopo un frame dei
+*     campioni perso attende il keyframe di ogni sensore (IMU_pack_resync)
+*   - conta le risposte ai comandi (IMU_TELEM_PARAM, tools/imu_param.c)
+*   - espande i messaggi del registro differito (IMU_TELEM_LOG, src/IMU_log.c)
+*     con i formati di src/IMU_log_msg.h e li scrive come testo (-g, "-" per
+*     stdout): istante in ms e, tra messaggi vicini, la distanza in us
+*   - conta frame validi, errori di CRC e di lunghezza, frame persi (buchi
+*     nel numero di sequenza, sul collegamento o scartati dal firmware con
+*     entrambi i buffer occupati); riassume periodo e durata del ciclo e, dalla
+*     seriale, la latenza di arrivo rispetto all'istante del firmware (al
+*     netto della minima, perche' gli orologi non sono allineati)
+*   - con IMU_USE_DMP scrive in CSV (-m) gli angoli e il ritardo dei
+*     quaternioni del DMP di ogni sensore; con -r anche l'assetto della
+*     fusione sull'MCU rieseguita, e alla fine lo scarto RMS tra i due
+*   - con -r riesegue i campioni grezzi nella catena del firmware (src/IMU.c
+*     con calibrazione, filtro, bias e voting) su MPU-6050 simulati: ogni
+*     frame viene scritto nei registri dei dati dei sensori simulati e segue
+*     una chiamata a IMU_result. Il CSV riceve anche l'assetto rieseguito e
+*     alla fine si stampa lo scarto RMS da quello registrato: cambiando il
+*     filtro (-f, -s, -q, o IMU_FILTER_CONFIG in main.h) si valuta l'effetto
+*     sui dati veri del robot. La calibrazione all'avvio vede il primo
+*     campione ripetuto; la temperatura non e' nel frame e resta a 36.5 C.
+*     I frame arrivano gia' decimati, quindi la riesecuzione non usa la FIFO
+*
+* Compilazione (dalla cartella tools):
+*   gcc -O2 -Ihost -I../src -I../r_riic_rx600 -I../r_riic_rx600/src
+*       -I../r_bsp/mcu/rx63n -I../r_bsp/board/rdkrx63n -o imu_telemrec
+*       imu_telemrec.c host/mpu6050_sim.c ../src/IMU*.c -lm
+* Uso:          ./imu_telemrec [-d /dev/ttyUSB0 | file | -] [-w cattura.bin]
+*                              [-o frame.csv] [-c prefisso] [-b scatola.csv]
+*                              [-a campioni.csv] [-g registro.txt] [-r hz]
+*                              [-f taglio_hz] [-s stadi] [-q notch_q] [-m dmp.csv]
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "platform.h"
+#include "CMT.h"
+#include "IMU.h"
+#include "IMU_telem.h"
+#include "IMU_log.h"
+#include "mpu6050_sim.h"
+#include <termios.h>		/* dopo iodefine.h: definisce B0, nome di campo dei registri */
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define COUNT_US		((double)CMT_COUNTER_CYCLES * 1e6 / ICLK_HZ)	/* us per unita' di CMT_counter */
+#define NUM_RAW			(IMU_NUM_SENSORS * 6)
+#define NUM_COLS		(5 + NUM_RAW + 6)
+#define NUM_REPLAY		6
+#define REG_RAW_ACCEL	0x3B
+
+/*******************************************************************************
+Definizione strutture
+*******************************************************************************/
+/* Frame decodificato */
+typedef struct
+{
+	uint8_t  type;
+	uint8_t  sensors;
+	uint16_t seq;
+	uint32_t timestamp;
+	uint16_t work;
+	uint16_t period;
+	int16_t  raw[IMU_NUM_SENSORS][6];
+	float    angle[3];
+	float    omega[3];
+#if IMU_USE_DMP
+	uint16_t dmp_latency[IMU_NUM_SENSORS];		/* IMU_TELEM_DMP_INVALID: nessun quaternione */
+	float    dmp_angle[IMU_NUM_SENSORS][3];
+#endif
+
+} frame_struct;
+
+/* Minimo, massimo e momenti di una grandezza */
+typedef struct
+{
+	double min, max, sum, sumsq;
+	uint64_t n;
+
+} stat_struct;
+
+/*******************************************************************************
+Variabili globali
+*******************************************************************************/
+static const char * const col_name[NUM_COLS] = {
+	"t_ms", "seq", "sensors", "work_us", "period_us",
+#if IMU_NUM_SENSORS > 0
+	"a0x", "a0y", "a0z", "g0x", "g0y", "g0z",
+#endif
+#if IMU_NUM_SENSORS > 1
+	"a1x", "a1y", "a1z", "g1x", "g1y", "g1z",
+#endif
+	"roll", "pitch", "yaw", "wx", "wy", "wz"
+};
+static const char * const replay_name[NUM_REPLAY] = {"r_roll", "r_pitch", "r_yaw", "r_wx", "r_wy", "r_wz"};
+
+/* Formati dei messaggi del registro, nell'ordine degli identificativi */
+#define IMU_LOG_MSG(id, fmt)	fmt,
+static const char * const log_fmt[NUM_IMU_LOG] = {
+	"messaggio nullo",
+#include "IMU_log_msg.h"
+};
+#undef IMU_LOG_MSG
+
+static FILE *csv, *capture, *bbox_csv, *samples_csv, *log_txt, *dmp_csv;
+static FILE *column[NUM_COLS + NUM_REPLAY];
+static int replay_hz;
+static IMU_filter_config_struct filter = IMU_FILTER_CONFIG;
+
+static IMU_dev_struct dev[IMU_NUM_SENSORS];
+static IMU_data_struct fused;
+static bool replay_started;
+static uint32_t replay_last_ms;
+static double replay_sq[NUM_REPLAY];
+static double dmp_sq[3];
+static uint64_t dmp_n;
+
+static uint64_t frames, bbox_frames, crc_errors, len_errors, lost, overflows;
+static IMU_pack_struct pack;
+static bool have_samples_seq;
+static uint16_t last_samples_seq;
+static uint64_t param_frames;
+static uint64_t log_frames, log_records, log_errors;
+static uint32_t log_drops, log_last_ms;
+static uint16_t log_last_count;
+static bool have_log;
+static uint64_t samples_frames, samples, samples_skipped, samples_bytes, samples_errors;
+static bool have_seq;
+static uint16_t last_seq;
+static stat_struct period_us, work_us, latency_ms;
+static double latency_min = 1e300;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static int open_input (const char *path, bool tty);
+static void feed (uint8_t c, double host_ms);
+static int cobs_decode (const uint8_t *in, int n, uint8_t *out, int max);
+static void parse (const uint8_t *p, frame_struct *f);
+static void handle (const frame_struct *f, double host_ms);
+static void bbox (const uint8_t *p);
+static void unpack (const uint8_t *p, int n);
+static void log_frame (const uint8_t *p);
+static void log_print (FILE *out, const char *fmt, const uint32_t *arg, int n);
+static void replay (const frame_struct *f, float *out);
+static void stat_add (stat_struct *s, double v);
+static void stat_print (const char *name, const stat_struct *s, const char *unit);
+static double now_ms (void);
+static void usage (void);
+
+/*******************************************************************************
+* Funzioni della scheda non presenti sull'host
+*******************************************************************************/
+void lcd_display(uint8_t line, const uint8_t *text)
+{
+	(void)line;
+	(void)text;
+}
+
+/*******************************************************************************
+* Nome funzione     : main
+*******************************************************************************/
+int main(int argc, char **argv)
+{
+	const char *in_path = "-", *prefix = 0;
+	char name[512];
+	uint8_t buf[4096];
+	bool tty = false;
+	ssize_t n, i;
+	int fd, opt, k;
+
+	while ((opt = getopt(argc, argv, "d:w:o:c:b:a:g:r:f:s:q:m:h")) != -1)
+	{
+		switch (opt)
+		{
+			case 'd': in_path = optarg; tty = true; break;
+			case 'w': capture = fopen(optarg, "wb"); if (!capture) { perror(optarg); return 1; } break;
+			case 'o': csv = fopen(optarg, "w"); if (!csv) { perror(optarg); return 1; } break;
+			case 'c': prefix = optarg; break;
+			case 'b': bbox_csv = fopen(optarg, "w"); if (!bbox_csv) { perror(optarg); return 1; } break;
+			case 'a': samples_csv = fopen(optarg, "w"); if (!samples_csv) { perror(optarg); return 1; } break;
+			case 'g': log_txt = strcmp(optarg, "-") ? fopen(optarg, "w") : stdout; if (!log_txt) { perror(optarg); return 1; } break;
+			case 'r': replay_hz = atoi(optarg); break;
+			case 'f': filter.lowpass_hz = (float)atof(optarg); break;
+			case 's': filter.lowpass_stages = (uint8_t)atoi(optarg); break;
+			case 'q': filter.notch_q = (float)atof(optarg); break;
+			case 'm': dmp_csv = fopen(optarg, "w"); if (!dmp_csv) { perror(optarg); return 1; } break;
+			default: usage(); return 1;
+		}
+	}
+	if (optind < argc) {
+		in_path = argv[optind];
+	}
+	if ((replay_hz < 0) || (replay_hz > INV_MPU6050_ONE_K_HZ)) {
+		usage();
+		return 1;
+	}
+
+	fd = open_input(in_path, tty);
+	if (fd < 0) {
+		return 1;
+	}
+
+	if (csv)
+	{
+		for (k = 0; k < NUM_COLS; k++) {
+			fprintf(csv, "%s%s", k ? "," : "", col_name[k]);
+		}
+		for (k = 0; replay_hz && (k < NUM_REPLAY); k++) {
+			fprintf(csv, ",%s", replay_name[k]);
+		}
+		fputc('\n', csv);
+	}
+
+	if (bbox_csv) {
+		fprintf(bbox_csv, "number,trigger,index,count,t_ms,roll,pitch,yaw,wx,wy,wz,ax,ay,az,c0,c1,c2,work_us,sensors,flags\n");
+	}
+
+	if (samples_csv) {
+		fprintf(samples_csv, "t_ms,sensor,key,ax,ay,az,temp,gx,gy,gz\n");
+	}
+
+	if (dmp_csv)
+	{
+#if !IMU_USE_DMP
+		fprintf(stderr, "firmware senza DMP (IMU_USE_DMP in main.h): -m non produce righe\n");
+#endif
+		fprintf(dmp_csv, "t_ms,sensor,latency_ms,roll,pitch,yaw%s\n", replay_hz ? ",r_roll,r_pitch,r_yaw" : "");
+	}
+	IMU_pack_init(&pack, IMU_TELEM_SAMPLES_CHANNELS, IMU_NUM_SENSORS, IMU_PACK_KEY_INTERVAL);
+
+	for (k = 0; prefix && (k < NUM_COLS + (replay_hz ? NUM_REPLAY : 0)); k++)
+	{
+		snprintf(name, sizeof(name), "%s_%s.f64", prefix,
+				 (k < NUM_COLS) ? col_name[k] : replay_name[k - NUM_COLS]);
+		column[k] = fopen(name, "wb");
+		if (!column[k]) {
+			perror(name);
+			return 1;
+		}
+	}
+
+	/* Un blocco alla volta: la memoria non dipende dalla durata */
+	while ((n = read(fd, buf, sizeof(buf))) > 0)
+	{
+		double t = now_ms();
+		if (capture) {
+			fwrite(buf, 1, (size_t)n, capture);
+		}
+		for (i = 0; i < n; i++) {
+			feed(buf[i], t);
+		}
+	}
+
+	fprintf(stderr, "frame validi      %llu\n", (unsigned long long)frames);
+	if (bbox_frames) {
+		fprintf(stderr, "scatola nera      %llu campioni\n", (unsigned long long)bbox_frames);
+	}
+	if (samples_frames)
+	{
+		fprintf(stderr, "campioni grezzi   %llu in %llu frame, %.2f byte/campione (%.2fx), "
+				"%llu scartati in attesa di keyframe, %llu errori\n",
+				(unsigned long long)samples, (unsigned long long)samples_frames,
+				samples ? (double)samples_bytes / samples : 0.0,
+				samples_bytes ? (double)samples * (4 + 2 * IMU_TELEM_SAMPLES_CHANNELS) / samples_bytes : 0.0,
+				(unsigned long long)samples_skipped, (unsigned long long)samples_errors);
+	}
+	if (param_frames) {
+		fprintf(stderr, "risposte comandi  %llu\n", (unsigned long long)param_frames);
+	}
+	if (log_frames)
+	{
+		fprintf(stderr, "registro          %llu messaggi in %llu frame, %lu scartati dal firmware, %llu errori\n",
+				(unsigned long long)log_records, (unsigned long long)log_frames,
+				(unsigned long)log_drops, (unsigned long long)log_errors);
+	}
+	fprintf(stderr, "frame persi       %llu (%.3f%%)\n", (unsigned long long)lost,
+			(frames + bbox_frames + samples_frames + param_frames + log_frames + lost) ?
+			100.0 * lost / (frames + bbox_frames + samples_frames + param_frames + log_frames + lost) : 0.0);
+	fprintf(stderr, "errori CRC        %llu\n", (unsigned long long)crc_errors);
+	fprintf(stderr, "errori lunghezza  %llu (troppo lunghi: %llu)\n",
+			(unsigned long long)len_errors, (unsigned long long)overflows);
+	stat_print("periodo", &period_us, "us");
+	stat_print("elaborazione", &work_us, "us");
+	if (tty) {
+		stat_print("latenza", &latency_ms, "ms");
+	}
+	for (k = 0; replay_hz && frames && (k < NUM_REPLAY); k++) {
+		fprintf(stderr, "scarto RMS %-7s %.6g\n", col_name[NUM_COLS - NUM_REPLAY + k] , sqrt(replay_sq[k] / frames));
+	}
+	for (k = 0; dmp_n && (k < 3); k++) {
+		fprintf(stderr, "DMP - MCU  %-7s %.6g (RMS su %llu quaternioni)\n", col_name[NUM_COLS - NUM_REPLAY + k],
+				sqrt(dmp_sq[k] / dmp_n), (unsigned long long)dmp_n);
+	}
+
+	if (csv) {
+		fclose(csv);
+	}
+	if (bbox_csv) {
+		fclose(bbox_csv);
+	}
+	if (samples_csv) {
+		fclose(samples_csv);
+	}
+	if (dmp_csv) {
+		fclose(dmp_csv);
+	}
+	if (log_txt && (stdout != log_txt)) {
+		fclose(log_txt);
+	}
+	if (capture) {
+		fclose(capture);
+	}
+	for (k = 0; k < NUM_COLS + NUM_REPLAY; k++)
+	{
+		if (column[k]) {
+			fclose(column[k]);
+		}
+	}
+
+	return (frames + bbox_frames + samples_frames > 0) ? 0 : 2;
+
+} /* Fine main() */
+
+/*******************************************************************************
+* Nome funzione     : open_input
+* Descrizione  	    : Apre l'ingresso; la seriale in modo raw alla velocita'
+* 					  della telemetria
+*******************************************************************************/
+static int open_input(const char *path, bool tty)
+{
+	struct termios tio;
+	int fd;
+
+	if (0 == strcmp(path, "-")) {
+		return STDIN_FILENO;
+	}
+
+	fd = open(path, O_RDONLY | O_NOCTTY);
+	if (fd < 0)
+	{
+		perror(path);
+		return -1;
+	}
+
+	if (tty)
+	{
+		if (tcgetattr(fd, &tio) < 0)
+		{
+			perror(path);
+			close(fd);
+			return -1;
+		}
+		cfmakeraw(&tio);
+		tio.c_cflag |= CLOCAL | CREAD;
+		tio.c_cc[VMIN] = 1;
+		tio.c_cc[VTIME] = 0;
+		cfsetispeed(&tio, B1500000);
+		cfsetospeed(&tio, B1500000);
+		if (tcsetattr(fd, TCSANOW, &tio) < 0)
+		{
+			perror(path);
+			close(fd);
+			return -1;
+		}
+		tcflush(fd, TCIFLUSH);
+	}
+
+	return fd;
+
+} /* Fine open_input() */
+
+/*******************************************************************************
+* Nome funzione     : feed
+* Descrizione  	    : Accumula un byte; lo zero chiude il frame. Un frame piu'
+* 					  lungo del massimo viene scartato fino al prossimo zero.
+* 					  I frame dei campioni e del registro hanno lunghezza
+* 					  variabile, quelli di risposta IMU_TELEM_PARAM_PAYLOAD,
+* 					  gli altri IMU_TELEM_FRAME
+*******************************************************************************/
+static void feed(uint8_t c, double host_ms)
+{
+	static uint8_t enc[IMU_TELEM_ENCODED];
+	static int len;
+	static bool too_long;
+	uint8_t dec[IMU_TELEM_ENCODED];
+	frame_struct f;
+	uint16_t crc, seq;
+	int n;
+
+	if (0 != c)
+	{
+		if (len < (int)sizeof(enc)) {
+			enc[len++] = c;
+		}
+		else {
+			too_long = true;
+		}
+		return;
+	}
+
+	/* Zeri consecutivi: nessun frame */
+	if ((0 == len) && !too_long) {
+		return;
+	}
+
+	n = too_long ? -1 : cobs_decode(enc, len, dec, sizeof(dec));
+	if (too_long) {
+		overflows++;
+	}
+	len = 0;
+	too_long = false;
+
+	if ((n < IMU_TELEM_SAMPLES_HEADER + 2) ||
+		((IMU_TELEM_SAMPLES == dec[0]) ? (n > IMU_TELEM_SAMPLES_PAYLOAD + 2) :
+		 (IMU_TELEM_PARAM == dec[0]) ? (n != IMU_TELEM_PARAM_PAYLOAD + 2) :
+		 (IMU_TELEM_LOG == dec[0]) ? ((n < IMU_TELEM_LOG_HEADER + 2) || (n != IMU_TELEM_LOG_HEADER + 4 * dec[1] + 2)) :
+		 (n != IMU_TELEM_FRAME)))
+	{
+		len_errors++;
+		return;
+	}
+
+	crc = (uint16_t)(dec[n - 2] | (dec[n - 1] << 8));
+	if (crc != IMU_telem_crc16(dec, (uint16_t)(n - 2), IMU_TELEM_CRC_INIT))
+	{
+		crc_errors++;
+		return;
+	}
+
+	/* Numero di frame comune a tutti i tipi */
+	seq = (uint16_t)(dec[2] | (dec[3] << 8));
+	if (have_seq) {
+		lost += (uint16_t)(seq - last_seq - 1);
+	}
+	have_seq = true;
+	last_seq = seq;
+
+	if (IMU_TELEM_BBOX == dec[0])
+	{
+		bbox(dec);
+		return;
+	}
+	if (IMU_TELEM_SAMPLES == dec[0])
+	{
+		unpack(dec, n - 2);
+		return;
+	}
+	if (IMU_TELEM_PARAM == dec[0])
+	{
+		param_frames++;
+		return;
+	}
+	if (IMU_TELEM_LOG == dec[0])
+	{
+		log_frame(dec);
+		return;
+	}
+
+	parse(dec, &f);
+	if (IMU_TELEM_STATE != f.type)
+	{
+		len_errors++;
+		return;
+	}
+
+	handle(&f, host_ms);
+
+} /* Fine feed() */
+
+/*******************************************************************************
+* Nome funzione     : cobs_decode
+* Descrizione  	    : Inverso di IMU_telem_cobs; -1 se il frame e' malformato
+*******************************************************************************/
+static int cobs_decode(const uint8_t *in, int n, uint8_t *out, int max)
+{
+	int i = 0, o = 0, k, code;
+
+	while (i < n)
+	{
+		code = in[i++];
+		for (k = 1; k < code; k++)
+		{
+			if ((i >= n) || (o >= max)) {
+				return -1;
+			}
+			out[o++] = in[i++];
+		}
+		if ((code < 0xFF) && (i < n))
+		{
+			if (o >= max) {
+				return -1;
+			}
+			out[o++] = 0;
+		}
+	}
+
+	return o;
+
+} /* Fine cobs_decode() */
+
+/*******************************************************************************
+* Nome funzione     : parse
+* Descrizione  	    : Campi del frame (formato in src/IMU_telem.c)
+*******************************************************************************/
+static void parse(const uint8_t *p, frame_struct *f)
+{
+	int i, k;
+
+	f->type      = p[0];
+	f->sensors   = p[1];
+	f->seq       = (uint16_t)(p[2] | (p[3] << 8));
+	f->timestamp = (uint32_t)p[4] | ((uint32_t)p[5] << 8) | ((uint32_t)p[6] << 16) | ((uint32_t)p[7] << 24);
+	f->work      = (uint16_t)(p[8] | (p[9] << 8));
+	f->period    = (uint16_t)(p[10] | (p[11] << 8));
+	p += IMU_TELEM_HEADER;
+
+	for (i = 0; i < IMU_NUM_SENSORS; i++)
+	{
+		for (k = 0; k < 6; k++, p += 2) {
+			f->raw[i][k] = (int16_t)(p[0] | (p[1] << 8));
+		}
+	}
+
+	memcpy(f->angle, p, sizeof(f->angle));
+	memcpy(f->omega, p + sizeof(f->angle), sizeof(f->omega));
+#if IMU_USE_DMP
+	p += sizeof(f->angle) + sizeof(f->omega);
+
+	for (i = 0; i < IMU_NUM_SENSORS; i++, p += 2 + sizeof(f->dmp_angle[i]))
+	{
+		f->dmp_latency[i] = (uint16_t)(p[0] | (p[1] << 8));
+		memcpy(f->dmp_angle[i], p + 2, sizeof(f->dmp_angle[i]));
+	}
+#endif
+
+} /* Fine parse() */
+
+/*******************************************************************************
+* Nome funzione     : handle
+* Descrizione  	    : Statistiche e uscite di un frame valido
+*******************************************************************************/
+static void handle(const frame_struct *f, double host_ms)
+{
+	double col[NUM_COLS + NUM_REPLAY];
+	float r[NUM_REPLAY];
+	int i, k, n = 0, ncol;
+
+	frames++;
+
+	/* Il primo periodo misura dall'avvio della telemetria */
+	if (frames > 1) {
+		stat_add(&period_us, f->period * COUNT_US);
+	}
+	stat_add(&work_us, f->work * COUNT_US);
+	if (host_ms - f->timestamp < latency_min) {
+		latency_min = host_ms - f->timestamp;
+	}
+	stat_add(&latency_ms, host_ms - f->timestamp);
+
+	col[n++] = f->timestamp;
+	col[n++] = f->seq;
+	col[n++] = f->sensors;
+	col[n++] = f->work * COUNT_US;
+	col[n++] = f->period * COUNT_US;
+	for (i = 0; i < IMU_NUM_SENSORS; i++)
+	{
+		for (k = 0; k < 6; k++) {
+			col[n++] = f->raw[i][k];
+		}
+	}
+	for (k = 0; k < 3; k++) {
+		col[n++] = f->angle[k];
+	}
+	for (k = 0; k < 3; k++) {
+		col[n++] = f->omega[k];
+	}
+
+	if (replay_hz)
+	{
+		replay(f, r);
+		for (k = 0; k < NUM_REPLAY; k++)
+		{
+			col[n++] = r[k];
+			replay_sq[k] += (r[k] - col[NUM_COLS - NUM_REPLAY + k]) * (r[k] - col[NUM_COLS - NUM_REPLAY + k]);
+		}
+	}
+	ncol = n;
+
+	if (csv)
+	{
+		fprintf(csv, "%.0f,%.0f,%.0f,%.2f,%.2f", col[0], col[1], col[2], col[3], col[4]);
+		for (k = 5; k < 5 + NUM_RAW; k++) {
+			fprintf(csv, ",%.0f", col[k]);
+		}
+		for (; k < ncol; k++) {
+			fprintf(csv, ",%.7g", col[k]);
+		}
+		fputc('\n', csv);
+	}
+
+	for (k = 0; k < ncol; k++)
+	{
+		if (column[k]) {
+			fwrite(&col[k], sizeof(double), 1, column[k]);
+		}
+	}
+
+#if IMU_USE_DMP
+	/* Quaternioni del DMP; con -r confrontati con la fusione sull'MCU */
+	for (i = 0; i < IMU_NUM_SENSORS; i++)
+	{
+		if (IMU_TELEM_DMP_INVALID == f->dmp_latency[i]) {
+			continue;
+		}
+		if (replay_hz)
+		{
+			for (k = 0; k < 3; k++) {
+				dmp_sq[k] += (f->dmp_angle[i][k] - r[k]) * (f->dmp_angle[i][k] - r[k]);
+			}
+			dmp_n++;
+		}
+		if (dmp_csv)
+		{
+			fprintf(dmp_csv, "%lu,%d,%u,%.7g,%.7g,%.7g", (unsigned long)f->timestamp, i, f->dmp_latency[i],
+					f->dmp_angle[i][0], f->dmp_angle[i][1], f->dmp_angle[i][2]);
+			if (replay_hz) {
+				fprintf(dmp_csv, ",%.7g,%.7g,%.7g", r[0], r[1], r[2]);
+			}
+			fputc('\n', dmp_csv);
+		}
+	}
+#endif
+
+} /* Fine handle() */
+
+/*******************************************************************************
+* Nome funzione     : bbox
+* Descrizione  	    : Campione della scatola nera (IMU_telem_send_bbox), una
+* 					  riga del CSV con le grandezze in unita' SI
+*******************************************************************************/
+static void bbox(const uint8_t *p)
+{
+	const uint8_t *r = p + IMU_TELEM_HEADER;
+	int16_t v[12];
+	int k;
+
+	bbox_frames++;
+	if (!bbox_csv) {
+		return;
+	}
+
+	for (k = 0; k < 12; k++) {
+		v[k] = (int16_t)(r[4 + 2 * k] | (r[5 + 2 * k] << 8));
+	}
+
+	fprintf(bbox_csv, "%u,%u,%u,%u,%u",
+			(unsigned)(p[4] | (p[5] << 8) | (p[6] << 16) | ((uint32_t)p[7] << 24)), p[1],
+			(unsigned)(p[8] | (p[9] << 8)), (unsigned)(p[10] | (p[11] << 8)),
+			(unsigned)(r[0] | (r[1] << 8) | (r[2] << 16) | ((uint32_t)r[3] << 24)));
+	for (k = 0; k < 3; k++) {
+		fprintf(bbox_csv, ",%.4f", v[k] / IMU_BBOX_ANGLE_SCALE);
+	}
+	for (k = 3; k < 6; k++) {
+		fprintf(bbox_csv, ",%.3f", v[k] / IMU_BBOX_OMEGA_SCALE);
+	}
+	for (k = 6; k < 12; k++) {
+		fprintf(bbox_csv, ",%d", v[k]);
+	}
+	fprintf(bbox_csv, ",%.2f,%u,%u\n", (r[28] | (r[29] << 8)) * COUNT_US, r[30], r[31]);
+
+} /* Fine bbox() */
+
+/*******************************************************************************
+* Nome funzione     : unpack
+* Descrizione  	    : Frame dei campioni compressi. Un buco nel numero dei
+* 					  frame dei campioni fa perdere i riferimenti delle
+* 					  differenze: si attende il keyframe di ogni sensore
+*******************************************************************************/
+static void unpack(const uint8_t *p, int n)
+{
+	IMU_pack_sample_struct s;
+	uint16_t seq = (uint16_t)(p[4] | (p[5] << 8));
+	int pos = IMU_TELEM_SAMPLES_HEADER, used, e, k;
+
+	samples_frames++;
+	if (have_samples_seq && ((uint16_t)(last_samples_seq + 1) != seq)) {
+		IMU_pack_resync(&pack);
+	}
+	have_samples_seq = true;
+	last_samples_seq = seq;
+	samples_bytes += (uint64_t)(n - IMU_TELEM_SAMPLES_HEADER);
+
+	for (e = 0; e < p[1]; e++)
+	{
+		used = IMU_pack_decode(&pack, p + pos, (uint16_t)(n - pos), &s);
+		if (0 == used)
+		{
+			/* Il resto del frame non e' decodificabile */
+			samples_errors++;
+			IMU_pack_resync(&pack);
+			return;
+		}
+		pos += used;
+
+		if (!s.valid)
+		{
+			samples_skipped++;
+			continue;
+		}
+		samples++;
+		if (samples_csv)
+		{
+			fprintf(samples_csv, "%u,%u,%d", (unsigned)s.timestamp, s.stream, s.key);
+			for (k = 0; k < IMU_TELEM_SAMPLES_CHANNELS; k++) {
+				fprintf(samples_csv, ",%d", s.v[k]);
+			}
+			fputc('\n', samples_csv);
+		}
+	}
+	if (pos != n) {
+		samples_errors++;
+	}
+
+} /* Fine unpack() */
+
+/*******************************************************************************
+* Nome funzione     : log_frame
+* Descrizione  	    : Frame del registro: ogni messaggio con l'istante e,
+* 					  se il precedente e' a meno di 5 ms, la distanza
+* 					  misurata con CMT_counter
+*******************************************************************************/
+static void log_frame(const uint8_t *p)
+{
+	uint32_t w[IMU_TELEM_LOG_WORDS];
+	int words = p[1], pos, k, args;
+	uint16_t id;
+
+	log_frames++;
+	log_drops = (uint32_t)p[4] | ((uint32_t)p[5] << 8) | ((uint32_t)p[6] << 16) | ((uint32_t)p[7] << 24);
+	for (k = 0; (k < words) && (k < IMU_TELEM_LOG_WORDS); k++)
+	{
+		pos = IMU_TELEM_LOG_HEADER + 4 * k;
+		w[k] = (uint32_t)p[pos] | ((uint32_t)p[pos + 1] << 8) | ((uint32_t)p[pos + 2] << 16) | ((uint32_t)p[pos + 3] << 24);
+	}
+
+	for (pos = 0; pos < words; pos += 2 + args)
+	{
+		args = IMU_LOG_HDR_ARGS(w[pos]);
+		id = IMU_LOG_HDR_ID(w[pos]);
+		if ((pos + 2 + args > words) || (0 == id) || (id >= NUM_IMU_LOG))
+		{
+			log_errors++;
+			return;
+		}
+		log_records++;
+		if (!log_txt) {
+			continue;
+		}
+
+		if (have_log && (w[pos + 1] - log_last_ms <= 5)) {
+			fprintf(log_txt, "%10lu (+%8.1f us) ", (unsigned long)w[pos + 1],
+					(int16_t)(IMU_LOG_HDR_COUNT(w[pos]) - log_last_count) * COUNT_US);
+		}
+		else {
+			fprintf(log_txt, "%10lu               ", (unsigned long)w[pos + 1]);
+		}
+		log_print(log_txt, log_fmt[id], &w[pos + 2], args);
+		fputc('\n', log_txt);
+
+		have_log = true;
+		log_last_ms = w[pos + 1];
+		log_last_count = IMU_LOG_HDR_COUNT(w[pos]);
+	}
+
+} /* Fine log_frame() */
+
+/*******************************************************************************
+* Nome funzione     : log_print
+* Descrizione  	    : Espande un formato con gli argomenti grezzi: interi per
+* 					  d i u x X c, bit di un float per f g e (senza
+* 					  modificatori di lunghezza)
+*******************************************************************************/
+static void log_print(FILE *out, const char *fmt, const uint32_t *arg, int n)
+{
+	IMU_log_word_u v;
+	char spec[32];
+	const char *q;
+	int k = 0;
+
+	while (*fmt)
+	{
+		if ('%' != *fmt)
+		{
+			fputc(*fmt++, out);
+			continue;
+		}
+		if ('%' == fmt[1])
+		{
+			fputc('%', out);
+			fmt += 2;
+			continue;
+		}
+
+		for (q = fmt + 1; *q && !strchr("diuxXcfgeEG", *q); q++);
+		if (!*q || (q - fmt + 2 > (int)sizeof(spec)))
+		{
+			fputs(fmt, out);
+			return;
+		}
+		memcpy(spec, fmt, (size_t)(q - fmt + 1));
+		spec[q - fmt + 1] = 0;
+		v.u = (k < n) ? arg[k] : 0;
+		k++;
+
+		if (strchr("fgeEG", *q)) {
+			fprintf(out, spec, (double)v.f);
+		}
+		else if (('d' == *q) || ('i' == *q)) {
+			fprintf(out, spec, (int)(int32_t)v.u);
+		}
+		else {
+			fprintf(out, spec, (unsigned)v.u);
+		}
+		fmt = q + 1;
+	}
+
+} /* Fine log_print() */
+
+/*******************************************************************************
+* Nome funzione     : replay
+* Descrizione  	    : Scrive i campioni del frame nei sensori simulati e
+* 					  riesegue IMU_result. Alla prima chiamata configura e
+* 					  inizializza i sensori come main.c, con lettura diretta
+* 					  dei registri alla frequenza dei frame
+*******************************************************************************/
+static void replay(const frame_struct *f, float *out)
+{
+	uint8_t *regs;
+	int i, k;
+
+	/* Registri dei dati: accelerometro, temperatura (0), giroscopio, big-endian */
+	for (i = 0; i < IMU_NUM_SENSORS; i++)
+	{
+		regs = &mpu6050_sim[i].regs[REG_RAW_ACCEL];
+		for (k = 0; k < 3; k++)
+		{
+			regs[2 * k]     = (uint8_t)((uint16_t)f->raw[i][k] >> 8);
+			regs[2 * k + 1] = (uint8_t)f->raw[i][k];
+			regs[8 + 2 * k] = (uint8_t)((uint16_t)f->raw[i][3 + k] >> 8);
+			regs[9 + 2 * k] = (uint8_t)f->raw[i][3 + k];
+		}
+	}
+
+	if (!replay_started)
+	{
+		mpu6050_sim_reset();
+		for (i = 0; i < IMU_NUM_SENSORS; i++)
+		{
+			memset(&dev[i], 0, sizeof(dev[i]));
+			dev[i].channel = CHANNEL_0;
+			dev[i].slave_address = (0 == i) ? IMU_ADDRESS_AD0_LOW : IMU_ADDRESS_AD0_HIGH;
+			dev[i].config.accel_fs = INV_MPU6050_FS_02G;
+			dev[i].config.gyro_fs = INV_MPU6050_FSR_250DPS;
+			dev[i].config.dlpf = INV_MPU6050_FILTER_256HZ_NODLPF;
+			dev[i].config.rate_hz = (uint16_t)replay_hz;
+			dev[i].config.filter = filter;
+		}
+
+		/* Il reset dei sensori simulati azzera i registri: li riscrive */
+		replay_started = true;
+		replay(f, out);
+		replay_started = false;
+
+		IMU_init(dev, IMU_NUM_SENSORS);
+		replay_started = true;
+		replay_last_ms = f->timestamp;
+	}
+
+	/* Il tempo simulato segue quello del firmware */
+	ms_delay((int32_t)(f->timestamp - replay_last_ms));
+	replay_last_ms = f->timestamp;
+	IMU_result(dev, IMU_NUM_SENSORS, &fused);
+
+	for (k = 0; k < 3; k++)
+	{
+		out[k]     = fused.angle[k];
+		out[3 + k] = fused.omega[k];
+	}
+
+} /* Fine replay() */
+
+/*******************************************************************************
+* Nome funzione     : stat_add
+*******************************************************************************/
+static void stat_add(stat_struct *s, double v)
+{
+	if ((0 == s->n) || (v < s->min)) {
+		s->min = v;
+	}
+	if ((0 == s->n) || (v > s->max)) {
+		s->max = v;
+	}
+	s->sum += v;
+	s->sumsq += v * v;
+	s->n++;
+
+} /* Fine stat_add() */
+
+/*******************************************************************************
+* Nome funzione     : stat_print
+* Descrizione  	    : Minimo, media, massimo e deviazione standard; la latenza
+* 					  e' riferita al suo minimo
+*******************************************************************************/
+static void stat_print(const char *name, const stat_struct *s, const char *unit)
+{
+	double mean, sd, ref = (s == &latency_ms) ? latency_min : 0.0;
+
+	if (0 == s->n) {
+		return;
+	}
+	mean = s->sum / s->n;
+	sd = sqrt(fmax(s->sumsq / s->n - mean * mean, 0.0));
+	fprintf(stderr, "%-17s min %.2f  media %.2f  max %.2f  dev.st. %.2f %s\n",
+			name, s->min - ref, mean - ref, s->max - ref, sd, unit);
+
+} /* Fine stat_print() */
+
+/*******************************************************************************
+* Nome funzione     : now_ms
+* Descrizione  	    : Orologio monotono dell'host (ms)
+*******************************************************************************/
+static double now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+
+} /* Fine now_ms() */
+
+/*******************************************************************************
+* Nome funzione     : usage
+*******************************************************************************/
+static void usage(void)
+{
+	fprintf(stderr,
+			"uso: imu_telemrec [-d seriale | file | -] [-w cattura.bin] [-o frame.csv]\n"
+			"                  [-c prefisso] [-b scatola.csv] [-a campioni.csv] [-g registro.txt] [-r hz]\n"
+			"                  [-f taglio_hz] [-s stadi] [-q notch_q] [-m dmp.csv]\n"
+			"  -d  seriale a %d baud (altrimenti file registrato o stdin)\n"
+			"  -w  salva i byte ricevuti\n"
+			"  -o  frame in CSV\n"
+			"  -c  un file <prefisso>_<canale>.f64 per canale\n"
+			"  -b  campioni della scatola nera in CSV\n"
+			"  -a  campioni grezzi compressi, decompressi in CSV\n"
+			"  -g  messaggi del registro espansi in testo (- per stdout)\n"
+			"  -r  riesegue i campioni nel firmware alla frequenza dei frame (Hz)\n"
+			"  -f, -s, -q  passa basso e notch del filtro rieseguito\n"
+			"  -m  angoli e ritardo dei quaternioni del DMP in CSV (con IMU_USE_DMP)\n",
+			IMU_TELEM_BAUD);
+
+} /* Fine usage() */
@@ -0,0 +1,248 @@
+/* Authors: Alessandro Ciurlia, Human Mahdavidaronkola, Giacomo D'Amicantonio, Simone Marroncelli, Raffaele Berchicci */
+
+/*******************************************************************************
+* Strumento host: stima il modello del bias in temperatura di un sensore
+*
+* Ingresso (file o stdin): una riga CSV per campione, registrata con il robot
+* fermo mentre la scheda si scalda:
+*     temperatura_C, gx, gy, gz (grad/s), ax, ay, az (g)
+* Le righe che non iniziano con un numero vengono ignorate.
+* Per l'accelerometro si stima solo la variazione rispetto alla media, quindi
+* l'asse che vede la gravita' non viene falsato.
+*
+* Uscita: l'inizializzatore di IMU_tempmodel_struct da copiare in main.c.
+*
+* Compilazione: gcc -O2 -o imu_tempfit imu_tempfit.c -lm
+* Uso:          ./imu_tempfit [-r temp_rif] [log.csv]
+*******************************************************************************/
+
+/*******************************************************************************
+Includes: <System Includes> , "Project Includes"
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/*******************************************************************************
+Defines
+*******************************************************************************/
+#define ORDER		3				/* deve coincidere con IMU_TEMP_POLY_ORDER */
+#define NCOEF		(ORDER + 1)
+#define NCHAN		6
+
+/*******************************************************************************
+Definizione strutture
+*******************************************************************************/
+typedef struct
+{
+	double *t;
+	double *v[NCHAN];
+	size_t n, cap;
+
+} log_struct;
+
+/*******************************************************************************
+Prototipi funzioni
+*******************************************************************************/
+static void log_push (log_struct *log, const double *row);
+static int fit_poly (const double *t, const double *v, size_t n, double t0, double *coef);
+static int solve (double a[NCOEF][NCOEF], double *b, double *x);
+
+/*******************************************************************************
+* Nome funzione     : main
+*******************************************************************************/
+int main(int argc, char **argv)
+{
+	log_struct log = {0};
+	FILE *in = stdin;
+	char line[256];
+	double row[NCHAN + 1], t0 = 0.0, mean, coef[NCHAN][NCOEF];
+	int have_ref = 0, argi = 1;
+	size_t i;
+	int k, c;
+
+	if ((argi + 1 < argc) && (0 == strcmp(argv[argi], "-r")))
+	{
+		t0 = atof(argv[argi + 1]);
+		have_ref = 1;
+		argi += 2;
+	}
+	if (argi < argc)
+	{
+		in = fopen(argv[argi], "r");
+		if (!in)
+		{
+			perror(argv[argi]);
+			return 1;
+		}
+	}
+
+	/* Legge i campioni */
+	while (fgets(line, sizeof(line), in))
+	{
+		if (7 == sscanf(line, "%lf,%lf,%lf,%lf,%lf,%lf,%lf",
+						&row[0], &row[1], &row[2], &row[3], &row[4], &row[5], &row[6])) {
+			log_push(&log, row);
+		}
+	}
+
+	if (log.n < 10 * NCOEF)
+	{
+		fprintf(stderr, "servono almeno %d campioni, letti %lu\n", 10 * NCOEF, (unsigned long)log.n);
+		return 1;
+	}
+
+	/* Temperatura di riferimento: media del log, se non indicata */
+	if (!have_ref)
+	{
+		for (i = 0; i < log.n; i++) {
+			t0 += log.t[i];
+		}
+		t0 /= (double)log.n;
+	}
+
+	for (k = 0; k < NCHAN; k++)
+	{
+		if (fit_poly(log.t, log.v[k], log.n, t0, coef[k]))
+		{
+			fprintf(stderr, "sistema singolare: serve un intervallo di temperatura piu' ampio\n");
+			return 1;
+		}
+	}
+
+	/* L'accelerometro conserva solo la parte variabile (la costante e' gravita' + offset) */
+	for (k = 3; k < NCHAN; k++)
+	{
+		mean = 0.0;
+		for (i = 0; i < log.n; i++) {
+			mean += log.v[k][i];
+		}
+		coef[k][0] -= mean / (double)log.n;
+	}
+
+	printf("/* %lu campioni */\n", (unsigned long)log.n);
+	printf("{%.2ff,\n", t0);
+	for (k = 0; k < NCHAN; k++)
+	{
+		printf("%s", (0 == k) || (3 == k) ? " {" : "  ");
+		printf("{");
+		for (c = 0; c < NCOEF; c++) {
+			printf("%.6ef%s", coef[k][c], (c < NCOEF - 1) ? ", " : "");
+		}
+		printf("}%s\n", (2 == k) ? "}," : (5 == k) ? "}}" : ",");
+	}
+
+	return 0;
+
+} /* Fine main() */
+
+/*******************************************************************************
+* Nome funzione     : log_push
+* Descrizione  	    : Aggiunge un campione al log, allargando i vettori
+*******************************************************************************/
+static void log_push(log_struct *log, const double *row)
+{
+	int k;
+
+	if (log->n == log->cap)
+	{
+		log->cap = log->cap ? 2 * log->cap : 1024;
+		log->t = realloc(log->t, log->cap * sizeof(double));
+		for (k = 0; k < NCHAN; k++) {
+			log->v[k] = realloc(log->v[k], log->cap * sizeof(double));
+		}
+		if (!log->t)
+		{
+			fprintf(stderr, "memoria esaurita\n");
+			exit(1);
+		}
+	}
+
+	log->t[log->n] = row[0];
+	for (k = 0; k < NCHAN; k++) {
+		log->v[k][log->n] = row[k + 1];
+	}
+	log->n++;
+
+} /* Fine log_push() */
+
+/*******************************************************************************
+* Nome funzione     : fit_poly
+* Descrizione  	    : Minimi quadrati del polinomio in (t - t0) con le equazioni
+* 					  normali
+*******************************************************************************/
+static int fit_poly(const double *t, const double *v, size_t n, double t0, double *coef)
+{
+	double a[NCOEF][NCOEF] = {{0}}, b[NCOEF] = {0}, p[NCOEF];
+	size_t i;
+	int r, c;
+
+	for (i = 0; i < n; i++)
+	{
+		p[0] = 1.0;
+		for (c = 1; c < NCOEF; c++) {
+			p[c] = p[c - 1] * (t[i] - t0);
+		}
+		for (r = 0; r < NCOEF; r++)
+		{
+			b[r] += p[r] * v[i];
+			for (c = 0; c < NCOEF; c++) {
+				a[r][c] += p[r] * p[c];
+			}
+		}
+	}
+
+	return solve(a, b, coef);
+
+} /* Fine fit_poly() */
+
+/*******************************************************************************
+* Nome funzione     : solve
+* Descrizione  	    : Eliminazione di Gauss con pivot parziale
+*******************************************************************************/
+static int solve(double a[NCOEF][NCOEF], double *b, double *x)
+{
+	double f, tmp;
+	int r, c, k, piv;
+
+	for (k = 0; k < NCOEF; k++)
+	{
+		piv = k;
+		for (r = k + 1; r < NCOEF; r++)
+		{
+			if (fabs(a[r][k]) > fabs(a[piv][k])) {
+				piv = r;
+			}
+		}
+		if (fabs(a[piv][k]) < 1e-12) {
+			return 1;
+		}
+		for (c = 0; c < NCOEF; c++)
+		{
+			tmp = a[k][c]; a[k][c] = a[piv][c]; a[piv][c] = tmp;
+		}
+		tmp = b[k]; b[k] = b[piv]; b[piv] = tmp;
+
+		for (r = k + 1; r < NCOEF; r++)
+		{
+			f = a[r][k] / a[k][k];
+			for (c = k; c < NCOEF; c++) {
+				a[r][c] -= f * a[k][c];
+			}
+			b[r] -= f * b[k];
+		}
+	}
+
+	for (k = NCOEF - 1; k >= 0; k--)
+	{
+		x[k] = b[k];
+		for (c = k + 1; c < NCOEF; c++) {
+			x[k] -= a[k][c] * x[c];
+		}
+		x[k] /= a[k][k];
+	}
+
+	return 0;
+
+} /* Fine solve() */